@@ -0,0 +1,452 @@
+#ifndef ASSET_PACK_HPP
+#define ASSET_PACK_HPP
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+#include "mesh_simplify.hpp"
+#include "shader.hpp"
+
+// One file holding everything startup reads: shader text, the cylinder's LOD chains and
+// textures already decoded with their mip chains (the TextureCache entry layout). The
+// header is followed by an index sorted by name, then the blobs, each on a 64-byte
+// boundary. The pack is mapped once; stored blobs are handed to GL straight from the
+// mapping, blobs written LZ4 compressed are expanded into a caller's buffer first.
+
+constexpr std::uint32_t ASSET_PACK_VERSION = 1;
+constexpr std::size_t ASSET_PACK_ALIGNMENT = 64;
+constexpr std::size_t ASSET_NAME_BYTES = 56;
+constexpr char ASSET_PACK_MAGIC[8] = { 'E', 'C', 'P', 'A', 'C', 'K', '\r', '\n' };
+
+enum AssetType : std::uint32_t
+{
+    ASSET_SHADER = 1,   // GLSL text, not NUL-terminated
+    ASSET_TEXTURE = 2,  // TextureCacheHeader and RGB mip levels
+    ASSET_LOD_CHAIN = 3 // packLodChain()
+};
+
+enum AssetCompression : std::uint32_t
+{
+    ASSET_STORED = 0,
+    ASSET_LZ4 = 1 // LZ4 block format, no frame
+};
+
+struct AssetPackHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+};
+
+struct AssetPackEntry
+{
+    char name[ASSET_NAME_BYTES]; // NUL-padded
+    std::uint32_t type;
+    std::uint32_t compression;
+    std::uint64_t offset;        // From the start of the pack
+    std::uint64_t storedBytes;   // In the pack
+    std::uint64_t bytes;         // Once expanded
+};
+
+// The LZ4 block format, enough for the builder and the loader. No library is vendored,
+// and the format is simple enough that decoding it costs less than the reads it saves.
+namespace lz4
+{
+    constexpr int HASH_BITS = 16;
+    constexpr std::size_t MIN_MATCH = 4;
+    constexpr std::size_t LAST_LITERALS = 5; // The format ends every block with literals
+    constexpr std::size_t MATCH_LIMIT = 12;  // and starts no match this close to the end
+
+    inline std::size_t compressBound(std::size_t bytes)
+    {
+        return bytes + bytes / 255 + 16;
+    }
+
+    inline std::uint32_t read32(const unsigned char* p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    inline unsigned char* writeLength(unsigned char* out, std::size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            *out++ = 255;
+        *out++ = static_cast<unsigned char>(length);
+        return out;
+    }
+
+    // Greedy single-probe matcher, returns the compressed size; `out` needs compressBound()
+    inline std::size_t compress(const unsigned char* in, std::size_t bytes, unsigned char* out)
+    {
+        std::vector<std::int64_t> table(std::size_t(1) << HASH_BITS, -1);
+        unsigned char* const start = out;
+        std::size_t anchor = 0;
+        std::size_t i = 0;
+        const std::size_t matchEnd = bytes > LAST_LITERALS ? bytes - LAST_LITERALS : 0;
+        while (bytes >= MATCH_LIMIT + 1 && i < bytes - MATCH_LIMIT)
+        {
+            const std::uint32_t sequence = read32(in + i);
+            const std::uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+            const std::int64_t candidate = table[hash];
+            table[hash] = static_cast<std::int64_t>(i);
+            if (candidate < 0 || i - candidate > 65535 || read32(in + candidate) != sequence)
+            {
+                ++i;
+                continue;
+            }
+            std::size_t length = MIN_MATCH;
+            while (i + length < matchEnd && in[candidate + length] == in[i + length])
+                ++length;
+
+            const std::size_t literals = i - anchor;
+            const std::size_t extra = length - MIN_MATCH;
+            *out++ = static_cast<unsigned char>((std::min<std::size_t>(literals, 15) << 4) | std::min<std::size_t>(extra, 15));
+            if (literals >= 15)
+                out = writeLength(out, literals - 15);
+            std::memcpy(out, in + anchor, literals);
+            out += literals;
+            const std::size_t offset = i - static_cast<std::size_t>(candidate);
+            *out++ = static_cast<unsigned char>(offset);
+            *out++ = static_cast<unsigned char>(offset >> 8);
+            if (extra >= 15)
+                out = writeLength(out, extra - 15);
+            i += length;
+            anchor = i;
+        }
+        const std::size_t literals = bytes - anchor;
+        *out++ = static_cast<unsigned char>(std::min<std::size_t>(literals, 15) << 4);
+        if (literals >= 15)
+            out = writeLength(out, literals - 15);
+        if (literals > 0)
+            std::memcpy(out, in + anchor, literals);
+        out += literals;
+        return static_cast<std::size_t>(out - start);
+    }
+
+    // False unless `in` expands to exactly `bytes`; never reads or writes out of bounds
+    inline bool decompress(const unsigned char* in, std::size_t inBytes, unsigned char* out, std::size_t bytes)
+    {
+        const unsigned char* const inEnd = in + inBytes;
+        unsigned char* const outStart = out;
+        unsigned char* const outEnd = out + bytes;
+        auto readLength = [&](std::size_t& length)
+        {
+            unsigned char next;
+            do
+            {
+                if (in == inEnd)
+                    return false;
+                next = *in++;
+                length += next;
+            } while (next == 255);
+            return true;
+        };
+        while (in < inEnd)
+        {
+            const unsigned char token = *in++;
+            std::size_t literals = token >> 4;
+            if (literals == 15 && !readLength(literals))
+                return false;
+            if (literals > static_cast<std::size_t>(inEnd - in) || literals > static_cast<std::size_t>(outEnd - out))
+                return false;
+            if (literals > 0)
+                std::memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+            if (in == inEnd)
+                break; // The last sequence has no match
+
+            if (inEnd - in < 2)
+                return false;
+            const std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+            in += 2;
+            std::size_t length = token & 15;
+            if (length == 15 && !readLength(length))
+                return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<std::size_t>(out - outStart) || length > static_cast<std::size_t>(outEnd - out))
+                return false;
+            // Byte by byte, a match may overlap what it is copying
+            const unsigned char* match = out - offset;
+            for (std::size_t k = 0; k < length; ++k)
+                out[k] = match[k];
+            out += length;
+        }
+        return out == outEnd;
+    }
+}
+
+// LOD chain blob: level count, then a (index count, error) pair per level, then the
+// indices of every level back to back as uploadLodChain lays them out in the EBO
+inline std::vector<unsigned char> packLodChain(const std::vector<LodLevel>& chain)
+{
+    std::vector<unsigned char> blob(4 + chain.size() * 8);
+    const std::uint32_t levels = static_cast<std::uint32_t>(chain.size());
+    std::memcpy(blob.data(), &levels, 4);
+    for (std::size_t level = 0; level < chain.size(); ++level)
+    {
+        const std::uint32_t count = static_cast<std::uint32_t>(chain[level].indices.size());
+        std::memcpy(&blob[4 + level * 8], &count, 4);
+        std::memcpy(&blob[8 + level * 8], &chain[level].error, 4);
+        const unsigned char* indices = reinterpret_cast<const unsigned char*>(chain[level].indices.data());
+        blob.insert(blob.end(), indices, indices + count * sizeof(GLuint));
+    }
+    return blob;
+}
+
+// uploadLodChain for a packed chain, the EBO is filled from the blob in place
+inline bool uploadPackedLodChain(const unsigned char* blob, std::size_t bytes, LodBuffer& lod)
+{
+    std::uint32_t levels;
+    if (!blob || bytes < 4)
+        return false;
+    std::memcpy(&levels, blob, 4);
+    if (levels == 0 || levels > (bytes - 4) / 8)
+        return false;
+    const std::size_t indexStart = 4 + static_cast<std::size_t>(levels) * 8;
+    std::size_t indexBytes = 0;
+    for (std::uint32_t level = 0; level < levels; ++level)
+    {
+        std::uint32_t count;
+        float error;
+        std::memcpy(&count, blob + 4 + level * 8, 4);
+        std::memcpy(&error, blob + 8 + level * 8, 4);
+        lod.offsets.push_back(indexBytes);
+        lod.counts.push_back(static_cast<GLsizei>(count));
+        lod.errors.push_back(error);
+        indexBytes += static_cast<std::size_t>(count) * sizeof(GLuint);
+    }
+    if (indexBytes != bytes - indexStart)
+    {
+        lod = LodBuffer();
+        return false;
+    }
+    glGenBuffers(1, &lod.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexBytes), blob + indexStart, GL_STATIC_DRAW);
+    return true;
+}
+
+class AssetPack
+{
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // False if the file is missing or is not a pack this build can read
+    bool open(const std::string& path)
+    {
+        entries = nullptr;
+        entryCount = 0;
+        if (!file.open(path))
+            return false;
+        AssetPackHeader header;
+        if (file.size() < sizeof(header))
+            return fail();
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0 || header.version != ASSET_PACK_VERSION ||
+            header.entryCount > (file.size() - sizeof(header)) / sizeof(AssetPackEntry))
+            return fail();
+        // The header keeps the index 8-byte aligned, so it is used in place
+        entries = reinterpret_cast<const AssetPackEntry*>(file.data() + sizeof(header));
+        entryCount = header.entryCount;
+        for (std::uint32_t i = 0; i < entryCount; ++i)
+        {
+            const AssetPackEntry& entry = entries[i];
+            if (entry.name[ASSET_NAME_BYTES - 1] != '\0' || entry.offset > file.size() || entry.storedBytes > file.size() - entry.offset ||
+                (entry.compression == ASSET_STORED && entry.storedBytes != entry.bytes) || entry.compression > ASSET_LZ4 ||
+                (i > 0 && std::strncmp(entries[i - 1].name, entry.name, ASSET_NAME_BYTES) >= 0))
+                return fail();
+        }
+        return true;
+    }
+
+    bool isOpen() const { return entries != nullptr; }
+    std::uint32_t size() const { return entryCount; }
+
+    // Entry called `name` of `type`, or nullptr
+    const AssetPackEntry* find(const std::string& name, std::uint32_t type) const
+    {
+        if (!entries || name.size() >= ASSET_NAME_BYTES)
+            return nullptr;
+        const AssetPackEntry* end = entries + entryCount;
+        const AssetPackEntry* found = std::lower_bound(entries, end, name, [](const AssetPackEntry& entry, const std::string& key)
+        {
+            return std::strncmp(entry.name, key.c_str(), ASSET_NAME_BYTES) < 0;
+        });
+        if (found == end || std::strncmp(found->name, name.c_str(), ASSET_NAME_BYTES) != 0 || found->type != type)
+            return nullptr;
+        return found;
+    }
+
+    // An entry's bytes: the mapping itself for stored blobs, `scratch` expanded otherwise.
+    // nullptr if a compressed blob is damaged.
+    const unsigned char* contents(const AssetPackEntry& entry, std::vector<unsigned char>& scratch) const
+    {
+        const unsigned char* stored = file.data() + entry.offset;
+        if (entry.compression == ASSET_STORED)
+        {
+            ++mappedReads;
+            return stored;
+        }
+        scratch.resize(static_cast<std::size_t>(entry.bytes));
+        if (!lz4::decompress(stored, static_cast<std::size_t>(entry.storedBytes), scratch.data(), scratch.size()))
+            return nullptr;
+        ++expandedReads;
+        return scratch.data();
+    }
+
+    // Shader text from the pack, or from the loose file at `path` if the pack lacks it
+    ShaderSource shaderSource(const char* path, std::vector<unsigned char>& storage) const
+    {
+        const AssetPackEntry* entry = find(path, ASSET_SHADER);
+        const unsigned char* text = entry ? contents(*entry, storage) : nullptr;
+        if (text)
+            return ShaderSource{ reinterpret_cast<const char*>(text), static_cast<int>(entry->bytes) };
+
+        std::ifstream loose(path, std::ios::binary);
+        if (!loose)
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        storage.assign(std::istreambuf_iterator<char>(loose), std::istreambuf_iterator<char>());
+        return ShaderSource{ reinterpret_cast<const char*>(storage.data()), static_cast<int>(storage.size()) };
+    }
+
+    // Blobs read from the mapping in place, and ones expanded into a buffer
+    mutable std::atomic<int> mappedReads{ 0 };
+    mutable std::atomic<int> expandedReads{ 0 };
+
+private:
+    bool fail()
+    {
+        file.close();
+        entries = nullptr;
+        entryCount = 0;
+        return false;
+    }
+
+    MappedFile file;
+    const AssetPackEntry* entries = nullptr;
+    std::uint32_t entryCount = 0;
+};
+
+// Collects blobs and writes them out as a pack
+class AssetPackWriter
+{
+public:
+    // With `compress` the blob is kept LZ4 compressed if that saves at least an eighth.
+    // False if the name is too long or already taken.
+    bool add(const std::string& name, std::uint32_t type, std::vector<unsigned char> data, bool compress)
+    {
+        if (name.empty() || name.size() >= ASSET_NAME_BYTES)
+            return false;
+        for (const Blob& blob : blobs)
+            if (blob.name == name)
+                return false;
+        Blob blob;
+        blob.name = name;
+        blob.type = type;
+        blob.bytes = data.size();
+        blob.compression = ASSET_STORED;
+        if (compress && !data.empty())
+        {
+            std::vector<unsigned char> packed(lz4::compressBound(data.size()));
+            packed.resize(lz4::compress(data.data(), data.size(), packed.data()));
+            if (packed.size() <= data.size() - data.size() / 8)
+            {
+                data.swap(packed);
+                blob.compression = ASSET_LZ4;
+            }
+        }
+        blob.data = std::move(data);
+        blobs.push_back(std::move(blob));
+        return true;
+    }
+
+    // A loose file's bytes under its own path
+    bool addFile(const std::string& path, std::uint32_t type, bool compress)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        return add(path, type, std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()), compress);
+    }
+
+    bool write(const std::string& path)
+    {
+        std::sort(blobs.begin(), blobs.end(), [](const Blob& a, const Blob& b) { return a.name < b.name; });
+        AssetPackHeader header = {};
+        std::memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+        header.version = ASSET_PACK_VERSION;
+        header.entryCount = static_cast<std::uint32_t>(blobs.size());
+
+        std::vector<AssetPackEntry> index(blobs.size());
+        std::uint64_t offset = sizeof(header) + index.size() * sizeof(AssetPackEntry);
+        for (std::size_t i = 0; i < blobs.size(); ++i)
+        {
+            AssetPackEntry& entry = index[i];
+            std::memset(&entry, 0, sizeof(entry));
+            std::memcpy(entry.name, blobs[i].name.data(), blobs[i].name.size());
+            entry.type = blobs[i].type;
+            entry.compression = blobs[i].compression;
+            offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+            entry.offset = offset;
+            entry.storedBytes = blobs[i].data.size();
+            entry.bytes = blobs[i].bytes;
+            offset += entry.storedBytes;
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(AssetPackEntry)));
+        static const char padding[ASSET_PACK_ALIGNMENT] = {};
+        for (std::size_t i = 0; i < blobs.size(); ++i)
+        {
+            file.write(padding, static_cast<std::streamsize>(index[i].offset - static_cast<std::uint64_t>(file.tellp())));
+            file.write(reinterpret_cast<const char*>(blobs[i].data.data()), static_cast<std::streamsize>(blobs[i].data.size()));
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Stored and expanded size of everything added so far
+    std::size_t storedBytes() const
+    {
+        std::size_t total = 0;
+        for (const Blob& blob : blobs)
+            total += blob.data.size();
+        return total;
+    }
+
+    std::size_t bytes() const
+    {
+        std::size_t total = 0;
+        for (const Blob& blob : blobs)
+            total += blob.bytes;
+        return total;
+    }
+
+private:
+    struct Blob
+    {
+        std::string name;
+        std::uint32_t type;
+        std::uint32_t compression;
+        std::size_t bytes;
+        std::vector<unsigned char> data;
+    };
+
+    std::vector<Blob> blobs;
+};
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef BAKED_MESH_HPP
+#define BAKED_MESH_HPP
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <vector>
+#include "bounds.hpp"
+
+// Every mesh in the crown uses the same interleaved layout: x, y, z, u, v
+constexpr int VERTEX_STRIDE = 5;
+
+// Compile-time trigonometry, the <cmath> versions are not constexpr
+namespace baked
+{
+    constexpr double CT_PI = 3.14159265358979323846;
+
+    constexpr double wrapAngle(double x)
+    {
+        // Bring the angle into [-pi, pi] so the series converges quickly
+        while (x > CT_PI)
+            x -= 2.0 * CT_PI;
+        while (x < -CT_PI)
+            x += 2.0 * CT_PI;
+        return x;
+    }
+
+    constexpr double sin(double x)
+    {
+        x = wrapAngle(x);
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cos(double x)
+    {
+        x = wrapAngle(x);
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+// Vertex and index writers shared by the baked meshes and the runtime generators, so both
+// always produce the same data. `Floats` and `Indices` are std::arrays when baking and
+// std::vectors already sized by the caller at runtime.
+namespace baked
+{
+    constexpr std::size_t cylinderVertexCount(int sectors) { return static_cast<std::size_t>(sectors + 1) * 4; }
+    constexpr std::size_t cylinderSurfaceIndexCount(int sectors) { return static_cast<std::size_t>(sectors) * 6; }
+    constexpr std::size_t CROSS_VERTEX_COUNT = 8;
+    constexpr std::size_t CROSS_INDEX_COUNT = 12;
+    constexpr std::size_t SPIKE_VERTEX_COUNT = 6;
+    constexpr std::size_t SPIKE_INDEX_COUNT = 24;
+
+    // Two triangles a-b-c and b-d-c at out[o]
+    template <typename Indices>
+    constexpr void writeQuad(Indices& out, std::size_t o, GLuint a, GLuint b, GLuint c, GLuint d)
+    {
+        out[o + 0] = a; out[o + 1] = b; out[o + 2] = c;
+        out[o + 3] = b; out[o + 4] = d; out[o + 5] = c;
+    }
+
+    // Four vertices per ring (outer top, outer bottom, inner top, inner bottom), one index
+    // list per surface
+    template <typename Floats, typename Indices>
+    constexpr void writeCylinder(int sectors, float radiusOuter, float radiusInner, float height, Floats& vertices,
+        Indices& outerIndices, Indices& innerIndices, Indices& topCapIndices, Indices& bottomCapIndices)
+    {
+        const double sectorStep = 2.0 * CT_PI / sectors;
+        std::size_t v = 0;
+
+        for (int i = 0; i <= sectors; ++i)
+        {
+            const double angle = i * sectorStep;
+            const float c = static_cast<float>(cos(angle));
+            const float s = static_cast<float>(sin(angle));
+            const float u = static_cast<float>(i) / sectors;
+
+            const float radii[4] = { radiusOuter, radiusOuter, radiusInner, radiusInner };
+            const float ys[4] = { height / 2, -height / 2, height / 2, -height / 2 };
+            const float ts[4] = { 1.0f, 0.0f, 1.0f, 0.0f };
+            for (int k = 0; k < 4; ++k)
+            {
+                vertices[v++] = radii[k] * c;
+                vertices[v++] = ys[k];
+                vertices[v++] = radii[k] * s;
+                vertices[v++] = u;     // Texture X
+                vertices[v++] = ts[k]; // Texture Y
+            }
+        }
+
+        for (int i = 0; i < sectors; ++i)
+        {
+            const GLuint current = i * 4;
+            const GLuint next = ((i + 1) % sectors) * 4;
+            const std::size_t o = i * 6;
+
+            // Every surface is wound counter-clockwise seen from its visible side
+            writeQuad(outerIndices, o, current, next, current + 1, next + 1);
+            writeQuad(innerIndices, o, current + 2, current + 3, next + 2, next + 3);
+            writeQuad(topCapIndices, o, current, current + 2, next, next + 2);
+            writeQuad(bottomCapIndices, o, current + 1, next + 1, current + 3, next + 3);
+        }
+    }
+
+    // A vertical and a horizontal quad
+    template <typename Floats, typename Indices>
+    constexpr void writeCross(float width, float height, float thickness, Floats& vertices, Indices& indices)
+    {
+        const float halfWidth = width / 2.0f;
+        const float halfHeight = height / 2.0f;
+        const float halfThickness = thickness / 3;
+        const float bottom = static_cast<float>(-halfHeight - 0.1);
+        const float top = static_cast<float>(halfHeight - 0.1);
+
+        const float data[CROSS_VERTEX_COUNT * VERTEX_STRIDE] = {
+            // Vertical part
+            -halfThickness, bottom, 0.0f, 0.0f, 0.0f,
+             halfThickness, bottom, 0.0f, 1.0f, 0.0f,
+             halfThickness, top,    0.0f, 1.0f, 1.0f,
+            -halfThickness, top,    0.0f, 0.0f, 1.0f,
+
+            // Horizontal part
+            -halfWidth, -halfThickness, 0.0f, 0.0f, 0.0f,
+             halfWidth, -halfThickness, 0.0f, 1.0f, 0.0f,
+             halfWidth,  halfThickness, 0.0f, 1.0f, 1.0f,
+            -halfWidth,  halfThickness, 0.0f, 0.0f, 1.0f,
+        };
+        for (std::size_t i = 0; i < CROSS_VERTEX_COUNT * VERTEX_STRIDE; ++i)
+            vertices[i] = data[i];
+
+        const GLuint idx[CROSS_INDEX_COUNT] = {
+            0, 1, 2, 2, 3, 0, // Vertical part
+            4, 5, 6, 6, 7, 4  // Horizontal part
+        };
+        for (std::size_t i = 0; i < CROSS_INDEX_COUNT; ++i)
+            indices[i] = idx[i];
+    }
+
+    // Triangular prism; the profile only depends on height and thickness
+    template <typename Floats, typename Indices>
+    constexpr void writeSpike(float height, float thickness, Floats& vertices, Indices& indices)
+    {
+        const float halfHeight = height / 3.0f;
+        const float halfThickness = thickness; // Keep full thickness
+
+        const float data[SPIKE_VERTEX_COUNT * VERTEX_STRIDE] = {
+            // Front face
+            -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
+             halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
+             0.0f,           halfHeight,  halfThickness,  0.5f, 1.0f,  // 2 - Top Front
+
+            // Back face
+            -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
+             halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
+             0.0f,           halfHeight, -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
+        };
+        for (std::size_t i = 0; i < SPIKE_VERTEX_COUNT * VERTEX_STRIDE; ++i)
+            vertices[i] = data[i];
+
+        const GLuint idx[SPIKE_INDEX_COUNT] = {
+            0, 1, 2,          // Front face
+            3, 5, 4,          // Back face
+            0, 2, 3, 3, 2, 5, // Left side
+            1, 4, 2, 2, 4, 5, // Right side
+            0, 3, 1, 1, 3, 4  // Bottom face
+        };
+        for (std::size_t i = 0; i < SPIKE_INDEX_COUNT; ++i)
+            indices[i] = idx[i];
+    }
+}
+
+// Fixed-size mesh whose vertex and index arrays can live in read-only data
+template <std::size_t VertexCount, std::size_t IndexCount>
+struct BakedMesh
+{
+    static constexpr std::size_t VERTEX_COUNT = VertexCount;
+    static constexpr std::size_t INDEX_COUNT = IndexCount;
+
+    std::array<GLfloat, VertexCount * VERTEX_STRIDE> vertices{};
+    std::array<GLuint, IndexCount> indices{};
+
+    Bounds bounds() const { return computeBounds(vertices.data(), vertices.size(), VERTEX_STRIDE); }
+};
+
+// Hollow cylinder with a sector count fixed at compile time, see baked::writeCylinder
+template <int Sectors>
+struct CylinderMesh
+{
+    static_assert(Sectors >= 3, "A cylinder needs at least three sectors");
+
+    static constexpr std::size_t VERTEX_COUNT = baked::cylinderVertexCount(Sectors);
+    static constexpr std::size_t SURFACE_INDEX_COUNT = baked::cylinderSurfaceIndexCount(Sectors);
+
+    std::array<GLfloat, VERTEX_COUNT * VERTEX_STRIDE> vertices{};
+    std::array<GLuint, SURFACE_INDEX_COUNT> outerIndices{};
+    std::array<GLuint, SURFACE_INDEX_COUNT> innerIndices{};
+    std::array<GLuint, SURFACE_INDEX_COUNT> topCapIndices{};
+    std::array<GLuint, SURFACE_INDEX_COUNT> bottomCapIndices{};
+
+    Bounds bounds() const { return computeBounds(vertices.data(), vertices.size(), VERTEX_STRIDE); }
+
+    constexpr CylinderMesh(float radiusOuter, float radiusInner, float height)
+    {
+        baked::writeCylinder(Sectors, radiusOuter, radiusInner, height, vertices, outerIndices, innerIndices, topCapIndices, bottomCapIndices);
+    }
+};
+
+// Cross made of a vertical and a horizontal quad
+struct CrossMesh : BakedMesh<baked::CROSS_VERTEX_COUNT, baked::CROSS_INDEX_COUNT>
+{
+    constexpr CrossMesh(float width, float height, float thickness)
+    {
+        baked::writeCross(width, height, thickness, vertices, indices);
+    }
+};
+
+// Triangular prism spike
+struct SpikeMesh : BakedMesh<baked::SPIKE_VERTEX_COUNT, baked::SPIKE_INDEX_COUNT>
+{
+    constexpr SpikeMesh(float width, float height, float thickness)
+    {
+        (void)width; // The spike profile only depends on height and thickness
+        baked::writeSpike(height, thickness, vertices, indices);
+    }
+};
+
+// Runtime generators for parts whose parameters are only known at runtime. They write
+// through the same baked:: writers, into std::vectors instead of static arrays.
+inline void generateHollowCylinder(float radiusOuter, float radiusInner, float height, int sectors,
+    std::vector<GLfloat>& vertices, std::vector<GLuint>& outerIndices,
+    std::vector<GLuint>& innerIndices, std::vector<GLuint>& topCapIndices,
+    std::vector<GLuint>& bottomCapIndices)
+{
+    vertices.assign(baked::cylinderVertexCount(sectors) * VERTEX_STRIDE, 0.0f);
+    for (std::vector<GLuint>* surface : { &outerIndices, &innerIndices, &topCapIndices, &bottomCapIndices })
+        surface->assign(baked::cylinderSurfaceIndexCount(sectors), 0);
+    baked::writeCylinder(sectors, radiusOuter, radiusInner, height, vertices, outerIndices, innerIndices, topCapIndices, bottomCapIndices);
+}
+
+inline void generateCross(float width, float height, float thickness, std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+    vertices.assign(baked::CROSS_VERTEX_COUNT * VERTEX_STRIDE, 0.0f);
+    indices.assign(baked::CROSS_INDEX_COUNT, 0);
+    baked::writeCross(width, height, thickness, vertices, indices);
+}
+
+inline void generateSpike(float width, float height, float thickness, std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+    (void)width;
+    vertices.assign(baked::SPIKE_VERTEX_COUNT * VERTEX_STRIDE, 0.0f);
+    indices.assign(baked::SPIKE_INDEX_COUNT, 0);
+    baked::writeSpike(height, thickness, vertices, indices);
+}
+
+// GPU handles for one uploaded mesh
+struct MeshBuffers
+{
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    GLsizei indexCount = 0;
+    Bounds bounds;
+};
+
+// Upload interleaved (x, y, z, u, v) vertices and indices. Works for both the baked
+// arrays (read straight from static storage) and the runtime std::vector path.
+inline MeshBuffers uploadMesh(const GLfloat* vertices, std::size_t floatCount,
+    const GLuint* indices, std::size_t indexCount)
+{
+    MeshBuffers mesh;
+    mesh.indexCount = static_cast<GLsizei>(indexCount);
+    mesh.bounds = computeBounds(vertices, floatCount, VERTEX_STRIDE);
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    glGenBuffers(1, &mesh.EBO);
+
+    glBindVertexArray(mesh.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, floatCount * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+    // Vertex attributes (x, y, z, u, v)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_STRIDE * sizeof(GLfloat), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_STRIDE * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return mesh;
+}
+
+template <std::size_t V, std::size_t I>
+inline MeshBuffers uploadMesh(const BakedMesh<V, I>& baked)
+{
+    return uploadMesh(baked.vertices.data(), baked.vertices.size(), baked.indices.data(), baked.indices.size());
+}
+
+// A mesh from the runtime generators
+inline MeshBuffers uploadMesh(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices)
+{
+    return uploadMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+inline void deleteMesh(MeshBuffers& mesh)
+{
+    glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteBuffers(1, &mesh.VBO);
+    glDeleteBuffers(1, &mesh.EBO);
+    mesh = MeshBuffers();
+}
+
+#endif
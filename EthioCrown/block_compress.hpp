@@ -0,0 +1,623 @@
+#ifndef BLOCK_COMPRESS_HPP
+#define BLOCK_COMPRESS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "job_system.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLOCK_COMPRESS_SSE2
+#include <emmintrin.h>
+#endif
+
+// CPU encoders for the GPU block formats, 4x4 opaque RGB blocks each:
+//   BC1         8 bytes, two RGB565 endpoints and 2-bit indices (desktop, EXT_texture_compression_s3tc)
+//   BC7         16 bytes, mode 6 only: one RGBA7+P endpoint pair with 4-bit indices (GL 4.2)
+//   ETC2 RGB    8 bytes, the ETC1-compatible individual and differential modes (GL 4.3, GLES 3)
+// Endpoints come from the block's principal axis and are refined by least squares; the
+// per-pixel index fit is SSE2. compressImage() runs the block loop on a job system.
+
+enum BlockFormat
+{
+    BLOCK_BC1,
+    BLOCK_BC7,
+    BLOCK_ETC2_RGB,
+    BLOCK_FORMAT_COUNT
+};
+
+inline const char* blockFormatName(int format)
+{
+    static const char* const NAMES[BLOCK_FORMAT_COUNT] = { "bc1", "bc7", "etc2" };
+    return format >= 0 && format < BLOCK_FORMAT_COUNT ? NAMES[format] : "unknown";
+}
+
+inline int blockFormatBytes(int format)
+{
+    return format == BLOCK_BC7 ? 16 : 8;
+}
+
+namespace block_compress_detail
+{
+    // 16 pixels, row-major, RGBA with A = 255
+    typedef unsigned char Block[16][4];
+
+    inline int clampByte(int value)
+    {
+        return std::min(255, std::max(0, value));
+    }
+
+    inline int squaredError(const unsigned char* a, const int* b)
+    {
+        const int r = a[0] - b[0], g = a[1] - b[1], bl = a[2] - b[2];
+        return r * r + g * g + bl * bl;
+    }
+
+    // Mean and dominant direction of the block's colours, by power iteration on the covariance
+    inline void principalAxis(const Block& pixels, float mean[3], float axis[3])
+    {
+        mean[0] = mean[1] = mean[2] = 0.0f;
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                mean[c] += pixels[i][c];
+        for (int c = 0; c < 3; ++c)
+            mean[c] /= 16.0f;
+
+        float cov[6] = {}; // rr rg rb gg gb bb
+        for (int i = 0; i < 16; ++i)
+        {
+            const float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+            cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+            cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        }
+        // Start from the covariance row of the widest channel; a fixed start vector fails
+        // on anti-correlated channels
+        float v[3] = { cov[0], cov[1], cov[2] };
+        if (cov[3] > cov[0] && cov[3] >= cov[5])
+        {
+            v[0] = cov[1]; v[1] = cov[3]; v[2] = cov[4];
+        }
+        else if (cov[5] > cov[0] && cov[5] > cov[3])
+        {
+            v[0] = cov[2]; v[1] = cov[4]; v[2] = cov[5];
+        }
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            const float x = cov[0] * v[0] + cov[1] * v[1] + cov[2] * v[2];
+            const float y = cov[1] * v[0] + cov[3] * v[1] + cov[4] * v[2];
+            const float z = cov[2] * v[0] + cov[4] * v[1] + cov[5] * v[2];
+            const float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+            if (length < 1e-6f)
+                break;
+            v[0] = x / length; v[1] = y / length; v[2] = z / length;
+        }
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (int c = 0; c < 3; ++c)
+            axis[c] = length > 1e-6f ? v[c] / length : 0.0f;
+    }
+
+    // Block extremes along the axis, as colours
+    inline void axisEndpoints(const Block& pixels, const float mean[3], const float axis[3], float high[3], float low[3])
+    {
+        float lowest = 0.0f, highest = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            const float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * highest));
+            low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * lowest));
+        }
+    }
+
+    // Position of every pixel along a -> b, rounded to 0..steps
+    inline void fitIndices(const Block& pixels, const int a[3], const int b[3], int steps, int indices[16])
+    {
+        const int direction[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const int length = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+        if (length == 0)
+        {
+            std::fill(indices, indices + 16, 0);
+            return;
+        }
+        const float scale = static_cast<float>(steps) / length;
+        int i = 0;
+#ifdef BLOCK_COMPRESS_SSE2
+        // Dot products of four pixels at a time: madd pairs (r, g) and (b, a) of each pixel
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i origin = _mm_setr_epi16(static_cast<short>(a[0]), static_cast<short>(a[1]), static_cast<short>(a[2]), 0,
+                                              static_cast<short>(a[0]), static_cast<short>(a[1]), static_cast<short>(a[2]), 0);
+        const __m128i weights = _mm_setr_epi16(static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0,
+                                               static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0);
+        const __m128 scales = _mm_set1_ps(scale);
+        const __m128i top = _mm_set1_epi32(steps);
+        for (; i < 16; i += 4)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels[i]));
+            const __m128i lo = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(bytes, zero), origin), weights);
+            const __m128i hi = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(bytes, zero), origin), weights);
+            const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+            const __m128i dots = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+            __m128i steps4 = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(dots), scales));
+            // Clamp to [0, steps] without SSE4.1 min/max
+            steps4 = _mm_andnot_si128(_mm_cmplt_epi32(steps4, zero), steps4);
+            const __m128i over = _mm_cmpgt_epi32(steps4, top);
+            steps4 = _mm_or_si128(_mm_and_si128(over, top), _mm_andnot_si128(over, steps4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), steps4);
+        }
+#endif
+        for (; i < 16; ++i)
+        {
+            const int dot = (pixels[i][0] - a[0]) * direction[0] + (pixels[i][1] - a[1]) * direction[1] + (pixels[i][2] - a[2]) * direction[2];
+            indices[i] = std::min(steps, std::max(0, static_cast<int>(std::lround(dot * scale))));
+        }
+    }
+
+    // Endpoints that best reproduce the pixels for fixed weights (weights[i] / total of the way
+    // from a to b), by least squares. False if the weights do not pin both endpoints down.
+    inline bool refineEndpoints(const Block& pixels, const int weights[16], int total, float a[3], float b[3])
+    {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, pa[3] = {}, pb[3] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            const float beta = static_cast<float>(weights[i]) / total, alpha = 1.0f - beta;
+            aa += alpha * alpha; bb += beta * beta; ab += alpha * beta;
+            for (int c = 0; c < 3; ++c)
+            {
+                pa[c] += alpha * pixels[i][c];
+                pb[c] += beta * pixels[i][c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-3f)
+            return false;
+        for (int c = 0; c < 3; ++c)
+        {
+            a[c] = std::min(255.0f, std::max(0.0f, (pa[c] * bb - pb[c] * ab) / determinant));
+            b[c] = std::min(255.0f, std::max(0.0f, (pb[c] * aa - pa[c] * ab) / determinant));
+        }
+        return true;
+    }
+
+    // BC1 -------------------------------------------------------------------------------
+
+    inline int pack565(const float color[3])
+    {
+        const int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+        const int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+        const int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    inline void unpack565(int packed, int color[3])
+    {
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Error and 2-bit codes of an endpoint pair with color0 > color1 (four-colour mode)
+    inline int fitBC1(const Block& pixels, int color0, int color1, std::uint32_t& codes)
+    {
+        int palette[4][3];
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        // Steps along color0 -> color1 in BC1 code order
+        static const int CODE[4] = { 0, 2, 3, 1 };
+        int steps[16];
+        fitIndices(pixels, palette[0], palette[1], 3, steps);
+        codes = 0;
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            // The projection can miss by one step after 565 rounding, check the neighbours
+            int best = steps[i], bestError = squaredError(pixels[i], palette[CODE[best]]);
+            for (int step = std::max(0, steps[i] - 1); step <= std::min(3, steps[i] + 1); ++step)
+            {
+                const int candidate = squaredError(pixels[i], palette[CODE[step]]);
+                if (candidate < bestError)
+                {
+                    best = step;
+                    bestError = candidate;
+                }
+            }
+            steps[i] = best;
+            codes |= static_cast<std::uint32_t>(CODE[best]) << (2 * i);
+            error += bestError;
+        }
+        return error;
+    }
+
+    inline int encodeBC1(const Block& pixels, unsigned char out[8])
+    {
+        float mean[3], axis[3], high[3], low[3];
+        principalAxis(pixels, mean, axis);
+        axisEndpoints(pixels, mean, axis, high, low);
+
+        int color0 = pack565(high), color1 = pack565(low);
+        std::uint32_t codes = 0;
+        int error;
+        if (color0 == color1)
+        {
+            // Flat after quantization: three-colour mode with every pixel on color0
+            int flat[3];
+            unpack565(color0, flat);
+            error = 0;
+            for (int i = 0; i < 16; ++i)
+                error += squaredError(pixels[i], flat);
+        }
+        else
+        {
+            if (color0 < color1)
+                std::swap(color0, color1);
+            error = fitBC1(pixels, color0, color1, codes);
+
+            // One least-squares pass on the weights the first fit chose
+            static const int WEIGHT[4] = { 0, 3, 1, 2 };
+            int weights[16];
+            for (int i = 0; i < 16; ++i)
+                weights[i] = WEIGHT[(codes >> (2 * i)) & 3];
+            float refined0[3], refined1[3];
+            if (refineEndpoints(pixels, weights, 3, refined0, refined1))
+            {
+                int candidate0 = pack565(refined0), candidate1 = pack565(refined1);
+                if (candidate0 < candidate1)
+                    std::swap(candidate0, candidate1);
+                std::uint32_t candidateCodes;
+                const int candidateError = candidate0 == candidate1 ? error : fitBC1(pixels, candidate0, candidate1, candidateCodes);
+                if (candidateError < error)
+                {
+                    color0 = candidate0;
+                    color1 = candidate1;
+                    codes = candidateCodes;
+                    error = candidateError;
+                }
+            }
+        }
+        out[0] = static_cast<unsigned char>(color0);
+        out[1] = static_cast<unsigned char>(color0 >> 8);
+        out[2] = static_cast<unsigned char>(color1);
+        out[3] = static_cast<unsigned char>(color1 >> 8);
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = static_cast<unsigned char>(codes >> (8 * i));
+        return error;
+    }
+
+    // BC7 mode 6 ------------------------------------------------------------------------
+
+    static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // 7-bit RGB plus the endpoint's shared P bit; alpha is 127 with P = 1, i.e. 255
+    struct Bc7Endpoint
+    {
+        int rgb7[3];
+        int p;
+        int color[3]; // As the decoder expands it
+    };
+
+    inline Bc7Endpoint quantizeBC7(const float color[3])
+    {
+        Bc7Endpoint best{};
+        int bestError = -1;
+        for (int p = 0; p < 2; ++p)
+        {
+            Bc7Endpoint candidate{};
+            candidate.p = p;
+            int error = p ? 0 : 1; // Alpha 254 instead of 255 without the P bit
+            for (int c = 0; c < 3; ++c)
+            {
+                candidate.rgb7[c] = std::min(127, std::max(0, static_cast<int>(std::lround((color[c] - p) / 2.0f))));
+                candidate.color[c] = candidate.rgb7[c] * 2 + p;
+                const float difference = color[c] - candidate.color[c];
+                error += static_cast<int>(difference * difference);
+            }
+            if (bestError < 0 || error < bestError)
+            {
+                best = candidate;
+                bestError = error;
+            }
+        }
+        return best;
+    }
+
+    inline int fitBC7(const Block& pixels, const Bc7Endpoint& e0, const Bc7Endpoint& e1, int indices[16])
+    {
+        int palette[16][3];
+        for (int k = 0; k < 16; ++k)
+            for (int c = 0; c < 3; ++c)
+                palette[k][c] = ((64 - BC7_WEIGHTS[k]) * e0.color[c] + BC7_WEIGHTS[k] * e1.color[c] + 32) >> 6;
+        fitIndices(pixels, e0.color, e1.color, 15, indices);
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = indices[i], bestError = squaredError(pixels[i], palette[best]);
+            for (int k = std::max(0, indices[i] - 1); k <= std::min(15, indices[i] + 1); ++k)
+            {
+                const int candidate = squaredError(pixels[i], palette[k]);
+                if (candidate < bestError)
+                {
+                    best = k;
+                    bestError = candidate;
+                }
+            }
+            indices[i] = best;
+            error += bestError;
+        }
+        return error;
+    }
+
+    // LSB-first bit packer for the 128-bit BC7 block
+    struct BitWriter
+    {
+        unsigned char* out;
+        int position = 0;
+
+        void write(int value, int bits)
+        {
+            for (int i = 0; i < bits; ++i, ++position)
+                if ((value >> i) & 1)
+                    out[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+        }
+    };
+
+    inline int encodeBC7(const Block& pixels, unsigned char out[16])
+    {
+        float mean[3], axis[3], high[3], low[3];
+        principalAxis(pixels, mean, axis);
+        axisEndpoints(pixels, mean, axis, high, low);
+
+        Bc7Endpoint e0 = quantizeBC7(high), e1 = quantizeBC7(low);
+        int indices[16];
+        int error = fitBC7(pixels, e0, e1, indices);
+
+        int weights[16];
+        for (int i = 0; i < 16; ++i)
+            weights[i] = BC7_WEIGHTS[indices[i]];
+        float refined0[3], refined1[3];
+        if (refineEndpoints(pixels, weights, 64, refined0, refined1))
+        {
+            const Bc7Endpoint candidate0 = quantizeBC7(refined0), candidate1 = quantizeBC7(refined1);
+            int candidateIndices[16];
+            const int candidateError = fitBC7(pixels, candidate0, candidate1, candidateIndices);
+            if (candidateError < error)
+            {
+                e0 = candidate0;
+                e1 = candidate1;
+                std::memcpy(indices, candidateIndices, sizeof(indices));
+                error = candidateError;
+            }
+        }
+
+        // The first index is stored without its top bit, which must therefore be 0
+        if (indices[0] >= 8)
+        {
+            std::swap(e0, e1);
+            for (int i = 0; i < 16; ++i)
+                indices[i] = 15 - indices[i];
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter bits{ out };
+        bits.write(1 << 6, 7); // Mode 6
+        for (int c = 0; c < 3; ++c)
+        {
+            bits.write(e0.rgb7[c], 7);
+            bits.write(e1.rgb7[c], 7);
+        }
+        bits.write(127, 7);
+        bits.write(127, 7);
+        bits.write(e0.p, 1);
+        bits.write(e1.p, 1);
+        bits.write(indices[0], 3);
+        for (int i = 1; i < 16; ++i)
+            bits.write(indices[i], 4);
+        return error;
+    }
+
+    // ETC2 RGB, ETC1 modes --------------------------------------------------------------
+
+    static const int ETC_MODIFIERS[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+    struct EtcSubblock
+    {
+        int table = 0;
+        int error = 0;
+        int selectors[8] = {}; // msb * 2 + lsb per pixel of the half
+    };
+
+    // Pixels of half `half` of a block split vertically (flip = 0) or horizontally (flip = 1)
+    inline int etcPixel(int flip, int half, int k)
+    {
+        return flip ? (half * 2 + k / 4) * 4 + k % 4 : (k % 4) * 4 + half * 2 + k / 4;
+    }
+
+    inline EtcSubblock fitEtcSubblock(const Block& pixels, int flip, int half, const int base[3])
+    {
+        EtcSubblock best;
+        best.error = -1;
+        for (int table = 0; table < 8; ++table)
+        {
+            const int modifiers[4] = { ETC_MODIFIERS[table][0], ETC_MODIFIERS[table][1], -ETC_MODIFIERS[table][0], -ETC_MODIFIERS[table][1] };
+            int colors[4][3];
+            for (int selector = 0; selector < 4; ++selector)
+                for (int c = 0; c < 3; ++c)
+                    colors[selector][c] = clampByte(base[c] + modifiers[selector]);
+            EtcSubblock candidate;
+            candidate.table = table;
+            for (int k = 0; k < 8; ++k)
+            {
+                const unsigned char* pixel = pixels[etcPixel(flip, half, k)];
+                int bestSelector = 0, bestError = -1;
+                for (int selector = 0; selector < 4; ++selector)
+                {
+                    const int error = squaredError(pixel, colors[selector]);
+                    if (bestError < 0 || error < bestError)
+                    {
+                        bestSelector = selector;
+                        bestError = error;
+                    }
+                }
+                candidate.selectors[k] = bestSelector;
+                candidate.error += bestError;
+            }
+            if (best.error < 0 || candidate.error < best.error)
+                best = candidate;
+        }
+        return best;
+    }
+
+    inline int encodeETC2(const Block& pixels, unsigned char out[8])
+    {
+        std::uint64_t bestBits = 0;
+        int bestError = -1;
+        for (int flip = 0; flip < 2; ++flip)
+        {
+            float average[2][3] = {};
+            for (int half = 0; half < 2; ++half)
+                for (int k = 0; k < 8; ++k)
+                    for (int c = 0; c < 3; ++c)
+                        average[half][c] += pixels[etcPixel(flip, half, k)][c] / 8.0f;
+
+            for (int differential = 0; differential < 2; ++differential)
+            {
+                int stored[2][3], base[2][3];
+                bool valid = true;
+                for (int half = 0; half < 2; ++half)
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        if (differential)
+                        {
+                            stored[half][c] = static_cast<int>(average[half][c] * 31.0f / 255.0f + 0.5f);
+                            base[half][c] = (stored[half][c] << 3) | (stored[half][c] >> 2);
+                        }
+                        else
+                        {
+                            stored[half][c] = static_cast<int>(average[half][c] * 15.0f / 255.0f + 0.5f);
+                            base[half][c] = stored[half][c] * 17;
+                        }
+                    }
+                // The second colour is a 3-bit signed delta from the first; anything else
+                // would decode as one of ETC2's T, H or planar modes
+                if (differential)
+                    for (int c = 0; c < 3; ++c)
+                        valid = valid && stored[1][c] - stored[0][c] >= -4 && stored[1][c] - stored[0][c] <= 3;
+                if (!valid)
+                    continue;
+
+                const EtcSubblock first = fitEtcSubblock(pixels, flip, 0, base[0]);
+                const EtcSubblock second = fitEtcSubblock(pixels, flip, 1, base[1]);
+                const int error = first.error + second.error;
+                if (bestError >= 0 && error >= bestError)
+                    continue;
+
+                std::uint64_t bits = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    const int shift = 56 - 8 * c;
+                    if (differential)
+                        bits |= static_cast<std::uint64_t>((stored[0][c] << 3) | ((stored[1][c] - stored[0][c]) & 7)) << shift;
+                    else
+                        bits |= static_cast<std::uint64_t>((stored[0][c] << 4) | stored[1][c]) << shift;
+                }
+                bits |= static_cast<std::uint64_t>(first.table) << 37;
+                bits |= static_cast<std::uint64_t>(second.table) << 34;
+                bits |= static_cast<std::uint64_t>(differential) << 33;
+                bits |= static_cast<std::uint64_t>(flip) << 32;
+                for (int half = 0; half < 2; ++half)
+                {
+                    const EtcSubblock& subblock = half ? second : first;
+                    for (int k = 0; k < 8; ++k)
+                    {
+                        // Selector bits are stored column-major: pixel (x, y) is bit x * 4 + y
+                        const int pixel = etcPixel(flip, half, k);
+                        const int bit = (pixel % 4) * 4 + pixel / 4;
+                        bits |= static_cast<std::uint64_t>(subblock.selectors[k] >> 1) << (16 + bit);
+                        bits |= static_cast<std::uint64_t>(subblock.selectors[k] & 1) << bit;
+                    }
+                }
+                bestBits = bits;
+                bestError = error;
+            }
+        }
+        for (int i = 0; i < 8; ++i)
+            out[i] = static_cast<unsigned char>(bestBits >> (56 - 8 * i)); // Big-endian
+        return bestError;
+    }
+
+    inline int encodeBlock(int format, const Block& pixels, unsigned char* out)
+    {
+        switch (format)
+        {
+        case BLOCK_BC1: return encodeBC1(pixels, out);
+        case BLOCK_BC7: return encodeBC7(pixels, out);
+        default: return encodeETC2(pixels, out);
+        }
+    }
+}
+
+// Bytes of a width x height image in `format`, whole blocks
+inline std::size_t compressedSize(int format, int width, int height)
+{
+    return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * blockFormatBytes(format);
+}
+
+// Encode tightly packed RGB into `out` (compressedSize bytes), block rows spread over
+// `jobs` when given. Partial edge blocks repeat the last row and column. Returns the
+// summed squared error over the image's pixels and channels.
+inline double compressImage(const unsigned char* rgb, int width, int height, int format, unsigned char* out, JobSystem* jobs = nullptr)
+{
+    using namespace block_compress_detail;
+    const int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    const int bytes = blockFormatBytes(format);
+    std::vector<double> rowErrors(blocksHigh, 0.0);
+
+    auto encodeRows = [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t by = begin; by < end; ++by)
+        {
+            double rowError = 0.0;
+            for (int bx = 0; bx < blocksWide; ++bx)
+            {
+                Block pixels;
+                for (int i = 0; i < 16; ++i)
+                {
+                    const int x = bx * 4 + i % 4, y = static_cast<int>(by) * 4 + i / 4;
+                    const unsigned char* source = rgb + (static_cast<std::size_t>(std::min(y, height - 1)) * width + std::min(x, width - 1)) * 3;
+                    pixels[i][0] = source[0];
+                    pixels[i][1] = source[1];
+                    pixels[i][2] = source[2];
+                    pixels[i][3] = 255;
+                }
+                unsigned char* block = out + (by * blocksWide + bx) * bytes;
+                const int error = encodeBlock(format, pixels, block);
+                // Edge blocks repeat pixels, count their error for the pixels they cover
+                const int covered = std::min(4, width - bx * 4) * std::min(4, height - static_cast<int>(by) * 4);
+                rowError += error * covered / 16.0;
+            }
+            rowErrors[by] = rowError;
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(blocksHigh, 4, encodeRows);
+    else
+        encodeRows(0, blocksHigh);
+
+    double total = 0.0;
+    for (double rowError : rowErrors)
+        total += rowError;
+    return total;
+}
+
+#endif
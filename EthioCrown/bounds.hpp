@@ -0,0 +1,68 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Axis-aligned box plus a bounding sphere around the same geometry
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+};
+
+// Bounds of interleaved vertices whose first three floats are the position
+inline Bounds computeBounds(const float* vertices, std::size_t floatCount, int stride)
+{
+    Bounds b;
+    if (floatCount < 3)
+        return b;
+
+    b.min = b.max = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    for (std::size_t i = 0; i + 2 < floatCount; i += stride)
+    {
+        const glm::vec3 p(vertices[i], vertices[i + 1], vertices[i + 2]);
+        b.min = glm::min(b.min, p);
+        b.max = glm::max(b.max, p);
+    }
+
+    // Sphere around the box center, tightened to the farthest vertex
+    b.center = (b.min + b.max) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (std::size_t i = 0; i + 2 < floatCount; i += stride)
+    {
+        const glm::vec3 d = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]) - b.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+    b.radius = std::sqrt(radiusSquared);
+    return b;
+}
+
+// World-space bounds of local bounds placed with an affine `model` matrix
+inline Bounds transformBounds(const Bounds& local, const glm::mat4& model)
+{
+    // Arvo's method: project the box extents onto each world axis
+    const glm::vec3 center = glm::vec3(model * glm::vec4((local.min + local.max) * 0.5f, 1.0f));
+    const glm::vec3 e = local.extents();
+    glm::vec3 worldExtents;
+    for (int axis = 0; axis < 3; ++axis)
+        worldExtents[axis] = std::abs(model[0][axis]) * e.x + std::abs(model[1][axis]) * e.y + std::abs(model[2][axis]) * e.z;
+
+    const glm::mat3 linear(model);
+    const float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+
+    Bounds world;
+    world.min = center - worldExtents;
+    world.max = center + worldExtents;
+    world.center = glm::vec3(model * glm::vec4(local.center, 1.0f));
+    world.radius = local.radius * scale;
+    return world;
+}
+
+#endif
@@ -0,0 +1,623 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX__)
+#define CROWN_BVH_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CROWN_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Bounding volume hierarchy over a triangle soup, built with the binned surface area
+// heuristic. Nodes are 32 bytes, children are stored next to each other and always after
+// their parent, so refitting after vertices move is a single reverse sweep.
+// Rays are traced one at a time or in packets of BVH_PACKET_SIZE lanes: 4 with the SSE2
+// baseline the project builds for, 8 in builds that opt into AVX for the whole program
+// (/arch:AVX2, -mavx2), which then only run on CPUs that have it.
+
+constexpr std::uint32_t BVH_NO_HIT = 0xFFFFFFFFu;
+constexpr int BVH_SAH_BINS = 16;
+constexpr int BVH_MAX_LEAF_TRIANGLES = 8;
+constexpr int BVH_STACK_SIZE = 64;
+
+// Below this depth splits stop following the SAH and halve their range instead, so no tree
+// is deeper than BVH_SAH_MAX_DEPTH + 29 levels (2^32 triangles down to leaves of 8) and
+// traversal, which holds at most one entry per level plus one, fits its fixed stack
+constexpr int BVH_SAH_MAX_DEPTH = 32;
+static_assert(BVH_SAH_MAX_DEPTH + 29 + 1 <= BVH_STACK_SIZE, "BVH traversal stack too small for the depth bound");
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    float tMin = 0.0f;
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    float tMax = FLT_MAX;
+};
+
+struct RayHit
+{
+    float t = FLT_MAX;
+    float u = 0.0f;                       // Barycentrics of vertices 1 and 2
+    float v = 0.0f;
+    std::uint32_t triangle = BVH_NO_HIT;  // Index into the triangle list given to build()
+};
+
+struct BvhNode
+{
+    glm::vec3 min;
+    std::uint32_t leftFirst; // First triangle slot for leaves, left child otherwise
+    glm::vec3 max;
+    std::uint16_t count;     // Triangles in a leaf, 0 for inner nodes
+    std::uint16_t axis;      // Split axis of inner nodes, picks the near child first
+};
+
+namespace bvh_simd
+{
+#if defined(CROWN_BVH_AVX)
+    constexpr int WIDTH = 8;
+    struct F { __m256 v; };
+    inline F set1(float x) { return { _mm256_set1_ps(x) }; }
+    inline F load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    inline void store(float* p, F a) { _mm256_storeu_ps(p, a.v); }
+    inline F operator+(F a, F b) { return { _mm256_add_ps(a.v, b.v) }; }
+    inline F operator-(F a, F b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline F operator*(F a, F b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline F operator/(F a, F b) { return { _mm256_div_ps(a.v, b.v) }; }
+    inline F min(F a, F b) { return { _mm256_min_ps(a.v, b.v) }; }
+    inline F max(F a, F b) { return { _mm256_max_ps(a.v, b.v) }; }
+    inline F operator&(F a, F b) { return { _mm256_and_ps(a.v, b.v) }; }
+    inline F lessEqual(F a, F b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+    inline F greater(F a, F b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    inline F greaterEqual(F a, F b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+    inline F select(F mask, F a, F b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+    inline F abs(F a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+    inline int mask(F a) { return _mm256_movemask_ps(a.v); }
+    inline F laneMask(int bits)
+    {
+        const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256i b = _mm256_set1_epi32(bits);
+        return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(b, lanes), lanes)) };
+    }
+#elif defined(CROWN_BVH_SSE)
+    constexpr int WIDTH = 4;
+    struct F { __m128 v; };
+    inline F set1(float x) { return { _mm_set1_ps(x) }; }
+    inline F load(const float* p) { return { _mm_loadu_ps(p) }; }
+    inline void store(float* p, F a) { _mm_storeu_ps(p, a.v); }
+    inline F operator+(F a, F b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline F operator-(F a, F b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline F operator*(F a, F b) { return { _mm_mul_ps(a.v, b.v) }; }
+    inline F operator/(F a, F b) { return { _mm_div_ps(a.v, b.v) }; }
+    inline F min(F a, F b) { return { _mm_min_ps(a.v, b.v) }; }
+    inline F max(F a, F b) { return { _mm_max_ps(a.v, b.v) }; }
+    inline F operator&(F a, F b) { return { _mm_and_ps(a.v, b.v) }; }
+    inline F lessEqual(F a, F b) { return { _mm_cmple_ps(a.v, b.v) }; }
+    inline F greater(F a, F b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    inline F greaterEqual(F a, F b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+    inline F select(F mask, F a, F b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+    inline F abs(F a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+    inline int mask(F a) { return _mm_movemask_ps(a.v); }
+    inline F laneMask(int bits)
+    {
+        const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+        const __m128i b = _mm_set1_epi32(bits);
+        return { _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(b, lanes), lanes)) };
+    }
+#else
+    constexpr int WIDTH = 4;
+    struct F { float v[4]; };
+    template <typename Op>
+    inline F map(F a, F b, Op op) { for (int i = 0; i < 4; ++i) a.v[i] = op(a.v[i], b.v[i]); return a; }
+    inline float bitsToFloat(bool on) { return on ? -std::numeric_limits<float>::quiet_NaN() : 0.0f; }
+    inline bool isSet(float x) { return std::signbit(x); }
+    inline F set1(float x) { return { { x, x, x, x } }; }
+    inline F load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void store(float* p, F a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline F operator+(F a, F b) { return map(a, b, [](float x, float y) { return x + y; }); }
+    inline F operator-(F a, F b) { return map(a, b, [](float x, float y) { return x - y; }); }
+    inline F operator*(F a, F b) { return map(a, b, [](float x, float y) { return x * y; }); }
+    inline F operator/(F a, F b) { return map(a, b, [](float x, float y) { return x / y; }); }
+    inline F min(F a, F b) { return map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    inline F max(F a, F b) { return map(a, b, [](float x, float y) { return y > x ? y : x; }); }
+    inline F operator&(F a, F b) { return map(a, b, [](float x, float y) { return bitsToFloat(isSet(x) && isSet(y)); }); }
+    inline F lessEqual(F a, F b) { return map(a, b, [](float x, float y) { return bitsToFloat(x <= y); }); }
+    inline F greater(F a, F b) { return map(a, b, [](float x, float y) { return bitsToFloat(x > y); }); }
+    inline F greaterEqual(F a, F b) { return map(a, b, [](float x, float y) { return bitsToFloat(x >= y); }); }
+    inline F select(F m, F a, F b) { for (int i = 0; i < 4; ++i) a.v[i] = isSet(m.v[i]) ? a.v[i] : b.v[i]; return a; }
+    inline F abs(F a) { for (float& x : a.v) x = std::abs(x); return a; }
+    inline int mask(F a) { int m = 0; for (int i = 0; i < 4; ++i) m |= isSet(a.v[i]) << i; return m; }
+    inline F laneMask(int bits) { F m; for (int i = 0; i < 4; ++i) m.v[i] = bitsToFloat((bits >> i) & 1); return m; }
+#endif
+}
+
+constexpr int BVH_PACKET_SIZE = bvh_simd::WIDTH;
+
+// Structure-of-arrays ray packet. Lanes outside `active` are ignored and left untouched.
+struct RayPacket
+{
+    float originX[BVH_PACKET_SIZE] = {}, originY[BVH_PACKET_SIZE] = {}, originZ[BVH_PACKET_SIZE] = {};
+    float directionX[BVH_PACKET_SIZE] = {}, directionY[BVH_PACKET_SIZE] = {}, directionZ[BVH_PACKET_SIZE] = {};
+    float tMin[BVH_PACKET_SIZE] = {};
+    float tMax[BVH_PACKET_SIZE] = {};     // Shrinks to the closest hit
+    float u[BVH_PACKET_SIZE] = {}, v[BVH_PACKET_SIZE] = {};
+    std::uint32_t triangle[BVH_PACKET_SIZE] = {};
+    int active = 0;
+
+    void set(int lane, const Ray& ray)
+    {
+        originX[lane] = ray.origin.x; originY[lane] = ray.origin.y; originZ[lane] = ray.origin.z;
+        directionX[lane] = ray.direction.x; directionY[lane] = ray.direction.y; directionZ[lane] = ray.direction.z;
+        tMin[lane] = ray.tMin;
+        tMax[lane] = ray.tMax;
+        u[lane] = v[lane] = 0.0f;
+        triangle[lane] = BVH_NO_HIT;
+        active |= 1 << lane;
+    }
+};
+
+class Bvh
+{
+public:
+    // Three positions per triangle
+    void build(const std::vector<glm::vec3>& positions)
+    {
+        const std::uint32_t triangleCount = static_cast<std::uint32_t>(positions.size() / 3);
+        order.resize(triangleCount);
+        centroids.resize(triangleCount);
+        for (std::uint32_t i = 0; i < triangleCount; ++i)
+        {
+            order[i] = i;
+            centroids[i] = (positions[i * 3] + positions[i * 3 + 1] + positions[i * 3 + 2]) * (1.0f / 3.0f);
+        }
+
+        nodes.clear();
+        nodes.reserve(triangleCount * 2 + 1);
+        BvhNode root = {};
+        root.leftFirst = 0;
+        root.count = 0;
+        nodes.push_back(root);
+        if (triangleCount == 0)
+        {
+            nodes[0].min = nodes[0].max = glm::vec3(0.0f);
+            triangles.clear();
+            return;
+        }
+
+        // Iterative subdivision, ranges kept in a work list
+        struct Work { std::uint32_t node, first, count; int depth; };
+        std::vector<Work> work = { { 0, 0, triangleCount, 0 } };
+        depth = 0;
+        while (!work.empty())
+        {
+            const Work item = work.back();
+            work.pop_back();
+            depth = std::max(depth, item.depth);
+            std::uint32_t leftCount = 0;
+            int axis = 0;
+            if (!split(positions, item.first, item.count, item.depth, leftCount, axis))
+            {
+                makeLeaf(item.node, item.first, item.count);
+                continue;
+            }
+
+            const std::uint32_t left = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back(BvhNode());
+            nodes.push_back(BvhNode());
+            nodes[item.node].leftFirst = left;
+            nodes[item.node].count = 0;
+            nodes[item.node].axis = static_cast<std::uint16_t>(axis);
+            work.push_back({ left, item.first, leftCount, item.depth + 1 });
+            work.push_back({ left + 1, item.first + leftCount, item.count - leftCount, item.depth + 1 });
+        }
+        centroids.clear();
+        centroids.shrink_to_fit();
+        refit(positions);
+    }
+
+    // Recompute triangle data and node bounds after vertices moved, keeping the topology
+    void refit(const std::vector<glm::vec3>& positions)
+    {
+        triangles.resize(order.size());
+        for (std::size_t slot = 0; slot < order.size(); ++slot)
+        {
+            const glm::vec3& p0 = positions[order[slot] * 3];
+            triangles[slot].v0 = p0;
+            triangles[slot].edge1 = positions[order[slot] * 3 + 1] - p0;
+            triangles[slot].edge2 = positions[order[slot] * 3 + 2] - p0;
+        }
+
+        for (std::size_t n = nodes.size(); n-- > 0;)
+        {
+            BvhNode& node = nodes[n];
+            if (node.count > 0)
+            {
+                node.min = glm::vec3(FLT_MAX);
+                node.max = glm::vec3(-FLT_MAX);
+                for (std::uint32_t i = 0; i < node.count; ++i)
+                {
+                    const std::uint32_t triangle = order[node.leftFirst + i];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        node.min = glm::min(node.min, positions[triangle * 3 + k]);
+                        node.max = glm::max(node.max, positions[triangle * 3 + k]);
+                    }
+                }
+            }
+            else if (!order.empty())
+            {
+                const BvhNode& left = nodes[node.leftFirst];
+                const BvhNode& right = nodes[node.leftFirst + 1];
+                node.min = glm::min(left.min, right.min);
+                node.max = glm::max(left.max, right.max);
+            }
+        }
+    }
+
+    // Closest hit along the ray, updates `hit` only when something is closer than hit.t
+    bool intersect(const Ray& ray, RayHit& hit) const
+    {
+        if (order.empty())
+            return false;
+        const glm::vec3 invDir = 1.0f / ray.direction;
+        float tMax = std::min(ray.tMax, hit.t);
+        bool found = false;
+
+        std::uint32_t stack[BVH_STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BvhNode& node = nodes[stack[--top]];
+            if (!slabTest(node, ray.origin, invDir, ray.tMin, tMax))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (std::uint32_t i = 0; i < node.count; ++i)
+                {
+                    float t, u, v;
+                    if (intersectTriangle(triangles[node.leftFirst + i], ray, ray.tMin, tMax, t, u, v))
+                    {
+                        tMax = t;
+                        hit.t = t;
+                        hit.u = u;
+                        hit.v = v;
+                        hit.triangle = order[node.leftFirst + i];
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // Push the far child first so the near one is popped next
+            assert(top + 2 <= BVH_STACK_SIZE);
+            const bool flip = ray.direction[node.axis] < 0.0f;
+            stack[top++] = node.leftFirst + (flip ? 0 : 1);
+            stack[top++] = node.leftFirst + (flip ? 1 : 0);
+        }
+        return found;
+    }
+
+    // Any hit in [tMin, tMax), for shadow rays
+    bool occluded(const Ray& ray) const
+    {
+        if (order.empty())
+            return false;
+        const glm::vec3 invDir = 1.0f / ray.direction;
+        std::uint32_t stack[BVH_STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BvhNode& node = nodes[stack[--top]];
+            if (!slabTest(node, ray.origin, invDir, ray.tMin, ray.tMax))
+                continue;
+            if (node.count > 0)
+            {
+                float t, u, v;
+                for (std::uint32_t i = 0; i < node.count; ++i)
+                    if (intersectTriangle(triangles[node.leftFirst + i], ray, ray.tMin, ray.tMax, t, u, v))
+                        return true;
+                continue;
+            }
+            assert(top + 2 <= BVH_STACK_SIZE);
+            stack[top++] = node.leftFirst;
+            stack[top++] = node.leftFirst + 1;
+        }
+        return false;
+    }
+
+    // Closest hits for every active lane. Nodes are visited while any lane's slab test passes;
+    // each triangle is tested against all lanes at once.
+    void intersect(RayPacket& packet) const
+    {
+        traversePacket(packet, false);
+    }
+
+    // Mask of active lanes hitting anything in [tMin, tMax)
+    int occluded(const RayPacket& packet) const
+    {
+        RayPacket copy = packet;
+        return traversePacket(copy, true);
+    }
+
+    const std::vector<BvhNode>& nodeList() const { return nodes; }
+    int treeDepth() const { return depth; } // Levels below the root
+    std::size_t triangleCount() const { return order.size(); }
+
+private:
+    struct Triangle
+    {
+        glm::vec3 v0, edge1, edge2;
+    };
+
+    static bool slabTest(const BvhNode& node, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax)
+    {
+        const glm::vec3 t0 = (node.min - origin) * invDir;
+        const glm::vec3 t1 = (node.max - origin) * invDir;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+        const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return enter <= exit;
+    }
+
+    // Moller-Trumbore, two-sided
+    static bool intersectTriangle(const Triangle& tri, const Ray& ray, float tMin, float tMax, float& t, float& u, float& v)
+    {
+        const glm::vec3 p = glm::cross(ray.direction, tri.edge2);
+        const float det = glm::dot(tri.edge1, p);
+        if (std::abs(det) < 1e-12f)
+            return false;
+        const float invDet = 1.0f / det;
+        const glm::vec3 s = ray.origin - tri.v0;
+        u = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        const glm::vec3 q = glm::cross(s, tri.edge1);
+        v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+        t = glm::dot(tri.edge2, q) * invDet;
+        return t > tMin && t < tMax;
+    }
+
+    int traversePacket(RayPacket& packet, bool anyHit) const
+    {
+        using namespace bvh_simd;
+        if (order.empty() || !packet.active)
+            return 0;
+
+        const F ox = load(packet.originX), oy = load(packet.originY), oz = load(packet.originZ);
+        const F dx = load(packet.directionX), dy = load(packet.directionY), dz = load(packet.directionZ);
+        const F one = set1(1.0f);
+        const F ix = one / dx, iy = one / dy, iz = one / dz;
+        const F tMin = load(packet.tMin);
+        const F active = laneMask(packet.active);
+        F tMax = load(packet.tMax);
+        F hitU = load(packet.u), hitV = load(packet.v);
+        int hitMask = 0;
+
+        // Children are visited in the order most active lanes travel along the split axis;
+        // for coherent packets that is every lane's order, for others a fair guess
+        bool flipAxis[3];
+        const float* directions[3] = { packet.directionX, packet.directionY, packet.directionZ };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            int negative = 0, lanes = 0;
+            for (int l = 0; l < BVH_PACKET_SIZE; ++l)
+            {
+                if (!((packet.active >> l) & 1))
+                    continue;
+                ++lanes;
+                negative += directions[axis][l] < 0.0f;
+            }
+            flipAxis[axis] = 2 * negative > lanes;
+        }
+
+        std::uint32_t stack[BVH_STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BvhNode& node = nodes[stack[--top]];
+            const F tx0 = (set1(node.min.x) - ox) * ix, tx1 = (set1(node.max.x) - ox) * ix;
+            const F ty0 = (set1(node.min.y) - oy) * iy, ty1 = (set1(node.max.y) - oy) * iy;
+            const F tz0 = (set1(node.min.z) - oz) * iz, tz1 = (set1(node.max.z) - oz) * iz;
+            const F enter = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), tMin));
+            const F exit = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), tMax));
+            if (!mask(lessEqual(enter, exit) & active))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (std::uint32_t i = 0; i < node.count; ++i)
+                {
+                    const Triangle& tri = triangles[node.leftFirst + i];
+                    const F e1x = set1(tri.edge1.x), e1y = set1(tri.edge1.y), e1z = set1(tri.edge1.z);
+                    const F e2x = set1(tri.edge2.x), e2y = set1(tri.edge2.y), e2z = set1(tri.edge2.z);
+                    const F px = dy * e2z - dz * e2y, py = dz * e2x - dx * e2z, pz = dx * e2y - dy * e2x;
+                    const F det = e1x * px + e1y * py + e1z * pz;
+                    const F invDet = one / det;
+                    const F sx = ox - set1(tri.v0.x), sy = oy - set1(tri.v0.y), sz = oz - set1(tri.v0.z);
+                    const F u = (sx * px + sy * py + sz * pz) * invDet;
+                    const F qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+                    const F v = (dx * qx + dy * qy + dz * qz) * invDet;
+                    const F t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+                    const F hit = active & greater(abs(det), set1(1e-12f)) & greaterEqual(u, set1(0.0f)) &
+                                  greaterEqual(v, set1(0.0f)) & lessEqual(u + v, one) & greater(t, tMin) & greater(tMax, t);
+                    const int bits = mask(hit);
+                    if (!bits)
+                        continue;
+                    if (anyHit)
+                    {
+                        hitMask |= bits;
+                        if (hitMask == packet.active)
+                            return hitMask;
+                        continue;
+                    }
+                    tMax = select(hit, t, tMax);
+                    hitU = select(hit, u, hitU);
+                    hitV = select(hit, v, hitV);
+                    for (int l = 0; l < BVH_PACKET_SIZE; ++l)
+                        if ((bits >> l) & 1)
+                            packet.triangle[l] = order[node.leftFirst + i];
+                    hitMask |= bits;
+                }
+                continue;
+            }
+
+            assert(top + 2 <= BVH_STACK_SIZE);
+            const bool flip = flipAxis[node.axis];
+            stack[top++] = node.leftFirst + (flip ? 0 : 1);
+            stack[top++] = node.leftFirst + (flip ? 1 : 0);
+        }
+
+        if (!anyHit)
+        {
+            store(packet.tMax, tMax);
+            store(packet.u, hitU);
+            store(packet.v, hitV);
+        }
+        return hitMask;
+    }
+
+    // Binned SAH split of order[first, first + count) at `depth`. False when a leaf is cheaper.
+    bool split(const std::vector<glm::vec3>& positions, std::uint32_t first, std::uint32_t count, int depth,
+        std::uint32_t& leftCount, int& splitAxis)
+    {
+        if (count <= 2)
+            return false;
+        if (depth >= BVH_SAH_MAX_DEPTH)
+            return halve(count, leftCount, splitAxis);
+
+        glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX), centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+        for (std::uint32_t i = first; i < first + count; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                boundsMin = glm::min(boundsMin, positions[order[i] * 3 + k]);
+                boundsMax = glm::max(boundsMax, positions[order[i] * 3 + k]);
+            }
+            centroidMin = glm::min(centroidMin, centroids[order[i]]);
+            centroidMax = glm::max(centroidMax, centroids[order[i]]);
+        }
+
+        auto area = [](const glm::vec3& lo, const glm::vec3& hi)
+        {
+            const glm::vec3 e = glm::max(hi - lo, glm::vec3(0.0f));
+            return e.x * e.y + e.y * e.z + e.z * e.x;
+        };
+
+        float bestCost = FLT_MAX;
+        int bestAxis = -1, bestBin = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float extent = centroidMax[axis] - centroidMin[axis];
+            if (extent <= 0.0f)
+                continue;
+
+            struct Bin { glm::vec3 lo = glm::vec3(FLT_MAX), hi = glm::vec3(-FLT_MAX); std::uint32_t count = 0; };
+            Bin bins[BVH_SAH_BINS];
+            const float scale = BVH_SAH_BINS / extent;
+            for (std::uint32_t i = first; i < first + count; ++i)
+            {
+                const int b = std::min(BVH_SAH_BINS - 1, static_cast<int>((centroids[order[i]][axis] - centroidMin[axis]) * scale));
+                ++bins[b].count;
+                for (int k = 0; k < 3; ++k)
+                {
+                    bins[b].lo = glm::min(bins[b].lo, positions[order[i] * 3 + k]);
+                    bins[b].hi = glm::max(bins[b].hi, positions[order[i] * 3 + k]);
+                }
+            }
+
+            // Sweep from the right, then from the left evaluating every plane
+            float rightArea[BVH_SAH_BINS];
+            std::uint32_t rightCount[BVH_SAH_BINS];
+            glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+            std::uint32_t n = 0;
+            for (int b = BVH_SAH_BINS - 1; b > 0; --b)
+            {
+                lo = glm::min(lo, bins[b].lo);
+                hi = glm::max(hi, bins[b].hi);
+                n += bins[b].count;
+                rightArea[b] = area(lo, hi);
+                rightCount[b] = n;
+            }
+            lo = glm::vec3(FLT_MAX);
+            hi = glm::vec3(-FLT_MAX);
+            n = 0;
+            for (int b = 0; b < BVH_SAH_BINS - 1; ++b)
+            {
+                lo = glm::min(lo, bins[b].lo);
+                hi = glm::max(hi, bins[b].hi);
+                n += bins[b].count;
+                if (n == 0 || rightCount[b + 1] == 0)
+                    continue;
+                const float cost = area(lo, hi) * n + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        // Traversal step costs about one triangle test
+        const float parentArea = area(boundsMin, boundsMax);
+        const float leafCost = static_cast<float>(count);
+        const float splitCost = 1.0f + (parentArea > 0.0f ? bestCost / parentArea : FLT_MAX);
+        if (bestAxis < 0 || (splitCost >= leafCost && count <= BVH_MAX_LEAF_TRIANGLES))
+        {
+            // Coincident centroids: halve the range so leaves stay bounded
+            return halve(count, leftCount, splitAxis);
+        }
+
+        const float scale = BVH_SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+        auto middle = std::partition(order.begin() + first, order.begin() + first + count, [&](std::uint32_t triangle)
+        {
+            return std::min(BVH_SAH_BINS - 1, static_cast<int>((centroids[triangle][bestAxis] - centroidMin[bestAxis]) * scale)) <= bestBin;
+        });
+        leftCount = static_cast<std::uint32_t>(middle - (order.begin() + first));
+        splitAxis = bestAxis;
+        if (leftCount == 0 || leftCount == count)
+            return halve(count, leftCount, splitAxis);
+        return true;
+    }
+
+    // Split in the middle of the range when the SAH cannot, unless it already fits a leaf
+    static bool halve(std::uint32_t count, std::uint32_t& leftCount, int& splitAxis)
+    {
+        if (count <= static_cast<std::uint32_t>(BVH_MAX_LEAF_TRIANGLES))
+            return false;
+        leftCount = count / 2;
+        splitAxis = 0;
+        return true;
+    }
+
+    void makeLeaf(std::uint32_t node, std::uint32_t first, std::uint32_t count)
+    {
+        nodes[node].leftFirst = first;
+        nodes[node].count = static_cast<std::uint16_t>(count);
+        nodes[node].axis = 0;
+    }
+
+    std::vector<BvhNode> nodes;
+    std::vector<std::uint32_t> order;     // Slot -> triangle index given to build()
+    std::vector<Triangle> triangles;      // In slot order
+    std::vector<glm::vec3> centroids;     // Build only
+    int depth = 0;
+};
+
+#endif
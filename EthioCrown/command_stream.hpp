@@ -0,0 +1,406 @@
+#ifndef COMMAND_STREAM_HPP
+#define COMMAND_STREAM_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// Recorded frames: the frame builder writes compact binary commands instead of calling GL
+// and the backend replays them, as often as it likes while nothing changes. GL objects are
+// referred to by index into a resource table registered at startup, so a stream saved to
+// disk replays in a later run that registers the same resources in the same order.
+
+// Bump allocator over one growable block. reset() rewinds without freeing, so once the
+// block has grown to a frame's size recording allocates nothing. Allocations are returned
+// as offsets, which stay valid when the block grows.
+class LinearAllocator
+{
+public:
+    std::size_t allocate(std::size_t bytes, std::size_t alignment = 8)
+    {
+        const std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes > storage.size())
+            storage.resize(std::max(offset + bytes, storage.size() * 2));
+        used = offset + bytes;
+        return offset;
+    }
+
+    // Replace the contents with `count` bytes, keeping the block
+    void assign(const void* bytes, std::size_t count)
+    {
+        used = 0;
+        if (count > 0)
+            std::memcpy(at(allocate(count)), bytes, count);
+    }
+
+    void reset() { used = 0; }
+
+    void* at(std::size_t offset) { return storage.data() + offset; }
+    const void* at(std::size_t offset) const { return storage.data() + offset; }
+    std::size_t size() const { return used; }
+    std::size_t capacity() const { return storage.size(); }
+
+private:
+    std::vector<std::uint8_t> storage;
+    std::size_t used = 0;
+};
+
+// GL names and uniform locations that commands refer to by index
+struct CommandResources
+{
+    std::vector<GLuint> objects; // Programs, vertex arrays, textures and buffers
+    std::vector<GLint> uniforms;
+
+    std::uint32_t addObject(GLuint name)
+    {
+        objects.push_back(name);
+        return static_cast<std::uint32_t>(objects.size() - 1);
+    }
+
+    std::uint32_t addUniform(GLint location)
+    {
+        uniforms.push_back(location);
+        return static_cast<std::uint32_t>(uniforms.size() - 1);
+    }
+};
+
+enum CommandOp : std::uint16_t
+{
+    CMD_CLEAR,
+    CMD_USE_PROGRAM,
+    CMD_UNIFORM_INT,
+    CMD_UNIFORM_MAT4,
+    CMD_BIND_VERTEX_ARRAY,
+    CMD_BIND_TEXTURE,
+    CMD_BIND_INDEX_BUFFER,
+    CMD_DRAW_ELEMENTS,
+    CMD_MULTI_DRAW_ELEMENTS,
+    CMD_OP_COUNT
+};
+
+// Every command starts with this; `size` covers the header and payload and keeps the next
+// command 8-byte aligned. Draws are always indexed GL_UNSIGNED_INT triangles.
+struct CommandHeader
+{
+    std::uint16_t op;
+    std::uint16_t reserved;
+    std::uint32_t size;
+};
+
+namespace command_detail
+{
+    struct ClearCommand { CommandHeader header; std::uint32_t mask; };
+    struct ResourceCommand { CommandHeader header; std::uint32_t resource; };
+    struct UniformIntCommand { CommandHeader header; std::uint32_t uniform; std::int32_t value; };
+    struct UniformMat4Command { CommandHeader header; std::uint32_t uniform; float value[16]; };
+    struct DrawElementsCommand { CommandHeader header; std::uint32_t count; std::uint64_t byteOffset; };
+    // Followed by drawCount byte offsets (uint64) and then drawCount counts (int32)
+    struct MultiDrawCommand { CommandHeader header; std::uint32_t drawCount; std::uint32_t reserved; };
+
+    constexpr std::uint32_t NO_RESOURCE = 0xffffffffu;
+    constexpr char FILE_MAGIC[4] = { 'E', 'C', 'C', 'S' };
+    constexpr std::uint32_t FILE_VERSION = 1;
+
+    // Native byte order; captures are meant to be replayed on the machine that made them
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t commandCount;
+        std::uint32_t reserved;
+        std::uint64_t bytes;
+    };
+
+    inline std::size_t alignCommand(std::size_t bytes) { return (bytes + 7) & ~std::size_t(7); }
+}
+
+class CommandStream
+{
+public:
+    void reset()
+    {
+        arena.reset();
+        commands = 0;
+        boundProgram = boundVertexArray = boundTexture = boundIndexBuffer = command_detail::NO_RESOURCE;
+    }
+
+    void clear(GLbitfield mask) { append<command_detail::ClearCommand>(CMD_CLEAR)->mask = mask; }
+
+    void useProgram(std::uint32_t program)
+    {
+        if (program != boundProgram)
+            append<command_detail::ResourceCommand>(CMD_USE_PROGRAM)->resource = program;
+        boundProgram = program;
+    }
+
+    void uniformInt(std::uint32_t uniform, int value)
+    {
+        command_detail::UniformIntCommand* command = append<command_detail::UniformIntCommand>(CMD_UNIFORM_INT);
+        command->uniform = uniform;
+        command->value = value;
+    }
+
+    void uniformMat4(std::uint32_t uniform, const glm::mat4& value)
+    {
+        command_detail::UniformMat4Command* command = append<command_detail::UniformMat4Command>(CMD_UNIFORM_MAT4);
+        command->uniform = uniform;
+        std::memcpy(command->value, glm::value_ptr(value), sizeof(command->value));
+    }
+
+    // Binds already in effect earlier in the stream are dropped
+    void bindVertexArray(std::uint32_t vertexArray)
+    {
+        if (vertexArray == boundVertexArray)
+            return;
+        append<command_detail::ResourceCommand>(CMD_BIND_VERTEX_ARRAY)->resource = vertexArray;
+        boundVertexArray = vertexArray;
+        boundIndexBuffer = command_detail::NO_RESOURCE; // The index buffer is vertex array state
+    }
+
+    void bindTexture(std::uint32_t texture)
+    {
+        if (texture == boundTexture)
+            return;
+        append<command_detail::ResourceCommand>(CMD_BIND_TEXTURE)->resource = texture;
+        boundTexture = texture;
+    }
+
+    void bindIndexBuffer(std::uint32_t buffer)
+    {
+        if (buffer == boundIndexBuffer)
+            return;
+        append<command_detail::ResourceCommand>(CMD_BIND_INDEX_BUFFER)->resource = buffer;
+        boundIndexBuffer = buffer;
+    }
+
+    void drawElements(GLsizei count, std::size_t byteOffset)
+    {
+        command_detail::DrawElementsCommand* command = append<command_detail::DrawElementsCommand>(CMD_DRAW_ELEMENTS);
+        command->count = static_cast<std::uint32_t>(count);
+        command->byteOffset = byteOffset;
+    }
+
+    void multiDrawElements(const GLsizei* counts, const GLvoid* const* byteOffsets, GLsizei drawCount)
+    {
+        if (drawCount == 0)
+            return;
+        const std::size_t extra = drawCount * (sizeof(std::uint64_t) + sizeof(std::int32_t));
+        command_detail::MultiDrawCommand* command = append<command_detail::MultiDrawCommand>(CMD_MULTI_DRAW_ELEMENTS, extra);
+        command->drawCount = static_cast<std::uint32_t>(drawCount);
+        std::uint8_t* payload = reinterpret_cast<std::uint8_t*>(command + 1);
+        for (GLsizei i = 0; i < drawCount; ++i)
+        {
+            const std::uint64_t offset = reinterpret_cast<std::uintptr_t>(byteOffsets[i]);
+            std::memcpy(payload + i * sizeof(std::uint64_t), &offset, sizeof(offset));
+        }
+        std::memcpy(payload + drawCount * sizeof(std::uint64_t), counts, drawCount * sizeof(std::int32_t));
+    }
+
+    // Replace this stream with another recording without rebuilding it
+    void copyFrom(const CommandStream& other)
+    {
+        arena.assign(other.arena.at(0), other.arena.size());
+        commands = other.commands;
+        boundProgram = other.boundProgram;
+        boundVertexArray = other.boundVertexArray;
+        boundTexture = other.boundTexture;
+        boundIndexBuffer = other.boundIndexBuffer;
+    }
+
+    bool save(const char* path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        command_detail::FileHeader header = {};
+        std::memcpy(header.magic, command_detail::FILE_MAGIC, sizeof(header.magic));
+        header.version = command_detail::FILE_VERSION;
+        header.commandCount = static_cast<std::uint32_t>(commands);
+        header.bytes = arena.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(static_cast<const char*>(arena.at(0)), arena.size());
+        return static_cast<bool>(file);
+    }
+
+    // Rejects files that are not well-formed or refer to resources missing from `resources`
+    bool load(const char* path, const CommandResources& resources)
+    {
+        reset();
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        const std::streamoff fileSize = file.tellg();
+        file.seekg(0);
+        command_detail::FileHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, command_detail::FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != command_detail::FILE_VERSION ||
+            header.bytes != static_cast<std::uint64_t>(fileSize) - sizeof(header))
+            return false;
+        std::vector<char> bytes(header.bytes);
+        if (!file.read(bytes.data(), bytes.size()))
+            return false;
+        arena.assign(bytes.data(), bytes.size());
+        commands = header.commandCount;
+        if (!validate(resources))
+        {
+            reset();
+            return false;
+        }
+        // Nothing is known about GL state at the end of a loaded stream
+        boundProgram = boundVertexArray = boundTexture = boundIndexBuffer = command_detail::NO_RESOURCE;
+        return true;
+    }
+
+    std::size_t commandCount() const { return commands; }
+    std::size_t bytes() const { return arena.size(); }
+    const std::uint8_t* data() const { return static_cast<const std::uint8_t*>(arena.at(0)); }
+
+private:
+    template <typename Command>
+    Command* append(CommandOp op, std::size_t extraBytes = 0)
+    {
+        const std::size_t size = command_detail::alignCommand(sizeof(Command) + extraBytes);
+        Command* command = static_cast<Command*>(arena.at(arena.allocate(size)));
+        std::memset(command, 0, size); // Padding included, so saved captures are deterministic
+        command->header.op = op;
+        command->header.size = static_cast<std::uint32_t>(size);
+        ++commands;
+        return command;
+    }
+
+    bool validate(const CommandResources& resources) const
+    {
+        using namespace command_detail;
+        std::size_t offset = 0, count = 0;
+        while (offset < arena.size())
+        {
+            CommandHeader header;
+            if (arena.size() - offset < sizeof(header))
+                return false;
+            std::memcpy(&header, data() + offset, sizeof(header));
+            if (header.op >= CMD_OP_COUNT || header.size < sizeof(header) || header.size % 8 != 0 || header.size > arena.size() - offset)
+                return false;
+
+            const std::uint8_t* command = data() + offset;
+            std::uint32_t index = 0;
+            switch (header.op)
+            {
+            case CMD_CLEAR:
+                if (header.size < sizeof(ClearCommand))
+                    return false;
+                break;
+            case CMD_USE_PROGRAM:
+            case CMD_BIND_VERTEX_ARRAY:
+            case CMD_BIND_TEXTURE:
+            case CMD_BIND_INDEX_BUFFER:
+                if (header.size < sizeof(ResourceCommand))
+                    return false;
+                std::memcpy(&index, command + offsetof(ResourceCommand, resource), sizeof(index));
+                if (index >= resources.objects.size())
+                    return false;
+                break;
+            case CMD_UNIFORM_INT:
+            case CMD_UNIFORM_MAT4:
+                if (header.size < (header.op == CMD_UNIFORM_INT ? sizeof(UniformIntCommand) : sizeof(UniformMat4Command)))
+                    return false;
+                std::memcpy(&index, command + sizeof(CommandHeader), sizeof(index));
+                if (index >= resources.uniforms.size())
+                    return false;
+                break;
+            case CMD_DRAW_ELEMENTS:
+                if (header.size < sizeof(DrawElementsCommand))
+                    return false;
+                break;
+            case CMD_MULTI_DRAW_ELEMENTS:
+                std::memcpy(&index, command + offsetof(MultiDrawCommand, drawCount), sizeof(index));
+                if (header.size < sizeof(MultiDrawCommand) + std::uint64_t(index) * (sizeof(std::uint64_t) + sizeof(std::int32_t)))
+                    return false;
+                break;
+            }
+            offset += header.size;
+            ++count;
+        }
+        return count == commands;
+    }
+
+    LinearAllocator arena;
+    std::size_t commands = 0;
+    // GL state at the end of the recording so far, for dropping redundant binds
+    std::uint32_t boundProgram = command_detail::NO_RESOURCE;
+    std::uint32_t boundVertexArray = command_detail::NO_RESOURCE;
+    std::uint32_t boundTexture = command_detail::NO_RESOURCE;
+    std::uint32_t boundIndexBuffer = command_detail::NO_RESOURCE;
+};
+
+// Issues a recorded stream on the thread that owns the GL context
+class CommandPlayer
+{
+public:
+    void replay(const CommandStream& stream, const CommandResources& resources)
+    {
+        using namespace command_detail;
+        const std::uint8_t* command = stream.data();
+        const std::uint8_t* end = command + stream.bytes();
+        while (command < end)
+        {
+            const CommandHeader& header = *reinterpret_cast<const CommandHeader*>(command);
+            switch (header.op)
+            {
+            case CMD_CLEAR:
+                glClear(reinterpret_cast<const ClearCommand*>(command)->mask);
+                break;
+            case CMD_USE_PROGRAM:
+                glUseProgram(resources.objects[reinterpret_cast<const ResourceCommand*>(command)->resource]);
+                break;
+            case CMD_UNIFORM_INT:
+            {
+                const UniformIntCommand* uniform = reinterpret_cast<const UniformIntCommand*>(command);
+                glUniform1i(resources.uniforms[uniform->uniform], uniform->value);
+                break;
+            }
+            case CMD_UNIFORM_MAT4:
+            {
+                const UniformMat4Command* uniform = reinterpret_cast<const UniformMat4Command*>(command);
+                glUniformMatrix4fv(resources.uniforms[uniform->uniform], 1, GL_FALSE, uniform->value);
+                break;
+            }
+            case CMD_BIND_VERTEX_ARRAY:
+                glBindVertexArray(resources.objects[reinterpret_cast<const ResourceCommand*>(command)->resource]);
+                break;
+            case CMD_BIND_TEXTURE:
+                glBindTexture(GL_TEXTURE_2D, resources.objects[reinterpret_cast<const ResourceCommand*>(command)->resource]);
+                break;
+            case CMD_BIND_INDEX_BUFFER:
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, resources.objects[reinterpret_cast<const ResourceCommand*>(command)->resource]);
+                break;
+            case CMD_DRAW_ELEMENTS:
+            {
+                const DrawElementsCommand* draw = reinterpret_cast<const DrawElementsCommand*>(command);
+                glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(draw->count), GL_UNSIGNED_INT,
+                    reinterpret_cast<const GLvoid*>(static_cast<std::uintptr_t>(draw->byteOffset)));
+                break;
+            }
+            case CMD_MULTI_DRAW_ELEMENTS:
+            {
+                const MultiDrawCommand* draw = reinterpret_cast<const MultiDrawCommand*>(command);
+                const std::uint64_t* byteOffsets = reinterpret_cast<const std::uint64_t*>(draw + 1);
+                offsets.resize(draw->drawCount);
+                for (std::uint32_t i = 0; i < draw->drawCount; ++i)
+                    offsets[i] = reinterpret_cast<const GLvoid*>(static_cast<std::uintptr_t>(byteOffsets[i]));
+                glMultiDrawElements(GL_TRIANGLES, reinterpret_cast<const GLsizei*>(byteOffsets + draw->drawCount),
+                    GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(draw->drawCount));
+                break;
+            }
+            }
+            command += header.size;
+        }
+    }
+
+private:
+    std::vector<const GLvoid*> offsets;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+// Runtime CPU feature checks for the kernels that have AVX2 versions. The project builds
+// for the SSE2 baseline; AVX2 kernels are compiled function by function with
+// CROWN_AVX2_TARGET and picked through a function pointer when cpuHasAvx2() says so, so
+// one binary runs everywhere. MSVC accepts AVX2 intrinsics without /arch, so the macro
+// is empty there.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CROWN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CROWN_AVX2_TARGET
+#else
+#define CROWN_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+inline bool cpuHasAvx2()
+{
+#if defined(CROWN_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // AVX needs OS support for the YMM state as well as the CPU flag
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(CROWN_X86)
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+#endif
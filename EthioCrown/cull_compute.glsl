@@ -0,0 +1,132 @@
+#version 430 core
+layout(local_size_x = 64) in;
+
+// Must match DrawElementsIndirectCommand and GpuObject in gpu_culling.hpp
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+struct ObjectData
+{
+    mat4 model;
+    uint mesh;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+layout(std430, binding = 1) readonly buffer MeshBounds { vec4 meshSpheres[]; }; // xyz = center, w = radius
+layout(std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) writeonly buffer Visible { uint visibleObjects[]; };
+layout(std430, binding = 4) buffer Visibility { uint visibleLastFrame[]; };
+layout(std430, binding = 5) buffer Stats { uint occludedObjects; uint testedObjects; };
+
+// 0 = frustum only, 1 = draw what was visible last frame, 2 = Hi-Z re-test of everything
+const uint PHASE_FRUSTUM = 0u;
+const uint PHASE_PREVIOUS = 1u;
+const uint PHASE_OCCLUSION = 2u;
+
+// Must match GpuCullParams in gpu_culling.hpp
+layout(std140, binding = 0) uniform CullParams
+{
+    vec4 frustumPlanes[6];
+    mat4 viewProjection;
+    uint objectCount;
+    uint phase;
+    int hiZLevels;
+};
+uniform sampler2D hiZ;
+
+// Conservative Hi-Z test of a world-space sphere: compare the nearest depth of its box
+// with the farthest depth stored over its screen rectangle
+bool occluded(vec3 center, float radius)
+{
+    vec2 rectMin = vec2(1.0);
+    vec2 rectMax = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false; // Crosses the camera plane, always draw
+        vec3 ndc = clip.xyz / clip.w;
+        rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);
+        rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    rectMin = clamp(rectMin, 0.0, 1.0);
+    rectMax = clamp(rectMax, 0.0, 1.0);
+
+    // Mip where the rectangle spans at most two texels in each direction. Texel j of level L
+    // covers pixels [j << L, (j + 1) << L) and the last one also the odd leftovers.
+    vec2 baseSize = vec2(textureSize(hiZ, 0));
+    vec2 extent = (rectMax - rectMin) * baseSize;
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hiZLevels - 1);
+    ivec2 levelLast = textureSize(hiZ, level) - 1;
+    ivec2 a = min(ivec2(min(rectMin * baseSize, baseSize - 1.0)) >> level, levelLast);
+    ivec2 b = min(ivec2(min(rectMax * baseSize, baseSize - 1.0)) >> level, levelLast);
+
+    float farthest = max(max(texelFetch(hiZ, a, level).r, texelFetch(hiZ, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(hiZ, ivec2(a.x, b.y), level).r, texelFetch(hiZ, b, level).r));
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= objectCount)
+        return;
+
+    // World-space bounding sphere of this instance
+    ObjectData object = objects[id];
+    vec4 sphere = meshSpheres[object.mesh];
+    vec3 center = (object.model * vec4(sphere.xyz, 1.0)).xyz;
+    float scale = max(length(object.model[0].xyz), max(length(object.model[1].xyz), length(object.model[2].xyz)));
+    float radius = sphere.w * scale;
+
+    bool inFrustum = true;
+    for (int i = 0; i < 6; ++i)
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+            inFrustum = false;
+
+    if (phase == PHASE_PREVIOUS)
+    {
+        // Redraw last frame's visible set, it seeds this frame's depth pyramid
+        if (!inFrustum || visibleLastFrame[id] == 0u)
+            return;
+    }
+    else if (phase == PHASE_OCCLUSION)
+    {
+        // Re-test everything against this frame's pyramid. Objects drawn in the first phase
+        // only update their flag, newly revealed ones are drawn now so nothing pops in late.
+        bool wasVisible = visibleLastFrame[id] != 0u;
+        bool visible = inFrustum;
+        if (inFrustum)
+        {
+            atomicAdd(testedObjects, 1u);
+            if (occluded(center, radius))
+            {
+                atomicAdd(occludedObjects, 1u);
+                visible = false;
+            }
+        }
+        visibleLastFrame[id] = visible ? 1u : 0u;
+        if (!visible || wasVisible)
+            return;
+    }
+    else if (!inFrustum)
+    {
+        return;
+    }
+
+    // Append to the instance list of this mesh's draw command
+    uint slot = atomicAdd(commands[object.mesh].instanceCount, 1u);
+    visibleObjects[commands[object.mesh].baseInstance + slot] = id;
+}
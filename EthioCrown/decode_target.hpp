@@ -0,0 +1,85 @@
+#ifndef DECODE_TARGET_HPP
+#define DECODE_TARGET_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+// stb_image allocator hooks that let one decode write its output straight into caller
+// memory, e.g. a mapped pixel unpack buffer. The caller points the current thread at a
+// target sized for the image; the first allocation that fits it is served from the target
+// and every other allocation goes to the heap as usual. main.cpp installs the hooks as
+// STBI_MALLOC / STBI_REALLOC / STBI_FREE before expanding stb_image.
+
+struct DecodeTarget
+{
+    unsigned char* data = nullptr;
+    std::size_t capacity = 0;
+    std::size_t expected = 0;   // Smallest allocation that can be the output image
+    bool claimed = false;
+};
+
+inline DecodeTarget*& currentDecodeTarget()
+{
+    thread_local DecodeTarget* target = nullptr;
+    return target;
+}
+
+inline bool ownedByDecodeTarget(const void* pointer)
+{
+    const DecodeTarget* target = currentDecodeTarget();
+    return target && target->claimed && pointer == target->data;
+}
+
+inline void* decodeMalloc(std::size_t size)
+{
+    DecodeTarget* target = currentDecodeTarget();
+    if (target && !target->claimed && size >= target->expected && size <= target->capacity)
+    {
+        target->claimed = true;
+        return target->data;
+    }
+    return std::malloc(size);
+}
+
+inline void* decodeRealloc(void* pointer, std::size_t size)
+{
+    if (!ownedByDecodeTarget(pointer))
+        return std::realloc(pointer, size);
+    DecodeTarget* target = currentDecodeTarget();
+    if (size <= target->capacity)
+        return pointer;
+    // Outgrew the target, move to the heap and give the target up
+    void* moved = std::malloc(size);
+    if (moved)
+    {
+        std::memcpy(moved, pointer, target->capacity);
+        target->claimed = false;
+    }
+    return moved;
+}
+
+inline void decodeFree(void* pointer)
+{
+    if (!ownedByDecodeTarget(pointer))
+        std::free(pointer);
+}
+
+// Points the current thread's decodes at `target` for the lifetime of the scope
+class DecodeTargetScope
+{
+public:
+    explicit DecodeTargetScope(DecodeTarget& target) : previous(currentDecodeTarget())
+    {
+        currentDecodeTarget() = &target;
+    }
+    ~DecodeTargetScope() { currentDecodeTarget() = previous; }
+
+    DecodeTargetScope(const DecodeTargetScope&) = delete;
+    DecodeTargetScope& operator=(const DecodeTargetScope&) = delete;
+
+private:
+    DecodeTarget* previous;
+};
+
+#endif
@@ -4,18 +4,40 @@ out vec4 FragColor;
 in vec3 FragPos;
 in vec2 TexCoord; // Texture coordinates
 
-uniform vec3 objectColor;   // Base object color
 uniform vec3 lightColor;    // Spotlight color
 uniform vec3 lightPos;      // Spotlight position
 uniform vec3 lightDir;      // Spotlight direction
 uniform vec3 viewPos;       // Camera position
 uniform float cutOff;       // Spotlight cutoff angle (cosine value)
 uniform float outerCutOff;  // Spotlight outer cutoff for smooth edges
-uniform vec3 outsideColor;  // Outer wall color
-uniform vec3 insideColor;   // Inner wall color
 
-uniform sampler2D texture1; // Outer texture sampler
-uniform sampler2D texture2; // Inner texture sampler
+uniform sampler2D texture1; // Texture of the part being drawn
+
+// Sparse virtual texture (virtual_texture.hpp), set per draw for the parts that use it
+// instead of texture1
+uniform bool virtualTextured;
+uniform sampler2D pageTable;  // Per page and level: cache slot x, y and level of the page to use
+uniform sampler2D pageCache;
+uniform vec4 virtualPages;    // Pages across and down at level 0, level count, tile size
+uniform vec4 virtualExtent;   // Part of the level 0 pages the image covers
+uniform vec4 pageCacheLayout; // Border, padded tile size, cache width and height in texels
+
+vec4 sampleVirtualTexture(vec2 coord)
+{
+    // The level the feedback pass asks for, looked up in the page table at that level
+    vec2 texels = coord * virtualExtent.xy * virtualPages.xy * virtualPages.w;
+    float lod = log2(max(length(dFdx(texels)), length(dFdy(texels))));
+    int level = int(clamp(floor(lod), 0.0, virtualPages.z - 1.0));
+    vec2 uv = fract(coord) * virtualExtent.xy;
+    vec2 pages = max(floor(virtualPages.xy / exp2(float(level))), vec2(1.0));
+    vec4 entry = floor(texelFetch(pageTable, ivec2(uv * pages), level) * 255.0 + 0.5);
+
+    // The page may be a coarser one standing in until the right one is loaded
+    vec2 residentPages = max(floor(virtualPages.xy / exp2(entry.z)), vec2(1.0));
+    vec2 inPage = fract(uv * residentPages);
+    vec2 texel = entry.xy * pageCacheLayout.y + pageCacheLayout.x + inPage * virtualPages.w;
+    return textureLod(pageCache, texel / pageCacheLayout.zw, 0.0);
+}
 
 void main() {
     // Normalize vectors
@@ -43,20 +65,10 @@ void main() {
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 16.0);
     vec3 specular = specularStrength * spec * lightColor;
 
-    // Determine color for top, bottom, and sides
-    vec3 resultColor;
-    
-    // Sample the appropriate texture based on the surface
-    vec4 texColor;
-    if (resultColor == insideColor) {
-        texColor = texture(texture2, TexCoord); // Use inner texture for inside surfaces
-    } else {
-        texColor = texture(texture1, TexCoord); // Use outer texture for outside surfaces
-    }
-
-    // Combine lighting effects with spotlight intensity
-    vec3 finalColor = (ambient + intensity * (diffuse + specular)) * resultColor;
-
-    // Mix lighting with texture
-    FragColor = mix(vec4(finalColor, 3.0), texColor,1.2); // Blend lighting with texture
+    // Every surface of a part shares its texture; a uniform branch, so derivatives hold
+    vec4 texColor = virtualTextured ? sampleVirtualTexture(TexCoord) : texture(texture1, TexCoord);
+
+    // Combine lighting effects with spotlight intensity and light the texture with them
+    vec3 lighting = ambient + intensity * (diffuse + specular);
+    FragColor = vec4(lighting * texColor.rgb, texColor.a);
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Streaming buffer for per-frame dynamic data. One buffer is split into a region per frame
+// in flight; each frame sub-allocates uniforms, instance data and indirect commands from
+// its region and fences it, and a region is only written again once its fence has passed.
+// With GL 4.4 the buffer is persistently and coherently mapped (ARB_buffer_storage), so
+// writes are plain stores: no driver allocation, no mapping and no implicit sync per frame.
+// Older contexts fall back to a staging copy pushed with glBufferSubData.
+
+constexpr int FRAME_RING_REGIONS = 3;
+
+struct RingAllocation
+{
+    GLuint buffer = 0;
+    GLintptr offset = 0;   // Into `buffer`
+    GLsizeiptr size = 0;
+    void* data = nullptr;  // Null when the region is full
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+class FrameRing
+{
+public:
+    // `frameBytes` is the most one frame may allocate
+    void create(GLsizeiptr frameBytes)
+    {
+        GLint alignment = 16;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        uniformAlignment = alignment;
+        if (GLAD_GL_VERSION_4_3)
+        {
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            storageAlignment = alignment;
+        }
+        regionSize = alignUp(frameBytes, 256);
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        persistent = GLAD_GL_VERSION_4_4 != 0;
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * FRAME_RING_REGIONS, nullptr, flags);
+            mapped = static_cast<std::uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * FRAME_RING_REGIONS, flags));
+        }
+        else
+        {
+            glBufferData(GL_COPY_WRITE_BUFFER, regionSize * FRAME_RING_REGIONS, nullptr, GL_STREAM_DRAW);
+            staging.resize(static_cast<std::size_t>(regionSize) * FRAME_RING_REGIONS);
+            mapped = staging.data();
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // Move to the next region, waiting if the GPU still reads what was written there
+    void beginFrame()
+    {
+        region = (region + 1) % FRAME_RING_REGIONS;
+        used = 0;
+        GLsync& fence = fences[region];
+        if (!fence)
+            return;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            ++stalls;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // Fence the region after the commands that read it
+    void endFrame()
+    {
+        if (persistent)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    RingAllocation allocate(GLsizeiptr bytes, GLsizeiptr alignment = 16)
+    {
+        RingAllocation allocation;
+        const GLsizeiptr offset = alignUp(used, alignment);
+        if (offset + bytes > regionSize)
+        {
+            ++overflows;
+            return allocation;
+        }
+        used = offset + bytes;
+        allocation.buffer = buffer;
+        allocation.offset = region * regionSize + offset;
+        allocation.size = bytes;
+        allocation.data = mapped + allocation.offset;
+        return allocation;
+    }
+
+    // Make what was written to `allocation` visible to GL; free when persistently mapped
+    void flush(const RingAllocation& allocation)
+    {
+        if (persistent || !allocation)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // allocate + copy + flush
+    RingAllocation write(const void* data, GLsizeiptr bytes, GLsizeiptr alignment = 16)
+    {
+        RingAllocation allocation = allocate(bytes, alignment);
+        if (allocation)
+        {
+            std::memcpy(allocation.data, data, bytes);
+            flush(allocation);
+        }
+        return allocation;
+    }
+
+    void destroy()
+    {
+        for (GLsync& fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (persistent && mapped)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        mapped = nullptr;
+        staging.clear();
+    }
+
+    bool persistentlyMapped() const { return persistent; }
+
+    GLsizeiptr uniformAlignment = 256;
+    GLsizeiptr storageAlignment = 256;
+    int stalls = 0;    // beginFrame calls that had to wait for the GPU
+    int overflows = 0; // Allocations that did not fit, callers fall back to direct uploads
+
+private:
+    static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    GLuint buffer = 0;
+    std::uint8_t* mapped = nullptr;
+    std::vector<std::uint8_t> staging;
+    bool persistent = false;
+    GLsizeiptr regionSize = 0;
+    GLsizeiptr used = 0;
+    int region = 0;
+    GLsync fences[FRAME_RING_REGIONS] = {};
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward-facing planes (xyz = normal, w = distance)
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    // Extract the planes from a projection * view (* model) matrix
+    static Frustum fromMatrix(const glm::mat4& m)
+    {
+        const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum f;
+        f.planes[0] = row3 + row0; // Left
+        f.planes[1] = row3 - row0; // Right
+        f.planes[2] = row3 + row1; // Bottom
+        f.planes[3] = row3 - row1; // Top
+        f.planes[4] = row3 + row2; // Near
+        f.planes[5] = row3 - row2; // Far
+        for (glm::vec4& p : f.planes)
+            p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& p : planes)
+            if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+                return false;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef FRUSTUM_CULL_HPP
+#define FRUSTUM_CULL_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "bounds.hpp"
+#include "cpu_features.hpp"
+#include "frustum.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CROWN_CULL_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Structure-of-arrays world bounds (AABB center + half extents), padded to a multiple
+// of eight entries so the SIMD kernels never read past the end
+struct CullBounds
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::size_t count = 0;
+
+    void resize(std::size_t n)
+    {
+        count = n;
+        const std::size_t padded = (n + 7) & ~std::size_t(7);
+        for (std::vector<float>* v : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+            v->assign(padded, 0.0f);
+    }
+
+    void set(std::size_t i, const Bounds& world)
+    {
+        const glm::vec3 c = (world.min + world.max) * 0.5f;
+        const glm::vec3 e = world.extents();
+        centerX[i] = c.x; centerY[i] = c.y; centerZ[i] = c.z;
+        extentX[i] = e.x; extentY[i] = e.y; extentZ[i] = e.z;
+    }
+};
+
+struct CullStats
+{
+    std::size_t tested = 0;
+    std::size_t visible = 0;
+    double microseconds = 0.0;
+
+    double objectsPerMicrosecond() const { return microseconds > 0.0 ? tested / microseconds : 0.0; }
+};
+
+// A box is outside when it lies entirely behind any plane:
+// dot(n, c) + w + dot(|n|, e) < 0
+// Kernels test boxes [begin, end); begin must be a multiple of eight so chunks stay aligned.
+inline void cullBoundsScalar(const Frustum& frustum, const CullBounds& b, std::vector<std::uint32_t>& visible,
+    std::size_t begin = 0, std::size_t end = SIZE_MAX)
+{
+    end = std::min(end, b.count);
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        bool inside = true;
+        for (const glm::vec4& p : frustum.planes)
+        {
+            // summed in the SIMD kernels' order, so boxes touching a plane round the same way
+            const float d = (p.x * b.centerX[i] + p.y * b.centerY[i]) + (p.z * b.centerZ[i] + p.w);
+            const float r = std::abs(p.x) * b.extentX[i] + std::abs(p.y) * b.extentY[i] + std::abs(p.z) * b.extentZ[i];
+            if (d + r < 0.0f)
+            {
+                inside = false;
+                break;
+            }
+        }
+        if (inside)
+            visible.push_back(static_cast<std::uint32_t>(i));
+    }
+}
+
+#ifdef CROWN_CULL_SSE
+// Four boxes per instruction
+inline void cullBoundsSSE(const Frustum& frustum, const CullBounds& b, std::vector<std::uint32_t>& visible,
+    std::size_t begin = 0, std::size_t end = SIZE_MAX)
+{
+    end = std::min(end, b.count);
+    __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        nx[p] = _mm_set1_ps(plane.x); ny[p] = _mm_set1_ps(plane.y);
+        nz[p] = _mm_set1_ps(plane.z); nw[p] = _mm_set1_ps(plane.w);
+        ax[p] = _mm_set1_ps(std::abs(plane.x)); ay[p] = _mm_set1_ps(std::abs(plane.y));
+        az[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (std::size_t i = begin; i < end; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(&b.centerX[i]), cy = _mm_loadu_ps(&b.centerY[i]), cz = _mm_loadu_ps(&b.centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&b.extentX[i]), ey = _mm_loadu_ps(&b.extentY[i]), ez = _mm_loadu_ps(&b.extentZ[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k)
+            if ((mask & (1 << k)) && i + k < end)
+                visible.push_back(static_cast<std::uint32_t>(i + k));
+    }
+}
+#endif
+
+#ifdef CROWN_X86
+// Eight boxes per instruction, only called when the CPU has AVX2
+CROWN_AVX2_TARGET inline void cullBoundsAVX2(const Frustum& frustum, const CullBounds& b, std::vector<std::uint32_t>& visible,
+    std::size_t begin = 0, std::size_t end = SIZE_MAX)
+{
+    end = std::min(end, b.count);
+    __m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+        nx[p] = _mm256_set1_ps(plane.x); ny[p] = _mm256_set1_ps(plane.y);
+        nz[p] = _mm256_set1_ps(plane.z); nw[p] = _mm256_set1_ps(plane.w);
+        ax[p] = _mm256_set1_ps(std::abs(plane.x)); ay[p] = _mm256_set1_ps(std::abs(plane.y));
+        az[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (std::size_t i = begin; i < end; i += 8)
+    {
+        const __m256 cx = _mm256_loadu_ps(&b.centerX[i]), cy = _mm256_loadu_ps(&b.centerY[i]), cz = _mm256_loadu_ps(&b.centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&b.extentX[i]), ey = _mm256_loadu_ps(&b.extentY[i]), ez = _mm256_loadu_ps(&b.extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), nw[p]));
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; ++k)
+            if ((mask & (1 << k)) && i + k < end)
+                visible.push_back(static_cast<std::uint32_t>(i + k));
+    }
+}
+#endif
+
+using CullKernel = void (*)(const Frustum&, const CullBounds&, std::vector<std::uint32_t>&, std::size_t, std::size_t);
+
+struct CullKernelInfo
+{
+    const char* name;
+    CullKernel kernel;
+};
+
+// Every kernel this build has that the CPU can run, narrowest first
+inline const std::vector<CullKernelInfo>& cullKernels()
+{
+    static const std::vector<CullKernelInfo> kernels = []()
+    {
+        std::vector<CullKernelInfo> list = { { "scalar", cullBoundsScalar } };
+#ifdef CROWN_CULL_SSE
+        list.push_back({ "SSE2", cullBoundsSSE });
+#endif
+#ifdef CROWN_X86
+        if (cpuHasAvx2())
+            list.push_back({ "AVX2", cullBoundsAVX2 });
+#endif
+        return list;
+    }();
+    return kernels;
+}
+
+// Name of the widest kernel, the one cullBounds() uses
+inline const char* cullKernelName()
+{
+    return cullKernels().back().name;
+}
+
+// Append the indices of all boxes touching the frustum to `visible` and time the pass
+inline CullStats cullBounds(const Frustum& frustum, const CullBounds& b, std::vector<std::uint32_t>& visible,
+    std::size_t begin = 0, std::size_t end = SIZE_MAX)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t before = visible.size();
+    end = std::min(end, b.count);
+    static const CullKernel kernel = cullKernels().back().kernel;
+    kernel(frustum, b, visible, begin, end);
+    CullStats stats;
+    stats.tested = end > begin ? end - begin : 0;
+    stats.visible = visible.size() - before;
+    stats.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// Throughput of every available kernel over a large random field of boxes
+inline void runCullBenchmark(std::size_t objectCount = 1 << 20, int iterations = 50)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    CullBounds bounds;
+    bounds.resize(objectCount);
+    for (std::size_t i = 0; i < objectCount; ++i)
+    {
+        Bounds b;
+        b.min = glm::vec3(position(rng), position(rng) * 0.2f, position(rng));
+        b.max = b.min + glm::vec3(size(rng), size(rng), size(rng));
+        bounds.set(i, b);
+    }
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 4.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<std::uint32_t> visible;
+    visible.reserve(objectCount);
+    for (const CullKernelInfo& info : cullKernels())
+    {
+        double best = 1e30;
+        for (int it = 0; it < iterations; ++it)
+        {
+            visible.clear();
+            const auto start = std::chrono::steady_clock::now();
+            info.kernel(frustum, bounds, visible, 0, bounds.count);
+            best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::cout << "cull " << info.name << ": " << objectCount << " objects, " << visible.size() << " visible, "
+                  << objectCount / best << " objects/us" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef GPU_CULLING_HPP
+#define GPU_CULLING_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "baked_mesh.hpp"
+#include "bounds.hpp"
+#include "frame_ring.hpp"
+#include "frustum.hpp"
+#include "hiz.hpp"
+#include "meshlet.hpp"
+#include "shader.hpp"
+
+// GPU-driven culling (GL 4.3+). Per-instance transforms and per-mesh bounds live in SSBOs,
+// a compute pass culls every instance and fills the instance counts of one
+// DrawElementsIndirectCommand per mesh, and the draws are issued with glMultiDrawElementsIndirect.
+// CPU work per frame is a fixed-size command reset, one dispatch and one call per draw range;
+// the reset, the pass parameters and moved instances are staged through a FrameRing.
+//
+// With a Hi-Z pyramid the pass runs twice per frame: the first phase draws what was visible
+// last frame, its depth builds the pyramid, and the second phase tests every instance against
+// it, draws the ones that just became visible and records visibility for the next frame.
+
+// Layout fixed by GL
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// std430 layout of ObjectData in cull_compute.glsl / gpu_vertex_shader.glsl
+struct GpuObject
+{
+    glm::mat4 model;
+    GLuint mesh;
+    GLuint pad[3];
+};
+
+// std140 layout of CullParams in cull_compute.glsl
+struct GpuCullParams
+{
+    glm::vec4 frustumPlanes[6];
+    glm::mat4 viewProjection;
+    GLuint objectCount;
+    GLuint phase;
+    GLint hiZLevels;
+    GLuint pad;
+};
+
+// Uniform block binding of CullParams
+constexpr GLuint GPU_CULL_PARAMS_BINDING = 0;
+
+// SSBO binding points shared with the shaders
+constexpr GLuint GPU_OBJECTS_BINDING = 0;
+constexpr GLuint GPU_MESH_BOUNDS_BINDING = 1;
+constexpr GLuint GPU_COMMANDS_BINDING = 2;
+constexpr GLuint GPU_VISIBLE_BINDING = 3;
+constexpr GLuint GPU_VISIBILITY_BINDING = 4;
+constexpr GLuint GPU_STATS_BINDING = 5;
+constexpr GLuint GPU_CULL_GROUP_SIZE = 64;
+
+// Matches the phase constants in cull_compute.glsl
+enum CullPhase : GLuint
+{
+    CULL_FRUSTUM_ONLY = 0,
+    CULL_PREVIOUS_VISIBLE = 1,
+    CULL_OCCLUSION = 2
+};
+
+// Stats block of cull_compute.glsl, accumulated over frames until read
+struct OcclusionStats
+{
+    GLuint occluded = 0;
+    GLuint tested = 0;
+};
+
+class GpuCuller
+{
+public:
+    GpuCuller() = default;
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+    ~GpuCuller() { destroy(); }
+
+    // Append a mesh to the shared vertex/index pool, returns its mesh id
+    GLuint addMesh(const GLfloat* vertices, std::size_t floatCount, const GLuint* indices, std::size_t indexCount,
+        const Bounds& bounds)
+    {
+        DrawElementsIndirectCommand command = {};
+        command.count = static_cast<GLuint>(indexCount);
+        command.firstIndex = static_cast<GLuint>(poolIndices.size());
+        command.baseVertex = static_cast<GLint>(poolVertices.size() / VERTEX_STRIDE);
+        commands.push_back(command);
+        meshSpheres.push_back(glm::vec4(bounds.center, bounds.radius));
+
+        poolVertices.insert(poolVertices.end(), vertices, vertices + floatCount);
+        poolIndices.insert(poolIndices.end(), indices, indices + indexCount);
+        return static_cast<GLuint>(commands.size() - 1);
+    }
+
+    // Append a mesh as one cullable mesh per meshlet, returns the id of the first one.
+    // All clusters share the vertices; each draws its own range of the reordered indices.
+    GLuint addMeshlets(const GLfloat* vertices, std::size_t floatCount, const MeshletMesh& mesh)
+    {
+        const GLuint firstMesh = static_cast<GLuint>(commands.size());
+        const GLuint baseIndex = static_cast<GLuint>(poolIndices.size());
+        const GLint baseVertex = static_cast<GLint>(poolVertices.size() / VERTEX_STRIDE);
+        for (const Meshlet& m : mesh.meshlets)
+        {
+            DrawElementsIndirectCommand command = {};
+            command.count = m.triangleCount * 3;
+            command.firstIndex = baseIndex + m.firstIndex;
+            command.baseVertex = baseVertex;
+            commands.push_back(command);
+            meshSpheres.push_back(glm::vec4(m.center, m.radius));
+        }
+
+        poolVertices.insert(poolVertices.end(), vertices, vertices + floatCount);
+        poolIndices.insert(poolIndices.end(), mesh.indices.begin(), mesh.indices.end());
+        return firstMesh;
+    }
+
+    // Upload the mesh pool and create the pipeline, call once after all addMesh calls.
+    // Per-frame data is staged through `frameRing`, which must outlive the culler.
+    void build(ShaderSource computeSource, FrameRing& frameRing)
+    {
+        ring = &frameRing;
+        cullShader = new Shader(computeSource);
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenBuffers(1, &objectBuffer);
+        glGenBuffers(1, &boundsBuffer);
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &visibleBuffer);
+        glGenBuffers(1, &visibilityBuffer);
+        glGenBuffers(1, &statsBuffer);
+        glGenBuffers(1, &paramsBuffer);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, poolVertices.size() * sizeof(GLfloat), poolVertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_STRIDE * sizeof(GLfloat), (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_STRIDE * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, poolIndices.size() * sizeof(GLuint), poolIndices.data(), GL_STATIC_DRAW);
+
+        // Visible object ids feed an instanced attribute, baseInstance selects each mesh's slice
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, meshSpheres.size() * sizeof(glm::vec4), meshSpheres.data(), GL_STATIC_DRAW);
+
+        const OcclusionStats zero;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(OcclusionStats), &zero, GL_DYNAMIC_READ);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        // Only used when a frame's ring region is full
+        glBindBuffer(GL_UNIFORM_BUFFER, paramsBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuCullParams), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        cullShader->use();
+        cullShader->setInt("hiZ", 0);
+
+        poolVertices.clear();
+        poolVertices.shrink_to_fit();
+        poolIndices.clear();
+        poolIndices.shrink_to_fit();
+    }
+
+    // Replace all instances, reallocating their buffers. Use updateObjects when only
+    // transforms change.
+    void setObjects(const std::vector<glm::mat4>& models, const std::vector<GLuint>& meshIds)
+    {
+        objectCount = static_cast<GLuint>(models.size());
+        objectMeshes = meshIds;
+        std::vector<GpuObject> objects(models.size());
+        std::vector<GLuint> perMesh(commands.size(), 0);
+        for (std::size_t i = 0; i < models.size(); ++i)
+        {
+            objects[i].model = models[i];
+            objects[i].mesh = meshIds[i];
+            ++perMesh[meshIds[i]];
+        }
+
+        // Each mesh owns a slice of the visible list large enough for all of its instances
+        GLuint base = 0;
+        for (std::size_t m = 0; m < commands.size(); ++m)
+        {
+            commands[m].baseInstance = base;
+            base += perMesh[m];
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(GpuObject), objects.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (base > 0 ? base : 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+        // Everything counts as visible on the first frame, the occlusion phase corrects it
+        const std::vector<GLuint> visibility(objects.empty() ? 1 : objects.size(), 1);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, visibility.size() * sizeof(GLuint), visibility.data(), GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // New transforms for the same instances, written straight into the ring and copied on
+    // the GPU so nothing is reallocated
+    void updateObjects(const std::vector<glm::mat4>& models)
+    {
+        const RingAllocation staged = ring->allocate(objectCount * sizeof(GpuObject), ring->storageAlignment);
+        if (!staged)
+        {
+            setObjects(models, std::vector<GLuint>(objectMeshes));
+            return;
+        }
+        GpuObject* objects = static_cast<GpuObject*>(staged.data);
+        for (GLuint i = 0; i < objectCount; ++i)
+        {
+            GpuObject object = {};
+            object.model = models[i];
+            object.mesh = objectMeshes[i];
+            objects[i] = object;
+        }
+        ring->flush(staged);
+        copyStaged(staged, objectBuffer);
+    }
+
+    // Reset instance counts and run the culling dispatch. The occlusion phase needs the
+    // pyramid built from this frame's first-phase depth and the matching view-projection.
+    void cull(const Frustum& frustum, CullPhase phase = CULL_FRUSTUM_ONLY, const HiZPyramid* hiZ = nullptr,
+        const glm::mat4& viewProjection = glm::mat4(1.0f))
+    {
+        for (DrawElementsIndirectCommand& command : commands)
+            command.instanceCount = 0;
+        const GLsizeiptr commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+        const RingAllocation stagedCommands = ring->write(commands.data(), commandBytes);
+        if (stagedCommands)
+        {
+            copyStaged(stagedCommands, commandBuffer);
+        }
+        else
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, commands.data());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+
+        GpuCullParams params = {};
+        for (int i = 0; i < 6; ++i)
+            params.frustumPlanes[i] = frustum.planes[i];
+        params.viewProjection = viewProjection;
+        params.objectCount = objectCount;
+        params.phase = phase;
+        params.hiZLevels = hiZ ? hiZ->levels : 0;
+        const RingAllocation stagedParams = ring->write(&params, sizeof(params), ring->uniformAlignment);
+        if (stagedParams)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, GPU_CULL_PARAMS_BINDING, stagedParams.buffer, stagedParams.offset, stagedParams.size);
+        }
+        else
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, paramsBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(params), &params);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, GPU_CULL_PARAMS_BINDING, paramsBuffer);
+        }
+
+        cullShader->use();
+        if (phase == CULL_OCCLUSION && hiZ)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, hiZ->texture);
+        }
+        bindStorage();
+        glDispatchCompute((objectCount + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE, 1, 1);
+
+        // Commands, instanced attributes and the object SSBO are read by the draws that follow
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // Occlusion counters accumulated since the last call, then reset (stalls on the GPU)
+    OcclusionStats readOcclusionStats()
+    {
+        OcclusionStats stats;
+        const OcclusionStats zero;
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(OcclusionStats), &stats);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(OcclusionStats), &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return stats;
+    }
+
+    GLuint meshCount() const { return static_cast<GLuint>(commands.size()); }
+
+    // Draw meshes [firstMesh, firstMesh + meshCount) with whatever program and textures are bound
+    void draw(GLuint firstMesh, GLsizei meshCount) const
+    {
+        bindStorage();
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (const GLvoid*)(firstMesh * sizeof(DrawElementsIndirectCommand)), meshCount, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    void destroy()
+    {
+        if (!cullShader)
+            return;
+        glDeleteProgram(cullShader->ID);
+        delete cullShader;
+        cullShader = nullptr;
+        glDeleteVertexArrays(1, &VAO);
+        GLuint buffers[] = { VBO, EBO, objectBuffer, boundsBuffer, commandBuffer, visibleBuffer, visibilityBuffer, statsBuffer, paramsBuffer };
+        glDeleteBuffers(9, buffers);
+    }
+
+private:
+    // GPU-side copy of a ring allocation to the start of `target`
+    static void copyStaged(const RingAllocation& staged, GLuint target)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, staged.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staged.offset, 0, staged.size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void bindStorage() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_OBJECTS_BINDING, objectBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_MESH_BOUNDS_BINDING, boundsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_COMMANDS_BINDING, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_VISIBLE_BINDING, visibleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_VISIBILITY_BINDING, visibilityBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_STATS_BINDING, statsBuffer);
+    }
+
+    Shader* cullShader = nullptr;
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLuint objectBuffer = 0, boundsBuffer = 0, commandBuffer = 0, visibleBuffer = 0;
+    GLuint visibilityBuffer = 0, statsBuffer = 0, paramsBuffer = 0;
+    FrameRing* ring = nullptr;
+    std::vector<GLuint> objectMeshes;
+    GLuint objectCount = 0;
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<glm::vec4> meshSpheres;
+    std::vector<GLfloat> poolVertices;
+    std::vector<GLuint> poolIndices;
+};
+
+#endif
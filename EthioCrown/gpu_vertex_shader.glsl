@@ -0,0 +1,29 @@
+#version 430 core
+layout(location = 0) in vec3 aPos;      // Vertex position
+layout(location = 1) in vec2 aTexCoord; // Texture coordinates
+layout(location = 2) in uint aObjectId; // Per-instance, written by the culling pass
+
+out vec3 FragPos;  // Position for fragment shader
+out vec2 TexCoord; // Texture coordinates for fragment shader
+
+struct ObjectData
+{
+    mat4 model;
+    uint mesh;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    mat4 model = objects[aObjectId].model;
+    FragPos = vec3(model * vec4(aPos, 1.0));  // Transform vertex position
+    TexCoord = aTexCoord; // Pass texture coordinates
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
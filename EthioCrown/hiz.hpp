@@ -0,0 +1,139 @@
+#ifndef HIZ_HPP
+#define HIZ_HPP
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+#include "shader.hpp"
+
+// Hierarchical-Z occlusion culling (GL 4.3+). The scene renders into an offscreen target
+// whose depth attachment is a sampleable texture; a compute reduction turns that depth into
+// a pyramid where every texel holds the farthest depth of the screen area it covers.
+
+constexpr GLuint HIZ_GROUP_SIZE = 8;
+
+// Offscreen colour + depth target, blitted to the window after the frame is drawn
+struct SceneTarget
+{
+    GLuint FBO = 0;
+    GLuint colorBuffer = 0;
+    GLuint depthTexture = 0;
+    int width = 0;
+    int height = 0;
+
+    // `srgb` stores the colour sRGB encoded, for rendering with GL_FRAMEBUFFER_SRGB
+    void create(int w, int h, bool srgb = false)
+    {
+        width = w;
+        height = h;
+
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height);
+
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER::SCENE_TARGET_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Copy the colour attachment to the default framebuffer
+    void present() const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void destroy()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteTextures(1, &depthTexture);
+        FBO = colorBuffer = depthTexture = 0;
+    }
+};
+
+class HiZPyramid
+{
+public:
+    HiZPyramid() = default;
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+    ~HiZPyramid() { destroy(); }
+
+    // Level 0 matches the depth buffer, every level above halves it down to 1x1
+    void create(int width, int height, ShaderSource computeSource)
+    {
+        buildShader = new Shader(computeSource);
+        baseWidth = width;
+        baseHeight = height;
+        levels = 1;
+        while ((std::max(width, height) >> levels) > 0)
+            ++levels;
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Rebuild every level from a depth texture of the same size
+    void build(GLuint depthTexture)
+    {
+        buildShader->use();
+        buildShader->setInt("source", 0);
+        glActiveTexture(GL_TEXTURE0);
+
+        for (int level = 0; level < levels; ++level)
+        {
+            const int w = std::max(baseWidth >> level, 1);
+            const int h = std::max(baseHeight >> level, 1);
+            glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : texture);
+            buildShader->setBool("copyDepth", level == 0);
+            buildShader->setInt("sourceLevel", level == 0 ? 0 : level - 1);
+            glBindImageTexture(0, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute((w + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (h + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+            // The next level (and the cull pass after the last one) fetches what was just stored
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void destroy()
+    {
+        if (!buildShader)
+            return;
+        glDeleteProgram(buildShader->ID);
+        delete buildShader;
+        buildShader = nullptr;
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    GLuint texture = 0;
+    int levels = 0;
+
+private:
+    Shader* buildShader = nullptr;
+    int baseWidth = 0;
+    int baseHeight = 0;
+};
+
+#endif
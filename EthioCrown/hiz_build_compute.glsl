@@ -0,0 +1,44 @@
+#version 430 core
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// One Hi-Z level: level 0 copies the depth buffer, every further level keeps the farthest
+// depth of the texels it covers (including the extra row/column of odd-sized sources)
+layout(r32f, binding = 0) uniform writeonly image2D destination;
+uniform sampler2D source;
+uniform int sourceLevel;
+uniform bool copyDepth;
+
+float fetchClamped(ivec2 p, ivec2 size)
+{
+    return texelFetch(source, clamp(p, ivec2(0), size - 1), sourceLevel).r;
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 destinationSize = imageSize(destination);
+    if (any(greaterThanEqual(p, destinationSize)))
+        return;
+
+    ivec2 sourceSize = textureSize(source, sourceLevel);
+    float depth;
+    if (copyDepth)
+    {
+        depth = fetchClamped(p, sourceSize);
+    }
+    else
+    {
+        ivec2 s = p * 2;
+        depth = max(max(fetchClamped(s, sourceSize), fetchClamped(s + ivec2(1, 0), sourceSize)),
+                    max(fetchClamped(s + ivec2(0, 1), sourceSize), fetchClamped(s + ivec2(1, 1), sourceSize)));
+        bool extraColumn = (sourceSize.x & 1) != 0 && p.x == destinationSize.x - 1;
+        bool extraRow = (sourceSize.y & 1) != 0 && p.y == destinationSize.y - 1;
+        if (extraColumn)
+            depth = max(depth, max(fetchClamped(s + ivec2(2, 0), sourceSize), fetchClamped(s + ivec2(2, 1), sourceSize)));
+        if (extraRow)
+            depth = max(depth, max(fetchClamped(s + ivec2(0, 2), sourceSize), fetchClamped(s + ivec2(1, 2), sourceSize)));
+        if (extraColumn && extraRow)
+            depth = max(depth, fetchClamped(s + ivec2(2, 2), sourceSize));
+    }
+    imageStore(destination, p, vec4(depth));
+}
@@ -0,0 +1,268 @@
+#ifndef IMAGE_SCALE_HPP
+#define IMAGE_SCALE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGE_SCALE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Decoding straight to a target size. JPEGs are first reduced by 1/2, 1/4 or 1/8 inside
+// the decoder (stbi_set_jpeg_scale_on_load_thread), which skips most IDCT work and
+// shrinks the decoder's planes. The remaining ratio, at most 2x for JPEGs, is made up
+// by an area-averaging resampler.
+
+struct ImageDecodePlan
+{
+    int width = 0;       // Final size
+    int height = 0;
+    int dctShift = 0;    // JPEG scale passed to the decoder
+    int decodeWidth = 0; // What a JPEG decoder produces with that scale
+    int decodeHeight = 0;
+
+    bool resampled() const { return decodeWidth != width || decodeHeight != height; }
+};
+
+// Fit width x height in maxSize x maxSize keeping the aspect ratio; 0 keeps the full size
+inline ImageDecodePlan planImageDecode(int width, int height, int maxSize)
+{
+    ImageDecodePlan plan;
+    plan.width = plan.decodeWidth = width;
+    plan.height = plan.decodeHeight = height;
+    if (maxSize <= 0 || std::max(width, height) <= maxSize)
+        return plan;
+
+    const double scale = static_cast<double>(maxSize) / std::max(width, height);
+    plan.width = std::min(maxSize, std::max(1, static_cast<int>(std::lround(width * scale))));
+    plan.height = std::min(maxSize, std::max(1, static_cast<int>(std::lround(height * scale))));
+    // Largest DCT reduction that does not drop below the target
+    while (plan.dctShift < 3)
+    {
+        const int shift = plan.dctShift + 1;
+        const int round = (1 << shift) - 1;
+        if (((width + round) >> shift) < plan.width || ((height + round) >> shift) < plan.height)
+            break;
+        plan.dctShift = shift;
+        plan.decodeWidth = (width + round) >> shift;
+        plan.decodeHeight = (height + round) >> shift;
+    }
+    return plan;
+}
+
+namespace image_scale_detail
+{
+    constexpr int WEIGHT_BITS = 14;
+
+    // For every output sample the input samples it averages: `count` taps from first[i],
+    // padded with zero weights, fixed-point weights summing to 1 << 14
+    struct TapTable
+    {
+        int count = 0;
+        std::vector<int> first;
+        std::vector<std::int16_t> weights; // count per output sample
+    };
+
+    inline TapTable areaTaps(int from, int to)
+    {
+        const double ratio = static_cast<double>(from) / to;
+        TapTable table;
+        table.count = static_cast<int>(std::ceil(ratio)) + 1;
+        table.first.resize(to);
+        table.weights.assign(static_cast<std::size_t>(to) * table.count, 0);
+        for (int i = 0; i < to; ++i)
+        {
+            const double begin = i * ratio, end = std::min(static_cast<double>(from), (i + 1) * ratio);
+            // Keep the padded taps inside the input
+            const int first = std::min(static_cast<int>(begin), std::max(0, from - table.count));
+            std::int16_t* weights = &table.weights[static_cast<std::size_t>(i) * table.count];
+            table.first[i] = first;
+            int total = 0, largest = 0;
+            for (int k = 0; k < table.count && first + k < from; ++k)
+            {
+                const int j = first + k;
+                const double overlap = std::min(end, j + 1.0) - std::max(begin, static_cast<double>(j));
+                if (overlap <= 0.0)
+                    continue;
+                weights[k] = static_cast<std::int16_t>(std::lround(overlap / ratio * (1 << WEIGHT_BITS)));
+                total += weights[k];
+                if (weights[k] > weights[largest])
+                    largest = k;
+            }
+            // Put the rounding error on the largest tap so flat areas stay exact
+            weights[largest] = static_cast<std::int16_t>(weights[largest] + (1 << WEIGHT_BITS) - total);
+        }
+        return table;
+    }
+
+    // Weighted sum of rows, `bytes` wide
+    inline void blendRows(const unsigned char* const* rows, const std::int16_t* weights, int count, int bytes, unsigned char* out)
+    {
+        int x = 0;
+#ifdef IMAGE_SCALE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi32(1 << (WEIGHT_BITS - 1));
+        for (; x + 8 <= bytes; x += 8)
+        {
+            __m128i lo = round, hi = round;
+            // Two rows per madd: interleave their samples against interleaved weights
+            for (int k = 0; k < count; k += 2)
+            {
+                const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k] + x)), zero);
+                const __m128i b = k + 1 < count ? _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k + 1] + x)), zero) : zero;
+                const int pair = (weights[k] & 0xffff) | ((k + 1 < count ? weights[k + 1] : 0) << 16);
+                const __m128i w = _mm_set1_epi32(pair);
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+            }
+            const __m128i words = _mm_packs_epi32(_mm_srai_epi32(lo, WEIGHT_BITS), _mm_srai_epi32(hi, WEIGHT_BITS));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(words, words));
+        }
+#endif
+        for (; x < bytes; ++x)
+        {
+            int sum = 1 << (WEIGHT_BITS - 1);
+            for (int k = 0; k < count; ++k)
+                sum += rows[k][x] * weights[k];
+            out[x] = static_cast<unsigned char>(std::min(255, std::max(0, sum >> WEIGHT_BITS)));
+        }
+    }
+
+    // Horizontal pass. TAPS is the table's tap count when it is small enough to unroll, 0 otherwise.
+    // Reads up to 8 bytes past the last tap, `in` needs that much padding.
+    template<int CHANNELS, int TAPS>
+    inline void reduceRow(const unsigned char* in, const TapTable& columns, int width, unsigned char* out)
+    {
+        const int count = TAPS ? TAPS : columns.count;
+        const std::int16_t* weights = columns.weights.data();
+        int x = 0;
+#ifdef IMAGE_SCALE_SSE2
+        if (CHANNELS >= 3)
+        {
+            // One pixel per iteration, two taps per madd: interleave the channels of
+            // neighbouring taps against their interleaved weights
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi32(1 << (WEIGHT_BITS - 1));
+            for (; x < width - 1; ++x, weights += count, out += CHANNELS)
+            {
+                const unsigned char* pixel = in + columns.first[x] * CHANNELS;
+                __m128i sums = round;
+                for (int k = 0; k < count; k += 2)
+                {
+                    const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + k * CHANNELS)), zero);
+                    const __m128i b = k + 1 < count ? _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel + (k + 1) * CHANNELS)), zero) : zero;
+                    const int pair = (weights[k] & 0xffff) | ((k + 1 < count ? weights[k + 1] : 0) << 16);
+                    sums = _mm_add_epi32(sums, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), _mm_set1_epi32(pair)));
+                }
+                const __m128i words = _mm_packs_epi32(_mm_srai_epi32(sums, WEIGHT_BITS), zero);
+                // Four bytes out, for RGB the fourth is overwritten by the next pixel
+                const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, zero));
+                std::memcpy(out, &packed, 4);
+            }
+        }
+#endif
+        for (; x < width; ++x, weights += count, out += CHANNELS)
+        {
+            const unsigned char* pixel = in + columns.first[x] * CHANNELS;
+            int sums[CHANNELS];
+            for (int c = 0; c < CHANNELS; ++c)
+                sums[c] = 1 << (WEIGHT_BITS - 1);
+            for (int k = 0; k < count; ++k, pixel += CHANNELS)
+                for (int c = 0; c < CHANNELS; ++c)
+                    sums[c] += pixel[c] * weights[k];
+            for (int c = 0; c < CHANNELS; ++c)
+                out[c] = static_cast<unsigned char>(std::min(255, sums[c] >> WEIGHT_BITS));
+        }
+    }
+
+    template<int CHANNELS>
+    inline void reduceRow(const unsigned char* in, const TapTable& columns, int width, unsigned char* out)
+    {
+        switch (columns.count)
+        {
+        case 2: reduceRow<CHANNELS, 2>(in, columns, width, out); break;
+        case 3: reduceRow<CHANNELS, 3>(in, columns, width, out); break;
+        case 4: reduceRow<CHANNELS, 4>(in, columns, width, out); break;
+        default: reduceRow<CHANNELS, 0>(in, columns, width, out); break;
+        }
+    }
+}
+
+// Area-averaging resample of tightly packed 8-bit pixels to a smaller (or equal) size.
+// Rows are blended with SIMD first, then each row is reduced horizontally.
+inline void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight,
+                          unsigned char* target, int width, int height, int channels)
+{
+    using namespace image_scale_detail;
+    const TapTable columns = areaTaps(sourceWidth, width);
+    const TapTable rows = areaTaps(sourceHeight, height);
+    const int sourceStride = sourceWidth * channels;
+    std::vector<unsigned char> blended(sourceStride + 8);
+    std::vector<const unsigned char*> rowPointers(rows.count);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int k = 0; k < rows.count; ++k)
+            rowPointers[k] = source + static_cast<std::size_t>(std::min(rows.first[y] + k, sourceHeight - 1)) * sourceStride;
+        blendRows(rowPointers.data(), &rows.weights[static_cast<std::size_t>(y) * rows.count], rows.count, sourceStride, blended.data());
+
+        unsigned char* out = target + static_cast<std::size_t>(y) * width * channels;
+        switch (channels)
+        {
+        case 1: reduceRow<1>(blended.data(), columns, width, out); break;
+        case 2: reduceRow<2>(blended.data(), columns, width, out); break;
+        case 3: reduceRow<3>(blended.data(), columns, width, out); break;
+        default: reduceRow<4>(blended.data(), columns, width, out); break;
+        }
+    }
+}
+
+// Scaled decode time against full decode plus resample, for the repository's photos
+inline void runScaledDecodeBenchmark(int iterations = 5)
+{
+    const char* const FILES[] = { "goldi.jpg", "Image.jpg", "cylinder.jpg" };
+    const int SIZES[] = { 0, 1024, 512, 256, 128 };
+    for (const char* file : FILES)
+    {
+        int width, height, channels;
+        if (!stbi_info(file, &width, &height, &channels))
+        {
+            std::cerr << "Failed to read " << file << std::endl;
+            continue;
+        }
+        std::cout << "scaled decode " << file << " (" << width << "x" << height << "):";
+        for (int maxSize : SIZES)
+        {
+            const ImageDecodePlan plan = planImageDecode(width, height, maxSize);
+            std::vector<unsigned char> output(static_cast<std::size_t>(plan.width) * plan.height * 3);
+            const auto start = std::chrono::steady_clock::now();
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                stbi_set_jpeg_scale_on_load_thread(plan.dctShift);
+                int decodedWidth, decodedHeight;
+                unsigned char* pixels = stbi_load(file, &decodedWidth, &decodedHeight, &channels, 3);
+                stbi_set_jpeg_scale_on_load_thread(0);
+                if (!pixels)
+                    break;
+                if (decodedWidth != plan.width || decodedHeight != plan.height)
+                    resampleImage(pixels, decodedWidth, decodedHeight, output.data(), plan.width, plan.height, 3);
+                stbi_image_free(pixels);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            std::cout << " " << plan.width << "x" << plan.height << " (1/" << (1 << plan.dctShift) << ") " << ms << " ms,";
+        }
+        std::cout << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job system. Every worker owns a deque: it pushes and pops its own jobs at
+// the back (newest first, still warm in cache) and steals from the front of the others
+// when it runs dry. Threads that are not workers (main, render, texture loader) each get
+// an injection queue of their own to submit into, so one thread's burst of jobs does not
+// queue up in front of another's. The deques are std::deques behind a mutex rather than
+// lock-free ones; jobs here are coarse (a cull chunk, a decode band) and one uncontended
+// lock per push or pop does not show next to them. Threads that wait on a job run other
+// jobs meanwhile, so waiting inside a job (e.g. a nested parallelFor) never deadlocks and
+// with no workers the waiting thread simply runs everything itself; with nothing left to
+// run they sleep until the job is done.
+
+constexpr unsigned JOB_INJECTION_QUEUES = 4; // Shared round-robin when more threads submit
+
+class JobSystem;
+
+struct Job
+{
+    std::function<void()> work;
+    std::atomic<int> pending{ 1 };     // Unfinished dependencies, plus one while being set up
+    std::atomic<bool> done{ false };
+    std::mutex dependentsMutex;
+    std::vector<std::shared_ptr<Job>> dependents;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+class JobSystem
+{
+public:
+    // Workers beside the calling thread, which joins in whenever it waits
+    explicit JobSystem(unsigned threadCount = std::thread::hardware_concurrency())
+        : workerCount(std::max(1u, threadCount) - 1), queues(workerCount + JOB_INJECTION_QUEUES)
+    {
+        for (unsigned i = 0; i < workerCount; ++i)
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    // Schedule `work` once every dependency has finished
+    JobHandle run(std::function<void()> work, std::initializer_list<JobHandle> dependencies = {})
+    {
+        JobHandle job = std::make_shared<Job>();
+        job->work = std::move(work);
+        for (const JobHandle& dependency : dependencies)
+        {
+            if (!dependency)
+                continue;
+            std::lock_guard<std::mutex> lock(dependency->dependentsMutex);
+            if (dependency->done.load(std::memory_order_acquire))
+                continue;
+            job->pending.fetch_add(1, std::memory_order_relaxed);
+            dependency->dependents.push_back(job);
+        }
+        release(job);
+        return job;
+    }
+
+    // Run other jobs until `job` has finished, sleeping while there are none to run
+    void wait(const JobHandle& job)
+    {
+        while (job && !job->done.load())
+        {
+            if (runOne())
+                continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            waiters.fetch_add(1);
+            wake.wait(lock, [&]() { return job->done.load() || queued.load() > 0; });
+            waiters.fetch_sub(1);
+        }
+    }
+
+    // fn(begin, end) over [0, count) in chunks of `grain`; returns when all chunks are done
+    template <typename Fn>
+    void parallelFor(std::size_t count, std::size_t grain, Fn fn)
+    {
+        grain = std::max<std::size_t>(grain, 1);
+        if (count <= grain || workerCount == 0)
+        {
+            if (count > 0)
+                fn(std::size_t(0), count);
+            return;
+        }
+
+        std::vector<JobHandle> chunks;
+        chunks.reserve(count / grain);
+        for (std::size_t begin = grain; begin < count; begin += grain)
+        {
+            const std::size_t end = std::min(begin + grain, count);
+            chunks.push_back(run([&fn, begin, end]() { fn(begin, end); }));
+        }
+        fn(std::size_t(0), grain);
+        for (const JobHandle& chunk : chunks)
+            wait(chunk);
+    }
+
+    unsigned threadCount() const { return workerCount + 1; }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    // Which queue of which job system a thread pushes to; a thread can use several systems
+    struct QueueIdentity
+    {
+        std::uint64_t system = 0;
+        unsigned queue = 0;
+    };
+    static constexpr int REMEMBERED_SYSTEMS = 4;
+
+    static QueueIdentity* identities()
+    {
+        static thread_local QueueIdentity remembered[REMEMBERED_SYSTEMS];
+        return remembered;
+    }
+
+    static std::uint64_t nextSerial()
+    {
+        static std::atomic<std::uint64_t> serial{ 0 };
+        return ++serial;
+    }
+
+    // The calling thread's deque if it is one of the workers, else its injection queue
+    unsigned ownQueue()
+    {
+        QueueIdentity* remembered = identities();
+        for (int i = 0; i < REMEMBERED_SYSTEMS; ++i)
+            if (remembered[i].system == serial)
+                return remembered[i].queue;
+        static thread_local unsigned replace = 0;
+        QueueIdentity& identity = remembered[replace++ % REMEMBERED_SYSTEMS];
+        identity.system = serial;
+        identity.queue = workerCount + submitters.fetch_add(1, std::memory_order_relaxed) % JOB_INJECTION_QUEUES;
+        return identity.queue;
+    }
+
+    void release(const JobHandle& job)
+    {
+        if (job->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        Queue& queue = queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        queued.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+    }
+
+    JobHandle take()
+    {
+        const unsigned self = ownQueue();
+        {
+            Queue& own = queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                JobHandle job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                return job;
+            }
+        }
+        for (std::size_t offset = 1; offset < queues.size(); ++offset)
+        {
+            Queue& victim = queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                JobHandle job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    bool runOne()
+    {
+        JobHandle job = take();
+        if (!job)
+            return false;
+        queued.fetch_sub(1);
+        job->work();
+        job->work = nullptr;
+
+        std::vector<JobHandle> ready;
+        {
+            std::lock_guard<std::mutex> lock(job->dependentsMutex);
+            job->done.store(true);
+            ready.swap(job->dependents);
+        }
+        for (const JobHandle& dependent : ready)
+            release(dependent);
+
+        // Sleeping waiters check their job under the lock
+        if (waiters.load() > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+            }
+            wake.notify_all();
+        }
+        return true;
+    }
+
+    void workerLoop(unsigned index)
+    {
+        QueueIdentity& identity = identities()[0];
+        identity.system = serial;
+        identity.queue = index;
+        for (;;)
+        {
+            if (runOne())
+                continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+            if (stopping)
+                return;
+        }
+    }
+
+    const std::uint64_t serial = nextSerial(); // Tells systems apart in QueueIdentity
+    const unsigned workerCount;
+    std::vector<Queue> queues;                 // Worker deques, then the injection queues
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> submitters{ 0 };
+    std::atomic<int> queued{ 0 };
+    std::atomic<int> waiters{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif
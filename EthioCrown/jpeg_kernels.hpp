@@ -0,0 +1,401 @@
+#ifndef JPEG_KERNELS_HPP
+#define JPEG_KERNELS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "cpu_features.hpp"
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+
+// AVX2 versions of stb_image's hot JPEG kernels: the 8x8 IDCT, 2x2 chroma upsampling and
+// YCbCr to RGB. They are bit-identical to stb's own kernels and are swapped in by the
+// STBI_JPEG_KERNEL_HOOK in stbi__setup_jpeg when CPUID reports AVX2, so one binary runs
+// everywhere. stb's SSE2 and scalar kernels stay as the fallbacks.
+
+#ifdef CROWN_X86
+#define JPEG_KERNELS_X86
+#define JPEG_AVX2_TARGET CROWN_AVX2_TARGET
+#endif
+
+enum JpegKernelPath { JPEG_KERNELS_SCALAR, JPEG_KERNELS_SSE2, JPEG_KERNELS_AVX2, JPEG_KERNEL_PATH_COUNT };
+
+inline const char* jpegKernelPathName(int path)
+{
+    static const char* const NAMES[JPEG_KERNEL_PATH_COUNT] = { "scalar", "sse2", "avx2" };
+    return NAMES[path];
+}
+
+// The SSE2 path is whatever stb_image picked for itself, which is SSE2 on x86 builds
+inline bool jpegKernelPathSupported(int path)
+{
+    switch (path)
+    {
+    case JPEG_KERNELS_SCALAR: return true;
+#ifdef JPEG_KERNELS_X86
+    case JPEG_KERNELS_SSE2: return true;
+#endif
+    case JPEG_KERNELS_AVX2:
+    {
+        static const bool avx2 = cpuHasAvx2();
+        return avx2;
+    }
+    default: return false;
+    }
+}
+
+// Path used by decodes that start after the call; -1 picks the fastest supported one
+inline std::atomic<int>& jpegKernelPathSetting()
+{
+    static std::atomic<int> path{ -1 };
+    return path;
+}
+
+inline void setJpegKernelPath(int path) { jpegKernelPathSetting() = path; }
+
+inline int jpegKernelPath()
+{
+    const int path = jpegKernelPathSetting();
+    if (path >= 0 && jpegKernelPathSupported(path))
+        return path;
+    return jpegKernelPathSupported(JPEG_KERNELS_AVX2) ? JPEG_KERNELS_AVX2 : JPEG_KERNELS_SSE2;
+}
+
+#ifdef JPEG_KERNELS_X86
+namespace jpeg_avx2
+{
+    // stb_image's fixed-point constants, rounded exactly as stbi__f2f and stbi__float2fixed do
+    constexpr int f2f(float x) { return static_cast<int>(x * 4096 + 0.5); }
+    constexpr int colorFixed(float x) { return static_cast<int>(x * 4096.0f + 0.5f); }
+
+    // Two 16-bit coefficients per 32-bit lane, for madd against interleaved row pairs
+    JPEG_AVX2_TARGET inline __m256i pairConstant(int even, int odd)
+    {
+        return _mm256_set1_epi32(static_cast<int>((static_cast<unsigned>(even) & 0xffffu) | (static_cast<unsigned>(odd) << 16)));
+    }
+
+    // Interleave two rows of eight 16-bit values into one register, columns 0-3 in the low lane
+    JPEG_AVX2_TARGET inline __m256i interleave(__m128i x, __m128i y)
+    {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(x, y)), _mm_unpackhi_epi16(x, y), 1);
+    }
+
+    JPEG_AVX2_TARGET inline __m128i narrow(__m256i v)
+    {
+        return _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    }
+
+    JPEG_AVX2_TARGET inline __m128i narrowBytes(__m256i v)
+    {
+        return _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    }
+
+    JPEG_AVX2_TARGET inline void transpose(__m128i r[8])
+    {
+        const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+        const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+        const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+        const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+        const __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+        const __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+        const __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+        const __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+        r[0] = _mm_unpacklo_epi64(b0, b4); r[1] = _mm_unpackhi_epi64(b0, b4);
+        r[2] = _mm_unpacklo_epi64(b1, b5); r[3] = _mm_unpackhi_epi64(b1, b5);
+        r[4] = _mm_unpacklo_epi64(b2, b6); r[5] = _mm_unpackhi_epi64(b2, b6);
+        r[6] = _mm_unpacklo_epi64(b3, b7); r[7] = _mm_unpackhi_epi64(b3, b7);
+    }
+
+    // One 1-D pass of stb's DCT_ISLOW over eight columns at once, all products in 32 bits.
+    // stb's rotations are folded into per-input coefficients so each term is one madd.
+    template<int SHIFT>
+    JPEG_AVX2_TARGET inline void idctPass(const __m128i s[8], int bias, __m128i out[8])
+    {
+        constexpr int K1 = f2f(1.175875602f), KP1 = f2f(-0.899976223f), KP2 = f2f(-2.562915447f);
+        constexpr int KP3 = f2f(-1.961570560f), KP4 = f2f(-0.390180644f);
+        constexpr int KA = f2f(0.298631336f), KB = f2f(2.053119869f), KC = f2f(3.072711026f), KD = f2f(1.501321110f);
+        constexpr int KE = f2f(0.5411961f), KF = f2f(-1.847759065f), KG = f2f(0.765366865f);
+
+        // Even part
+        const __m256i s26 = interleave(s[2], s[6]);
+        const __m256i t2e = _mm256_madd_epi16(s26, pairConstant(KE, KE + KF));
+        const __m256i t3e = _mm256_madd_epi16(s26, pairConstant(KE + KG, KE));
+        const __m256i s0 = _mm256_cvtepi16_epi32(s[0]);
+        const __m256i s4 = _mm256_cvtepi16_epi32(s[4]);
+        const __m256i biasv = _mm256_set1_epi32(bias);
+        const __m256i t0e = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(s0, s4), 12), biasv);
+        const __m256i t1e = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(s0, s4), 12), biasv);
+        const __m256i x0 = _mm256_add_epi32(t0e, t3e), x3 = _mm256_sub_epi32(t0e, t3e);
+        const __m256i x1 = _mm256_add_epi32(t1e, t2e), x2 = _mm256_sub_epi32(t1e, t2e);
+
+        // Odd part, a = s7, b = s5, c = s3, d = s1
+        const __m256i s73 = interleave(s[7], s[3]);
+        const __m256i s51 = interleave(s[5], s[1]);
+        const __m256i t0 = _mm256_add_epi32(_mm256_madd_epi16(s73, pairConstant(KA + K1 + KP1 + KP3, K1 + KP3)),
+                                            _mm256_madd_epi16(s51, pairConstant(K1, K1 + KP1)));
+        const __m256i t1 = _mm256_add_epi32(_mm256_madd_epi16(s73, pairConstant(K1, K1 + KP2)),
+                                            _mm256_madd_epi16(s51, pairConstant(KB + K1 + KP2 + KP4, K1 + KP4)));
+        const __m256i t2 = _mm256_add_epi32(_mm256_madd_epi16(s73, pairConstant(K1 + KP3, KC + K1 + KP2 + KP3)),
+                                            _mm256_madd_epi16(s51, pairConstant(K1 + KP2, K1)));
+        const __m256i t3 = _mm256_add_epi32(_mm256_madd_epi16(s73, pairConstant(K1 + KP1, K1)),
+                                            _mm256_madd_epi16(s51, pairConstant(K1 + KP4, KD + K1 + KP1 + KP4)));
+
+        out[0] = narrow(_mm256_srai_epi32(_mm256_add_epi32(x0, t3), SHIFT));
+        out[7] = narrow(_mm256_srai_epi32(_mm256_sub_epi32(x0, t3), SHIFT));
+        out[1] = narrow(_mm256_srai_epi32(_mm256_add_epi32(x1, t2), SHIFT));
+        out[6] = narrow(_mm256_srai_epi32(_mm256_sub_epi32(x1, t2), SHIFT));
+        out[2] = narrow(_mm256_srai_epi32(_mm256_add_epi32(x2, t1), SHIFT));
+        out[5] = narrow(_mm256_srai_epi32(_mm256_sub_epi32(x2, t1), SHIFT));
+        out[3] = narrow(_mm256_srai_epi32(_mm256_add_epi32(x3, t0), SHIFT));
+        out[4] = narrow(_mm256_srai_epi32(_mm256_sub_epi32(x3, t0), SHIFT));
+    }
+
+    JPEG_AVX2_TARGET inline void idctBlock(unsigned char* out, int outStride, short* data)
+    {
+        __m128i rows[8], columns[8];
+        for (int i = 0; i < 8; ++i)
+            rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 8));
+
+        // Columns, keeping 2 extra bits; then rows, rounding and re-centring on 128
+        idctPass<10>(rows, 512, columns);
+        transpose(columns);
+        idctPass<17>(columns, 65536 + (128 << 17), rows);
+        transpose(rows);
+
+        for (int i = 0; i < 8; i += 2)
+        {
+            const __m128i pixels = _mm_packus_epi16(rows[i], rows[i + 1]);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * outStride), pixels);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (i + 1) * outStride), _mm_unpackhi_epi64(pixels, pixels));
+        }
+    }
+
+    // stb's reduced-precision conversion, which its SIMD kernels reproduce exactly
+    inline void ycbcrToRgbScalar(unsigned char* out, unsigned char y, unsigned char cb, unsigned char cr)
+    {
+        const int yFixed = (y << 20) + (1 << 19);
+        const int crs = cr - 128, cbs = cb - 128;
+        int r = yFixed + crs * (colorFixed(1.40200f) << 8);
+        int g = yFixed + crs * -(colorFixed(0.71414f) << 8) + static_cast<int>(static_cast<unsigned>(cbs * -(colorFixed(0.34414f) << 8)) & 0xffff0000u);
+        int b = yFixed + cbs * (colorFixed(1.77200f) << 8);
+        r >>= 20;
+        g >>= 20;
+        b >>= 20;
+        out[0] = static_cast<unsigned char>(r < 0 ? 0 : r > 255 ? 255 : r);
+        out[1] = static_cast<unsigned char>(g < 0 ? 0 : g > 255 ? 255 : g);
+        out[2] = static_cast<unsigned char>(b < 0 ? 0 : b > 255 ? 255 : b);
+        out[3] = 255;
+    }
+
+    // 16 pixels per iteration, for both 3- and 4-byte output steps (stb's SSE2 kernel only
+    // handles 4, and textures are decoded as RGB)
+    JPEG_AVX2_TARGET inline void ycbcrToRgb(unsigned char* out, const unsigned char* y, const unsigned char* pcb,
+                                            const unsigned char* pcr, int count, int step)
+    {
+        int i = 0;
+        if (step == 3 || step == 4)
+        {
+            const __m256i crConst0 = _mm256_set1_epi16(static_cast<short>(colorFixed(1.40200f)));
+            const __m256i crConst1 = _mm256_set1_epi16(static_cast<short>(-colorFixed(0.71414f)));
+            const __m256i cbConst0 = _mm256_set1_epi16(static_cast<short>(-colorFixed(0.34414f)));
+            const __m256i cbConst1 = _mm256_set1_epi16(static_cast<short>(colorFixed(1.77200f)));
+            const __m256i centre = _mm256_set1_epi16(128);
+            const __m256i round = _mm256_set1_epi16(8);
+            const __m128i opaque = _mm_set1_epi8(-1);
+            const __m128i toRgb[3][3] = {
+                { _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5),
+                  _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128),
+                  _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128) },
+                { _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128),
+                  _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10),
+                  _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128) },
+                { _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128),
+                  _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128),
+                  _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15) }
+            };
+
+            for (; i + 15 < count; i += 16)
+            {
+                // Luma as y * 16 + 8, chroma centred and scaled by 256 for the high-half multiplies
+                const __m256i yw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+                const __m256i cbw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcb + i)));
+                const __m256i crw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pcr + i)));
+                const __m256i yws = _mm256_add_epi16(_mm256_slli_epi16(yw, 4), round);
+                const __m256i crs = _mm256_slli_epi16(_mm256_sub_epi16(crw, centre), 8);
+                const __m256i cbs = _mm256_slli_epi16(_mm256_sub_epi16(cbw, centre), 8);
+
+                const __m256i rw = _mm256_srai_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(crConst0, crs), yws), 4);
+                const __m256i gw = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(cbConst0, cbs), yws),
+                                                                      _mm256_mulhi_epi16(crs, crConst1)), 4);
+                const __m256i bw = _mm256_srai_epi16(_mm256_add_epi16(yws, _mm256_mulhi_epi16(cbs, cbConst1)), 4);
+                const __m128i r = narrowBytes(rw), g = narrowBytes(gw), b = narrowBytes(bw);
+
+                if (step == 4)
+                {
+                    const __m128i rg0 = _mm_unpacklo_epi8(r, g), rg1 = _mm_unpackhi_epi8(r, g);
+                    const __m128i ba0 = _mm_unpacklo_epi8(b, opaque), ba1 = _mm_unpackhi_epi8(b, opaque);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 0), _mm_unpacklo_epi16(rg0, ba0));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi16(rg0, ba0));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), _mm_unpacklo_epi16(rg1, ba1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 48), _mm_unpackhi_epi16(rg1, ba1));
+                    out += 64;
+                }
+                else
+                {
+                    for (int part = 0; part < 3; ++part)
+                    {
+                        const __m128i packed = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, toRgb[part][0]), _mm_shuffle_epi8(g, toRgb[part][1])),
+                                                            _mm_shuffle_epi8(b, toRgb[part][2]));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + part * 16), packed);
+                    }
+                    out += 48;
+                }
+            }
+        }
+        // Like stb, the tail writes a fourth byte even at step 3; its output has a spare byte
+        for (; i < count; ++i, out += step)
+            ycbcrToRgbScalar(out, y[i], pcb[i], pcr[i]);
+    }
+
+    // 2x2 chroma upsampling of one row, 16 input pixels per iteration
+    JPEG_AVX2_TARGET inline unsigned char* resampleRowHv2(unsigned char* out, unsigned char* inNear, unsigned char* inFar, int w, int hs)
+    {
+        (void)hs;
+        if (w == 1)
+        {
+            out[0] = out[1] = static_cast<unsigned char>((3 * inNear[0] + inFar[0] + 2) >> 2);
+            return out;
+        }
+
+        int i = 0;
+        int t1 = 3 * inNear[0] + inFar[0];
+        // The last input pixel needs the filter's boundary case, so stop short of it
+        for (; i < ((w - 1) & ~15); i += 16)
+        {
+            // Vertical pass: 3 * near + far = 4 * near + (far - near)
+            const __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inNear + i)));
+            const __m256i farw = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inFar + i)));
+            const __m256i curr = _mm256_add_epi16(_mm256_slli_epi16(nearw, 2), _mm256_sub_epi16(farw, nearw));
+
+            // Neighbours one pixel left and right, across the lane boundary, with the
+            // pixels just outside this group filled in
+            const __m256i prev = _mm256_insert_epi16(
+                _mm256_alignr_epi8(curr, _mm256_permute2x128_si256(curr, curr, 0x08), 14), t1, 0);
+            const __m256i next = _mm256_insert_epi16(
+                _mm256_alignr_epi8(_mm256_permute2x128_si256(curr, curr, 0x81), curr, 2), 3 * inNear[i + 16] + inFar[i + 16], 15);
+
+            // Horizontal pass: even = 3 * curr + prev, odd = 3 * curr + next, rounded
+            const __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), _mm256_set1_epi16(8));
+            const __m256i even = _mm256_srli_epi16(_mm256_add_epi16(curb, _mm256_sub_epi16(prev, curr)), 4);
+            const __m256i odd = _mm256_srli_epi16(_mm256_add_epi16(curb, _mm256_sub_epi16(next, curr)), 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2), _mm256_or_si256(even, _mm256_slli_epi16(odd, 8)));
+
+            t1 = 3 * inNear[i + 15] + inFar[i + 15];
+        }
+
+        int t0 = t1;
+        t1 = 3 * inNear[i] + inFar[i];
+        out[i * 2] = static_cast<unsigned char>((3 * t1 + t0 + 8) >> 4);
+        for (++i; i < w; ++i)
+        {
+            t0 = t1;
+            t1 = 3 * inNear[i] + inFar[i];
+            out[i * 2 - 1] = static_cast<unsigned char>((3 * t0 + t1 + 8) >> 4);
+            out[i * 2] = static_cast<unsigned char>((3 * t1 + t0 + 8) >> 4);
+        }
+        out[w * 2 - 1] = static_cast<unsigned char>((t1 + 2) >> 2);
+        return out;
+    }
+}
+#endif
+
+// Called from stbi__setup_jpeg through STBI_JPEG_KERNEL_HOOK with the kernels stb picked
+// (SSE2 where available) and its portable scalar ones
+template<typename Idct, typename Color, typename Resample>
+inline void selectJpegKernels(Idct& idct, Color& color, Resample& resample, Idct scalarIdct, Color scalarColor, Resample scalarResample)
+{
+    switch (jpegKernelPath())
+    {
+    case JPEG_KERNELS_SCALAR:
+        idct = scalarIdct;
+        color = scalarColor;
+        resample = scalarResample;
+        break;
+#ifdef JPEG_KERNELS_X86
+    case JPEG_KERNELS_AVX2:
+        idct = jpeg_avx2::idctBlock;
+        color = jpeg_avx2::ycbcrToRgb;
+        resample = jpeg_avx2::resampleRowHv2;
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+// Decode throughput of the repository's photos through every supported kernel path, in
+// MB/s of decoded RGB, checked against the scalar output
+inline void runDecodeBenchmark(int iterations = 10)
+{
+    const char* const FILES[] = { "goldi.jpg", "Image.jpg", "cylinder.jpg", "heyy.jpg", "spikes.jfif" };
+    const int fileCount = static_cast<int>(sizeof(FILES) / sizeof(FILES[0]));
+    std::vector<std::vector<unsigned char>> sources(fileCount);
+    std::vector<std::vector<unsigned char>> reference(fileCount);
+    const int previousPath = jpegKernelPathSetting();
+
+    setJpegKernelPath(JPEG_KERNELS_SCALAR);
+    for (int file = 0; file < fileCount; ++file)
+    {
+        std::ifstream stream(FILES[file], std::ios::binary);
+        sources[file].assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        int width, height, channels;
+        unsigned char* pixels = stbi_load_from_memory(sources[file].data(), static_cast<int>(sources[file].size()), &width, &height, &channels, 3);
+        if (!pixels)
+        {
+            std::cerr << "Failed to decode " << FILES[file] << std::endl;
+            return;
+        }
+        reference[file].assign(pixels, pixels + static_cast<std::size_t>(width) * height * 3);
+        stbi_image_free(pixels);
+    }
+
+    for (int path = 0; path < JPEG_KERNEL_PATH_COUNT; ++path)
+    {
+        if (!jpegKernelPathSupported(path))
+        {
+            std::cout << "decode " << jpegKernelPathName(path) << ": not supported on this CPU" << std::endl;
+            continue;
+        }
+        setJpegKernelPath(path);
+        std::cout << "decode " << jpegKernelPathName(path) << ":";
+        double totalBytes = 0.0, totalSeconds = 0.0;
+        bool identical = true;
+        for (int file = 0; file < fileCount; ++file)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                int width, height, channels;
+                unsigned char* pixels = stbi_load_from_memory(sources[file].data(), static_cast<int>(sources[file].size()), &width, &height, &channels, 3);
+                if (iteration == 0)
+                    identical = identical && std::memcmp(pixels, reference[file].data(), reference[file].size()) == 0;
+                stbi_image_free(pixels);
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const double bytes = static_cast<double>(reference[file].size()) * iterations;
+            totalBytes += bytes;
+            totalSeconds += seconds;
+            std::cout << " " << FILES[file] << " " << bytes / seconds * 1e-6 << ",";
+        }
+        std::cout << " all " << totalBytes / totalSeconds * 1e-6 << " MB/s" << (identical ? "" : " (output differs from scalar!)") << std::endl;
+    }
+    setJpegKernelPath(previousPath);
+}
+
+#endif
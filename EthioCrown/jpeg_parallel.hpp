@@ -0,0 +1,122 @@
+#ifndef JPEG_PARALLEL_HPP
+#define JPEG_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <vector>
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+#include "job_system.hpp"
+
+// Splits the decode of a single JPEG across a job system. A baseline scan with restart
+// markers is cut at them and its intervals are Huffman decoded on the jobs. Otherwise the
+// scan is one serial bit stream, so it is decoded a band of MCU rows at a time while the
+// jobs run the IDCTs of the band before; progressive images keep all their coefficients
+// and IDCT them in row bands at the end. The upsampling and colour conversion pass runs
+// as row bands too. main.cpp installs the hooks as STBI_JPEG_PARALLEL_HOOK /
+// STBI_JPEG_PARALLEL_THREADS before expanding stb_image.
+
+inline std::atomic<JobSystem*>& jpegDecodeJobSlot()
+{
+    static std::atomic<JobSystem*> jobs{ nullptr };
+    return jobs;
+}
+
+// Jobs that every thread's JPEG decodes split across, nullptr decodes serially. Must not
+// change while a decode is running.
+inline void setJpegDecodeJobs(JobSystem* jobs)
+{
+    jpegDecodeJobSlot().store(jobs, std::memory_order_release);
+}
+
+inline int jpegDecodeThreads()
+{
+    const JobSystem* jobs = jpegDecodeJobSlot().load(std::memory_order_acquire);
+    return jobs ? static_cast<int>(jobs->threadCount()) : 1;
+}
+
+// task(user, i) for every i in [0, count), returns once all have run
+template <typename Task>
+inline void jpegParallelFor(int count, Task task, void* user)
+{
+    JobSystem* jobs = jpegDecodeJobSlot().load(std::memory_order_acquire);
+    if (!jobs)
+    {
+        for (int i = 0; i < count; ++i)
+            task(user, i);
+        return;
+    }
+    jobs->parallelFor(static_cast<std::size_t>(count), 1, [task, user](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            task(user, static_cast<int>(i));
+    });
+}
+
+// Decode time of the larger photos by thread count, checked against the serial output
+inline void runParallelDecodeBenchmark(int iterations = 10)
+{
+    const char* const FILES[] = { "goldi.jpg", "Image.jpg", "cylinder.jpg" };
+    const int fileCount = static_cast<int>(sizeof(FILES) / sizeof(FILES[0]));
+    std::vector<std::vector<unsigned char>> sources(fileCount);
+    std::vector<std::vector<unsigned char>> reference(fileCount);
+    JobSystem* const previous = jpegDecodeJobSlot().load();
+
+    setJpegDecodeJobs(nullptr);
+    for (int file = 0; file < fileCount; ++file)
+    {
+        std::ifstream stream(FILES[file], std::ios::binary);
+        sources[file].assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        int width, height, channels;
+        unsigned char* pixels = stbi_load_from_memory(sources[file].data(), static_cast<int>(sources[file].size()), &width, &height, &channels, 3);
+        if (!pixels)
+        {
+            std::cerr << "Failed to decode " << FILES[file] << std::endl;
+            setJpegDecodeJobs(previous);
+            return;
+        }
+        reference[file].assign(pixels, pixels + static_cast<std::size_t>(width) * height * 3);
+        stbi_image_free(pixels);
+    }
+
+    // Powers of two up to the core count, and at least two so the split path is checked
+    const unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+    for (unsigned threads : threadCounts)
+    {
+        JobSystem jobs(threads);
+        setJpegDecodeJobs(threads > 1 ? &jobs : nullptr);
+        std::cout << "parallel decode " << threads << (threads == 1 ? " thread:" : " threads:");
+        bool identical = true;
+        for (int file = 0; file < fileCount; ++file)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                int width, height, channels;
+                unsigned char* pixels = stbi_load_from_memory(sources[file].data(), static_cast<int>(sources[file].size()), &width, &height, &channels, 3);
+                if (iteration == 0)
+                    identical = identical && pixels && std::memcmp(pixels, reference[file].data(), reference[file].size()) == 0;
+                stbi_image_free(pixels);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            std::cout << " " << FILES[file] << " " << ms << " ms,";
+        }
+        std::cout << (identical ? "" : " (output differs from serial!)") << std::endl;
+        setJpegDecodeJobs(nullptr);
+    }
+    setJpegDecodeJobs(previous);
+}
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef KTX2_HPP
+#define KTX2_HPP
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+#include "block_compress.hpp"
+#include "image_scale.hpp"
+#include "job_system.hpp"
+
+// KTX 2.0 containers holding one block-compressed 2D texture with its mip chain, no
+// supercompression. Rows are stored bottom-up (KTXorientation "ru") to match the GL upload
+// of the flipped stb_image decodes, so the runtime hands every level straight to
+// glCompressedTexImage2D. Colour textures are tagged sRGB (the _SRGB vkFormat and an sRGB
+// transfer function in the data format descriptor), anything else linear.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+constexpr std::uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+constexpr std::uint32_t VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132;
+constexpr std::uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+constexpr std::uint32_t VK_FORMAT_BC7_SRGB_BLOCK = 146;
+constexpr std::uint32_t VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147;
+constexpr std::uint32_t VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK = 148;
+
+struct Ktx2Level
+{
+    std::uint64_t offset = 0; // From the start of the file
+    std::uint64_t length = 0;
+};
+
+struct Ktx2Texture
+{
+    int format = -1;                // BlockFormat
+    int width = 0;
+    int height = 0;
+    bool srgb = false;              // Texels are sRGB encoded
+    std::vector<Ktx2Level> levels;  // Full size first
+};
+
+inline std::uint32_t blockFormatVkFormat(int format, bool srgb = false)
+{
+    switch (format)
+    {
+    case BLOCK_BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case BLOCK_BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    default: return srgb ? VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+    }
+}
+
+// `srgb` picks the variant that decodes texels from sRGB when sampled
+inline GLenum blockFormatGlFormat(int format, bool srgb = false)
+{
+    switch (format)
+    {
+    case BLOCK_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+    }
+}
+
+inline bool glHasExtension(const char* extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Whether the current context can sample `format`, or its sRGB variant
+inline bool glSupportsBlockFormat(int format, bool srgb = false)
+{
+    if (format == BLOCK_BC7)
+        return GLAD_GL_VERSION_4_2;
+    if (format == BLOCK_ETC2_RGB)
+        return GLAD_GL_VERSION_4_3;
+    return glHasExtension("GL_EXT_texture_compression_s3tc") && (!srgb || glHasExtension("GL_EXT_texture_sRGB"));
+}
+
+// "textures/cylinder.jpg" -> "textures/cylinder.ktx2"
+inline std::string ktx2PathFor(const std::string& path)
+{
+    const std::size_t dot = path.find_last_of('.');
+    const std::size_t slash = path.find_last_of("/\\");
+    const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    return (hasExtension ? path.substr(0, dot) : path) + ".ktx2";
+}
+
+inline bool isKtx2Path(const std::string& path)
+{
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".ktx2") == 0;
+}
+
+namespace ktx2_detail
+{
+    const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr std::size_t HEADER_BYTES = 80;      // Identifier, header and index
+    constexpr std::size_t LEVEL_ENTRY_BYTES = 24;
+    constexpr std::uint32_t DFD_BYTES = 44;       // Total size word, basic block, one sample
+    constexpr std::uint32_t TRANSFER_LINEAR = 1;  // KHR_DF_TRANSFER_LINEAR
+    constexpr std::uint32_t TRANSFER_SRGB = 2;    // KHR_DF_TRANSFER_SRGB
+
+    inline void put32(std::vector<unsigned char>& out, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    inline void put64(std::vector<unsigned char>& out, std::uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    inline std::uint64_t get(const unsigned char* in, int bytes)
+    {
+        std::uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+            value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+        return value;
+    }
+
+    inline int levelSize(int size, int level)
+    {
+        return std::max(1, size >> level);
+    }
+
+    // Basic data format descriptor of a single-sample compressed block
+    inline void putDataFormat(std::vector<unsigned char>& out, int format, bool srgb)
+    {
+        // Khronos colour models and their colour channel ids
+        const std::uint32_t model = format == BLOCK_BC1 ? 128 : format == BLOCK_BC7 ? 134 : 161;
+        const std::uint32_t channel = format == BLOCK_ETC2_RGB ? 2 : 0;
+        const std::uint32_t bytes = static_cast<std::uint32_t>(blockFormatBytes(format));
+        put32(out, DFD_BYTES);
+        put32(out, 0);                              // Khronos vendor, basic descriptor
+        put32(out, 2 | ((DFD_BYTES - 4) << 16));    // Version 2, block size
+        put32(out, model | (1 << 8) | ((srgb ? TRANSFER_SRGB : TRANSFER_LINEAR) << 16)); // BT.709 primaries, straight alpha
+        put32(out, 3 | (3 << 8));                   // 4x4x1x1 texels, stored minus one
+        put32(out, bytes);                          // Bytes in plane 0
+        put32(out, 0);
+        put32(out, (bytes * 8 - 1) << 16 | channel << 24); // Offset 0, all bits of the block
+        put32(out, 0);                              // Sample position
+        put32(out, 0);                              // Lower
+        put32(out, 0xFFFFFFFFu);                    // Upper
+    }
+
+    inline void putKeyValue(std::vector<unsigned char>& out, const char* key, const char* value)
+    {
+        const std::size_t keyBytes = std::strlen(key) + 1, valueBytes = std::strlen(value) + 1;
+        put32(out, static_cast<std::uint32_t>(keyBytes + valueBytes));
+        out.insert(out.end(), key, key + keyBytes);
+        out.insert(out.end(), value, value + valueBytes);
+        while (out.size() % 4)
+            out.push_back(0);
+    }
+}
+
+// `levels` holds the compressed mip chain, full size first, each compressedSize() bytes;
+// `srgb` tags the texels as sRGB encoded
+inline bool writeKtx2(const std::string& path, int format, bool srgb, int width, int height,
+    const std::vector<std::vector<unsigned char>>& levels)
+{
+    using namespace ktx2_detail;
+    const std::size_t levelCount = levels.size();
+    std::vector<unsigned char> dataFormat, keyValues;
+    putDataFormat(dataFormat, format, srgb);
+    putKeyValue(keyValues, "KTXorientation", "ru");
+
+    const std::size_t dataFormatOffset = HEADER_BYTES + levelCount * LEVEL_ENTRY_BYTES;
+    const std::size_t keyValueOffset = dataFormatOffset + dataFormat.size();
+    // Level data is stored smallest first, each level aligned to the block size
+    const std::size_t alignment = static_cast<std::size_t>(blockFormatBytes(format));
+    std::vector<std::uint64_t> offsets(levelCount);
+    std::size_t end = keyValueOffset + keyValues.size();
+    for (std::size_t level = levelCount; level-- > 0;)
+    {
+        end = (end + alignment - 1) / alignment * alignment;
+        offsets[level] = end;
+        end += levels[level].size();
+    }
+
+    std::vector<unsigned char> header(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+    put32(header, blockFormatVkFormat(format, srgb));
+    put32(header, 1);                                   // typeSize
+    put32(header, static_cast<std::uint32_t>(width));
+    put32(header, static_cast<std::uint32_t>(height));
+    put32(header, 0);                                   // pixelDepth
+    put32(header, 0);                                   // layerCount
+    put32(header, 1);                                   // faceCount
+    put32(header, static_cast<std::uint32_t>(levelCount));
+    put32(header, 0);                                   // No supercompression
+    put32(header, static_cast<std::uint32_t>(dataFormatOffset));
+    put32(header, static_cast<std::uint32_t>(dataFormat.size()));
+    put32(header, static_cast<std::uint32_t>(keyValueOffset));
+    put32(header, static_cast<std::uint32_t>(keyValues.size()));
+    put64(header, 0);                                   // No supercompression global data
+    put64(header, 0);
+    for (std::size_t level = 0; level < levelCount; ++level)
+    {
+        put64(header, offsets[level]);
+        put64(header, levels[level].size());
+        put64(header, levels[level].size());            // Uncompressed length, same without supercompression
+    }
+    header.insert(header.end(), dataFormat.begin(), dataFormat.end());
+    header.insert(header.end(), keyValues.begin(), keyValues.end());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    std::size_t written = header.size();
+    for (std::size_t level = levelCount; level-- > 0;)
+    {
+        static const char PADDING[16] = {};
+        file.write(PADDING, offsets[level] - written);
+        file.write(reinterpret_cast<const char*>(levels[level].data()), levels[level].size());
+        written = offsets[level] + levels[level].size();
+    }
+    return static_cast<bool>(file);
+}
+
+// Header and level index of a KTX2 file this renderer can upload; the file is left open
+// for the caller to read the levels from. Every level is checked to lie within the file.
+inline bool readKtx2(std::istream& file, Ktx2Texture& texture)
+{
+    using namespace ktx2_detail;
+    if (!file.seekg(0, std::ios::end))
+        return false;
+    const std::streamoff fileSize = file.tellg();
+    unsigned char header[HEADER_BYTES];
+    if (fileSize < 0 || !file.seekg(0) || !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+        return false;
+
+    const std::uint32_t vkFormat = static_cast<std::uint32_t>(get(header + 12, 4));
+    texture.format = -1;
+    for (int format = 0; format < BLOCK_FORMAT_COUNT; ++format)
+        for (bool srgb : { false, true })
+            if (blockFormatVkFormat(format, srgb) == vkFormat)
+            {
+                texture.format = format;
+                texture.srgb = srgb;
+            }
+    texture.width = static_cast<int>(get(header + 20, 4));
+    texture.height = static_cast<int>(get(header + 24, 4));
+    const std::uint64_t depth = get(header + 28, 4), layers = get(header + 32, 4), faces = get(header + 36, 4);
+    const std::uint64_t levelCount = get(header + 40, 4), supercompression = get(header + 44, 4);
+    if (texture.format < 0 || texture.width <= 0 || texture.height <= 0 || depth != 0 || layers != 0 || faces != 1 ||
+        supercompression != 0 || levelCount == 0 || levelCount > 32)
+        return false;
+
+    std::vector<unsigned char> index(static_cast<std::size_t>(levelCount) * LEVEL_ENTRY_BYTES);
+    if (!file.read(reinterpret_cast<char*>(index.data()), index.size()))
+        return false;
+    // Level data follows the index and ends within the file
+    const std::uint64_t size = static_cast<std::uint64_t>(fileSize);
+    const std::uint64_t dataStart = HEADER_BYTES + index.size();
+    texture.levels.resize(static_cast<std::size_t>(levelCount));
+    for (std::size_t level = 0; level < texture.levels.size(); ++level)
+    {
+        Ktx2Level& entry = texture.levels[level];
+        entry.offset = get(&index[level * LEVEL_ENTRY_BYTES], 8);
+        entry.length = get(&index[level * LEVEL_ENTRY_BYTES + 8], 8);
+        const int width = levelSize(texture.width, static_cast<int>(level)), height = levelSize(texture.height, static_cast<int>(level));
+        if (entry.length != compressedSize(texture.format, width, height) || entry.offset < dataStart || entry.offset > size ||
+            entry.length > size - entry.offset)
+            return false;
+    }
+    return true;
+}
+
+// Offline encoder: every file becomes a .ktx2 beside it with its full mip chain in
+// `format`, block rows encoded on `jobs`. Levels are area-averaged from the one above.
+// `srgb` tags the output as sRGB, which colour images are.
+inline void runTextureCompressor(int format, const char* const* files, int fileCount, JobSystem& jobs, bool srgb)
+{
+    stbi_set_flip_vertically_on_load(true);
+    for (int file = 0; file < fileCount; ++file)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(files[file], &width, &height, &channels, 3);
+        if (!pixels)
+        {
+            std::cerr << "Failed to load " << files[file] << std::endl;
+            continue;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<unsigned char>> levels;
+        std::vector<unsigned char> level(pixels, pixels + static_cast<std::size_t>(width) * height * 3), smaller;
+        stbi_image_free(pixels);
+        double baseError = 0.0;
+        std::size_t uncompressed = 0;
+        for (int levelWidth = width, levelHeight = height;;)
+        {
+            levels.emplace_back(compressedSize(format, levelWidth, levelHeight));
+            const double error = compressImage(level.data(), levelWidth, levelHeight, format, levels.back().data(), &jobs);
+            if (levels.size() == 1)
+                baseError = error;
+            uncompressed += level.size();
+            if (levelWidth == 1 && levelHeight == 1)
+                break;
+            const int nextWidth = std::max(1, levelWidth / 2), nextHeight = std::max(1, levelHeight / 2);
+            smaller.resize(static_cast<std::size_t>(nextWidth) * nextHeight * 3);
+            resampleImage(level.data(), levelWidth, levelHeight, smaller.data(), nextWidth, nextHeight, 3);
+            level.swap(smaller);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const std::string path = ktx2PathFor(files[file]);
+        if (!writeKtx2(path, format, srgb, width, height, levels))
+        {
+            std::cerr << "Failed to write " << path << std::endl;
+            continue;
+        }
+        std::size_t compressed = 0;
+        for (const std::vector<unsigned char>& data : levels)
+            compressed += data.size();
+        const double mse = baseError / (static_cast<double>(width) * height * 3);
+        std::cout << path << ": " << blockFormatName(format) << " " << width << "x" << height << ", " << levels.size() << " levels, "
+                  << compressed << " bytes (" << uncompressed << " as RGB), " << ms << " ms, base level PSNR "
+                  << (mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0) << " dB" << std::endl;
+    }
+    stbi_set_flip_vertically_on_load(false);
+}
+
+#endif
@@ -1,5 +1,18 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+// Route stb_image allocations through the decode target hooks so the texture loader can
+// decode straight into mapped unpack buffers
+#include "decode_target.hpp"
+#define STBI_MALLOC(sz) decodeMalloc(sz)
+#define STBI_REALLOC(p, newsz) decodeRealloc(p, newsz)
+#define STBI_FREE(p) decodeFree(p)
+// AVX2 JPEG kernels when the CPU has them
+#include "jpeg_kernels.hpp"
+#define STBI_JPEG_KERNEL_HOOK selectJpegKernels
+// IDCT and colour conversion of one image split across the decode jobs
+#include "jpeg_parallel.hpp"
+#define STBI_JPEG_PARALLEL_HOOK jpegParallelFor
+#define STBI_JPEG_PARALLEL_THREADS jpegDecodeThreads
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <iostream>
@@ -10,462 +23,410 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "main.h"
-
-// Define pi manually
-const float PI = 3.14159265359f;
+#include "baked_mesh.hpp"
+#include "mesh_simplify.hpp"
+#include "meshlet.hpp"
+#include "frustum.hpp"
+#include "bounds.hpp"
+#include "frustum_cull.hpp"
+#include "gpu_culling.hpp"
+#include "hiz.hpp"
+#include "soft_raster.hpp"
+#include "path_tracer.hpp"
+#include "picking.hpp"
+#include "transform_hierarchy.hpp"
+#include "job_system.hpp"
+#include "render_thread.hpp"
+#include "command_stream.hpp"
+#include "frame_ring.hpp"
+#include "texture_loader.hpp"
+#include "image_scale.hpp"
+#include "ktx2.hpp"
+#include "texture_cache.hpp"
+#include "texture_format.hpp"
+#include "texture_streaming.hpp"
+#include "virtual_texture.hpp"
+#include "asset_pack.hpp"
+#include "self_test.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 
 // Window settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
+constexpr unsigned int SCR_WIDTH = 800;
+constexpr unsigned int SCR_HEIGHT = 600;
+
+// Camera settings
+const glm::vec3 CAMERA_POS(0.0f, 4.0f, 5.0f);
+constexpr float FOV_Y_DEGREES = 45.0f;
+
+// Spotlight settings
+const glm::vec3 LIGHT_POS(0.0f, 5.0f, 8.0f);                  // A bit lower and forward
+const glm::vec3 LIGHT_DIR = glm::normalize(glm::vec3(0.0f, -0.8f, -1.0f));
+const glm::vec3 LIGHT_COLOR(1.5f, 1.5f, 1.2f);                // Softer warm light
+constexpr float LIGHT_CUTOFF_DEGREES = 8.0f;                  // Sharper beam
+constexpr float LIGHT_OUTER_CUTOFF_DEGREES = 11.0f;           // Soft edge
+
+// Scene settings, extra crowns are laid out on a grid behind the first one
+constexpr int CROWN_PART_COUNT = 9; // Cylinder, cross and seven spikes
+enum CrownImage { CYLINDER_IMAGE, SPIKES_IMAGE, CROWN_IMAGE_COUNT };
+const char* const CROWN_IMAGE_FILES[CROWN_IMAGE_COUNT] = { "cylinder.jpg", "spikes.jfif" };
+const char* const SHADER_FILES[] = {
+    "vertex_shader.glsl", "gpu_vertex_shader.glsl", "fragment_shader.glsl", "cull_compute.glsl", "hiz_build_compute.glsl",
+    "virtual_texture_feedback.glsl"
+};
+// Asset pack names of the cylinder surfaces' LOD chains: outer, inner, top cap, bottom cap
+const char* const CYLINDER_LOD_ASSETS[4] = { "cylinder_outer.lod", "cylinder_inner.lod", "cylinder_top.lod", "cylinder_bottom.lod" };
+constexpr float CROWN_SPACING = 4.0f;
+constexpr int CULL_REPORT_FRAMES = 300;
+constexpr std::size_t CULL_JOB_BOXES = 4096; // Boxes per culling job, a multiple of the SIMD width
+
+// LOD settings, coarser levels are used while their error stays under this many pixels
+constexpr float LOD_PIXEL_ERROR = 1.0f;
 
 // Cylinder settings
-const int SECTORS = 36;
-const float OUTER_RADIUS = 1.5f;
-const float INNER_RADIUS = 1.3f;
-const float HEIGHT = 1.5f;
+constexpr int SECTORS = 36;
+constexpr float OUTER_RADIUS = 1.5f;
+constexpr float INNER_RADIUS = 1.3f;
+constexpr float HEIGHT = 1.5f;
 
 // Cross settings
-const float CROSS_WIDTH = 0.4f;
-const float CROSS_HEIGHT = 0.65f;
-const float CROSS_THICKNESS = 0.2f;
+constexpr float CROSS_WIDTH = 0.4f;
+constexpr float CROSS_HEIGHT = 0.65f;
+constexpr float CROSS_THICKNESS = 0.2f;
 
 // Spike settings
-const float SPIKE_WIDTH = 0.5f;
-const float SPIKE_HEIGHT = 0.7f;
-const float SPIKE_THICKNESS = 0.1f;
+constexpr float SPIKE_WIDTH = 0.5f;
+constexpr float SPIKE_HEIGHT = 0.7f;
+constexpr float SPIKE_THICKNESS = 0.1f;
 
 // Spike1 settings
-const float SPIKE_WIDTH1 = 0.4f;
-const float SPIKE_HEIGHT1 = 0.7f;
-const float SPIKE_THICKNESS1 = 0.08f;
+constexpr float SPIKE_WIDTH1 = 0.4f;
+constexpr float SPIKE_HEIGHT1 = 0.7f;
+constexpr float SPIKE_THICKNESS1 = 0.08f;
 
 // Spike2 settings
-const float SPIKE_WIDTH2 = 0.4f;
-const float SPIKE_HEIGHT2 = 0.7f;
-const float SPIKE_THICKNESS2 = 0.08f;
+constexpr float SPIKE_WIDTH2 = 0.4f;
+constexpr float SPIKE_HEIGHT2 = 0.7f;
+constexpr float SPIKE_THICKNESS2 = 0.08f;
 
 // Spike3 settings
-const float SPIKE_WIDTH3 = 0.5f;
-const float SPIKE_HEIGHT3 = 0.4f;
-const float SPIKE_THICKNESS3 = 0.1f;
+constexpr float SPIKE_WIDTH3 = 0.5f;
+constexpr float SPIKE_HEIGHT3 = 0.4f;
+constexpr float SPIKE_THICKNESS3 = 0.1f;
 
 // Spike4 settings
-const float SPIKE_WIDTH4 = 0.4f;
-const float SPIKE_HEIGHT4 = 0.4f;
-const float SPIKE_THICKNESS4 = 0.1f;
+constexpr float SPIKE_WIDTH4 = 0.4f;
+constexpr float SPIKE_HEIGHT4 = 0.4f;
+constexpr float SPIKE_THICKNESS4 = 0.1f;
 
 // Spike5 settings
-const float SPIKE_WIDTH5 = 0.4f;
-const float SPIKE_HEIGHT5 = 0.4f;
-const float SPIKE_THICKNESS5 = 0.08f;
+constexpr float SPIKE_WIDTH5 = 0.4f;
+constexpr float SPIKE_HEIGHT5 = 0.4f;
+constexpr float SPIKE_THICKNESS5 = 0.08f;
 
 // Spike6 settings
-const float SPIKE_WIDTH6 = 0.4f;
-const float SPIKE_HEIGHT6 = 0.4f;
-const float SPIKE_THICKNESS6 = 0.08f;
-
-// Function to generate the hollow cylinder vertices and indices
-void generateHollowCylinder(float radiusOuter, float radiusInner, float height, int sectors,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& outerIndices,
-    std::vector<GLuint>& innerIndices, std::vector<GLuint>& topCapIndices,
-    std::vector<GLuint>& bottomCapIndices)
+constexpr float SPIKE_WIDTH6 = 0.4f;
+constexpr float SPIKE_HEIGHT6 = 0.4f;
+constexpr float SPIKE_THICKNESS6 = 0.08f;
+
+// Fixed-topology parts baked at compile time into read-only data
+static constexpr CylinderMesh<SECTORS> CYLINDER_MESH(OUTER_RADIUS, INNER_RADIUS, HEIGHT);
+static constexpr CrossMesh CROSS_MESH(CROSS_WIDTH, CROSS_HEIGHT, CROSS_THICKNESS);
+static constexpr SpikeMesh SPIKE_MESH(SPIKE_WIDTH, SPIKE_HEIGHT, SPIKE_THICKNESS);
+static constexpr SpikeMesh SPIKE1_MESH(SPIKE_WIDTH1, SPIKE_HEIGHT1, SPIKE_THICKNESS1);
+static constexpr SpikeMesh SPIKE2_MESH(SPIKE_WIDTH2, SPIKE_HEIGHT2, SPIKE_THICKNESS2);
+static constexpr SpikeMesh SPIKE3_MESH(SPIKE_WIDTH3, SPIKE_HEIGHT3, SPIKE_THICKNESS3);
+static constexpr SpikeMesh SPIKE4_MESH(SPIKE_WIDTH4, SPIKE_HEIGHT4, SPIKE_THICKNESS4);
+static constexpr SpikeMesh SPIKE5_MESH(SPIKE_WIDTH5, SPIKE_HEIGHT5, SPIKE_THICKNESS5);
+static constexpr SpikeMesh SPIKE6_MESH(SPIKE_WIDTH6, SPIKE_HEIGHT6, SPIKE_THICKNESS6);
+
+// Part placement relative to the crown root: 0 cylinder, 1 cross, 2-8 spikes
+void computePartModels(const glm::mat4& model, glm::mat4 (&partModels)[CROWN_PART_COUNT])
 {
-    float sectorStep = 2 * PI / sectors;
+    partModels[0] = model;
 
-    for (int i = 0; i <= sectors; ++i)
-    {
-        float angle = i * sectorStep;
-        float u = static_cast<float>(i) / sectors;
-
-        // Outer top
-        vertices.push_back(radiusOuter * cos(angle));
-        vertices.push_back(height / 2);
-        vertices.push_back(radiusOuter * sin(angle));
-        vertices.push_back(u); // Texture X
-        vertices.push_back(1.0f); // Texture Y
-
-        // Outer bottom
-        vertices.push_back(radiusOuter * cos(angle));
-        vertices.push_back(-height / 2);
-        vertices.push_back(radiusOuter * sin(angle));
-        vertices.push_back(u); // Texture X
-        vertices.push_back(0.0f); // Texture Y
-
-        // Inner top
-        vertices.push_back(radiusInner * cos(angle));
-        vertices.push_back(height / 2);
-        vertices.push_back(radiusInner * sin(angle));
-        vertices.push_back(u); // Texture X
-        vertices.push_back(1.0f); // Texture Y
-
-        // Inner bottom
-        vertices.push_back(radiusInner * cos(angle));
-        vertices.push_back(-height / 2);
-        vertices.push_back(radiusInner * sin(angle));
-        vertices.push_back(u); // Texture X
-        vertices.push_back(0.0f); // Texture Y
-    }
+    // Cross
+    partModels[1] = glm::translate(model, glm::vec3(0.0f, HEIGHT / 2 + CROSS_HEIGHT / 1.5 + 0.55, 2.12f));
 
-    // Generate indices for outer and inner surfaces
-    for (int i = 0; i < sectors; ++i)
-    {
-        int current = i * 4;
-        int next = ((i + 1) % sectors) * 4;
-
-        // Outer surface
-        outerIndices.push_back(current);
-        outerIndices.push_back(next);
-        outerIndices.push_back(current + 1);
-        outerIndices.push_back(next);
-        outerIndices.push_back(next + 1);
-        outerIndices.push_back(current + 1);
-
-        // Inner surface
-        innerIndices.push_back(current + 2);
-        innerIndices.push_back(next + 2);
-        innerIndices.push_back(current + 3);
-        innerIndices.push_back(next + 2);
-        innerIndices.push_back(next + 3);
-        innerIndices.push_back(current + 3);
-
-        // Top Cap (connect inner and outer top edges)
-        topCapIndices.push_back(current);
-        topCapIndices.push_back(next);
-        topCapIndices.push_back(current + 2);
-        topCapIndices.push_back(next);
-        topCapIndices.push_back(next + 2);
-        topCapIndices.push_back(current + 2);
-
-        // Bottom Cap (connect inner and outer bottom edges)
-        bottomCapIndices.push_back(current + 1);
-        bottomCapIndices.push_back(next + 1);
-        bottomCapIndices.push_back(current + 3);
-        bottomCapIndices.push_back(next + 1);
-        bottomCapIndices.push_back(next + 3);
-        bottomCapIndices.push_back(current + 3);
-    }
-}
+    // Spike(back spike)
+    partModels[2] = glm::translate(model, glm::vec3(0.0f, HEIGHT / 2.5 + SPIKE_HEIGHT / 1.5 + 0.55, -0.2f));
 
-// Function to generate the cross vertices and indices
-void generateCross(float width, float height, float thickness, std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
-{
-    // Define the cross as two rectangles (vertical and horizontal)
-    float halfWidth = width / 2.0;
-    float halfHeight = height / 2.0;
-    float halfThickness = thickness / 3;
-
-    // Vertical part
-    vertices.push_back(-halfThickness); vertices.push_back(-halfHeight - 0.1); vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(0.0f);
-    vertices.push_back(halfThickness); vertices.push_back(-halfHeight - 0.1); vertices.push_back(0.0f); vertices.push_back(1.0f); vertices.push_back(0.0f);
-    vertices.push_back(halfThickness); vertices.push_back(halfHeight - 0.1); vertices.push_back(0.0f); vertices.push_back(1.0f); vertices.push_back(1.0f);
-    vertices.push_back(-halfThickness); vertices.push_back(halfHeight - 0.1); vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(1.0f);
-
-    // Horizontal part
-    vertices.push_back(-halfWidth); vertices.push_back(-halfThickness); vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(0.0f);
-    vertices.push_back(halfWidth); vertices.push_back(-halfThickness); vertices.push_back(0.0f); vertices.push_back(1.0f); vertices.push_back(0.0f);
-    vertices.push_back(halfWidth); vertices.push_back(halfThickness); vertices.push_back(0.0f); vertices.push_back(1.0f); vertices.push_back(1.0f);
-    vertices.push_back(-halfWidth); vertices.push_back(halfThickness); vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(1.0f);
-
-    // Indices for the cross
-    indices = {
-        0, 1, 2, 2, 3, 0, // Vertical part
-        4, 5, 6, 6, 7, 4  // Horizontal part
-    };
-}
-// Function to generate the spike vertices and indices
-void generateSpike(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
-{
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
+    // Spike 1
+    partModels[3] = glm::translate(model, glm::vec3(1.099f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 1.15f));
 
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
+    // Spike 2
+    partModels[4] = glm::translate(model, glm::vec3(-1.099f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 1.15f));
 
-        // Back face
-        3, 5, 4,
+    // Spike 3(Left center)
+    partModels[5] = glm::translate(model, glm::vec3(-0.7f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 0.3f));
+    partModels[5] = glm::rotate(partModels[5], glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
+    // Spike 4(Right center)
+    partModels[6] = glm::translate(model, glm::vec3(0.7f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 0.3f));
+    partModels[6] = glm::rotate(partModels[6], glm::radians(30.0f), glm::vec3(0.0f, -1.0f, 0.0f));
 
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
+    // Spike 5
+    partModels[7] = glm::translate(model, glm::vec3(-0.65f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 2.0f));
+    partModels[7] = glm::rotate(partModels[7], glm::radians(30.0f), glm::vec3(0.0f, -1.0f, 0.0f));
 
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
+    // Spike 6
+    partModels[8] = glm::translate(model, glm::vec3(0.6f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 2.05));
+    partModels[8] = glm::rotate(partModels[8], glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 }
 
-void generateSpike1(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+// Crown placement, a square grid growing away from the camera
+std::vector<glm::mat4> layoutCrowns(int crownCount)
 {
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
-
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
-
-        // Back face
-        3, 5, 4,
-
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
-
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
-
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
+    std::vector<glm::mat4> crownTransforms(crownCount);
+    const int gridSide = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(crownCount))));
+    for (int crown = 0; crown < crownCount; ++crown)
+    {
+        const float x = (crown % gridSide - (gridSide - 1) * 0.5f) * CROWN_SPACING;
+        const float z = -(crown / gridSide) * CROWN_SPACING;
+        crownTransforms[crown] = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+    }
+    return crownTransforms;
 }
 
-void generateSpike2(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+// Gold crowns on a grey floor, flattened to world-space triangles for the path tracer
+void buildTraceScene(const std::vector<glm::mat4>& crownTransforms, TraceScene& scene)
 {
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
-
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
+    const std::uint32_t gold = scene.addMaterial(goldMaterial());
+    const std::uint32_t floor = scene.addMaterial({ glm::vec3(0.5f), 0.0f, 1.0f });
 
-        // Back face
-        3, 5, 4,
-
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
-
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
-
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
+    glm::mat4 partModels[CROWN_PART_COUNT];
+    computePartModels(glm::mat4(1.0f), partModels);
+    const BakedMesh<6, 24>* spikeData[] = {
+        &SPIKE_MESH, &SPIKE1_MESH, &SPIKE2_MESH, &SPIKE3_MESH, &SPIKE4_MESH, &SPIKE5_MESH, &SPIKE6_MESH
     };
+    for (const glm::mat4& root : crownTransforms)
+    {
+        for (const auto* surface : { &CYLINDER_MESH.outerIndices, &CYLINDER_MESH.innerIndices, &CYLINDER_MESH.topCapIndices, &CYLINDER_MESH.bottomCapIndices })
+            scene.addMesh(CYLINDER_MESH.vertices.data(), surface->data(), surface->size(), root * partModels[0], gold);
+        scene.addMesh(CROSS_MESH.vertices.data(), CROSS_MESH.indices.data(), CROSS_MESH.indices.size(), root * partModels[1], gold);
+        for (int spike = 0; spike < 7; ++spike)
+            scene.addMesh(spikeData[spike]->vertices.data(), spikeData[spike]->indices.data(), spikeData[spike]->indices.size(),
+                root * partModels[2 + spike], gold);
+    }
+    scene.addGround(glm::vec3(0.0f, -HEIGHT / 2, 0.0f), 50.0f, floor);
+    scene.build();
 }
-void generateSpike3(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
-{
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
-
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
 
-        // Back face
-        3, 5, 4,
-
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
-
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
-
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
-}
-void generateSpike4(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+// Stand-in bound until a texture from the loader is ready
+GLuint createPlaceholderTexture(unsigned char r, unsigned char g, unsigned char b)
 {
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
-
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
-
-        // Back face
-        3, 5, 4,
-
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
-
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
+    const unsigned char texel[4] = { r, g, b, 255 };
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    return texture;
+}
 
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
+// Everything the render thread needs for a frame; not modified once submitted
+struct FramePacket
+{
+    std::uint64_t frame = 0;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    Frustum frustum;
+    int transformFirst = 0;
+    std::vector<glm::mat4> transforms;     // World matrices changed this frame, from transformFirst on
+    CommandStream commands;                // CPU culling: recorded draws of the visible parts
+    std::vector<glm::mat4> instanceModels; // GPU culling: every instance, empty when unchanged
+    std::array<float, CROWN_IMAGE_COUNT> imagePixels{}; // Streaming: screen pixels each image covers
+};
+
+// Command line helpers
+bool hasArg(int argc, char** argv, const char* name)
+{
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0)
+            return true;
+    return false;
 }
-void generateSpike5(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+
+int intArg(int argc, char** argv, const char* name, int fallback)
 {
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0)
+            return std::atoi(argv[i + 1]);
+    return fallback;
+}
 
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
+const char* stringArg(int argc, char** argv, const char* name, const char* fallback)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], name) == 0)
+            return argv[i + 1];
+    return fallback;
+}
 
-        // Back face
-        3, 5, 4,
+// Asset pack builder: shaders and LOD chains compressed, images decoded the way the texture
+// loader would for colour (flipped, full size, their own channels) with their mip chains. Textures are stored so their
+// levels upload straight from the mapping unless `compressTextures` is set.
+int buildAssetPack(const char* path, bool compressTextures)
+{
+    AssetPackWriter writer;
+    for (const char* shaderFile : SHADER_FILES)
+    {
+        if (!writer.addFile(shaderFile, ASSET_SHADER, true))
+        {
+            std::cerr << "Failed to read " << shaderFile << std::endl;
+            return -1;
+        }
+    }
 
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
+    std::vector<GLfloat> cylinderVertices(CYLINDER_MESH.vertices.begin(), CYLINDER_MESH.vertices.end());
+    const std::array<GLuint, CYLINDER_MESH.SURFACE_INDEX_COUNT>* cylinderSurfaces[] = {
+        &CYLINDER_MESH.outerIndices, &CYLINDER_MESH.innerIndices, &CYLINDER_MESH.topCapIndices, &CYLINDER_MESH.bottomCapIndices
+    };
+    for (int surface = 0; surface < 4; ++surface)
+    {
+        const std::vector<GLuint> indices(cylinderSurfaces[surface]->begin(), cylinderSurfaces[surface]->end());
+        writer.add(CYLINDER_LOD_ASSETS[surface], ASSET_LOD_CHAIN, packLodChain(buildLodChain(cylinderVertices, indices)), true);
+    }
 
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
+    stbi_set_flip_vertically_on_load(true);
+    for (const char* imageFile : CROWN_IMAGE_FILES)
+    {
+        std::ifstream file(imageFile, std::ios::binary);
+        const std::vector<unsigned char> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        int width, height, channels;
+        unsigned char* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels, 0);
+        if (!pixels)
+        {
+            std::cerr << "Failed to load " << imageFile << std::endl;
+            return -1;
+        }
+        const std::uint64_t key = textureCacheKey(source.data(), source.size(), 0, channels, true);
+        writer.add(imageFile, ASSET_TEXTURE, buildTextureCacheEntry(key, pixels, width, height, width, height, channels), compressTextures);
+        stbi_image_free(pixels);
+    }
+    stbi_set_flip_vertically_on_load(false);
 
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
+    if (!writer.write(path))
+    {
+        std::cerr << "Failed to write " << path << std::endl;
+        return -1;
+    }
+    std::cout << path << ": " << writer.bytes() << " bytes of assets stored in " << writer.storedBytes() << std::endl;
+    return 0;
 }
-void generateSpike6(float width, float height, float thickness,
-    std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
-{
-    float halfWidth = width / 9;
-    float halfHeight = height / 3.0;
-    float halfThickness = thickness; // Keep full thickness
-
-    // Define 8 vertices for a 3D spike
-    vertices = {
-        // Front face
-        -halfThickness, -halfHeight,  halfThickness,  0.0f, 0.0f,  // 0 - Bottom Left Front
-         halfThickness, -halfHeight,  halfThickness,  1.0f, 0.0f,  // 1 - Bottom Right Front
-         0.0f,          halfHeight,   halfThickness,  0.5f, 1.0f,  // 2 - Top Front
-
-         // Back face
-         -halfThickness, -halfHeight, -halfThickness,  0.0f, 0.0f,  // 3 - Bottom Left Back
-          halfThickness, -halfHeight, -halfThickness,  1.0f, 0.0f,  // 4 - Bottom Right Back
-          0.0f,          halfHeight,  -halfThickness,  0.5f, 1.0f,  // 5 - Top Back
-    };
-
-    // Define indices for 3D spike
-    indices = {
-        // Front face
-        0, 1, 2,
 
-        // Back face
-        3, 5, 4,
+// Virtual texture builder: `imageFile` decoded flipped like the texture loader does, tiled
+// into pages of `tileSize` texels next to it as .vtex
+int buildVirtualTexture(const char* imageFile, int tileSize, bool compress)
+{
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(imageFile, &width, &height, &channels, 4);
+    stbi_set_flip_vertically_on_load(false);
+    if (!pixels)
+    {
+        std::cerr << "Failed to load " << imageFile << std::endl;
+        return -1;
+    }
+    const std::string path = virtualTexturePathFor(imageFile);
+    const bool written = writeVirtualTexture(path, pixels, width, height, tileSize, VIRTUAL_TEXTURE_BORDER, compress);
+    stbi_image_free(pixels);
+    if (!written)
+    {
+        std::cerr << "Failed to write " << path << " (at most " << VIRTUAL_TEXTURE_MAX_PAGES << " pages of " << tileSize
+                  << " texels a side)" << std::endl;
+        return -1;
+    }
+    std::cout << path << ": " << width << "x" << height << " in " << tileSize << " texel pages" << std::endl;
+    return 0;
+}
 
-        // Left side
-        0, 2, 3,
-        3, 2, 5,
+int main(int argc, char** argv)
+{
+    // Unit checks of the pure functions, exits nonzero if any fail
+    if (hasArg(argc, argv, "--self-test"))
+        return runSelfTests() == 0 ? 0 : 1;
 
-        // Right side
-        1, 4, 2,
-        2, 4, 5,
+    // Benchmarks run without a window
+    if (hasArg(argc, argv, "--bench-cull"))
+    {
+        runCullBenchmark();
+        return 0;
+    }
+    if (hasArg(argc, argv, "--bench-pick"))
+    {
+        runPickBenchmark();
+        return 0;
+    }
+    if (hasArg(argc, argv, "--bench-decode"))
+    {
+        runDecodeBenchmark(std::max(1, intArg(argc, argv, "--iterations", 10)));
+        runScaledDecodeBenchmark(std::max(1, intArg(argc, argv, "--iterations", 10)));
+        runParallelDecodeBenchmark(std::max(1, intArg(argc, argv, "--iterations", 10)));
+        return 0;
+    }
+    if (const char* formatName = stringArg(argc, argv, "--encode-ktx2", nullptr))
+    {
+        int format = 0;
+        while (format < BLOCK_FORMAT_COUNT && std::strcmp(blockFormatName(format), formatName) != 0)
+            ++format;
+        if (format == BLOCK_FORMAT_COUNT)
+        {
+            std::cerr << "Unknown block format " << formatName << ", expected bc1, bc7 or etc2" << std::endl;
+            return -1;
+        }
+        JobSystem jobs;
+        // The crown images are all colour
+        runTextureCompressor(format, CROWN_IMAGE_FILES, CROWN_IMAGE_COUNT, jobs, true);
+        return 0;
+    }
+    if (const char* packPath = stringArg(argc, argv, "--build-pack", nullptr))
+        return buildAssetPack(packPath, hasArg(argc, argv, "--compress-textures"));
+    if (const char* imageFile = stringArg(argc, argv, "--build-virtual-texture", nullptr))
+        return buildVirtualTexture(imageFile, intArg(argc, argv, "--vt-tile", 128), hasArg(argc, argv, "--compress-textures"));
 
-        // Bottom face
-        0, 3, 1,
-        1, 3, 4
-    };
-}
+    const int crownCount = std::max(1, intArg(argc, argv, "--crowns", 1));
 
+    // Offline stills: sample-limited by default, time-limited when --seconds is given
+    const char* tracePath = stringArg(argc, argv, "--trace", nullptr);
+    if (tracePath || hasArg(argc, argv, "--bench-trace"))
+    {
+        const int traceWidth = std::max(1, intArg(argc, argv, "--width", SCR_WIDTH));
+        const int traceHeight = std::max(1, intArg(argc, argv, "--height", SCR_HEIGHT));
+        const int samples = std::max(1, intArg(argc, argv, "--samples", tracePath ? 64 : 4));
+        const int seconds = intArg(argc, argv, "--seconds", 0);
+
+        TraceScene scene;
+        const auto buildStart = std::chrono::steady_clock::now();
+        buildTraceScene(layoutCrowns(crownCount), scene);
+        std::cout << "BVH built in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count()
+                  << " ms" << std::endl;
+
+        JobSystem jobs;
+        PathTracer tracer(scene, traceWidth, traceHeight, jobs);
+        tracer.setCamera(CAMERA_POS, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), FOV_Y_DEGREES);
+        if (!tracePath)
+        {
+            runTraceBenchmark(tracer, scene, traceWidth, traceHeight, samples);
+            return 0;
+        }
+
+        const TraceStats stats = seconds > 0 ? tracer.renderFor(seconds) : tracer.renderSamples(samples);
+        std::cout << tracer.samplesPerPixel() << " spp in " << stats.seconds << " s, "
+                  << stats.samplesPerSecond() * 1e-6 << " Msamples/s" << std::endl;
+        if (!tracer.writePpm(tracePath))
+        {
+            std::cerr << "Failed to write " << tracePath << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+    const bool hiZCulling = hasArg(argc, argv, "--hiz");
+    const bool rasterBenchmark = hasArg(argc, argv, "--bench-raster");
+    const bool gpuCulling = hiZCulling || hasArg(argc, argv, "--gpu-cull");
 
-int main()
-{
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -473,9 +434,14 @@ int main()
     }
 
     // OpenGL version and profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // GPU-driven culling needs compute shaders and indirect draws (GL 4.3)
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, gpuCulling ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // --srgb samples colour textures as sRGB and lights in linear space
+    const bool srgbTextures = hasArg(argc, argv, "--srgb");
+    if (srgbTextures)
+        glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 
     // Create window
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Textured Hollow Cylinder with Cross", NULL, NULL);
@@ -491,644 +457,956 @@ int main()
         return -1;
     }
 
+    if (gpuCulling && !GLAD_GL_VERSION_4_3) {
+        std::cerr << "GPU culling needs OpenGL 4.3" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    if (srgbTextures)
+        glEnable(GL_FRAMEBUFFER_SRGB);
+
+    // Geometry processing runs as jobs, this thread only creates GL objects. Images are
+    // decoded and uploaded by the texture loader; each file becomes one texture shared by
+    // the parts that use it, shown as a placeholder colour until it is ready.
+    JobSystem jobs;
+    stbi_set_flip_vertically_on_load(true);
+    const int PART_IMAGES[CROWN_PART_COUNT] = {
+        CYLINDER_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE, SPIKES_IMAGE
+    };
+    const GLuint placeholderTexture = createPlaceholderTexture(200, 160, 60);
+    GLuint crownTextures[CROWN_IMAGE_COUNT] = { placeholderTexture, placeholderTexture };
+    // Texture memory by category, optionally capped; uploads that would go over drop mip levels
+    TextureMemory textureMemory;
+    textureMemory.setBudget(static_cast<std::size_t>(std::max(0, intArg(argc, argv, "--texture-budget-mb", 0))) << 20);
+    textureMemory.track(placeholderTexture, TEXTURE_COLOR, 4);
+    TextureFormatOptions textureFormats;
+    textureFormats.srgb = srgbTextures;
+    textureFormats.rgb565 = hasArg(argc, argv, "--rgb565") && GLAD_GL_VERSION_4_1;
+    // Startup assets come from one mapped pack when there is one (--build-pack writes it),
+    // anything the pack lacks is read from the loose files
+    const char* packPath = stringArg(argc, argv, "--pack", "crown.pack");
+    AssetPack assets;
+    if (!assets.open(packPath) && std::ifstream(packPath))
+        std::cerr << packPath << " is not an asset pack this build can read, using loose files" << std::endl;
+    // A large image is decoded in bands on the same jobs; the loader thread submits them
+    // through its own queue, so frame jobs do not line up behind a decode. The jobs are
+    // declared before the loader, which stops decoding before they go away.
+    setJpegDecodeJobs(&jobs);
+    // --texture-cache <dir> keeps decoded mip chains in <dir> between runs; nothing is
+    // written to disk without it
+    const char* textureCacheDirectory = stringArg(argc, argv, "--texture-cache", nullptr);
+    TextureCache textureCache(textureCacheDirectory ? textureCacheDirectory : "", true);
+    TextureLoader textureLoader;
+    if (textureCacheDirectory)
+        textureLoader.setCache(&textureCache);
+    if (assets.isOpen())
+        textureLoader.setPack(&assets);
+    textureLoader.setFormats(textureFormats);
+    textureLoader.setMemory(&textureMemory);
+    if (!textureLoader.start(window))
+        std::cerr << "No shared context for background texture uploads, loading in place" << std::endl;
+    const int maxTextureSize = intArg(argc, argv, "--max-texture-size", 0);
+    // --stream-textures starts every image at its coarse levels and streams finer ones as
+    // they show up large enough on screen, within --stream-budget-mb
+    const bool textureStreaming = hasArg(argc, argv, "--stream-textures");
+    TextureStreamer textureStreamer;
+    textureStreamer.setBudget(static_cast<std::size_t>(std::max(0, intArg(argc, argv, "--stream-budget-mb", 32))) << 20);
+    // --ktx2 prefers the block-compressed files written by --encode-ktx2 where they exist
+    const bool compressedTextures = hasArg(argc, argv, "--ktx2");
+    for (int image = 0; image < CROWN_IMAGE_COUNT; ++image)
+    {
+        std::string path = CROWN_IMAGE_FILES[image];
+        if (compressedTextures && std::ifstream(ktx2PathFor(path)))
+            path = ktx2PathFor(path);
+        if (textureStreaming)
+            textureLoader.stream(path.c_str(), image, TEXTURE_COLOR);
+        else
+            textureLoader.load(path.c_str(), image, maxTextureSize, TEXTURE_COLOR);
+    }
 
     // Load shaders
-    Shader shader("vertex_shader.glsl", "fragment_shader.glsl");
-
-    // Generate cylinder
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> outerIndices, innerIndices, topCapIndices, bottomCapIndices;
-    generateHollowCylinder(OUTER_RADIUS, INNER_RADIUS, HEIGHT, SECTORS, vertices, outerIndices, innerIndices, topCapIndices, bottomCapIndices);
-
-    // Generate cross
-    std::vector<GLfloat> crossVertices;
-    std::vector<GLuint> crossIndices;
-    generateCross(CROSS_WIDTH, CROSS_HEIGHT, CROSS_THICKNESS, crossVertices, crossIndices);
-
-    // Generate spike
-    std::vector<GLfloat> spikeVertices;
-    std::vector<GLuint> spikeIndices;
-    generateSpike(SPIKE_WIDTH, SPIKE_HEIGHT, SPIKE_THICKNESS, spikeVertices, spikeIndices);
-    
-    // Generate spike1
-    std::vector<GLfloat> spike1Vertices;
-    std::vector<GLuint> spike1Indices;
-    generateSpike1(SPIKE_WIDTH1, SPIKE_HEIGHT1, SPIKE_THICKNESS1, spike1Vertices, spike1Indices);
-
-    // Generate spike2
-    std::vector<GLfloat> spike2Vertices;
-    std::vector<GLuint> spike2Indices;
-    generateSpike2(SPIKE_WIDTH2, SPIKE_HEIGHT2, SPIKE_THICKNESS2, spike2Vertices, spike2Indices);
-
-    // Generate spike3
-    std::vector<GLfloat> spike3Vertices;
-    std::vector<GLuint> spike3Indices;
-    generateSpike3(SPIKE_WIDTH3, SPIKE_HEIGHT3, SPIKE_THICKNESS3, spike3Vertices, spike3Indices);
-
-    // Generate spike4
-    std::vector<GLfloat> spike4Vertices;
-    std::vector<GLuint> spike4Indices;
-    generateSpike4(SPIKE_WIDTH4, SPIKE_HEIGHT4, SPIKE_THICKNESS4, spike4Vertices, spike4Indices);
-
-    // Generate spike5
-    std::vector<GLfloat> spike5Vertices;
-    std::vector<GLuint> spike5Indices;
-    generateSpike5(SPIKE_WIDTH5, SPIKE_HEIGHT5, SPIKE_THICKNESS5, spike5Vertices, spike5Indices);
-
-    // Generate spike6
-    std::vector<GLfloat> spike6Vertices;
-    std::vector<GLuint> spike6Indices;
-    generateSpike6(SPIKE_WIDTH6, SPIKE_HEIGHT6, SPIKE_THICKNESS6, spike6Vertices, spike6Indices);
-
-    // Set up VAO, VBO, and EBOs for cylinder
-    GLuint VAO, VBO, outerEBO, innerEBO, topEBO, bottomEBO;
+    std::vector<unsigned char> vertexSource, fragmentSource;
+    Shader shader(assets.shaderSource(gpuCulling ? "gpu_vertex_shader.glsl" : "vertex_shader.glsl", vertexSource),
+                  assets.shaderSource("fragment_shader.glsl", fragmentSource));
+
+    // Upload the cylinder straight from the baked arrays
+    GLuint VAO, VBO;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    glGenBuffers(1, &outerEBO);
-    glGenBuffers(1, &innerEBO);
-    glGenBuffers(1, &topEBO);
-    glGenBuffers(1, &bottomEBO);
 
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outerEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, outerIndices.size() * sizeof(GLuint), outerIndices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, innerEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, innerIndices.size() * sizeof(GLuint), innerIndices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, topEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, topCapIndices.size() * sizeof(GLuint), topCapIndices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bottomEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bottomCapIndices.size() * sizeof(GLuint), bottomCapIndices.data(), GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for cross
-    GLuint crossVAO, crossVBO, crossEBO;
-    glGenVertexArrays(1, &crossVAO);
-    glGenBuffers(1, &crossVBO);
-    glGenBuffers(1, &crossEBO);
-
-    glBindVertexArray(crossVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, crossVBO);
-    glBufferData(GL_ARRAY_BUFFER, crossVertices.size() * sizeof(GLfloat), crossVertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, crossEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, crossIndices.size() * sizeof(GLuint), crossIndices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike
-    GLuint spikeVAO, spikeVBO, spikeEBO;
-    glGenVertexArrays(1, &spikeVAO);
-    glGenBuffers(1, &spikeVBO);
-    glGenBuffers(1, &spikeEBO);
-
-    glBindVertexArray(spikeVAO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CYLINDER_MESH.vertices), CYLINDER_MESH.vertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, spikeVBO);
-    glBufferData(GL_ARRAY_BUFFER, spikeVertices.size() * sizeof(GLfloat), spikeVertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spikeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spikeIndices.size() * sizeof(GLuint), spikeIndices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike1
-    GLuint spike1VAO, spike1VBO, spike1EBO;
-    glGenVertexArrays(1, &spike1VAO);
-    glGenBuffers(1, &spike1VBO);
-    glGenBuffers(1, &spike1EBO);
-
-    glBindVertexArray(spike1VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike1VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike1Vertices.size() * sizeof(GLfloat), spike1Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike1EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike1Indices.size() * sizeof(GLuint), spike1Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike2
-    GLuint spike2VAO, spike2VBO, spike2EBO;
-    glGenVertexArrays(1, &spike2VAO);
-    glGenBuffers(1, &spike2VBO);
-    glGenBuffers(1, &spike2EBO);
-
-    glBindVertexArray(spike2VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike2VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike2Vertices.size() * sizeof(GLfloat), spike2Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike2EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike2Indices.size() * sizeof(GLuint), spike2Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike3
-    GLuint spike3VAO, spike3VBO, spike3EBO;
-    glGenVertexArrays(1, &spike3VAO);
-    glGenBuffers(1, &spike3VBO);
-    glGenBuffers(1, &spike3EBO);
-
-    glBindVertexArray(spike3VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike3VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike3Vertices.size() * sizeof(GLfloat), spike3Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike3EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike3Indices.size() * sizeof(GLuint), spike3Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for 4
-    GLuint spike4VAO, spike4VBO, spike4EBO;
-    glGenVertexArrays(1, &spike4VAO);
-    glGenBuffers(1, &spike4VBO);
-    glGenBuffers(1, &spike4EBO);
-
-    glBindVertexArray(spike4VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike4VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike4Vertices.size() * sizeof(GLfloat), spike4Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike4EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike4Indices.size() * sizeof(GLuint), spike4Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike5
-    GLuint spike5VAO, spike5VBO, spike5EBO;
-    glGenVertexArrays(1, &spike5VAO);
-    glGenBuffers(1, &spike5VBO);
-    glGenBuffers(1, &spike5EBO);
-
-    glBindVertexArray(spike5VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike5VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike5Vertices.size() * sizeof(GLfloat), spike5Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike5EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike5Indices.size() * sizeof(GLuint), spike5Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Set up VAO, VBO, and EBO for spike6
-    GLuint spike6VAO, spike6VBO, spike6EBO;
-    glGenVertexArrays(1, &spike6VAO);
-    glGenBuffers(1, &spike6VBO);
-    glGenBuffers(1, &spike6EBO);
-
-    glBindVertexArray(spike6VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, spike6VBO);
-    glBufferData(GL_ARRAY_BUFFER, spike6Vertices.size() * sizeof(GLfloat), spike6Vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spike6EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, spike6Indices.size() * sizeof(GLuint), spike6Indices.data(), GL_STATIC_DRAW);
-
-    // Vertex attributes (x, y, z, u, v)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // Load outer texture (goldi.jpg)
-    GLuint outerTexture;
-    glGenTextures(1, &outerTexture);
-    glBindTexture(GL_TEXTURE_2D, outerTexture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load("cylinder.jpg", &width, &height, &nrChannels, 0);
-    if (data)
+    // One EBO per surface holding its whole LOD chain, every level shares the vertex buffer.
+    // The full-detail level is also split into meshlets so hidden clusters can be skipped.
+    // Chains the asset pack lacks and clusters for all four surfaces are built in parallel,
+    // then uploaded here; packed chains go to their EBO from the pack.
+    std::vector<GLfloat> cylinderVertices(CYLINDER_MESH.vertices.begin(), CYLINDER_MESH.vertices.end());
+    const std::array<GLuint, CYLINDER_MESH.SURFACE_INDEX_COUNT>* cylinderSurfaces[] = {
+        &CYLINDER_MESH.outerIndices, &CYLINDER_MESH.innerIndices, &CYLINDER_MESH.topCapIndices, &CYLINDER_MESH.bottomCapIndices
+    };
+    const AssetPackEntry* packedLods[4];
+    for (int surface = 0; surface < 4; ++surface)
+        packedLods[surface] = assets.find(CYLINDER_LOD_ASSETS[surface], ASSET_LOD_CHAIN);
+    std::vector<LodLevel> lodChains[4];
+    MeshletMesh meshletData[4];
+    jobs.parallelFor(8, 1, [&](std::size_t begin, std::size_t end)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+        for (std::size_t job = begin; job < end; ++job)
+        {
+            if (job < 4 && packedLods[job])
+                continue;
+            const auto& surface = *cylinderSurfaces[job % 4];
+            const std::vector<GLuint> indices(surface.begin(), surface.end());
+            if (job < 4)
+                lodChains[job] = buildLodChain(cylinderVertices, indices);
+            else
+                meshletData[job - 4] = buildMeshlets(cylinderVertices, indices);
+        }
+    });
+    LodBuffer cylinderLodBuffers[4];
+    for (int surface = 0; surface < 4; ++surface)
     {
-        std::cerr << "Failed to load outer texture!" << std::endl;
+        std::vector<unsigned char> scratch;
+        const AssetPackEntry* packed = packedLods[surface];
+        if (packed && uploadPackedLodChain(assets.contents(*packed, scratch), static_cast<std::size_t>(packed->bytes), cylinderLodBuffers[surface]))
+            continue;
+        if (packed)
+        {
+            std::cerr << CYLINDER_LOD_ASSETS[surface] << " in " << packPath << " is damaged, rebuilding it" << std::endl;
+            const std::vector<GLuint> indices(cylinderSurfaces[surface]->begin(), cylinderSurfaces[surface]->end());
+            lodChains[surface] = buildLodChain(cylinderVertices, indices);
+        }
+        cylinderLodBuffers[surface] = uploadLodChain(lodChains[surface]);
     }
-    stbi_image_free(data);
+    LodBuffer& outerLod = cylinderLodBuffers[0];
+    LodBuffer& innerLod = cylinderLodBuffers[1];
+    LodBuffer& topLod = cylinderLodBuffers[2];
+    LodBuffer& bottomLod = cylinderLodBuffers[3];
+    MeshletBuffer outerMeshlets = uploadMeshlets(meshletData[0]);
+    MeshletBuffer innerMeshlets = uploadMeshlets(meshletData[1]);
+    MeshletBuffer topMeshlets = uploadMeshlets(meshletData[2]);
+    MeshletBuffer bottomMeshlets = uploadMeshlets(meshletData[3]);
 
-    // Load inner texture
-    GLuint innerTexture;
-    glGenTextures(1, &innerTexture);
-    glBindTexture(GL_TEXTURE_2D, innerTexture);
+    glBindVertexArray(0);
+
+    // Cross and spikes, no runtime generation or heap allocation
+    MeshBuffers crossMesh = uploadMesh(CROSS_MESH);
+    MeshBuffers spikeMesh = uploadMesh(SPIKE_MESH);
+    MeshBuffers spike1Mesh = uploadMesh(SPIKE1_MESH);
+    MeshBuffers spike2Mesh = uploadMesh(SPIKE2_MESH);
+    MeshBuffers spike3Mesh = uploadMesh(SPIKE3_MESH);
+    MeshBuffers spike4Mesh = uploadMesh(SPIKE4_MESH);
+    MeshBuffers spike5Mesh = uploadMesh(SPIKE5_MESH);
+    MeshBuffers spike6Mesh = uploadMesh(SPIKE6_MESH);
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Enable depth testing
+    glEnable(GL_DEPTH_TEST);
 
-    data = stbi_load("cylinder.jpg", &width, &height, &nrChannels, 0);
-    if (data)
+    // Per-part meshes and local bounds; part 0 is the cylinder with its own draw path
+    const MeshBuffers* partMeshes[CROWN_PART_COUNT] = {
+        nullptr, &crossMesh, &spikeMesh, &spike1Mesh, &spike2Mesh, &spike3Mesh, &spike4Mesh, &spike5Mesh, &spike6Mesh
+    };
+    Bounds partBounds[CROWN_PART_COUNT];
+    partBounds[0] = CYLINDER_MESH.bounds();
+    for (int part = 1; part < CROWN_PART_COUNT; ++part)
+        partBounds[part] = partMeshes[part]->bounds;
+
+    // GL objects that recorded frames refer to, registered in a fixed order so captures
+    // replay in later runs
+    CommandResources commandResources;
+    const std::uint32_t programResource = commandResources.addObject(shader.ID);
+    const std::uint32_t viewUniform = commandResources.addUniform(glGetUniformLocation(shader.ID, "view"));
+    const std::uint32_t projectionUniform = commandResources.addUniform(glGetUniformLocation(shader.ID, "projection"));
+    const std::uint32_t transformIndexUniform = commandResources.addUniform(glGetUniformLocation(shader.ID, "transformIndex"));
+    const std::uint32_t cylinderVertexArray = commandResources.addObject(VAO);
+    std::uint32_t imageResources[CROWN_IMAGE_COUNT];
+    for (int image = 0; image < CROWN_IMAGE_COUNT; ++image)
+        imageResources[image] = commandResources.addObject(crownTextures[image]);
+    const LodBuffer* surfaceLods[] = { &outerLod, &innerLod, &topLod, &bottomLod };
+    const MeshletBuffer* surfaceMeshlets[] = { &outerMeshlets, &innerMeshlets, &topMeshlets, &bottomMeshlets };
+    const std::uint32_t surfaceTextures[] = {
+        imageResources[CYLINDER_IMAGE], imageResources[CYLINDER_IMAGE], imageResources[CYLINDER_IMAGE], imageResources[CYLINDER_IMAGE]
+    };
+    std::uint32_t surfaceLodBuffers[4], surfaceMeshletBuffers[4];
+    for (int surface = 0; surface < 4; ++surface)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        surfaceLodBuffers[surface] = commandResources.addObject(surfaceLods[surface]->EBO);
+        surfaceMeshletBuffers[surface] = commandResources.addObject(surfaceMeshlets[surface]->EBO);
     }
-    else
+    std::uint32_t partVertexArrays[CROWN_PART_COUNT] = {}, partTextureResources[CROWN_PART_COUNT] = {};
+    for (int part = 1; part < CROWN_PART_COUNT; ++part)
     {
-        std::cerr << "Failed to load inner texture!" << std::endl;
+        partVertexArrays[part] = commandResources.addObject(partMeshes[part]->VAO);
+        partTextureResources[part] = imageResources[PART_IMAGES[part]];
     }
-    stbi_image_free(data);
-
-    // Load cross texture
-    GLuint crossTexture;
-    glGenTextures(1, &crossTexture);
-    glBindTexture(GL_TEXTURE_2D, crossTexture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    const std::uint32_t virtualTexturedUniform = commandResources.addUniform(glGetUniformLocation(shader.ID, "virtualTextured"));
 
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // Switch to textures the loader has finished, on whichever thread owns the context
+    auto adoptLoadedTextures = [&]()
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cerr << "Failed to load cross texture!" << std::endl;
-    }
-    stbi_image_free(data);
+        LoadedTexture loaded;
+        while (textureLoader.poll(loaded))
+        {
+            textureStreamer.adopt(loaded);
+            if (!loaded.texture)
+                continue;
+            // Streamed images replace the texture holding their previous levels
+            if (crownTextures[loaded.slot] != placeholderTexture)
+            {
+                textureMemory.release(crownTextures[loaded.slot]);
+                glDeleteTextures(1, &crownTextures[loaded.slot]);
+            }
+            crownTextures[loaded.slot] = loaded.texture;
+            commandResources.objects[imageResources[loaded.slot]] = loaded.texture;
+        }
+    };
 
-    // Load spike texture
-    GLuint spikeTexture;
-    glGenTextures(1, &spikeTexture);
-    glBindTexture(GL_TEXTURE_2D, spikeTexture);
+    // Record one cylinder surface: surviving meshlets at full detail, the LOD range otherwise
+    MeshletDrawList clusterDraws;
+    auto recordCylinderSurface = [&](CommandStream& commands, int surface, int level, const glm::mat4& model, const Frustum& frustum)
+    {
+        if (level == 0)
+        {
+            clusterDraws.clear();
+            cullMeshlets(surfaceMeshlets[surface]->meshlets, model, frustum, CAMERA_POS, clusterDraws);
+            if (clusterDraws.drawCount() == 0)
+                return;
+            commands.bindTexture(surfaceTextures[surface]);
+            commands.bindIndexBuffer(surfaceMeshletBuffers[surface]);
+            commands.multiDrawElements(clusterDraws.counts.data(), clusterDraws.offsets.data(), clusterDraws.drawCount());
+        }
+        else
+        {
+            commands.bindTexture(surfaceTextures[surface]);
+            commands.bindIndexBuffer(surfaceLodBuffers[surface]);
+            commands.drawElements(surfaceLods[surface]->counts[level], surfaceLods[surface]->offsets[level]);
+        }
+    };
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    const std::vector<glm::mat4> crownTransforms = layoutCrowns(crownCount);
 
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+    // Crown roots with their parts as children; object crown * CROWN_PART_COUNT + part
+    // lives in node partNodes[object]
+    TransformHierarchy transforms;
+    std::vector<int> partNodes(static_cast<std::size_t>(crownCount) * CROWN_PART_COUNT);
+    std::vector<int> nodeObjects;
     {
-        std::cerr << "Failed to load spike texture!" << std::endl;
+        glm::mat4 partModels[CROWN_PART_COUNT];
+        computePartModels(glm::mat4(1.0f), partModels);
+        for (int crown = 0; crown < crownCount; ++crown)
+        {
+            const int root = transforms.addNode(-1, crownTransforms[crown]);
+            for (int part = 0; part < CROWN_PART_COUNT; ++part)
+                partNodes[crown * CROWN_PART_COUNT + part] = transforms.addNode(root, partModels[part]);
+        }
+        nodeObjects.assign(transforms.size(), -1);
+        for (std::size_t object = 0; object < partNodes.size(); ++object)
+            nodeObjects[partNodes[object]] = static_cast<int>(object);
     }
-    stbi_image_free(data);
-
-    // Load spike1 texture
-    GLuint spike1Texture;
-    glGenTextures(1, &spike1Texture);
-    glBindTexture(GL_TEXTURE_2D, spike1Texture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    TransformBuffer transformBuffer;
+    transformBuffer.create(transforms.size());
+    transformBuffer.upload(transforms, transforms.update());
 
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // Click-to-select: one BVH per part mesh, one instance per part of every crown
+    const char* const PART_NAMES[CROWN_PART_COUNT] = {
+        "cylinder", "cross", "back spike", "spike 1", "spike 2", "spike 3", "spike 4", "spike 5", "spike 6"
+    };
+    Picker picker;
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        std::vector<GLuint> cylinderIndices;
+        for (const auto* surface : { &CYLINDER_MESH.outerIndices, &CYLINDER_MESH.innerIndices, &CYLINDER_MESH.topCapIndices, &CYLINDER_MESH.bottomCapIndices })
+            cylinderIndices.insert(cylinderIndices.end(), surface->begin(), surface->end());
+        const BakedMesh<6, 24>* spikeData[] = {
+            &SPIKE_MESH, &SPIKE1_MESH, &SPIKE2_MESH, &SPIKE3_MESH, &SPIKE4_MESH, &SPIKE5_MESH, &SPIKE6_MESH
+        };
+        int pickMeshes[CROWN_PART_COUNT];
+        pickMeshes[0] = picker.addMesh(CYLINDER_MESH.vertices.data(), cylinderIndices.data(), cylinderIndices.size());
+        pickMeshes[1] = picker.addMesh(CROSS_MESH.vertices.data(), CROSS_MESH.indices.data(), CROSS_MESH.indices.size());
+        for (int spike = 0; spike < 7; ++spike)
+            pickMeshes[2 + spike] = picker.addMesh(spikeData[spike]->vertices.data(), spikeData[spike]->indices.data(), spikeData[spike]->indices.size());
+
+        for (std::size_t object = 0; object < partNodes.size(); ++object)
+            picker.addInstance(pickMeshes[object % CROWN_PART_COUNT], transforms.world(partNodes[object]), object % CROWN_PART_COUNT);
     }
-    else
+    bool mouseWasDown = false;
+
+    // CPU rasterizer against this GL context (llvmpipe on GPU-less machines), same scene and view
+    if (rasterBenchmark)
     {
-        std::cerr << "Failed to load spike texture!" << std::endl;
+        const int frames = std::max(1, intArg(argc, argv, "--frames", 20));
+        const RasterTexture cylinderImage = loadRasterTexture("cylinder.jpg");
+        const RasterTexture spikesImage = loadRasterTexture("spikes.jfif");
+
+        RasterUniforms uniforms;
+        uniforms.view = glm::lookAt(CAMERA_POS, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        uniforms.projection = glm::perspective(glm::radians(FOV_Y_DEGREES), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        uniforms.lightPos = LIGHT_POS;
+        uniforms.lightDir = LIGHT_DIR;
+        uniforms.lightColor = LIGHT_COLOR;
+        uniforms.viewPos = CAMERA_POS;
+        uniforms.cutOff = glm::cos(glm::radians(LIGHT_CUTOFF_DEGREES));
+        uniforms.outerCutOff = glm::cos(glm::radians(LIGHT_OUTER_CUTOFF_DEGREES));
+
+        // Draw order matches the GL loop below: cylinder surfaces, cross, spikes, crown by crown
+        const std::array<GLuint, CYLINDER_MESH.SURFACE_INDEX_COUNT>* cylinderSurfaces[] = {
+            &CYLINDER_MESH.outerIndices, &CYLINDER_MESH.innerIndices, &CYLINDER_MESH.topCapIndices, &CYLINDER_MESH.bottomCapIndices
+        };
+        const BakedMesh<6, 24>* spikeData[] = {
+            &SPIKE_MESH, &SPIKE1_MESH, &SPIKE2_MESH, &SPIKE3_MESH, &SPIKE4_MESH, &SPIKE5_MESH, &SPIKE6_MESH
+        };
+        std::vector<RasterDraw> draws;
+        auto addDraw = [&](const GLfloat* vertices, std::size_t floatCount, const GLuint* indices, std::size_t indexCount,
+            const glm::mat4& world, const RasterTexture* texture)
+        {
+            RasterDraw draw;
+            draw.vertices = vertices;
+            draw.floatCount = floatCount;
+            draw.indices = indices;
+            draw.indexCount = indexCount;
+            draw.model = world;
+            draw.texture = texture;
+            draws.push_back(draw);
+        };
+        for (int crown = 0; crown < crownCount; ++crown)
+        {
+            const int* nodes = &partNodes[crown * CROWN_PART_COUNT];
+            for (const auto* surface : cylinderSurfaces)
+                addDraw(CYLINDER_MESH.vertices.data(), CYLINDER_MESH.vertices.size(), surface->data(), surface->size(),
+                    transforms.world(nodes[0]), &cylinderImage);
+            addDraw(CROSS_MESH.vertices.data(), CROSS_MESH.vertices.size(), CROSS_MESH.indices.data(), CROSS_MESH.indices.size(),
+                transforms.world(nodes[1]), &spikesImage);
+            for (int spike = 0; spike < 7; ++spike)
+                addDraw(spikeData[spike]->vertices.data(), spikeData[spike]->vertices.size(), spikeData[spike]->indices.data(),
+                    spikeData[spike]->indices.size(), transforms.world(nodes[2 + spike]), &spikesImage);
+        }
+
+        SoftwareRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT, jobs);
+        RasterStats rasterStats;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            rasterizer.clear();
+            rasterStats = rasterizer.render(draws, uniforms);
+        }
+        const double rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        // Reference frame through the GL shaders into an offscreen target
+        Shader referenceShader("vertex_shader.glsl", "fragment_shader.glsl");
+        GLuint referenceFBO, referenceBuffers[2];
+        glGenFramebuffers(1, &referenceFBO);
+        glGenRenderbuffers(2, referenceBuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, referenceBuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+        glBindRenderbuffer(GL_RENDERBUFFER, referenceBuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, SCR_WIDTH, SCR_HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, referenceFBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, referenceBuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, referenceBuffers[1]);
+
+        referenceShader.use();
+        referenceShader.setMat4("view", uniforms.view);
+        referenceShader.setMat4("projection", uniforms.projection);
+        referenceShader.setVec3("lightPos", uniforms.lightPos);
+        referenceShader.setVec3("lightDir", uniforms.lightDir);
+        referenceShader.setFloat("cutOff", uniforms.cutOff);
+        referenceShader.setFloat("outerCutOff", uniforms.outerCutOff);
+        referenceShader.setVec3("lightColor", uniforms.lightColor);
+        referenceShader.setVec3("viewPos", uniforms.viewPos);
+        referenceShader.setInt("transforms", TRANSFORM_TEXTURE_UNIT);
+        transformBuffer.bind();
+
+        // The reference needs the real images
+        textureLoader.finish();
+        adoptLoadedTextures();
+
+        const LodBuffer* cylinderLods[] = { &outerLod, &innerLod, &topLod, &bottomLod };
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glFinish();
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int crown = 0; crown < crownCount; ++crown)
+            {
+                referenceShader.setInt("transformIndex", partNodes[crown * CROWN_PART_COUNT]);
+                glBindVertexArray(VAO);
+                for (int surface = 0; surface < 4; ++surface)
+                {
+                    glBindTexture(GL_TEXTURE_2D, crownTextures[CYLINDER_IMAGE]);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cylinderLods[surface]->EBO);
+                    glDrawElements(GL_TRIANGLES, cylinderLods[surface]->counts[0], GL_UNSIGNED_INT, (GLvoid*)cylinderLods[surface]->offsets[0]);
+                }
+                for (int part = 1; part < CROWN_PART_COUNT; ++part)
+                {
+                    referenceShader.setInt("transformIndex", partNodes[crown * CROWN_PART_COUNT + part]);
+                    glBindTexture(GL_TEXTURE_2D, crownTextures[PART_IMAGES[part]]);
+                    glBindVertexArray(partMeshes[part]->VAO);
+                    glDrawElements(GL_TRIANGLES, partMeshes[part]->indexCount, GL_UNSIGNED_INT, 0);
+                }
+            }
+            glFinish();
+        }
+        const double glMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        std::vector<std::uint32_t> reference(static_cast<std::size_t>(SCR_WIDTH) * SCR_HEIGHT);
+        glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, reference.data());
+        const RasterDiff diff = compareImages(rasterizer.colorBuffer(), reference);
+
+        std::cout << "raster (" << rasterKernelName() << ", " << rasterizer.threads() << " threads): " << rasterMs << " ms/frame, "
+                  << rasterStats.triangles << " triangles, " << rasterStats.fragments << " fragments" << std::endl;
+        std::cout << "GL (" << glGetString(GL_RENDERER) << "): " << glMs << " ms/frame" << std::endl;
+        std::cout << "pixels off by more than 2 levels: " << diff.mismatched << "/" << diff.pixels
+                  << ", max channel error " << diff.maxChannelError << std::endl;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &referenceFBO);
+        glDeleteRenderbuffers(2, referenceBuffers);
+        glDeleteProgram(referenceShader.ID);
+        transformBuffer.destroy();
+        textureLoader.stop();
+        glfwTerminate();
+        return 0;
     }
-    stbi_image_free(data);
-
-    // Load spike2 texture
-    GLuint spike2Texture;
-    glGenTextures(1, &spike2Texture);
-    glBindTexture(GL_TEXTURE_2D, spike2Texture);
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // Per-frame dynamic data is streamed through a ring sized for the worst frame: every
+    // transform moved and, on the GPU path, every instance plus both cull passes
+    FrameRing frameRing;
+    GLsizeiptr ringFrameBytes = transforms.size() * sizeof(glm::mat4) + 4 * 256;
+
+    // GPU-driven path: every part in one pool, one instance per part per crown. The cylinder
+    // goes in as its meshlets so each cluster is culled (and occlusion tested) on its own.
+    GpuCuller gpuCuller;
+    bool gpuObjectsUploaded = false;
+    GLuint gpuPartsFirst = 0;
+    if (gpuCulling)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        auto addCylinderSurface = [&](const std::array<GLuint, CYLINDER_MESH.SURFACE_INDEX_COUNT>& surface)
+        {
+            return gpuCuller.addMeshlets(cylinderVertices.data(), cylinderVertices.size(),
+                buildMeshlets(cylinderVertices, std::vector<GLuint>(surface.begin(), surface.end())));
+        };
+        addCylinderSurface(CYLINDER_MESH.outerIndices);
+        addCylinderSurface(CYLINDER_MESH.innerIndices);
+        addCylinderSurface(CYLINDER_MESH.topCapIndices);
+        addCylinderSurface(CYLINDER_MESH.bottomCapIndices);
+
+        const BakedMesh<8, 12>* crossData = &CROSS_MESH;
+        gpuPartsFirst = gpuCuller.addMesh(crossData->vertices.data(), crossData->vertices.size(),
+            crossData->indices.data(), crossData->indices.size(), partBounds[1]);
+        const BakedMesh<6, 24>* spikeData[] = {
+            &SPIKE_MESH, &SPIKE1_MESH, &SPIKE2_MESH, &SPIKE3_MESH, &SPIKE4_MESH, &SPIKE5_MESH, &SPIKE6_MESH
+        };
+        for (int spike = 0; spike < 7; ++spike)
+            gpuCuller.addMesh(spikeData[spike]->vertices.data(), spikeData[spike]->vertices.size(),
+                spikeData[spike]->indices.data(), spikeData[spike]->indices.size(), partBounds[2 + spike]);
+
+        ringFrameBytes += static_cast<GLsizeiptr>(crownCount) * (gpuPartsFirst + CROWN_PART_COUNT - 1) * sizeof(GpuObject) +
+            2 * (gpuCuller.meshCount() * sizeof(DrawElementsIndirectCommand) + sizeof(GpuCullParams) + 2 * 256);
+        frameRing.create(ringFrameBytes);
+        std::vector<unsigned char> cullSource;
+        gpuCuller.build(assets.shaderSource("cull_compute.glsl", cullSource), frameRing);
     }
     else
     {
-        std::cerr << "Failed to load spike2 texture!" << std::endl;
+        frameRing.create(ringFrameBytes);
     }
-    stbi_image_free(data);
-
-    // Load spike3 texture
-    GLuint spike3Texture;
-    glGenTextures(1, &spike3Texture);
-    glBindTexture(GL_TEXTURE_2D, spike3Texture);
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // --virtual-texture puts a pre-tiled image (--build-virtual-texture writes one) on the
+    // cylinder, paged into a cache of --vt-cache-pages squared pages as the view needs them
+    VirtualTexture virtualTexture;
+    bool virtualTexturing = false;
+    if (const char* virtualTexturePath = stringArg(argc, argv, "--virtual-texture", nullptr))
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        std::vector<unsigned char> feedbackVertexSource, feedbackFragmentSource;
+        virtualTexturing = virtualTexture.create(virtualTexturePath, std::max(2, intArg(argc, argv, "--vt-cache-pages", 8)),
+            SCR_WIDTH, SCR_HEIGHT, assets.shaderSource("vertex_shader.glsl", feedbackVertexSource),
+            assets.shaderSource("virtual_texture_feedback.glsl", feedbackFragmentSource), srgbTextures);
+        if (!virtualTexturing)
+            std::cerr << virtualTexturePath << " is not a virtual texture this build can read" << std::endl;
     }
-    else
-    {
-        std::cerr << "Failed to load spike2 texture!" << std::endl;
-    }
-    stbi_image_free(data);
 
-    // Load spike4 texture
-    GLuint spike4Texture;
-    glGenTextures(1, &spike4Texture);
-    glBindTexture(GL_TEXTURE_2D, spike4Texture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // One indirect multi-draw per texture: all cylinder clusters, then the cross and
+    // spikes, which share the spikes image
+    auto drawGpuScene = [&]()
+    {
+        shader.use();
+        glBindTexture(GL_TEXTURE_2D, crownTextures[CYLINDER_IMAGE]);
+        if (virtualTexturing)
+            shader.setBool("virtualTextured", true);
+        gpuCuller.draw(0, gpuPartsFirst);
+        if (virtualTexturing)
+            shader.setBool("virtualTextured", false);
+        glBindTexture(GL_TEXTURE_2D, crownTextures[SPIKES_IMAGE]);
+        gpuCuller.draw(gpuPartsFirst, gpuCuller.meshCount() - gpuPartsFirst);
+    };
 
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // Hi-Z occlusion: the scene renders offscreen so its depth can be reduced into a pyramid
+    SceneTarget sceneTarget;
+    HiZPyramid hiZ;
+    if (hiZCulling)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        sceneTarget.create(SCR_WIDTH, SCR_HEIGHT, srgbTextures);
+        std::vector<unsigned char> hiZSource;
+        hiZ.create(SCR_WIDTH, SCR_HEIGHT, assets.shaderSource("hiz_build_compute.glsl", hiZSource));
     }
-    else
+    int occlusionFrames = 0;
+
+    // The camera and lights do not move; the lights stay in the program between frames and
+    // the camera travels in each frame packet
+    const glm::mat4 view = glm::lookAt(CAMERA_POS, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(FOV_Y_DEGREES), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    shader.use();
+    shader.setVec3("lightPos", LIGHT_POS);
+    shader.setVec3("lightDir", LIGHT_DIR);
+    shader.setFloat("cutOff", glm::cos(glm::radians(LIGHT_CUTOFF_DEGREES)));
+    shader.setFloat("outerCutOff", glm::cos(glm::radians(LIGHT_OUTER_CUTOFF_DEGREES)));
+    shader.setVec3("lightColor", LIGHT_COLOR);
+    shader.setVec3("viewPos", CAMERA_POS);
+    shader.setInt("transforms", TRANSFORM_TEXTURE_UNIT);
+    if (virtualTexturing)
+        virtualTexture.bind(shader);
+
+    CullBounds cullInput;
+    cullInput.resize(static_cast<std::size_t>(crownCount) * CROWN_PART_COUNT);
+    std::vector<std::uint32_t> visibleObjects;
+    visibleObjects.reserve(cullInput.count);
+    std::vector<std::vector<std::uint32_t>> chunkVisible((cullInput.count + CULL_JOB_BOXES - 1) / CULL_JOB_BOXES);
+    CullStats cullTotals;
+    int cullFrames = 0;
+    for (std::size_t object = 0; object < partNodes.size(); ++object)
+        cullInput.set(object, transformBounds(partBounds[object % CROWN_PART_COUNT], transforms.world(partNodes[object])));
+
+    // Per-frame jobs: transform update -> frustum cull -> sort by part, then front to back
+    TransformUpdate frameChanges;
+    CullStats cullStats;
+    auto updateTransforms = [&]()
     {
-        std::cerr << "Failed to load spike2 texture!" << std::endl;
-    }
-    stbi_image_free(data);
-
-    // Load spike5 texture
-    GLuint spike5Texture;
-    glGenTextures(1, &spike5Texture);
-    glBindTexture(GL_TEXTURE_2D, spike5Texture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+        frameChanges = transforms.update();
+        const std::vector<int>& changed = transforms.changedList();
+        jobs.parallelFor(changed.size(), 256, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const int object = nodeObjects[changed[i]];
+                if (object < 0)
+                    continue;
+                const glm::mat4& world = transforms.world(changed[i]);
+                cullInput.set(object, transformBounds(partBounds[object % CROWN_PART_COUNT], world));
+                picker.setTransform(object, world);
+            }
+        });
+    };
+    auto cullObjects = [&]()
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+        const auto start = std::chrono::steady_clock::now();
+        jobs.parallelFor(chunkVisible.size(), 1, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t chunk = begin; chunk < end; ++chunk)
+            {
+                chunkVisible[chunk].clear();
+                cullBounds(frustum, cullInput, chunkVisible[chunk], chunk * CULL_JOB_BOXES, (chunk + 1) * CULL_JOB_BOXES);
+            }
+        });
+        visibleObjects.clear();
+        for (const std::vector<std::uint32_t>& chunk : chunkVisible)
+            visibleObjects.insert(visibleObjects.end(), chunk.begin(), chunk.end());
+        cullStats.tested = cullInput.count;
+        cullStats.visible = visibleObjects.size();
+        cullStats.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    };
+    // Streaming demand: the most screen pixels any part in view covers with each image
+    std::array<float, CROWN_IMAGE_COUNT> imagePixels{};
+    auto measureImagePixels = [&]()
     {
-        std::cerr << "Failed to load spike2 texture!" << std::endl;
-    }
-    stbi_image_free(data);
-
-    // Load spike6 texture
-    GLuint spike6Texture;
-    glGenTextures(1, &spike6Texture);
-    glBindTexture(GL_TEXTURE_2D, spike6Texture);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        imagePixels.fill(0.0f);
+        for (std::size_t object = 0; object < partNodes.size(); ++object)
+        {
+            const int part = object % CROWN_PART_COUNT;
+            const Bounds world = transformBounds(partBounds[part], transforms.world(partNodes[object]));
+            if (!frustum.intersectsSphere(world.center, world.radius))
+                continue;
+            const float pixels = projectedPixels(world.radius, glm::length(world.center - CAMERA_POS), glm::radians(FOV_Y_DEGREES), (float)SCR_HEIGHT);
+            imagePixels[PART_IMAGES[part]] = std::max(imagePixels[PART_IMAGES[part]], pixels);
+        }
+    };
+    auto sortVisible = [&]()
+    {
+        // Same part shares a texture and VAO; nearer first helps the depth test
+        std::sort(visibleObjects.begin(), visibleObjects.end(), [&](std::uint32_t a, std::uint32_t b)
+        {
+            const std::uint32_t partA = a % CROWN_PART_COUNT, partB = b % CROWN_PART_COUNT;
+            if (partA != partB)
+                return partA < partB;
+            const glm::vec3 toA = glm::vec3(transforms.world(partNodes[a])[3]) - CAMERA_POS;
+            const glm::vec3 toB = glm::vec3(transforms.world(partNodes[b])[3]) - CAMERA_POS;
+            return glm::dot(toA, toA) < glm::dot(toB, toB);
+        });
+    };
 
-    data = stbi_load("spikes.jfif", &width, &height, &nrChannels, 0);
-    if (data)
+    // GPU-culling instances in upload order; only their matrices change between frames
+    std::vector<GLuint> gpuMeshIds;
+    std::vector<int> gpuInstanceNodes;
+    if (gpuCulling)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        for (int crown = 0; crown < crownCount; ++crown)
+        {
+            const int* nodes = &partNodes[crown * CROWN_PART_COUNT];
+            for (GLuint cluster = 0; cluster < gpuPartsFirst; ++cluster)
+            {
+                gpuInstanceNodes.push_back(nodes[0]);
+                gpuMeshIds.push_back(cluster);
+            }
+            for (int part = 1; part < CROWN_PART_COUNT; ++part)
+            {
+                gpuInstanceNodes.push_back(nodes[part]);
+                gpuMeshIds.push_back(gpuPartsFirst + part - 1);
+            }
+        }
     }
-    else
+
+    // Offline replay of a captured frame as a repeatable GL benchmark
+    CommandPlayer commandPlayer;
+    if (const char* replayPath = stringArg(argc, argv, "--replay", nullptr))
     {
-        std::cerr << "Failed to load spike2 texture!" << std::endl;
+        CommandStream captured;
+        if (!captured.load(replayPath, commandResources))
+        {
+            std::cerr << "Failed to load command capture " << replayPath << std::endl;
+        }
+        else
+        {
+            const int frames = intArg(argc, argv, "--frames", 500);
+            textureLoader.finish();
+            adoptLoadedTextures();
+            transformBuffer.bind();
+            glFinish();
+            const auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                commandPlayer.replay(captured, commandResources);
+                glFinish();
+            }
+            const double replayMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+            std::cout << "replay: " << captured.commandCount() << " commands (" << captured.bytes() << " bytes), "
+                      << replayMs << " ms/frame over " << frames << " frames" << std::endl;
+        }
+        frameRing.destroy();
+        transformBuffer.destroy();
+        virtualTexture.destroy();
+        textureLoader.stop();
+        glfwTerminate();
+        return 0;
     }
-    stbi_image_free(data);
-
+    const char* capturePath = stringArg(argc, argv, "--capture", nullptr);
 
-    // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
+    // Which virtual texture pages the cylinders want, drawn small and read back frames later
+    auto renderVirtualTextureFeedback = [&](const FramePacket& packet)
+    {
+        virtualTexture.renderFeedback(packet.view, packet.projection, [&](Shader& feedback)
+        {
+            feedback.setInt("transforms", TRANSFORM_TEXTURE_UNIT);
+            glBindVertexArray(VAO);
+            for (int crown = 0; crown < crownCount; ++crown)
+            {
+                feedback.setInt("transformIndex", partNodes[crown * CROWN_PART_COUNT]);
+                for (const LodBuffer* lod : surfaceLods)
+                {
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod->EBO);
+                    glDrawElements(GL_TRIANGLES, lod->counts[0], GL_UNSIGNED_INT, (GLvoid*)lod->offsets[0]);
+                }
+            }
+            glBindVertexArray(0);
+        });
+        virtualTexture.update(packet.frame);
+    };
 
-    // Render loop
-    while (!glfwWindowShouldClose(window))
+    // Render thread side: submit one packet to GL. Only this thread touches GL from here on.
+    glm::mat4 boundView(0.0f), boundProjection(0.0f);
+    auto renderFrame = [&](const FramePacket& packet)
     {
+        // Pick up finished textures; until then the placeholders stay bound
+        adoptLoadedTextures();
+        if (textureStreaming)
+        {
+            for (int image = 0; image < CROWN_IMAGE_COUNT; ++image)
+                textureStreamer.use(image, packet.imagePixels[image], packet.frame);
+            textureStreamer.update(packet.frame, textureLoader);
+        }
+
+        // Dynamic data of this frame goes into the ring region the GPU finished with
+        frameRing.beginFrame();
+
+        // Moved subtrees arrive as one contiguous span
+        transformBuffer.upload(packet.transformFirst, packet.transforms.data(), static_cast<int>(packet.transforms.size()), frameRing);
+        transformBuffer.bind();
+
+        if (!gpuCulling)
+        {
+            commandPlayer.replay(packet.commands, commandResources);
+            if (virtualTexturing)
+                renderVirtualTextureFeedback(packet);
+            frameRing.endFrame();
+            return;
+        }
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Use shader
         shader.use();
+        if (packet.view != boundView || packet.projection != boundProjection)
+        {
+            shader.setMat4("view", packet.view);
+            shader.setMat4("projection", packet.projection);
+            boundView = packet.view;
+            boundProjection = packet.projection;
+        }
+
+        if (!packet.instanceModels.empty())
+        {
+            if (!gpuObjectsUploaded)
+                gpuCuller.setObjects(packet.instanceModels, gpuMeshIds);
+            else
+                gpuCuller.updateObjects(packet.instanceModels);
+            gpuObjectsUploaded = true;
+        }
+
+        if (!hiZCulling)
+        {
+            gpuCuller.cull(packet.frustum);
+            drawGpuScene();
+        }
+        else
+        {
+            // Phase 1: redraw last frame's visible set and build the pyramid from its depth.
+            // Phase 2: re-test everything against it and draw what was wrongly held back.
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget.FBO);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            gpuCuller.cull(packet.frustum, CULL_PREVIOUS_VISIBLE);
+            drawGpuScene();
+            hiZ.build(sceneTarget.depthTexture);
+            gpuCuller.cull(packet.frustum, CULL_OCCLUSION, &hiZ, packet.projection * packet.view);
+            drawGpuScene();
+            sceneTarget.present();
+
+            if (++occlusionFrames == CULL_REPORT_FRAMES)
+            {
+                OcclusionStats occlusion = gpuCuller.readOcclusionStats();
+                std::cout << "hi-z: " << occlusion.occluded / occlusionFrames << "/"
+                          << occlusion.tested / occlusionFrames << " objects occluded per frame" << std::endl;
+                occlusionFrames = 0;
+            }
+        }
+        if (virtualTexturing)
+            renderVirtualTextureFeedback(packet);
+        frameRing.endFrame();
+    };
 
-        // Set transformation matrices
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 4.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-
-        shader.setMat4("model", model);
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-
-        // Set light properties
-        shader.setVec3("lightPos", glm::vec3(0.0f, 5.0f, 8.0f));  // A bit lower and forward
-        shader.setVec3("lightDir", glm::normalize(glm::vec3(0.0f, -0.8f, -1.0f)));
-
-        // Make the beam sharper
-        shader.setFloat("cutOff", glm::cos(glm::radians(8.0f)));  // Wider light
-        shader.setFloat("outerCutOff", glm::cos(glm::radians(11.0f))); // Soft edge
-
-        // Reduce brightness to match reference
-        shader.setVec3("lightColor", glm::vec3(1.5f, 1.5f, 1.2f));  // Softer warm light
-
-
-
-
-
-        // Draw outer surface
-        glBindTexture(GL_TEXTURE_2D, outerTexture);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outerEBO);
-        glDrawElements(GL_TRIANGLES, outerIndices.size(), GL_UNSIGNED_INT, 0);
-
-        // Draw inner surface
-        glBindTexture(GL_TEXTURE_2D, innerTexture);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, innerEBO);
-        glDrawElements(GL_TRIANGLES, innerIndices.size(), GL_UNSIGNED_INT, 0);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outerEBO);
-        glDrawElements(GL_TRIANGLES, outerIndices.size(), GL_UNSIGNED_INT, 0);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, innerEBO);
-        glDrawElements(GL_TRIANGLES, innerIndices.size(), GL_UNSIGNED_INT, 0);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, topEBO);
-        glDrawElements(GL_TRIANGLES, topCapIndices.size(), GL_UNSIGNED_INT, 0);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bottomEBO);
-        glDrawElements(GL_TRIANGLES, bottomCapIndices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader
-        glm::mat4 crossModel = glm::translate(model, glm::vec3(0.0f, HEIGHT / 2 + CROSS_HEIGHT / 1.5 + 0.55, 2.12f));
-        shader.setMat4("model", crossModel);
-        glBindTexture(GL_TEXTURE_2D, crossTexture);
-        glBindVertexArray(crossVAO);
-        glDrawElements(GL_TRIANGLES, crossIndices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike(back spike)
-        glm::mat4 spikeModel = glm::translate(model, glm::vec3(0.0f, HEIGHT / 2.5 + SPIKE_HEIGHT / 1.5 + 0.55, -0.2f));
-        shader.setMat4("model", spikeModel);
-        glBindTexture(GL_TEXTURE_2D, spikeTexture);
-        glBindVertexArray(spikeVAO);
-        glDrawElements(GL_TRIANGLES, spikeIndices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike 1
-        glm::mat4 spike1Model = glm::translate(model, glm::vec3(1.099f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 1.15f));
-        shader.setMat4("model", spike1Model);
-        glBindTexture(GL_TEXTURE_2D, spike1Texture);
-        glBindVertexArray(spike1VAO);
-        glDrawElements(GL_TRIANGLES, spike1Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike 2
-        glm::mat4 spike2Model = glm::translate(model, glm::vec3(-1.099f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 1.15f));
-        shader.setMat4("model", spike2Model);
-        glBindTexture(GL_TEXTURE_2D, spike2Texture);
-        glBindVertexArray(spike2VAO);
-        glDrawElements(GL_TRIANGLES, spike2Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike 3(Left center)
-        glm::mat4 spike3Model = glm::translate(model, glm::vec3(-0.7f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 0.3f));
-        spike3Model = glm::rotate(spike3Model, glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        shader.setMat4("model", spike3Model);
-        glBindTexture(GL_TEXTURE_2D, spike3Texture);
-        glBindVertexArray(spike3VAO);
-        glDrawElements(GL_TRIANGLES, spike3Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike(Right center)
-        glm::mat4 spike4Model = glm::translate(model, glm::vec3(0.7f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 0.3f));
-        spike4Model = glm::rotate(spike4Model, glm::radians(30.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-        shader.setMat4("model", spike4Model);
-        glBindTexture(GL_TEXTURE_2D, spike4Texture);
-        glBindVertexArray(spike4VAO);
-        glDrawElements(GL_TRIANGLES, spike4Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike 5
-        glm::mat4 spike5Model = glm::translate(model, glm::vec3(-0.65f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 2.0f));
-        spike5Model = glm::rotate(spike5Model, glm::radians(30.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-        shader.setMat4("model", spike5Model);
-        glBindTexture(GL_TEXTURE_2D, spike5Texture);
-        glBindVertexArray(spike5VAO);
-        glDrawElements(GL_TRIANGLES, spike5Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Pass the updated model matrix to the shader for spike 6
-
-        glm::mat4 spike6Model = glm::translate(model, glm::vec3(0.6f, HEIGHT / 2.5 + SPIKE_HEIGHT1 / 1.5 + 0.55, 2.05));
-        spike6Model = glm::rotate(spike6Model, glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        shader.setMat4("model", spike6Model);
-        glBindTexture(GL_TEXTURE_2D, spike6Texture);
-        glBindVertexArray(spike6VAO);
-        glDrawElements(GL_TRIANGLES, spike6Indices.size(), GL_UNSIGNED_INT, 0);
-
-        // Swap buffers and poll events
-        glfwSwapBuffers(window);
+    // Main thread side: the visible parts as commands, binding state once per run of the
+    // same part. Kept between frames and only re-recorded when something moved.
+    CommandStream recordedFrame;
+    bool frameRecorded = false;
+    auto recordFrame = [&]()
+    {
+        recordedFrame.reset();
+        recordedFrame.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        recordedFrame.useProgram(programResource);
+        recordedFrame.uniformMat4(viewUniform, view);
+        recordedFrame.uniformMat4(projectionUniform, projection);
+        int virtualTexturedSet = -1;
+        for (std::uint32_t object : visibleObjects)
+        {
+            const int part = object % CROWN_PART_COUNT;
+            const glm::mat4& world = transforms.world(partNodes[object]);
+            recordedFrame.uniformInt(transformIndexUniform, partNodes[object]);
+            if (virtualTexturing && virtualTexturedSet != (part == 0))
+            {
+                // Only the cylinder samples the virtual texture
+                virtualTexturedSet = part == 0;
+                recordedFrame.uniformInt(virtualTexturedUniform, virtualTexturedSet);
+            }
+
+            if (part == 0)
+            {
+                // Pick cylinder LODs from the projected geometric error, culling clusters at full detail
+                const float cylinderDistance = glm::length(CAMERA_POS - glm::vec3(world[3]));
+                recordedFrame.bindVertexArray(cylinderVertexArray);
+                for (int surface = 0; surface < 4; ++surface)
+                {
+                    const int level = selectLod(surfaceLods[surface]->errors, cylinderDistance, glm::radians(FOV_Y_DEGREES),
+                        (float)SCR_HEIGHT, LOD_PIXEL_ERROR);
+                    recordCylinderSurface(recordedFrame, surface, level, world, frustum);
+                }
+            }
+            else
+            {
+                recordedFrame.bindTexture(partTextureResources[part]);
+                recordedFrame.bindVertexArray(partVertexArrays[part]);
+                recordedFrame.drawElements(partMeshes[part]->indexCount, 0);
+            }
+        }
+        frameRecorded = true;
+    };
+
+    // The render thread takes the GL context; this thread simulates frame N+1 while it
+    // submits frame N
+    RenderThread<FramePacket> renderThread;
+    renderThread.start(window, renderFrame);
+    std::uint64_t frameIndex = 0;
+
+    // Main loop
+    while (!glfwWindowShouldClose(window))
+    {
         glfwPollEvents();
+
+        // Blocks only while the render thread still reads the packet from two frames ago
+        FramePacket* packet = renderThread.beginFrame();
+
+        // Scene work runs as jobs; this thread only waits for what goes into the packet
+        JobHandle updateJob = jobs.run(updateTransforms);
+        packet->frame = frameIndex++;
+        packet->view = view;
+        packet->projection = projection;
+        packet->frustum = frustum;
+
+        // Refresh only moved subtrees and hand them over as one span
+        jobs.wait(updateJob);
+        const std::vector<glm::mat4>& worlds = transforms.worldMatrices();
+        packet->transformFirst = frameChanges.first;
+        packet->transforms.assign(worlds.begin() + frameChanges.first, worlds.begin() + frameChanges.last);
+        if (textureStreaming && (packet->frame == 0 || !frameChanges.empty()))
+            measureImagePixels();
+        packet->imagePixels = imagePixels;
+
+        // A static scene keeps its recorded commands, so culling only runs after changes
+        JobHandle visibleJob;
+        const bool rerecord = !gpuCulling && (!frameRecorded || !frameChanges.empty());
+        if (rerecord)
+            visibleJob = jobs.run(sortVisible, { jobs.run(cullObjects) });
+
+        // Select the part under the cursor on left click
+        const bool mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (mouseDown && !mouseWasDown)
+        {
+            double cursorX, cursorY;
+            int windowWidth, windowHeight;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            const auto pickStart = std::chrono::steady_clock::now();
+            const PickResult picked = picker.pick(Picker::cursorRay(cursorX, cursorY, windowWidth, windowHeight, view, projection));
+            const double pickUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - pickStart).count();
+            if (picked.hit)
+                std::cout << "picked " << PART_NAMES[picked.part] << " of crown " << picked.instance / CROWN_PART_COUNT
+                          << ", triangle " << picked.triangle << " at (" << picked.position.x << ", " << picked.position.y
+                          << ", " << picked.position.z << ") in " << pickUs << " us" << std::endl;
+            else
+                std::cout << "picked nothing in " << pickUs << " us" << std::endl;
+        }
+        mouseWasDown = mouseDown;
+
+        if (gpuCulling)
+        {
+            // Instances only change with the scene, so they are resent when a transform moves
+            packet->instanceModels.clear();
+            if (packet->frame == 0 || !frameChanges.empty())
+                for (int node : gpuInstanceNodes)
+                    packet->instanceModels.push_back(transforms.world(node));
+            renderThread.submitFrame();
+            continue;
+        }
+
+        if (rerecord)
+        {
+            // Visible set from the cull and sort jobs
+            jobs.wait(visibleJob);
+            cullTotals.tested += cullStats.tested;
+            cullTotals.visible += cullStats.visible;
+            cullTotals.microseconds += cullStats.microseconds;
+            if (++cullFrames == CULL_REPORT_FRAMES)
+            {
+                std::cout << "cull (" << cullKernelName() << "): " << cullTotals.visible / cullFrames << "/"
+                          << cullTotals.tested / cullFrames << " objects visible, "
+                          << cullTotals.objectsPerMicrosecond() << " objects/us" << std::endl;
+                cullTotals = CullStats();
+                cullFrames = 0;
+            }
+
+            recordFrame();
+            if (capturePath)
+            {
+                if (recordedFrame.save(capturePath))
+                    std::cout << "captured " << recordedFrame.commandCount() << " commands to " << capturePath << std::endl;
+                else
+                    std::cerr << "Failed to write command capture " << capturePath << std::endl;
+                capturePath = nullptr;
+            }
+        }
+        packet->commands.copyFrom(recordedFrame);
+        renderThread.submitFrame();
     }
 
+    // Let the render thread finish what was submitted and take the context back for cleanup
+    renderThread.stop();
+    std::cout << "frame ring (" << (frameRing.persistentlyMapped() ? "persistent" : "staged") << "): " << frameRing.stalls
+              << " stalls, " << frameRing.overflows << " overflows" << std::endl;
+    std::cout << "texture decodes: " << textureLoader.decodedInPlace << " in place, " << textureLoader.decodedCopied
+              << " copied, " << textureLoader.decodedResampled << " resampled, " << textureLoader.uploadedCompressed
+              << " block-compressed, " << textureLoader.uploadedStreamed << " streamed" << std::endl;
+    std::cout << "asset pack: " << assets.size() << " assets, " << assets.mappedReads << " read in place, "
+              << assets.expandedReads << " expanded, " << textureLoader.uploadedPacked << " textures" << std::endl;
+    textureMemory.report(std::cout);
+    if (textureStreaming)
+        textureStreamer.report(std::cout);
+    if (virtualTexturing)
+        virtualTexture.report(std::cout);
+    if (textureCacheDirectory)
+        std::cout << "texture cache: " << textureCache.hits << " hits, " << textureCache.misses << " misses, "
+                  << textureCache.stores << " stored, " << textureCache.savedMs() << " ms saved" << std::endl;
+
     // Cleanup
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &outerEBO);
-    glDeleteBuffers(1, &innerEBO);
-    glDeleteVertexArrays(1, &crossVAO);
-    glDeleteBuffers(1, &crossVBO);
-    glDeleteBuffers(1, &crossEBO);
-    glDeleteVertexArrays(1, &spikeVAO);
-    glDeleteBuffers(1, &spikeVBO);
-    glDeleteBuffers(1, &spikeEBO);
-    glDeleteVertexArrays(1, &spike1VAO);
-    glDeleteBuffers(1, &spike1VBO);
-    glDeleteBuffers(1, &spike1EBO);
+    glDeleteBuffers(1, &outerLod.EBO);
+    glDeleteBuffers(1, &innerLod.EBO);
+    glDeleteBuffers(1, &topLod.EBO);
+    glDeleteBuffers(1, &bottomLod.EBO);
+    glDeleteBuffers(1, &outerMeshlets.EBO);
+    glDeleteBuffers(1, &innerMeshlets.EBO);
+    glDeleteBuffers(1, &topMeshlets.EBO);
+    glDeleteBuffers(1, &bottomMeshlets.EBO);
+    deleteMesh(crossMesh);
+    deleteMesh(spikeMesh);
+    deleteMesh(spike1Mesh);
+    deleteMesh(spike2Mesh);
+    deleteMesh(spike3Mesh);
+    deleteMesh(spike4Mesh);
+    deleteMesh(spike5Mesh);
+    deleteMesh(spike6Mesh);
+    gpuCuller.destroy();
+    frameRing.destroy();
+    hiZ.destroy();
+    virtualTexture.destroy();
+    transformBuffer.destroy();
+    if (hiZCulling)
+        sceneTarget.destroy();
+    textureLoader.stop();
+    for (int image = 0; image < CROWN_IMAGE_COUNT; ++image)
+    {
+        if (crownTextures[image] == placeholderTexture)
+            continue;
+        textureMemory.release(crownTextures[image]);
+        glDeleteTextures(1, &crownTextures[image]);
+    }
+    glDeleteTextures(1, &placeholderTexture);
     glfwTerminate();
 
     return 0;
@@ -0,0 +1,95 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only. Pages are brought in by the OS as they are touched, so
+// nothing is read up front and a file that is still in the page cache costs no I/O.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // False for missing and empty files
+    bool open(const std::string& path)
+    {
+        close();
+#ifdef _WIN32
+        const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER length;
+        if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+        {
+            // The view keeps the mapping and the file open, neither handle is needed after it
+            const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping)
+            {
+                view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+            if (view)
+                bytes = static_cast<std::size_t>(length.QuadPart);
+        }
+        CloseHandle(file);
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void* mapped = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapped != MAP_FAILED)
+            {
+                view = mapped;
+                bytes = static_cast<std::size_t>(status.st_size);
+            }
+        }
+        ::close(file);
+#endif
+        return view != nullptr;
+    }
+
+    void close()
+    {
+        if (!view)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap(view, bytes);
+#endif
+        view = nullptr;
+        bytes = 0;
+    }
+
+    const unsigned char* data() const { return static_cast<const unsigned char*>(view); }
+    std::size_t size() const { return bytes; }
+    bool isOpen() const { return view != nullptr; }
+
+private:
+    void* view = nullptr;
+    std::size_t bytes = 0;
+};
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef MESH_SIMPLIFY_HPP
+#define MESH_SIMPLIFY_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "baked_mesh.hpp"
+
+// Quadric-error-metric simplification for the interleaved (x, y, z, u, v) mesh format.
+// Simplification only produces new index lists, every LOD shares the original vertex buffer.
+namespace simplify_detail
+{
+    // Symmetric 4x4 error quadric stored as its upper triangle
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        void addPlane(const glm::dvec3& n, double d, double weight)
+        {
+            a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+            a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+            a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+            a33 += weight * d * d;
+        }
+
+        void add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+        }
+
+        double evaluate(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double r = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                + a22 * z * z + 2 * a23 * z
+                + a33;
+            return r < 0 ? 0 : r;
+        }
+    };
+
+    enum VertexKind : unsigned char
+    {
+        KIND_MANIFOLD, // Interior vertex, free to collapse onto any neighbour
+        KIND_BORDER,   // On an open edge, may only slide along that border
+        KIND_SEAM      // Shares its position with another vertex (UV seam), never moves
+    };
+
+    inline std::uint64_t edgeKey(std::uint32_t a, std::uint32_t b)
+    {
+        if (a > b)
+            std::swap(a, b);
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+
+    struct PositionKey
+    {
+        std::uint32_t x, y, z;
+        bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct PositionHash
+    {
+        std::size_t operator()(const PositionKey& k) const
+        {
+            return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u);
+        }
+    };
+
+    // Border edges are weighted heavily so open outlines keep their shape
+    constexpr double BORDER_WEIGHT = 10.0;
+
+    // Squared distance from p to triangle abc (closest point by Voronoi region)
+    inline float pointTriangleDistanceSquared(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return glm::dot(ap, ap);
+
+        const glm::vec3 bp = p - b;
+        const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return glm::dot(bp, bp);
+
+        const glm::vec3 cp = p - c;
+        const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return glm::dot(cp, cp);
+
+        glm::vec3 closest;
+        const float vc = d1 * d4 - d3 * d2;
+        const float vb = d5 * d2 - d1 * d6;
+        const float va = d3 * d6 - d5 * d4;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            closest = a + ab * (d1 / (d1 - d3));
+        else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            closest = a + ac * (d2 / (d2 - d6));
+        else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+            closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        else
+        {
+            const float denominator = 1.0f / (va + vb + vc);
+            closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+        }
+        const glm::vec3 offset = p - closest;
+        return glm::dot(offset, offset);
+    }
+}
+
+// Simplify `indices` towards `targetIndexCount` without exceeding `maxError` (object-space
+// distance). Returns the new index list; `resultError` receives the furthest any removed
+// vertex lies from the simplified triangles around the vertex it was merged into.
+inline std::vector<GLuint> simplifyMesh(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices,
+    std::size_t targetIndexCount, float maxError, float* resultError = nullptr)
+{
+    using namespace simplify_detail;
+
+    const std::size_t vertexCount = vertices.size() / VERTEX_STRIDE;
+    const std::size_t triangleCount = indices.size() / 3;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (std::size_t i = 0; i < vertexCount; ++i)
+        positions[i] = glm::vec3(vertices[i * VERTEX_STRIDE], vertices[i * VERTEX_STRIDE + 1], vertices[i * VERTEX_STRIDE + 2]);
+
+    // Weld referenced vertices by exact position, split vertices at the same spot form a seam
+    std::vector<char> referenced(vertexCount, 0);
+    for (GLuint index : indices)
+        referenced[index] = 1;
+
+    std::vector<std::uint32_t> weld(vertexCount);
+    std::vector<unsigned char> kind(vertexCount, KIND_MANIFOLD);
+    std::unordered_map<PositionKey, std::uint32_t, PositionHash> firstAtPosition;
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+    {
+        weld[i] = i;
+        if (!referenced[i])
+            continue;
+        PositionKey key;
+        std::memcpy(&key.x, &positions[i].x, 4);
+        std::memcpy(&key.y, &positions[i].y, 4);
+        std::memcpy(&key.z, &positions[i].z, 4);
+        auto found = firstAtPosition.find(key);
+        if (found == firstAtPosition.end())
+        {
+            firstAtPosition.emplace(key, i);
+        }
+        else
+        {
+            weld[i] = found->second;
+            kind[i] = KIND_SEAM;
+            kind[found->second] = KIND_SEAM;
+        }
+    }
+
+    // Count triangles per welded edge, an edge used once is an open border
+    std::unordered_map<std::uint64_t, int> edgeUse;
+    for (std::size_t t = 0; t < triangleCount; ++t)
+        for (int e = 0; e < 3; ++e)
+            ++edgeUse[edgeKey(weld[indices[t * 3 + e]], weld[indices[t * 3 + (e + 1) % 3]])];
+
+    // Plane quadrics per welded position, plus constraint planes along borders. The border
+    // weight only steers the collapse order; `maxError` is checked against the plain planes.
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<Quadric> planeQuadrics(vertexCount);
+    for (std::size_t t = 0; t < triangleCount; ++t)
+    {
+        const GLuint v[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+        const glm::dvec3 p0(positions[v[0]]), p1(positions[v[1]]), p2(positions[v[2]]);
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(n);
+        if (length <= 0.0)
+            continue;
+        n /= length;
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[weld[v[k]]].addPlane(n, -glm::dot(n, p0), 1.0);
+            planeQuadrics[weld[v[k]]].addPlane(n, -glm::dot(n, p0), 1.0);
+        }
+
+        for (int e = 0; e < 3; ++e)
+        {
+            const GLuint a = v[e], b = v[(e + 1) % 3];
+            if (edgeUse[edgeKey(weld[a], weld[b])] != 1)
+                continue;
+            const glm::dvec3 pa(positions[a]), pb(positions[b]);
+            glm::dvec3 edgeNormal = glm::cross(pb - pa, n);
+            const double edgeLength = glm::length(edgeNormal);
+            if (edgeLength <= 0.0)
+                continue;
+            edgeNormal /= edgeLength;
+            quadrics[weld[a]].addPlane(edgeNormal, -glm::dot(edgeNormal, pa), BORDER_WEIGHT);
+            quadrics[weld[b]].addPlane(edgeNormal, -glm::dot(edgeNormal, pa), BORDER_WEIGHT);
+            if (kind[a] == KIND_MANIFOLD)
+                kind[a] = KIND_BORDER;
+            if (kind[b] == KIND_MANIFOLD)
+                kind[b] = KIND_BORDER;
+        }
+    }
+
+    // Working triangle list and vertex -> triangle adjacency
+    std::vector<GLuint> tris(indices);
+    std::vector<char> alive(triangleCount, 1);
+    std::vector<std::vector<std::uint32_t>> adjacency(vertexCount);
+    for (std::uint32_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[tris[t * 3 + k]].push_back(t);
+
+    auto canCollapse = [&](GLuint from, GLuint to)
+    {
+        if (from == to || weld[from] == weld[to])
+            return false;
+        if (kind[from] == KIND_MANIFOLD)
+            return true;
+        if (kind[from] == KIND_BORDER)
+            return kind[to] != KIND_MANIFOLD && edgeUse[edgeKey(weld[from], weld[to])] == 1;
+        return false;
+    };
+
+    // Reject collapses that would flip a surviving triangle
+    auto flips = [&](GLuint from, GLuint to)
+    {
+        for (std::uint32_t t : adjacency[from])
+        {
+            if (!alive[t])
+                continue;
+            const GLuint* tri = &tris[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+                continue;
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                before[k] = positions[tri[k]];
+                after[k] = tri[k] == from ? positions[to] : positions[tri[k]];
+            }
+            const glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            const glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.0f)
+                return true;
+        }
+        return false;
+    };
+
+    struct Collapse
+    {
+        GLuint from, to;
+        double cost;     // Border-weighted, orders the collapses
+        double distance; // Unweighted, checked against maxError
+    };
+
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    std::size_t liveIndexCount = tris.size();
+    std::vector<Collapse> candidates;
+    std::vector<char> touched(vertexCount);
+    std::vector<std::uint32_t> mergedInto(vertexCount);
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+        mergedInto[i] = i;
+
+    // Greedy passes: cheapest independent collapses first until the target is met
+    while (liveIndexCount > targetIndexCount)
+    {
+        candidates.clear();
+        for (std::uint32_t t = 0; t < triangleCount; ++t)
+        {
+            if (!alive[t])
+                continue;
+            for (int e = 0; e < 3; ++e)
+            {
+                const GLuint a = tris[t * 3 + e], b = tris[t * 3 + (e + 1) % 3];
+                Quadric q = quadrics[weld[a]];
+                q.add(quadrics[weld[b]]);
+                Quadric plane = planeQuadrics[weld[a]];
+                plane.add(planeQuadrics[weld[b]]);
+                if (canCollapse(a, b))
+                    candidates.push_back({ a, b, q.evaluate(positions[b]), plane.evaluate(positions[b]) });
+                if (canCollapse(b, a))
+                    candidates.push_back({ b, a, q.evaluate(positions[a]), plane.evaluate(positions[a]) });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        std::size_t collapsed = 0;
+        for (const Collapse& c : candidates)
+        {
+            if (liveIndexCount <= targetIndexCount)
+                break;
+            if (c.distance > maxCost || touched[c.from] || touched[c.to] || flips(c.from, c.to))
+                continue;
+
+            for (std::uint32_t t : adjacency[c.from])
+            {
+                if (!alive[t])
+                    continue;
+                GLuint* tri = &tris[t * 3];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                {
+                    alive[t] = 0;
+                    liveIndexCount -= 3;
+                    continue;
+                }
+                for (int k = 0; k < 3; ++k)
+                {
+                    touched[tri[k]] = 1;
+                    if (tri[k] == c.from)
+                        tri[k] = c.to;
+                }
+                adjacency[c.to].push_back(t);
+            }
+            adjacency[c.from].clear();
+            quadrics[weld[c.to]].add(quadrics[weld[c.from]]);
+            planeQuadrics[weld[c.to]].add(planeQuadrics[weld[c.from]]);
+            touched[c.from] = touched[c.to] = 1;
+            mergedInto[c.from] = c.to;
+            ++collapsed;
+        }
+        if (collapsed == 0)
+            break;
+    }
+
+    std::vector<GLuint> result;
+    result.reserve(liveIndexCount);
+    for (std::size_t t = 0; t < triangleCount; ++t)
+        if (alive[t])
+            result.insert(result.end(), tris.begin() + t * 3, tris.begin() + t * 3 + 3);
+
+    // Measure the deviation directly: each removed vertex against the fan of the vertex it
+    // ended up in. The true nearest triangle can only be closer, so this never underestimates.
+    if (resultError)
+    {
+        float worst = 0.0f;
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            if (mergedInto[i] == i)
+                continue;
+            std::uint32_t survivor = mergedInto[i];
+            while (mergedInto[survivor] != survivor)
+                survivor = mergedInto[survivor];
+            float nearest = INFINITY;
+            for (std::uint32_t t : adjacency[survivor])
+                if (alive[t])
+                    nearest = std::min(nearest, pointTriangleDistanceSquared(positions[i],
+                        positions[tris[t * 3]], positions[tris[t * 3 + 1]], positions[tris[t * 3 + 2]]));
+            if (nearest != INFINITY)
+                worst = std::max(worst, nearest);
+        }
+        *resultError = std::sqrt(worst);
+    }
+    return result;
+}
+
+// LOD chain settings: each level targets `reduction` times the triangles of the previous one
+struct LodSettings
+{
+    int maxLevels = 4;
+    float reduction = 0.5f;
+    float maxError = 1e30f;
+    std::size_t minIndexCount = 36;
+};
+
+struct LodLevel
+{
+    std::vector<GLuint> indices;
+    float error = 0.0f; // Object-space geometric error of this level
+};
+
+// Level 0 is the source mesh. Each further level is simplified from the source, so errors
+// do not compound; generation stops once a level no longer reduces the triangle count.
+inline std::vector<LodLevel> buildLodChain(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices,
+    const LodSettings& settings = LodSettings())
+{
+    std::vector<LodLevel> chain;
+    chain.push_back({ indices, 0.0f });
+
+    float target = static_cast<float>(indices.size());
+    for (int level = 1; level < settings.maxLevels; ++level)
+    {
+        target *= settings.reduction;
+        const std::size_t targetIndexCount = static_cast<std::size_t>(target) / 3 * 3;
+        if (targetIndexCount < settings.minIndexCount)
+            break;
+
+        LodLevel lod;
+        lod.indices = simplifyMesh(vertices, indices, targetIndexCount, settings.maxError, &lod.error);
+        if (lod.indices.size() >= chain.back().indices.size())
+            break;
+        lod.error = std::max(lod.error, chain.back().error);
+        chain.push_back(std::move(lod));
+    }
+    return chain;
+}
+
+// Coarsest level whose error projects to at most `maxPixelError` pixels at `distance`
+inline int selectLod(const std::vector<float>& levelErrors, float distance, float fovY, float viewportHeight,
+    float maxPixelError = 1.0f)
+{
+    const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f) * std::max(distance, 1e-4f));
+    int level = 0;
+    for (std::size_t i = 1; i < levelErrors.size(); ++i)
+        if (levelErrors[i] * pixelsPerUnit <= maxPixelError)
+            level = static_cast<int>(i);
+    return level;
+}
+
+// All levels of a chain packed into one element buffer
+struct LodBuffer
+{
+    GLuint EBO = 0;
+    std::vector<GLsizei> counts;
+    std::vector<std::size_t> offsets; // Byte offsets into EBO
+    std::vector<float> errors;
+};
+
+inline LodBuffer uploadLodChain(const std::vector<LodLevel>& chain)
+{
+    LodBuffer lod;
+    std::vector<GLuint> packed;
+    for (const LodLevel& level : chain)
+    {
+        lod.offsets.push_back(packed.size() * sizeof(GLuint));
+        lod.counts.push_back(static_cast<GLsizei>(level.indices.size()));
+        lod.errors.push_back(level.error);
+        packed.insert(packed.end(), level.indices.begin(), level.indices.end());
+    }
+    glGenBuffers(1, &lod.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size() * sizeof(GLuint), packed.data(), GL_STATIC_DRAW);
+    return lod;
+}
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "baked_mesh.hpp"
+#include "frustum.hpp"
+
+// Cluster limits, sized for typical mesh-shader workgroups
+constexpr std::size_t MESHLET_MAX_VERTICES = 64;
+constexpr std::size_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet
+{
+    // Ranges into MeshletMesh::meshletVertices / meshletTriangles
+    std::uint32_t vertexOffset = 0;
+    std::uint32_t triangleOffset = 0;
+    std::uint32_t vertexCount = 0;
+    std::uint32_t triangleCount = 0;
+
+    // Range of this cluster's triangles in MeshletMesh::indices
+    std::uint32_t firstIndex = 0;
+
+    // Bounding sphere
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Normal cone: the cluster is back-facing when
+    // dot(normalize(coneApex - cameraPos), coneAxis) >= coneCutoff
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+struct MeshletMesh
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<GLuint> meshletVertices;         // Cluster-local vertex -> mesh vertex
+    std::vector<std::uint8_t> meshletTriangles; // Three cluster-local vertices per triangle
+    std::vector<GLuint> indices;                 // Triangles reordered so every cluster is contiguous
+};
+
+namespace meshlet_detail
+{
+    inline glm::vec3 position(const std::vector<GLfloat>& vertices, GLuint index)
+    {
+        const GLfloat* v = &vertices[index * VERTEX_STRIDE];
+        return glm::vec3(v[0], v[1], v[2]);
+    }
+
+    // Ritter's approximate bounding sphere
+    inline void boundingSphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius)
+    {
+        glm::vec3 a = points[0];
+        glm::vec3 b = a;
+        float best = -1.0f;
+        for (const glm::vec3& p : points)
+        {
+            const float d = glm::dot(p - a, p - a);
+            if (d > best) { best = d; b = p; }
+        }
+        glm::vec3 c = b;
+        best = -1.0f;
+        for (const glm::vec3& p : points)
+        {
+            const float d = glm::dot(p - b, p - b);
+            if (d > best) { best = d; c = p; }
+        }
+
+        center = (b + c) * 0.5f;
+        radius = glm::length(c - b) * 0.5f;
+        for (const glm::vec3& p : points)
+        {
+            const float d = glm::length(p - center);
+            if (d > radius)
+            {
+                const float grown = (radius + d) * 0.5f;
+                center += (p - center) * ((grown - radius) / d);
+                radius = grown;
+            }
+        }
+    }
+
+    inline void computeBounds(const std::vector<GLfloat>& vertices, const MeshletMesh& mesh, Meshlet& m)
+    {
+        std::vector<glm::vec3> points;
+        for (std::uint32_t i = 0; i < m.vertexCount; ++i)
+            points.push_back(position(vertices, mesh.meshletVertices[m.vertexOffset + i]));
+        boundingSphere(points, m.center, m.radius);
+
+        // Average triangle normal is the cone axis, the widest deviation gives its spread
+        std::vector<glm::vec3> normals;
+        glm::vec3 axis(0.0f);
+        for (std::uint32_t t = 0; t < m.triangleCount; ++t)
+        {
+            const std::uint8_t* tri = &mesh.meshletTriangles[(m.triangleOffset + t) * 3];
+            const glm::vec3 p0 = points[tri[0]], p1 = points[tri[1]], p2 = points[tri[2]];
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(n);
+            if (length <= 0.0f)
+                continue;
+            normals.push_back(n / length);
+            axis += n / length;
+        }
+        const float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength <= 0.0f)
+            return;
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals)
+            minDot = std::min(minDot, glm::dot(n, axis));
+
+        m.coneAxis = axis;
+        m.coneApex = m.center;
+        // Normals spread over more than ~84 degrees: the cone can never be culled
+        if (minDot <= 0.1f)
+        {
+            m.coneCutoff = 1.0f;
+            return;
+        }
+
+        // Move the apex back along the axis so every triangle plane is in front of it
+        float maxT = 0.0f;
+        for (std::uint32_t t = 0, n = 0; t < m.triangleCount; ++t)
+        {
+            const std::uint8_t* tri = &mesh.meshletTriangles[(m.triangleOffset + t) * 3];
+            const glm::vec3 p0 = points[tri[0]], p1 = points[tri[1]], p2 = points[tri[2]];
+            if (glm::length(glm::cross(p1 - p0, p2 - p0)) <= 0.0f)
+                continue;
+            const glm::vec3& normal = normals[n++];
+            const float dn = glm::dot(axis, normal);
+            const float dc = glm::dot(m.center - p0, normal);
+            maxT = std::max(maxT, dc / dn);
+        }
+        m.coneApex = m.center - axis * maxT;
+        m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+// Split a triangle list into clusters of at most `maxVertices` vertices and `maxTriangles`
+// triangles. Clusters grow greedily through shared vertices so they stay spatially compact.
+inline MeshletMesh buildMeshlets(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices,
+    std::size_t maxVertices = MESHLET_MAX_VERTICES, std::size_t maxTriangles = MESHLET_MAX_TRIANGLES)
+{
+    const std::size_t vertexCount = vertices.size() / VERTEX_STRIDE;
+    const std::size_t triangleCount = indices.size() / 3;
+
+    std::vector<std::vector<std::uint32_t>> adjacency(vertexCount);
+    for (std::uint32_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[indices[t * 3 + k]].push_back(t);
+
+    MeshletMesh mesh;
+    mesh.indices.reserve(indices.size());
+    std::vector<char> used(triangleCount, 0);
+    std::vector<int> localIndex(vertexCount, -1);
+
+    for (std::uint32_t seed = 0; seed < triangleCount; ++seed)
+    {
+        if (used[seed])
+            continue;
+
+        Meshlet m;
+        m.vertexOffset = static_cast<std::uint32_t>(mesh.meshletVertices.size());
+        m.triangleOffset = static_cast<std::uint32_t>(mesh.meshletTriangles.size() / 3);
+        m.firstIndex = static_cast<std::uint32_t>(mesh.indices.size());
+
+        auto newVertices = [&](std::uint32_t t)
+        {
+            int count = 0;
+            for (int k = 0; k < 3; ++k)
+                count += localIndex[indices[t * 3 + k]] < 0;
+            return count;
+        };
+
+        auto addTriangle = [&](std::uint32_t t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const GLuint v = indices[t * 3 + k];
+                if (localIndex[v] < 0)
+                {
+                    localIndex[v] = static_cast<int>(m.vertexCount++);
+                    mesh.meshletVertices.push_back(v);
+                }
+                mesh.meshletTriangles.push_back(static_cast<std::uint8_t>(localIndex[v]));
+                mesh.indices.push_back(v);
+            }
+            used[t] = 1;
+            ++m.triangleCount;
+        };
+
+        addTriangle(seed);
+        while (m.triangleCount < maxTriangles)
+        {
+            // Prefer the neighbour that adds the fewest new vertices
+            std::uint32_t best = 0;
+            int bestScore = 4;
+            for (std::uint32_t i = m.vertexOffset; i < mesh.meshletVertices.size() && bestScore > 0; ++i)
+            {
+                for (std::uint32_t t : adjacency[mesh.meshletVertices[i]])
+                {
+                    if (used[t])
+                        continue;
+                    const int score = newVertices(t);
+                    if (score < bestScore)
+                    {
+                        best = t;
+                        bestScore = score;
+                        if (score == 0)
+                            break;
+                    }
+                }
+            }
+            if (bestScore == 4 || m.vertexCount + bestScore > maxVertices)
+                break;
+            addTriangle(best);
+        }
+
+        for (std::uint32_t i = 0; i < m.vertexCount; ++i)
+            localIndex[mesh.meshletVertices[m.vertexOffset + i]] = -1;
+        mesh.meshlets.push_back(m);
+    }
+
+    for (Meshlet& m : mesh.meshlets)
+        meshlet_detail::computeBounds(vertices, mesh, m);
+    return mesh;
+}
+
+// Meshlet triangles uploaded as one element buffer, drawn with glMultiDrawElements
+struct MeshletBuffer
+{
+    GLuint EBO = 0;
+    std::vector<Meshlet> meshlets;
+};
+
+inline MeshletBuffer uploadMeshlets(const MeshletMesh& mesh)
+{
+    MeshletBuffer buffer;
+    buffer.meshlets = mesh.meshlets;
+    glGenBuffers(1, &buffer.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+    return buffer;
+}
+
+// Surviving clusters of one cull pass, ready for glMultiDrawElements
+struct MeshletDrawList
+{
+    std::vector<GLsizei> counts;
+    std::vector<const GLvoid*> offsets;
+    std::size_t tested = 0;
+    std::size_t frustumCulled = 0;
+    std::size_t backfaceCulled = 0;
+
+    void clear()
+    {
+        counts.clear();
+        offsets.clear();
+        tested = frustumCulled = backfaceCulled = 0;
+    }
+
+    GLsizei drawCount() const { return static_cast<GLsizei>(counts.size()); }
+};
+
+// Frustum and normal-cone test for every cluster of a mesh placed with `model`.
+// Only valid for meshes whose triangles are wound consistently outward.
+inline void cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model, const Frustum& frustum,
+    const glm::vec3& cameraPos, MeshletDrawList& out)
+{
+    const glm::mat3 linear(model);
+    const float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+
+    for (const Meshlet& m : meshlets)
+    {
+        ++out.tested;
+        const glm::vec3 center = glm::vec3(model * glm::vec4(m.center, 1.0f));
+        if (!frustum.intersectsSphere(center, m.radius * scale))
+        {
+            ++out.frustumCulled;
+            continue;
+        }
+
+        if (m.coneCutoff < 1.0f)
+        {
+            const glm::vec3 apex = glm::vec3(model * glm::vec4(m.coneApex, 1.0f));
+            const glm::vec3 axis = glm::normalize(linear * m.coneAxis);
+            if (glm::dot(glm::normalize(apex - cameraPos), axis) >= m.coneCutoff)
+            {
+                ++out.backfaceCulled;
+                continue;
+            }
+        }
+
+        out.counts.push_back(static_cast<GLsizei>(m.triangleCount * 3));
+        out.offsets.push_back((const GLvoid*)(static_cast<std::size_t>(m.firstIndex) * sizeof(GLuint)));
+    }
+}
+
+#endif
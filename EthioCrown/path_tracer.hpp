@@ -0,0 +1,567 @@
+#ifndef PATH_TRACER_HPP
+#define PATH_TRACER_HPP
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "bvh.hpp"
+#include "job_system.hpp"
+
+// Offline path tracer for stills of the crown. The scene is flattened into one world-space
+// BVH; every pass adds one sample to each pixel, tiles are shared out to all cores and
+// each tile traces small pixel blocks as ray packets. The crown is metallic GGX gold lit by
+// a sun (sampled directly) and a sky gradient.
+
+constexpr int TRACE_TILE_SIZE = 32;
+constexpr int TRACE_MAX_DEPTH = 8;
+constexpr int TRACE_RUSSIAN_ROULETTE_DEPTH = 3; // Paths may stop randomly after this many bounces
+constexpr float TRACE_RAY_OFFSET = 1e-4f;       // Pushes secondary rays off the surface
+constexpr float TRACE_INDIRECT_CLAMP = 4.0f;    // Caps bounced light per sample, trades a little bias for no fireflies
+constexpr float TRACE_PI = 3.14159265359f;
+
+// Pixel block traced as one packet: 4x2 with AVX, 2x2 otherwise
+constexpr int TRACE_BLOCK_HEIGHT = 2;
+constexpr int TRACE_BLOCK_WIDTH = BVH_PACKET_SIZE / TRACE_BLOCK_HEIGHT;
+
+struct TraceMaterial
+{
+    glm::vec3 baseColor;  // Albedo for dielectrics, F0 for metals
+    float metallic;       // 0 Lambert, 1 GGX conductor
+    float roughness;      // Perceptual, alpha = roughness^2
+};
+
+// Measured reflectance of gold at normal incidence
+inline TraceMaterial goldMaterial(float roughness = 0.25f)
+{
+    return { glm::vec3(1.0f, 0.766f, 0.336f), 1.0f, roughness };
+}
+
+struct TraceScene
+{
+    std::vector<glm::vec3> positions;              // Three per triangle, world space
+    std::vector<std::uint32_t> triangleMaterials;
+    std::vector<TraceMaterial> materials;
+    Bvh bvh;
+
+    std::uint32_t addMaterial(const TraceMaterial& material)
+    {
+        materials.push_back(material);
+        return static_cast<std::uint32_t>(materials.size() - 1);
+    }
+
+    // Indexed triangles with interleaved x,y,z,u,v vertices
+    template <typename Index>
+    void addMesh(const float* vertices, const Index* indices, std::size_t indexCount, const glm::mat4& model, std::uint32_t material)
+    {
+        for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const float* v = vertices + indices[i + k] * 5;
+                positions.push_back(glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f)));
+            }
+            triangleMaterials.push_back(material);
+        }
+    }
+
+    // Horizontal square centred on `center`
+    void addGround(const glm::vec3& center, float halfSize, std::uint32_t material)
+    {
+        const glm::vec3 a = center + glm::vec3(-halfSize, 0.0f, -halfSize), b = center + glm::vec3(halfSize, 0.0f, -halfSize);
+        const glm::vec3 c = center + glm::vec3(halfSize, 0.0f, halfSize), d = center + glm::vec3(-halfSize, 0.0f, halfSize);
+        positions.insert(positions.end(), { a, d, c, a, c, b });
+        triangleMaterials.insert(triangleMaterials.end(), { material, material });
+    }
+
+    void build() { bvh.build(positions); }
+
+    std::size_t triangleCount() const { return triangleMaterials.size(); }
+};
+
+struct TraceLighting
+{
+    glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 1.0f, 0.7f)); // Towards the sun
+    glm::vec3 sunRadiance = glm::vec3(3.0f, 2.9f, 2.7f);
+    glm::vec3 skyZenith = glm::vec3(0.25f, 0.4f, 0.75f);
+    glm::vec3 skyHorizon = glm::vec3(0.85f, 0.85f, 0.9f);
+    glm::vec3 groundColor = glm::vec3(0.15f, 0.13f, 0.12f);
+    float exposure = 1.0f;
+};
+
+struct TraceStats
+{
+    std::uint64_t samples = 0; // Pixel samples (camera paths)
+    std::uint64_t rays = 0;    // Extension and shadow rays
+    double seconds = 0.0;
+
+    double samplesPerSecond() const { return seconds > 0.0 ? samples / seconds : 0.0; }
+    double raysPerSecond() const { return seconds > 0.0 ? rays / seconds : 0.0; }
+
+    TraceStats& operator+=(const TraceStats& other)
+    {
+        samples += other.samples;
+        rays += other.rays;
+        seconds += other.seconds;
+        return *this;
+    }
+};
+
+namespace trace_detail
+{
+    // PCG hash, one stream per pixel and pass so the image does not depend on the thread count
+    inline std::uint32_t hash(std::uint32_t x)
+    {
+        const std::uint32_t state = x * 747796405u + 2891336453u;
+        const std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    struct Rng
+    {
+        std::uint32_t state;
+        float next()
+        {
+            state = hash(state);
+            return (state >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    inline int bitCount(int mask)
+    {
+        int count = 0;
+        for (; mask; mask &= mask - 1)
+            ++count;
+        return count;
+    }
+
+    // Tangent frame around a unit normal (Duff et al. 2017)
+    inline void basis(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+    {
+        const float sign = std::copysign(1.0f, n.z);
+        const float a = -1.0f / (sign + n.z);
+        const float c = n.x * n.y * a;
+        t = glm::vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+        b = glm::vec3(c, sign + n.y * n.y * a, -n.y);
+    }
+
+    inline glm::vec3 fresnelSchlick(const glm::vec3& f0, float cosTheta)
+    {
+        const float m = 1.0f - cosTheta;
+        return f0 + (glm::vec3(1.0f) - f0) * (m * m * m * m * m);
+    }
+
+    inline float ggxD(float NoH, float alpha2)
+    {
+        const float d = NoH * NoH * (alpha2 - 1.0f) + 1.0f;
+        return alpha2 / (TRACE_PI * d * d);
+    }
+
+    // Smith masking for one direction
+    inline float ggxG1(float NoX, float alpha2)
+    {
+        return 2.0f * NoX / (NoX + std::sqrt(alpha2 + (1.0f - alpha2) * NoX * NoX));
+    }
+
+    inline glm::vec3 evalBrdf(const TraceMaterial& m, const glm::vec3& n, const glm::vec3& V, const glm::vec3& L)
+    {
+        if (m.metallic < 0.5f)
+            return m.baseColor * (1.0f / TRACE_PI);
+
+        const float NoV = glm::dot(n, V), NoL = glm::dot(n, L);
+        if (NoV <= 0.0f || NoL <= 0.0f)
+            return glm::vec3(0.0f);
+        const glm::vec3 H = glm::normalize(V + L);
+        const float alpha = std::max(m.roughness * m.roughness, 1e-3f);
+        const float alpha2 = alpha * alpha;
+        const float D = ggxD(std::max(glm::dot(n, H), 0.0f), alpha2);
+        const float G = ggxG1(NoV, alpha2) * ggxG1(NoL, alpha2);
+        return fresnelSchlick(m.baseColor, std::max(glm::dot(V, H), 0.0f)) * (D * G / (4.0f * NoV * NoL));
+    }
+
+    // Importance sample the BRDF. Metals sample visible normals (Heitz 2018), so the weight is
+    // just F * G1(L); Lambert uses a cosine lobe with weight = albedo.
+    inline bool sampleBrdf(const TraceMaterial& m, const glm::vec3& n, const glm::vec3& V, Rng& rng, glm::vec3& L, glm::vec3& weight)
+    {
+        glm::vec3 t, b;
+        basis(n, t, b);
+        const float u1 = rng.next(), u2 = rng.next();
+
+        if (m.metallic < 0.5f)
+        {
+            const float r = std::sqrt(u1), phi = 2.0f * TRACE_PI * u2;
+            L = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u1));
+            weight = m.baseColor;
+            return true;
+        }
+
+        const float alpha = std::max(m.roughness * m.roughness, 1e-3f);
+        const glm::vec3 v(glm::dot(V, t), glm::dot(V, b), glm::dot(V, n));
+        if (v.z <= 0.0f)
+            return false;
+
+        const glm::vec3 vh = glm::normalize(glm::vec3(alpha * v.x, alpha * v.y, v.z));
+        const float lengthSquared = vh.x * vh.x + vh.y * vh.y;
+        const glm::vec3 t1 = lengthSquared > 0.0f ? glm::vec3(-vh.y, vh.x, 0.0f) / std::sqrt(lengthSquared) : glm::vec3(1.0f, 0.0f, 0.0f);
+        const glm::vec3 t2 = glm::cross(vh, t1);
+        const float r = std::sqrt(u1), phi = 2.0f * TRACE_PI * u2;
+        const float p1 = r * std::cos(phi);
+        const float s = 0.5f * (1.0f + vh.z);
+        const float p2 = (1.0f - s) * std::sqrt(std::max(0.0f, 1.0f - p1 * p1)) + s * r * std::sin(phi);
+        const glm::vec3 nh = t1 * p1 + t2 * p2 + vh * std::sqrt(std::max(0.0f, 1.0f - p1 * p1 - p2 * p2));
+        const glm::vec3 h = glm::normalize(glm::vec3(alpha * nh.x, alpha * nh.y, std::max(0.0f, nh.z)));
+
+        const glm::vec3 l = glm::reflect(-v, h);
+        if (l.z <= 0.0f)
+            return false;
+        L = t * l.x + b * l.y + n * l.z;
+        weight = fresnelSchlick(m.baseColor, std::max(glm::dot(v, h), 0.0f)) * ggxG1(l.z, alpha * alpha);
+        return true;
+    }
+
+    // Narkowicz ACES fit, then display gamma
+    inline std::uint8_t toDisplay(float x)
+    {
+        x = std::max(x, 0.0f);
+        x = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+        x = std::pow(std::min(x, 1.0f), 1.0f / 2.2f);
+        return static_cast<std::uint8_t>(x * 255.0f + 0.5f);
+    }
+}
+
+class PathTracer
+{
+public:
+    // Passes run on `jobs`, one tile-pulling job per thread it has
+    PathTracer(const TraceScene& traceScene, int w, int h, JobSystem& jobs)
+        : scene(traceScene), jobs(jobs), width(w), height(h), workerCount(jobs.threadCount()),
+          accumulation(static_cast<std::size_t>(w) * h, glm::vec3(0.0f))
+    {
+        normals.reserve(scene.triangleCount());
+        for (std::size_t i = 0; i < scene.triangleCount(); ++i)
+        {
+            const glm::vec3& p0 = scene.positions[i * 3];
+            const glm::vec3 n = glm::cross(scene.positions[i * 3 + 1] - p0, scene.positions[i * 3 + 2] - p0);
+            const float length = glm::length(n);
+            normals.push_back(length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        setCamera(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 45.0f);
+    }
+
+    // Any camera or lighting change restarts accumulation
+    void setCamera(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up, float fovYDegrees)
+    {
+        cameraPosition = position;
+        cameraForward = glm::normalize(target - position);
+        cameraRight = glm::normalize(glm::cross(cameraForward, up));
+        cameraUp = glm::cross(cameraRight, cameraForward);
+        tanHalfFov = std::tan(glm::radians(fovYDegrees) * 0.5f);
+        reset();
+    }
+
+    void setLighting(const TraceLighting& traceLighting)
+    {
+        lighting = traceLighting;
+        lighting.sunDirection = glm::normalize(lighting.sunDirection);
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(accumulation.begin(), accumulation.end(), glm::vec3(0.0f));
+        passes = 0;
+    }
+
+    // One more sample in every pixel
+    TraceStats renderPass()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const int tilesX = (width + TRACE_TILE_SIZE - 1) / TRACE_TILE_SIZE;
+        const int tileCount = tilesX * ((height + TRACE_TILE_SIZE - 1) / TRACE_TILE_SIZE);
+
+        std::atomic<int> nextTile(0);
+        std::vector<std::uint64_t> rayCounts(workerCount, 0);
+        jobs.parallelFor(workerCount, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t worker = first; worker < last; ++worker)
+                for (int tile = nextTile++; tile < tileCount; tile = nextTile++)
+                    rayCounts[worker] += traceTile((tile % tilesX) * TRACE_TILE_SIZE, (tile / tilesX) * TRACE_TILE_SIZE);
+        });
+        ++passes;
+
+        TraceStats stats;
+        stats.samples = static_cast<std::uint64_t>(width) * height;
+        for (std::uint64_t count : rayCounts)
+            stats.rays += count;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+
+    // Sample-limited: stop after a fixed number of samples per pixel
+    TraceStats renderSamples(int samplesPerPixel)
+    {
+        TraceStats total;
+        while (passes < samplesPerPixel)
+            total += renderPass();
+        return total;
+    }
+
+    // Time-limited: keep adding whole passes until the budget is spent (at least one pass)
+    TraceStats renderFor(double seconds, int maxSamplesPerPixel = INT_MAX)
+    {
+        TraceStats total;
+        const auto start = std::chrono::steady_clock::now();
+        do
+            total += renderPass();
+        while (passes < maxSamplesPerPixel &&
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds);
+        return total;
+    }
+
+    int samplesPerPixel() const { return passes; }
+    unsigned threads() const { return workerCount; }
+
+    // Tonemapped RGB8, top row first
+    std::vector<std::uint8_t> toRgb8() const
+    {
+        std::vector<std::uint8_t> rgb(accumulation.size() * 3);
+        const float scale = passes > 0 ? lighting.exposure / passes : 0.0f;
+        for (std::size_t i = 0; i < accumulation.size(); ++i)
+            for (int c = 0; c < 3; ++c)
+                rgb[i * 3 + c] = trace_detail::toDisplay(accumulation[i][c] * scale);
+        return rgb;
+    }
+
+    // Binary PPM (P6)
+    bool writePpm(const char* path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        const std::vector<std::uint8_t> rgb = toRgb8();
+        file << "P6\n" << width << " " << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+        return static_cast<bool>(file);
+    }
+
+    // Primary ray through a point of the image plane, (0,0) is the top-left corner
+    Ray primaryRay(float x, float y) const
+    {
+        const float aspect = static_cast<float>(width) / static_cast<float>(height);
+        const float px = (2.0f * x / width - 1.0f) * tanHalfFov * aspect;
+        const float py = (1.0f - 2.0f * y / height) * tanHalfFov;
+        Ray ray;
+        ray.origin = cameraPosition;
+        ray.direction = glm::normalize(cameraForward + cameraRight * px + cameraUp * py);
+        return ray;
+    }
+
+private:
+    glm::vec3 sky(const glm::vec3& direction) const
+    {
+        if (direction.y < 0.0f)
+            return lighting.groundColor;
+        return glm::mix(lighting.skyHorizon, lighting.skyZenith, std::sqrt(direction.y));
+    }
+
+    static glm::vec3 clampIndirect(const glm::vec3& value, int depth)
+    {
+        return depth == 0 ? value : glm::min(value, glm::vec3(TRACE_INDIRECT_CLAMP));
+    }
+
+    // Returns the number of rays traced
+    std::uint64_t traceTile(int tileX, int tileY)
+    {
+        std::uint64_t rays = 0;
+        const int endX = std::min(tileX + TRACE_TILE_SIZE, width);
+        const int endY = std::min(tileY + TRACE_TILE_SIZE, height);
+        for (int y = tileY; y < endY; y += TRACE_BLOCK_HEIGHT)
+            for (int x = tileX; x < endX; x += TRACE_BLOCK_WIDTH)
+                rays += tracePacket(x, y, endX, endY);
+        return rays;
+    }
+
+    // Follows one path per lane of a pixel block, bounce by bounce. Every bounce traces the
+    // extension rays of all live lanes as one packet and the sun shadow rays as another.
+    std::uint64_t tracePacket(int blockX, int blockY, int endX, int endY)
+    {
+        using namespace trace_detail;
+        int pixel[BVH_PACKET_SIZE];
+        Rng rng[BVH_PACKET_SIZE];
+        glm::vec3 throughput[BVH_PACKET_SIZE], radiance[BVH_PACKET_SIZE], sunContribution[BVH_PACKET_SIZE];
+        RayPacket rays;
+        int alive = 0;
+
+        for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+        {
+            const int x = blockX + lane % TRACE_BLOCK_WIDTH;
+            const int y = blockY + lane / TRACE_BLOCK_WIDTH;
+            if (x >= endX || y >= endY)
+                continue;
+            pixel[lane] = y * width + x;
+            rng[lane].state = hash(static_cast<std::uint32_t>(pixel[lane]) ^ hash(static_cast<std::uint32_t>(passes) + 0x9E3779B9u));
+            throughput[lane] = glm::vec3(1.0f);
+            radiance[lane] = glm::vec3(0.0f);
+            const float jitterX = rng[lane].next(), jitterY = rng[lane].next();
+            rays.set(lane, primaryRay(x + jitterX, y + jitterY));
+            alive |= 1 << lane;
+        }
+        const int used = alive;
+
+        std::uint64_t rayCount = 0;
+        for (int depth = 0; depth < TRACE_MAX_DEPTH && alive; ++depth)
+        {
+            rays.active = alive;
+            scene.bvh.intersect(rays);
+            rayCount += bitCount(alive);
+
+            RayPacket shadows;
+            for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+            {
+                if (!((alive >> lane) & 1))
+                    continue;
+                const glm::vec3 direction(rays.directionX[lane], rays.directionY[lane], rays.directionZ[lane]);
+                if (rays.triangle[lane] == BVH_NO_HIT)
+                {
+                    radiance[lane] += clampIndirect(throughput[lane] * sky(direction), depth);
+                    alive &= ~(1 << lane);
+                    continue;
+                }
+
+                const std::uint32_t triangle = rays.triangle[lane];
+                const TraceMaterial& material = scene.materials[scene.triangleMaterials[triangle]];
+                const glm::vec3 position = glm::vec3(rays.originX[lane], rays.originY[lane], rays.originZ[lane]) + direction * rays.tMax[lane];
+                glm::vec3 n = normals[triangle];
+                if (glm::dot(n, direction) > 0.0f)
+                    n = -n;
+                const glm::vec3 V = -direction;
+                const glm::vec3 origin = position + n * TRACE_RAY_OFFSET;
+
+                // Sun, sampled directly since a delta light is never hit by chance
+                const float NoL = glm::dot(n, lighting.sunDirection);
+                if (NoL > 0.0f)
+                {
+                    sunContribution[lane] = throughput[lane] * evalBrdf(material, n, V, lighting.sunDirection) * lighting.sunRadiance * NoL;
+                    Ray shadow;
+                    shadow.origin = origin;
+                    shadow.direction = lighting.sunDirection;
+                    shadows.set(lane, shadow);
+                }
+
+                glm::vec3 L, weight;
+                if (!sampleBrdf(material, n, V, rng[lane], L, weight))
+                {
+                    alive &= ~(1 << lane);
+                    continue;
+                }
+                throughput[lane] *= weight;
+
+                if (depth >= TRACE_RUSSIAN_ROULETTE_DEPTH)
+                {
+                    const float survive = std::min(std::max(throughput[lane].x, std::max(throughput[lane].y, throughput[lane].z)), 0.95f);
+                    if (rng[lane].next() >= survive)
+                    {
+                        alive &= ~(1 << lane);
+                        continue;
+                    }
+                    throughput[lane] /= survive;
+                }
+
+                Ray next;
+                next.origin = origin;
+                next.direction = L;
+                rays.set(lane, next);
+            }
+
+            if (shadows.active)
+            {
+                const int blocked = scene.bvh.occluded(shadows);
+                rayCount += bitCount(shadows.active);
+                for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+                    if (((shadows.active & ~blocked) >> lane) & 1)
+                        radiance[lane] += clampIndirect(sunContribution[lane], depth);
+            }
+        }
+
+        for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+            if ((used >> lane) & 1)
+                accumulation[pixel[lane]] += radiance[lane];
+        return rayCount;
+    }
+
+    const TraceScene& scene;
+    JobSystem& jobs;
+    int width;
+    int height;
+    unsigned workerCount;
+    std::vector<glm::vec3> accumulation; // Radiance sums, top row first
+    std::vector<glm::vec3> normals;      // Per triangle
+    int passes = 0;
+    TraceLighting lighting;
+    glm::vec3 cameraPosition, cameraForward, cameraRight, cameraUp;
+    float tanHalfFov = 1.0f;
+};
+
+// Name of the packet kernel this build uses
+inline const char* traceKernelName()
+{
+#if defined(CROWN_BVH_AVX)
+    return "AVX (8-ray packets)";
+#elif defined(CROWN_BVH_SSE)
+    return "SSE2 (4-ray packets)";
+#else
+    return "scalar (4-ray packets)";
+#endif
+}
+
+// Primary-ray traversal (single rays against packets) and progressive render throughput
+inline void runTraceBenchmark(PathTracer& tracer, const TraceScene& scene, int width, int height, int samplesPerPixel)
+{
+    std::cout << "trace: " << scene.triangleCount() << " triangles, " << scene.bvh.nodeList().size() << " BVH nodes ("
+              << scene.bvh.treeDepth() << " deep), " << traceKernelName() << ", " << tracer.threads() << " threads" << std::endl;
+
+    std::uint64_t singleHits = 0, packetHits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            RayHit hit;
+            singleHits += scene.bvh.intersect(tracer.primaryRay(x + 0.5f, y + 0.5f), hit);
+        }
+    const double singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int y = 0; y < height; y += TRACE_BLOCK_HEIGHT)
+        for (int x = 0; x < width; x += TRACE_BLOCK_WIDTH)
+        {
+            RayPacket packet;
+            for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+            {
+                const int px = x + lane % TRACE_BLOCK_WIDTH, py = y + lane / TRACE_BLOCK_WIDTH;
+                if (px < width && py < height)
+                    packet.set(lane, tracer.primaryRay(px + 0.5f, py + 0.5f));
+            }
+            scene.bvh.intersect(packet);
+            for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+                packetHits += ((packet.active >> lane) & 1) && packet.triangle[lane] != BVH_NO_HIT;
+        }
+    const double packetSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double primaryRays = static_cast<double>(width) * height;
+    std::cout << "primary rays, single: " << primaryRays / singleSeconds * 1e-6 << " Mrays/s, packets: "
+              << primaryRays / packetSeconds * 1e-6 << " Mrays/s (" << singleHits << "/" << packetHits << " hits)" << std::endl;
+
+    tracer.reset();
+    const TraceStats stats = tracer.renderSamples(samplesPerPixel);
+    std::cout << "path tracing " << width << "x" << height << " at " << samplesPerPixel << " spp: "
+              << stats.samplesPerSecond() * 1e-6 << " Msamples/s, " << stats.raysPerSecond() * 1e-6 << " Mrays/s, "
+              << stats.seconds << " s" << std::endl;
+}
+
+#endif
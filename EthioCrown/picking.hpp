@@ -0,0 +1,242 @@
+#ifndef PICKING_HPP
+#define PICKING_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "bvh.hpp"
+
+// Ray picking of crown parts. Every distinct mesh owns a BVH in its own object space; an
+// instance pairs a mesh with a model matrix, so the ray is moved into object space instead
+// of rebuilding trees when parts move. Changing a mesh's parameters without changing its
+// topology only refits its tree.
+
+struct PickResult
+{
+    bool hit = false;
+    int instance = -1;
+    int part = -1;                       // Caller-defined id given to addInstance
+    std::uint32_t triangle = BVH_NO_HIT; // Triangle within the instance's mesh
+    glm::vec3 position = glm::vec3(0.0f); // World space
+    float distance = 0.0f;               // Along the normalised world ray
+};
+
+class Picker
+{
+public:
+    // Indexed triangles with interleaved x,y,z,u,v vertices, returns the mesh id
+    template <typename Index>
+    int addMesh(const float* vertices, const Index* indices, std::size_t indexCount)
+    {
+        meshes.emplace_back();
+        Mesh& mesh = meshes.back();
+        mesh.indices.assign(indices, indices + indexCount);
+        gather(mesh, vertices);
+        mesh.bvh.build(mesh.positions);
+        return static_cast<int>(meshes.size() - 1);
+    }
+
+    // Vertices moved but the triangles are the same (e.g. a radius or height changed)
+    void updateMesh(int meshId, const float* vertices)
+    {
+        Mesh& mesh = meshes[meshId];
+        gather(mesh, vertices);
+        mesh.bvh.refit(mesh.positions);
+        for (Instance& instance : instances)
+            if (instance.mesh == meshId)
+                updateBounds(instance);
+    }
+
+    int addInstance(int meshId, const glm::mat4& model, int part)
+    {
+        Instance instance;
+        instance.mesh = meshId;
+        instance.part = part;
+        instances.push_back(instance);
+        setTransform(static_cast<int>(instances.size() - 1), model);
+        return static_cast<int>(instances.size() - 1);
+    }
+
+    void setTransform(int instanceId, const glm::mat4& model)
+    {
+        Instance& instance = instances[instanceId];
+        instance.model = model;
+        instance.inverseModel = glm::inverse(model);
+        updateBounds(instance);
+    }
+
+    // World ray through a cursor position in window coordinates (origin top-left)
+    static Ray cursorRay(double cursorX, double cursorY, int viewportWidth, int viewportHeight,
+        const glm::mat4& view, const glm::mat4& projection)
+    {
+        const float x = static_cast<float>(2.0 * cursorX / viewportWidth - 1.0);
+        const float y = static_cast<float>(1.0 - 2.0 * cursorY / viewportHeight);
+        const glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        const glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+        const glm::vec4 farPoint = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+
+        Ray ray;
+        ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+        ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+        return ray;
+    }
+
+    // Closest instance along a world ray
+    PickResult pick(const Ray& worldRay) const
+    {
+        PickResult result;
+        const glm::vec3 invDir = 1.0f / worldRay.direction;
+        float closest = worldRay.tMax;
+
+        for (std::size_t i = 0; i < instances.size(); ++i)
+        {
+            const Instance& instance = instances[i];
+            if (!hitsBox(instance.worldMin, instance.worldMax, worldRay.origin, invDir, worldRay.tMin, closest))
+                continue;
+
+            // Unnormalised object-space direction keeps t in world units
+            Ray local;
+            local.origin = glm::vec3(instance.inverseModel * glm::vec4(worldRay.origin, 1.0f));
+            local.direction = glm::vec3(instance.inverseModel * glm::vec4(worldRay.direction, 0.0f));
+            local.tMin = worldRay.tMin;
+            local.tMax = closest;
+
+            RayHit hit;
+            if (meshes[instance.mesh].bvh.intersect(local, hit))
+            {
+                closest = hit.t;
+                result.hit = true;
+                result.instance = static_cast<int>(i);
+                result.part = instance.part;
+                result.triangle = hit.triangle;
+                result.distance = hit.t;
+            }
+        }
+        if (result.hit)
+            result.position = worldRay.origin + worldRay.direction * result.distance;
+        return result;
+    }
+
+    std::size_t meshTriangleCount(int meshId) const { return meshes[meshId].bvh.triangleCount(); }
+
+private:
+    struct Mesh
+    {
+        std::vector<std::uint32_t> indices;
+        std::vector<glm::vec3> positions; // Three per triangle
+        Bvh bvh;
+    };
+
+    struct Instance
+    {
+        int mesh = 0;
+        int part = 0;
+        glm::mat4 model = glm::mat4(1.0f);
+        glm::mat4 inverseModel = glm::mat4(1.0f);
+        glm::vec3 worldMin = glm::vec3(0.0f);
+        glm::vec3 worldMax = glm::vec3(0.0f);
+    };
+
+    static void gather(Mesh& mesh, const float* vertices)
+    {
+        mesh.positions.resize(mesh.indices.size());
+        for (std::size_t i = 0; i < mesh.indices.size(); ++i)
+        {
+            const float* v = vertices + mesh.indices[i] * 5;
+            mesh.positions[i] = glm::vec3(v[0], v[1], v[2]);
+        }
+    }
+
+    // World box of the mesh's root bounds (Arvo's method)
+    void updateBounds(Instance& instance) const
+    {
+        const BvhNode& root = meshes[instance.mesh].bvh.nodeList()[0];
+        const glm::vec3 center = (root.min + root.max) * 0.5f;
+        const glm::vec3 extent = (root.max - root.min) * 0.5f;
+        const glm::vec3 worldCenter = glm::vec3(instance.model * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtent(0.0f);
+        for (int axis = 0; axis < 3; ++axis)
+            for (int k = 0; k < 3; ++k)
+                worldExtent[axis] += std::abs(instance.model[k][axis]) * extent[k];
+        instance.worldMin = worldCenter - worldExtent;
+        instance.worldMax = worldCenter + worldExtent;
+    }
+
+    static bool hitsBox(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax)
+    {
+        const glm::vec3 t0 = (lo - origin) * invDir;
+        const glm::vec3 t1 = (hi - origin) * invDir;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        return std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin)) <=
+               std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    }
+
+    std::vector<Mesh> meshes;
+    std::vector<Instance> instances;
+};
+
+// Build, refit and pick latency on a procedural ornament of about a million triangles
+inline void runPickBenchmark(int rings = 708, int segments = 708, int picks = 10000)
+{
+    std::vector<float> vertices;
+    std::vector<std::uint32_t> indices;
+    auto buildTorus = [&](float majorRadius, float minorRadius)
+    {
+        vertices.clear();
+        for (int r = 0; r <= rings; ++r)
+            for (int s = 0; s <= segments; ++s)
+            {
+                const float u = static_cast<float>(r) / rings, v = static_cast<float>(s) / segments;
+                const float a = u * 6.28318530718f, b = v * 6.28318530718f;
+                // Knurled surface so the tree is not trivially flat
+                const float minor = minorRadius * (1.0f + 0.05f * std::sin(b * 24.0f) * std::sin(a * 48.0f));
+                vertices.insert(vertices.end(), {
+                    (majorRadius + minor * std::cos(b)) * std::cos(a), minor * std::sin(b),
+                    (majorRadius + minor * std::cos(b)) * std::sin(a), u, v });
+            }
+    };
+    buildTorus(1.0f, 0.25f);
+    for (int r = 0; r < rings; ++r)
+        for (int s = 0; s < segments; ++s)
+        {
+            const std::uint32_t i0 = r * (segments + 1) + s, i1 = i0 + segments + 1;
+            indices.insert(indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+        }
+
+    Picker picker;
+    auto start = std::chrono::steady_clock::now();
+    const int mesh = picker.addMesh(vertices.data(), indices.data(), indices.size());
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    picker.addInstance(mesh, glm::mat4(1.0f), 0);
+
+    buildTorus(1.1f, 0.3f);
+    start = std::chrono::steady_clock::now();
+    picker.updateMesh(mesh, vertices.data());
+    const double refitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> cursorX(0.0, 800.0), cursorY(0.0, 600.0);
+    std::vector<Ray> rays(picks);
+    for (Ray& ray : rays)
+        ray = Picker::cursorRay(cursorX(rng), cursorY(rng), 800, 600, view, projection);
+
+    int hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (const Ray& ray : rays)
+        hits += picker.pick(ray).hit;
+    const double pickUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / picks;
+
+    std::cout << "pick: " << picker.meshTriangleCount(mesh) << " triangles, build " << buildMs << " ms, refit "
+              << refitMs << " ms, " << pickUs << " us/pick (" << hits << "/" << picks << " hits)" << std::endl;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Two-slot handoff between the thread that builds frames and the thread that submits them.
+// The producer fills one slot while the consumer draws from the other, so building frame
+// N+1 overlaps submitting frame N; the producer blocks only when it is two frames ahead.
+template <typename Packet>
+class FrameExchange
+{
+public:
+    // Slot for the next frame, waits while the consumer still reads it. Null once closed.
+    Packet* beginWrite()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return closed || state[writeSlot] == SLOT_FREE; });
+        return closed ? nullptr : &slots[writeSlot];
+    }
+
+    // Hand the slot from beginWrite() over, it must not be touched afterwards
+    void publish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            state[writeSlot] = SLOT_READY;
+            writeSlot ^= 1;
+        }
+        changed.notify_all();
+    }
+
+    // Oldest published frame, waits for one. Null once closed and drained.
+    const Packet* acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return closed || state[readSlot] == SLOT_READY; });
+        if (state[readSlot] != SLOT_READY)
+            return nullptr;
+        state[readSlot] = SLOT_READING;
+        return &slots[readSlot];
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            state[readSlot] = SLOT_FREE;
+            readSlot ^= 1;
+        }
+        changed.notify_all();
+    }
+
+    // Wake both sides; frames already published are still handed out
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        changed.notify_all();
+    }
+
+private:
+    enum SlotState { SLOT_FREE, SLOT_READY, SLOT_READING };
+
+    Packet slots[2];
+    SlotState state[2] = { SLOT_FREE, SLOT_FREE };
+    int writeSlot = 0;
+    int readSlot = 0;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+// Owns the window's GL context while running: every submitted packet is drawn by
+// `renderFrame` on this thread and presented. Events must still be polled by the thread
+// that created the window.
+template <typename Packet>
+class RenderThread
+{
+public:
+    ~RenderThread() { stop(); }
+
+    void start(GLFWwindow* target, std::function<void(const Packet&)> renderFrame)
+    {
+        window = target;
+        render = std::move(renderFrame);
+        glfwMakeContextCurrent(nullptr);
+        thread = std::thread([this]()
+        {
+            glfwMakeContextCurrent(window);
+            while (const Packet* packet = frames.acquire())
+            {
+                render(*packet);
+                glfwSwapBuffers(window);
+                frames.release();
+            }
+            glfwMakeContextCurrent(nullptr);
+        });
+    }
+
+    // Producer side: fill the returned packet, then submit it
+    Packet* beginFrame() { return frames.beginWrite(); }
+    void submitFrame() { frames.publish(); }
+
+    // Draw what was already submitted, join, and give the context back to the caller
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        frames.close();
+        thread.join();
+        glfwMakeContextCurrent(window);
+    }
+
+private:
+    FrameExchange<Packet> frames;
+    std::function<void(const Packet&)> render;
+    GLFWwindow* window = nullptr;
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,1012 @@
+#ifndef SELF_TEST_HPP
+#define SELF_TEST_HPP
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "asset_pack.hpp"
+#include "baked_mesh.hpp"
+#include "block_compress.hpp"
+#include "bvh.hpp"
+#include "frustum_cull.hpp"
+#include "image_scale.hpp"
+#include "job_system.hpp"
+#include "ktx2.hpp"
+#include "texture_cache.hpp"
+#include "texture_streaming.hpp"
+
+// Deterministic checks of the renderer's pure functions, run with --self-test. Nothing here
+// needs a window or a GL context; inputs come from a fixed-seed generator so every run and
+// every standard library sees the same data. A failed check prints its test, line and
+// expression, and the mode exits nonzero if any failed.
+
+class SelfTest
+{
+public:
+    explicit SelfTest(const char* name) : name(name) {}
+
+    void check(bool condition, const char* expression, int line)
+    {
+        ++checks;
+        if (condition)
+            return;
+        ++failures;
+        std::cerr << name << ":" << line << ": check failed: " << expression << std::endl;
+    }
+
+    const char* name;
+    int checks = 0;
+    int failures = 0;
+};
+
+#define SELF_TEST_CHECK(test, condition) (test).check((condition), #condition, __LINE__)
+
+namespace self_test_detail
+{
+    // xorshift64*, the same sequence on every platform
+    struct Random
+    {
+        std::uint64_t state;
+
+        explicit Random(std::uint64_t seed) : state(seed ? seed : 1) {}
+
+        std::uint32_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<std::uint32_t>((state * 0x2545F4914F6CDD1Dull) >> 32);
+        }
+
+        // Uniform in [low, high)
+        float uniform(float low, float high)
+        {
+            return low + (high - low) * static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    // Moller-Trumbore against every triangle, the reference for the BVH
+    inline float bruteForceHit(const std::vector<glm::vec3>& positions, const Ray& ray)
+    {
+        float best = FLT_MAX;
+        for (std::size_t t = 0; t + 2 < positions.size(); t += 3)
+        {
+            const glm::vec3 e1 = positions[t + 1] - positions[t], e2 = positions[t + 2] - positions[t];
+            const glm::vec3 p = glm::cross(ray.direction, e2);
+            const float det = glm::dot(e1, p);
+            if (std::abs(det) < 1e-12f)
+                continue;
+            const float inv = 1.0f / det;
+            const glm::vec3 s = ray.origin - positions[t];
+            const float u = glm::dot(s, p) * inv;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            const glm::vec3 q = glm::cross(s, e1);
+            const float v = glm::dot(ray.direction, q) * inv;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            const float distance = glm::dot(e2, q) * inv;
+            if (distance > ray.tMin && distance < best)
+                best = distance;
+        }
+        return best;
+    }
+
+    // Little-endian field of a file image
+    inline void poke(std::string& bytes, std::size_t offset, std::uint64_t value, int size)
+    {
+        for (int i = 0; i < size; ++i)
+            bytes[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    // Bytes of a file written by `write(path)` to a scratch path, which is removed again
+    template <typename Write>
+    inline std::string writtenBytes(const char* name, Write write)
+    {
+        std::error_code error;
+        const std::filesystem::path path = std::filesystem::temp_directory_path(error) / name;
+        if (error || !write(path.string()))
+            return std::string();
+        std::string bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        std::filesystem::remove(path, error);
+        return bytes;
+    }
+
+    // Reference decoders for what block_compress.hpp writes, straight from the format specs.
+    // Each fills 16 row-major RGB texels and returns false for a block mode it does not cover.
+    inline bool decodeBC1(const unsigned char* block, int texels[16][3])
+    {
+        const int color0 = block[0] | (block[1] << 8), color1 = block[2] | (block[3] << 8);
+        int palette[4][3];
+        for (int i = 0; i < 2; ++i)
+        {
+            const int packed = i ? color1 : color0;
+            const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+            palette[i][0] = (r << 3) | (r >> 2);
+            palette[i][1] = (g << 2) | (g >> 4);
+            palette[i][2] = (b << 3) | (b >> 2);
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            if (color0 > color1)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        const std::uint32_t codes = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<std::uint32_t>(block[7]) << 24);
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                texels[i][c] = palette[(codes >> (2 * i)) & 3][c];
+        return true;
+    }
+
+    // Mode 6 only
+    inline bool decodeBC7(const unsigned char* block, int texels[16][3])
+    {
+        int position = 0;
+        auto read = [&](int bits)
+        {
+            int value = 0;
+            for (int i = 0; i < bits; ++i, ++position)
+                value |= ((block[position >> 3] >> (position & 7)) & 1) << i;
+            return value;
+        };
+        if (read(7) != 1 << 6)
+            return false;
+        int endpoints[2][4];
+        for (int c = 0; c < 4; ++c)
+            for (int e = 0; e < 2; ++e)
+                endpoints[e][c] = read(7);
+        for (int e = 0; e < 2; ++e)
+        {
+            const int p = read(1);
+            for (int c = 0; c < 4; ++c)
+                endpoints[e][c] = (endpoints[e][c] << 1) | p;
+        }
+        static const int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        for (int i = 0; i < 16; ++i)
+        {
+            const int index = read(i == 0 ? 3 : 4);
+            for (int c = 0; c < 3; ++c)
+                texels[i][c] = ((64 - WEIGHTS[index]) * endpoints[0][c] + WEIGHTS[index] * endpoints[1][c] + 32) >> 6;
+        }
+        return true;
+    }
+
+    // The ETC1-compatible individual and differential modes only
+    inline bool decodeETC2(const unsigned char* block, int texels[16][3])
+    {
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits = (bits << 8) | block[i];
+        const bool differential = (bits >> 33) & 1, flip = (bits >> 32) & 1;
+        int base[2][3];
+        for (int c = 0; c < 3; ++c)
+        {
+            const int byte = static_cast<int>((bits >> (56 - 8 * c)) & 0xFF);
+            if (differential)
+            {
+                const int first = byte >> 3, delta = (byte & 4) ? (byte & 7) - 8 : (byte & 7);
+                const int second = first + delta;
+                if (second < 0 || second > 31)
+                    return false; // T, H or planar mode
+                base[0][c] = (first << 3) | (first >> 2);
+                base[1][c] = (second << 3) | (second >> 2);
+            }
+            else
+            {
+                base[0][c] = (byte >> 4) * 17;
+                base[1][c] = (byte & 15) * 17;
+            }
+        }
+        static const int MODIFIERS[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+        const int tables[2] = { static_cast<int>((bits >> 37) & 7), static_cast<int>((bits >> 34) & 7) };
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+            {
+                const int half = flip ? y / 2 : x / 2;
+                const int bit = x * 4 + y;
+                const int msb = static_cast<int>((bits >> (16 + bit)) & 1), lsb = static_cast<int>((bits >> bit) & 1);
+                const int magnitude = MODIFIERS[tables[half]][lsb];
+                const int modifier = msb ? -magnitude : magnitude;
+                for (int c = 0; c < 3; ++c)
+                    texels[y * 4 + x][c] = std::min(255, std::max(0, base[half][c] + modifier));
+            }
+        return true;
+    }
+}
+
+// Closest hits and occlusion, single rays and packets, against brute force over a scene
+// with the degenerate cases SAH builds trip on: stacked triangles with one centroid, sizes
+// spread over many octaves, and ordinary scattered ones
+inline void testBvhTraversal(SelfTest& test)
+{
+    using namespace self_test_detail;
+    Random random(33);
+    std::vector<glm::vec3> positions;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const float x = std::ldexp(1.0f, -(i % 100));
+        positions.push_back(glm::vec3(x, 0.0f, 0.0f));
+        positions.push_back(glm::vec3(x, x * 1e-3f, 0.0f));
+        positions.push_back(glm::vec3(x, 0.0f, x * 1e-3f));
+    }
+    for (int i = 0; i < 500; ++i)
+    {
+        positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+        positions.push_back(glm::vec3(1.0f, 0.0f, 0.0f));
+        positions.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    for (int i = 0; i < 1500; ++i)
+    {
+        const glm::vec3 c(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f));
+        positions.push_back(c);
+        positions.push_back(c + glm::vec3(0.05f, 0.0f, 0.0f));
+        positions.push_back(c + glm::vec3(0.0f, 0.05f, 0.0f));
+    }
+
+    Bvh bvh;
+    bvh.build(positions);
+    SELF_TEST_CHECK(test, bvh.treeDepth() + 1 <= BVH_STACK_SIZE);
+
+    int hits = 0, missed = 0, wrongDistance = 0, wrongOcclusion = 0, wrongPacket = 0;
+    for (int r = 0; r < 300; ++r)
+    {
+        RayPacket packet;
+        float expected[BVH_PACKET_SIZE];
+        for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+        {
+            Ray ray;
+            ray.origin = glm::vec3(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), 3.0f);
+            ray.direction = glm::normalize(glm::vec3(random.uniform(-0.3f, 0.3f), random.uniform(-0.3f, 0.3f), -1.0f));
+            packet.set(lane, ray);
+            expected[lane] = bruteForceHit(positions, ray);
+            hits += expected[lane] < FLT_MAX;
+
+            RayHit hit;
+            const bool hitSomething = bvh.intersect(ray, hit);
+            if (hitSomething != (expected[lane] < FLT_MAX))
+                ++missed;
+            else if (hitSomething && std::abs(hit.t - expected[lane]) > 1e-5f * std::max(1.0f, expected[lane]))
+                ++wrongDistance;
+            if (bvh.occluded(ray) != (expected[lane] < FLT_MAX))
+                ++wrongOcclusion;
+        }
+        const int occludedLanes = bvh.occluded(packet);
+        bvh.intersect(packet);
+        for (int lane = 0; lane < BVH_PACKET_SIZE; ++lane)
+        {
+            const bool hitSomething = packet.triangle[lane] != BVH_NO_HIT;
+            if (hitSomething != (expected[lane] < FLT_MAX) || ((occludedLanes >> lane) & 1) != (expected[lane] < FLT_MAX) ||
+                (hitSomething && std::abs(packet.tMax[lane] - expected[lane]) > 1e-5f * std::max(1.0f, expected[lane])))
+                ++wrongPacket;
+        }
+    }
+    // Both outcomes have to be exercised
+    SELF_TEST_CHECK(test, hits > 0 && hits < 300 * BVH_PACKET_SIZE);
+    SELF_TEST_CHECK(test, missed == 0);
+    SELF_TEST_CHECK(test, wrongDistance == 0);
+    SELF_TEST_CHECK(test, wrongOcclusion == 0);
+    SELF_TEST_CHECK(test, wrongPacket == 0);
+}
+
+// Jobs start only after every dependency finished, on a pool and with no workers at all.
+// Each job of a layered graph depends on two of the layer before and records when it ran.
+inline void testJobDependencies(SelfTest& test)
+{
+    constexpr int LAYERS = 6, WIDTH = 8;
+    for (unsigned threads : { 4u, 1u })
+    {
+        JobSystem jobs(threads);
+        for (int round = 0; round < 20; ++round)
+        {
+            std::atomic<int> clock{ 0 };
+            int started[LAYERS][WIDTH] = {}, finished[LAYERS][WIDTH] = {};
+            JobHandle handles[LAYERS][WIDTH];
+            for (int layer = 0; layer < LAYERS; ++layer)
+                for (int i = 0; i < WIDTH; ++i)
+                {
+                    auto work = [&, layer, i]()
+                    {
+                        started[layer][i] = ++clock;
+                        finished[layer][i] = ++clock;
+                    };
+                    if (layer == 0)
+                        handles[layer][i] = jobs.run(work);
+                    else
+                        handles[layer][i] = jobs.run(work, { handles[layer - 1][i], handles[layer - 1][(i + 3) % WIDTH] });
+                }
+            for (int i = 0; i < WIDTH; ++i)
+                jobs.wait(handles[LAYERS - 1][i]);
+
+            int outOfOrder = 0, notRun = 0;
+            for (int layer = 0; layer < LAYERS; ++layer)
+                for (int i = 0; i < WIDTH; ++i)
+                {
+                    notRun += !handles[layer][i]->done.load() || started[layer][i] == 0;
+                    if (layer > 0 && (started[layer][i] < finished[layer - 1][i] || started[layer][i] < finished[layer - 1][(i + 3) % WIDTH]))
+                        ++outOfOrder;
+                }
+            SELF_TEST_CHECK(test, notRun == 0);
+            SELF_TEST_CHECK(test, outOfOrder == 0);
+        }
+
+        // parallelFor covers the range exactly once, also when nested in a job
+        std::vector<std::atomic<int>> visits(1000);
+        JobHandle outer = jobs.run([&]()
+        {
+            jobs.parallelFor(visits.size(), 16, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    ++visits[i];
+            });
+        });
+        jobs.wait(outer);
+        int wrong = 0;
+        for (std::atomic<int>& count : visits)
+            wrong += count.load() != 1;
+        SELF_TEST_CHECK(test, wrong == 0);
+    }
+}
+
+// Each encoder's blocks decode, by the spec, to exactly the error it reported, and stay
+// within a per-format bound: flat blocks only lose endpoint precision, and two-colour
+// blocks are no worse than their colours quantized to the endpoint format
+inline void testBlockCompression(SelfTest& test)
+{
+    using namespace self_test_detail;
+    using block_compress_detail::Block;
+    typedef bool (*Decoder)(const unsigned char*, int[16][3]);
+    const Decoder DECODERS[BLOCK_FORMAT_COUNT] = { decodeBC1, decodeBC7, decodeETC2 };
+    // Largest channel error allowed on flat and on two-colour blocks: half a step of RGB565
+    // for BC1; the shared P bit for BC7; for ETC2 the smallest modifier (there is no zero
+    // one) on top of 5-bit bases, or 4-bit ones when the halves are too far apart for the
+    // differential delta
+    const int FLAT_BOUND[BLOCK_FORMAT_COUNT] = { 4, 1, 6 };
+    const int TWO_COLOR_BOUND[BLOCK_FORMAT_COUNT] = { 4, 1, 11 };
+
+    Random random(45);
+    for (int format = 0; format < BLOCK_FORMAT_COUNT; ++format)
+    {
+        int undecodable = 0, wrongError = 0, flatOver = 0, twoColorOver = 0, worseThanMean = 0;
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            // Flat, two colours split down the middle, then noise
+            Block pixels;
+            const int kind = trial % 3;
+            unsigned char colors[2][3];
+            for (int k = 0; k < 2; ++k)
+                for (int c = 0; c < 3; ++c)
+                    colors[k][c] = static_cast<unsigned char>(random.next() & 0xFF);
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                    pixels[i][c] = kind == 0 ? colors[0][c] : kind == 1 ? colors[(i % 4) / 2][c] : static_cast<unsigned char>(random.next() & 0xFF);
+                pixels[i][3] = 255;
+            }
+
+            unsigned char encoded[16] = {};
+            const int reported = block_compress_detail::encodeBlock(format, pixels, encoded);
+            int texels[16][3];
+            if (!DECODERS[format](encoded, texels))
+            {
+                ++undecodable;
+                continue;
+            }
+            int error = 0, largest = 0;
+            double mean[3] = {};
+            for (int i = 0; i < 16; ++i)
+                for (int c = 0; c < 3; ++c)
+                {
+                    const int difference = texels[i][c] - pixels[i][c];
+                    error += difference * difference;
+                    largest = std::max(largest, std::abs(difference));
+                    mean[c] += pixels[i][c] / 16.0;
+                }
+            wrongError += error != reported;
+            flatOver += kind == 0 && largest > FLAT_BOUND[format];
+            twoColorOver += kind == 1 && largest > TWO_COLOR_BOUND[format];
+
+            // Noise: never worse than filling the block with its mean colour
+            double meanError = 0.0;
+            for (int i = 0; i < 16; ++i)
+                for (int c = 0; c < 3; ++c)
+                    meanError += (pixels[i][c] - mean[c]) * (pixels[i][c] - mean[c]);
+            worseThanMean += kind == 2 && error > meanError;
+        }
+        SELF_TEST_CHECK(test, undecodable == 0);
+        SELF_TEST_CHECK(test, wrongError == 0);
+        SELF_TEST_CHECK(test, flatOver == 0);
+        SELF_TEST_CHECK(test, twoColorOver == 0);
+        SELF_TEST_CHECK(test, worseThanMean == 0);
+    }
+}
+
+// readKtx2 takes what writeKtx2 wrote, with its sRGB tag, and turns down every damaged
+// variant before any level is read: cut short, wrong identifier, unknown format, bad level
+// count, and level ranges that overlap the index, run past the end or wrap around
+inline void testKtx2Validation(SelfTest& test)
+{
+    using namespace self_test_detail;
+    using namespace ktx2_detail;
+    const int format = BLOCK_BC1, width = 8, height = 8;
+    std::vector<std::vector<unsigned char>> levels;
+    for (int level = 0; level < 4; ++level)
+        levels.emplace_back(compressedSize(format, std::max(1, width >> level), std::max(1, height >> level)), static_cast<unsigned char>(level));
+    const std::string valid = writtenBytes("ethiocrown_self_test.ktx2", [&](const std::string& path)
+    {
+        return writeKtx2(path, format, true, width, height, levels);
+    });
+    SELF_TEST_CHECK(test, !valid.empty());
+    if (valid.empty())
+        return;
+
+    auto accepts = [](const std::string& bytes, Ktx2Texture* result = nullptr)
+    {
+        std::istringstream stream(bytes);
+        Ktx2Texture texture;
+        const bool accepted = readKtx2(stream, texture);
+        if (result)
+            *result = texture;
+        return accepted;
+    };
+    Ktx2Texture texture;
+    SELF_TEST_CHECK(test, accepts(valid, &texture));
+    SELF_TEST_CHECK(test, texture.format == format && texture.srgb && texture.width == width && texture.height == height);
+    SELF_TEST_CHECK(test, texture.levels.size() == levels.size());
+    bool levelsMatch = texture.levels.size() == levels.size();
+    for (std::size_t level = 0; levelsMatch && level < levels.size(); ++level)
+        levelsMatch = texture.levels[level].offset + levels[level].size() <= valid.size() &&
+                      valid.compare(static_cast<std::size_t>(texture.levels[level].offset), levels[level].size(),
+                                    std::string(levels[level].begin(), levels[level].end())) == 0;
+    SELF_TEST_CHECK(test, levelsMatch);
+
+    const std::size_t levelIndex = HEADER_BYTES; // Level 0's offset, then its lengths
+    std::string damaged = valid.substr(0, valid.size() - 1);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    SELF_TEST_CHECK(test, !accepts(valid.substr(0, 40)));
+    SELF_TEST_CHECK(test, !accepts(std::string()));
+    damaged = valid;
+    damaged[1] = 'X';
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, 12, 9999, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, 40, 0, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, 40, 1000000, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, levelIndex, 8, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, levelIndex, valid.size() - 4, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, levelIndex, ~std::uint64_t(0) - 8, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, levelIndex + 8, levels[0].size() + 8, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+}
+
+// readTextureCacheHeader takes a built entry and turns down damaged ones: cut short, wrong
+// magic or version, impossible channel or level counts, level sizes that do not halve, and
+// level ranges outside the entry
+inline void testTextureCacheHeader(SelfTest& test)
+{
+    using namespace self_test_detail;
+    Random random(46);
+    const int width = 13, height = 6, channels = 3;
+    std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * channels);
+    for (unsigned char& value : pixels)
+        value = static_cast<unsigned char>(random.next() & 0xFF);
+    const std::vector<unsigned char> entry = buildTextureCacheEntry(0x1234, pixels.data(), width, height, width, height, channels);
+
+    TextureCacheHeader header;
+    SELF_TEST_CHECK(test, readTextureCacheHeader(entry.data(), entry.size(), header));
+    SELF_TEST_CHECK(test, header.key == 0x1234 && header.width == width && header.height == height && header.channels == channels);
+    SELF_TEST_CHECK(test, header.levelCount == 4); // 13x6, 6x3, 3x1, 1x1
+    SELF_TEST_CHECK(test, std::memcmp(entry.data() + header.levels[0].offset, pixels.data(), pixels.size()) == 0);
+
+    auto accepts = [&](const std::vector<unsigned char>& bytes, std::size_t size)
+    {
+        TextureCacheHeader parsed;
+        return readTextureCacheHeader(bytes.data(), size, parsed);
+    };
+    // Cut short: inside the header, and by the last level's final byte
+    const TextureCacheLevel& last = header.levels[header.levelCount - 1];
+    const std::size_t end = static_cast<std::size_t>(last.offset) + static_cast<std::size_t>(last.width) * last.height * channels;
+    SELF_TEST_CHECK(test, accepts(entry, end));
+    SELF_TEST_CHECK(test, !accepts(entry, end - 1));
+    SELF_TEST_CHECK(test, !accepts(entry, sizeof(TextureCacheHeader) - 1));
+
+    auto damaged = [&](auto change)
+    {
+        std::vector<unsigned char> bytes = entry;
+        TextureCacheHeader edited;
+        std::memcpy(&edited, bytes.data(), sizeof(edited));
+        change(edited);
+        std::memcpy(bytes.data(), &edited, sizeof(edited));
+        return accepts(bytes, bytes.size());
+    };
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.magic[0] = 'X'; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.version = TEXTURE_CACHE_VERSION + 1; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.channels = 0; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.channels = 5; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.levelCount = 0; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.levelCount = TEXTURE_CACHE_MAX_LEVELS + 1; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.levels[1].width += 1; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.width *= 64; }));
+    SELF_TEST_CHECK(test, !damaged([&](TextureCacheHeader& h) { h.levels[0].offset = entry.size() + 1; }));
+    SELF_TEST_CHECK(test, !damaged([&](TextureCacheHeader& h) { h.levels[0].offset = entry.size() - 8; }));
+    SELF_TEST_CHECK(test, !damaged([](TextureCacheHeader& h) { h.levels[2].offset = ~std::uint64_t(0); }));
+}
+
+// lz4 round-trips empty, tiny, incompressible and highly repetitive data (long length
+// extensions, overlapping matches), and rejects every cut-short block and hand-made blocks
+// whose matches reach before the output or lack their length bytes
+inline void testLz4(SelfTest& test)
+{
+    using namespace self_test_detail;
+    Random random(47);
+    std::vector<std::vector<unsigned char>> inputs(6);
+    inputs[1] = { 'c', 'r', 'o', 'w', 'n' };
+    inputs[2].resize(4096);
+    for (unsigned char& value : inputs[2])
+        value = static_cast<unsigned char>(random.next() & 0xFF);
+    inputs[3].assign(5000, 'a');
+    const std::string line = "uniform sampler2D crownTexture; // gold leaf\n";
+    for (int i = 0; i < 200; ++i)
+        inputs[4].insert(inputs[4].end(), line.begin(), line.end());
+    for (int i = 0; i < 6000; ++i)
+        inputs[5].push_back(random.uniform(0.0f, 1.0f) < 0.9f ? static_cast<unsigned char>(i / 100) : static_cast<unsigned char>(random.next()));
+
+    std::vector<unsigned char> mixed;
+    for (std::size_t index = 0; index < inputs.size(); ++index)
+    {
+        const std::vector<unsigned char>& input = inputs[index];
+        std::vector<unsigned char> packed(lz4::compressBound(input.size()));
+        const std::size_t packedBytes = lz4::compress(input.data(), input.size(), packed.data());
+        SELF_TEST_CHECK(test, packedBytes > 0 && packedBytes <= packed.size());
+        packed.resize(packedBytes);
+        std::vector<unsigned char> output(input.size());
+        SELF_TEST_CHECK(test, lz4::decompress(packed.data(), packed.size(), output.data(), output.size()) && output == input);
+        if (index == 3 || index == 4)
+            SELF_TEST_CHECK(test, packedBytes < input.size() / 16);
+        if (index == 5)
+            mixed = packed;
+    }
+
+    // Every strict prefix, and the right stream into the wrong size, fails
+    const std::vector<unsigned char>& expected = inputs[5];
+    std::vector<unsigned char> output(expected.size() + 1);
+    bool prefixesRejected = true;
+    for (std::size_t bytes = 0; bytes < mixed.size(); ++bytes)
+        prefixesRejected = prefixesRejected && !lz4::decompress(mixed.data(), bytes, output.data(), expected.size());
+    SELF_TEST_CHECK(test, prefixesRejected);
+    SELF_TEST_CHECK(test, !lz4::decompress(mixed.data(), mixed.size(), output.data(), expected.size() - 1));
+    SELF_TEST_CHECK(test, !lz4::decompress(mixed.data(), mixed.size(), output.data(), expected.size() + 1));
+
+    // One literal 'a', then a match of 4 + 4 at offset 1
+    auto expands = [](std::vector<unsigned char> block, std::size_t bytes)
+    {
+        std::vector<unsigned char> out(bytes);
+        return lz4::decompress(block.data(), block.size(), out.data(), out.size()) && std::count(out.begin(), out.end(), 'a') == static_cast<std::ptrdiff_t>(bytes);
+    };
+    SELF_TEST_CHECK(test, expands({ 0x14, 'a', 0x01, 0x00 }, 9));
+    SELF_TEST_CHECK(test, !expands({ 0x14, 'a', 0x02, 0x00 }, 9));
+    SELF_TEST_CHECK(test, !expands({ 0x14, 'a', 0x00, 0x00 }, 9));
+    SELF_TEST_CHECK(test, !expands({ 0x14, 'a', 0x01 }, 9));
+    SELF_TEST_CHECK(test, !expands({ 0x1F, 'a', 0x01, 0x00 }, 20));
+    SELF_TEST_CHECK(test, !expands({ 0xF0, 0xFF }, 270));
+}
+
+// AssetPack::open takes a written pack and turns down damaged ones: cut short, wrong magic
+// or version, more entries than the file holds, unterminated or unsorted names, unknown
+// compression, and blob ranges outside the file. A damaged LZ4 blob opens but does not expand.
+inline void testAssetPack(SelfTest& test)
+{
+    using namespace self_test_detail;
+    Random random(470);
+    std::vector<unsigned char> noise(300);
+    for (unsigned char& value : noise)
+        value = static_cast<unsigned char>(random.next() & 0xFF);
+    const std::string line = "gl_Position = projection * view * model * vec4(aPos, 1.0);\n";
+    std::vector<unsigned char> shader;
+    for (int i = 0; i < 40; ++i)
+        shader.insert(shader.end(), line.begin(), line.end());
+
+    // Sorted by name: the stored noise first, then the compressed shader
+    const std::string valid = writtenBytes("ethiocrown_self_test.pack", [&](const std::string& path)
+    {
+        AssetPackWriter writer;
+        return writer.add("shaders/crown.vert", ASSET_SHADER, shader, true) &&
+               writer.add("lods/noise", ASSET_LOD_CHAIN, noise, true) && writer.write(path);
+    });
+    SELF_TEST_CHECK(test, !valid.empty());
+    if (valid.empty())
+        return;
+
+    // Opens `bytes` from a scratch file; `inspect(pack)` runs while it is open
+    auto opens = [](const std::string& bytes, auto inspect)
+    {
+        std::error_code error;
+        const std::filesystem::path path = std::filesystem::temp_directory_path(error) / "ethiocrown_self_test_damaged.pack";
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        bool opened;
+        {
+            AssetPack pack;
+            opened = pack.open(path.string());
+            if (opened)
+                inspect(pack);
+        }
+        std::filesystem::remove(path, error);
+        return opened;
+    };
+    auto accepts = [&](const std::string& bytes) { return opens(bytes, [](const AssetPack&) {}); };
+
+    SELF_TEST_CHECK(test, opens(valid, [&](const AssetPack& pack)
+    {
+        std::vector<unsigned char> scratch;
+        const AssetPackEntry* stored = pack.find("lods/noise", ASSET_LOD_CHAIN);
+        const AssetPackEntry* packed = pack.find("shaders/crown.vert", ASSET_SHADER);
+        SELF_TEST_CHECK(test, pack.size() == 2 && stored && packed && !pack.find("lods/noise", ASSET_SHADER) && !pack.find("lods", ASSET_LOD_CHAIN));
+        if (!stored || !packed)
+            return;
+        SELF_TEST_CHECK(test, stored->compression == ASSET_STORED && packed->compression == ASSET_LZ4 && packed->storedBytes < shader.size());
+        const unsigned char* bytes = pack.contents(*stored, scratch);
+        SELF_TEST_CHECK(test, bytes && std::equal(noise.begin(), noise.end(), bytes));
+        bytes = pack.contents(*packed, scratch);
+        SELF_TEST_CHECK(test, bytes && std::equal(shader.begin(), shader.end(), bytes));
+    }));
+
+    const std::size_t noiseEntry = sizeof(AssetPackHeader), shaderEntry = noiseEntry + sizeof(AssetPackEntry);
+    SELF_TEST_CHECK(test, !accepts(valid.substr(0, valid.size() - 1)));
+    SELF_TEST_CHECK(test, !accepts(valid.substr(0, shaderEntry)));
+    SELF_TEST_CHECK(test, !accepts(valid.substr(0, sizeof(AssetPackHeader) - 1)));
+    std::string damaged = valid;
+    damaged[2] = 'X';
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, offsetof(AssetPackHeader, version), ASSET_PACK_VERSION + 1, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, offsetof(AssetPackHeader, entryCount), 0xFFFFFFFF, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    damaged[noiseEntry + ASSET_NAME_BYTES - 1] = 'x';
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    damaged[noiseEntry] = 't'; // "tods/noise" sorts after "shaders/crown.vert"
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, noiseEntry + offsetof(AssetPackEntry, compression), ASSET_LZ4 + 1, 4);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, noiseEntry + offsetof(AssetPackEntry, offset), valid.size() + 1, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, noiseEntry + offsetof(AssetPackEntry, offset), ~std::uint64_t(0) - 8, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, noiseEntry + offsetof(AssetPackEntry, storedBytes), valid.size(), 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+    damaged = valid;
+    poke(damaged, noiseEntry + offsetof(AssetPackEntry, bytes), noise.size() + 1, 8);
+    SELF_TEST_CHECK(test, !accepts(damaged));
+
+    // A compressed blob one byte short, or claiming one byte more, still opens but fails to expand
+    for (int change = 0; change < 2; ++change)
+    {
+        damaged = valid;
+        const std::size_t field = shaderEntry + (change == 0 ? offsetof(AssetPackEntry, storedBytes) : offsetof(AssetPackEntry, bytes));
+        std::uint64_t value = 0;
+        std::memcpy(&value, damaged.data() + field, sizeof(value));
+        poke(damaged, field, change == 0 ? value - 1 : value + 1, 8);
+        SELF_TEST_CHECK(test, opens(damaged, [&](const AssetPack& pack)
+        {
+            std::vector<unsigned char> scratch;
+            const AssetPackEntry* packed = pack.find("shaders/crown.vert", ASSET_SHADER);
+            SELF_TEST_CHECK(test, packed && !pack.contents(*packed, scratch));
+        }));
+    }
+}
+
+// textureLevelForFootprint keeps the coarsest level that still has a texel for every covered
+// pixel: exact at powers of two, clamped to the chain at both ends, and never finer for a
+// smaller footprint
+inline void testTextureLevelForFootprint(SelfTest& test)
+{
+    using namespace self_test_detail;
+    const int size = 1024, levelCount = 11; // 1024 down to 1
+    for (int level = 0; level < levelCount; ++level)
+        SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, static_cast<float>(size >> level)) == level);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, 511.0f) == 1);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, 513.0f) == 0);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, 4096.0f) == 0);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, 0.25f) == levelCount - 1);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, 0.0f) == levelCount - 1);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, levelCount, -5.0f) == levelCount - 1);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, 3, 1.0f) == 2); // A chain cut short
+    SELF_TEST_CHECK(test, textureLevelForFootprint(size, 1, 1.0f) == 0);
+    SELF_TEST_CHECK(test, textureLevelForFootprint(300, 9, 100.0f) == 1); // 300/100 texels per pixel
+
+    // Between the ends the level is as coarse as it can be without dropping below a texel per pixel
+    Random random(49);
+    int previous = 0;
+    bool covers = true, monotonic = true;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const float pixels = static_cast<float>(size) * std::exp2(-10.0f * static_cast<float>(i) / 2000.0f);
+        const int level = textureLevelForFootprint(size, levelCount, pixels);
+        monotonic = monotonic && level >= previous;
+        previous = level;
+
+        const float sampled = random.uniform(1.0f, static_cast<float>(size));
+        const int chosen = textureLevelForFootprint(size, levelCount, sampled);
+        covers = covers && static_cast<float>(size >> chosen) >= sampled && static_cast<float>(size >> (chosen + 1)) < sampled;
+    }
+    SELF_TEST_CHECK(test, monotonic);
+    SELF_TEST_CHECK(test, covers);
+}
+
+// Every compiled cull kernel keeps the same boxes as the scalar one. Box counts and ranges
+// that are not multiples of eight exercise the tails, and half the boxes are moved so that
+// their nearest corner lies on one of the planes
+inline void testCullKernels(SelfTest& test)
+{
+    self_test_detail::Random random(29);
+    const glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 3.0f, 9.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum = Frustum::fromMatrix(glm::perspective(glm::radians(60.0f), 1.5f, 0.5f, 30.0f) * view);
+    const std::vector<CullKernelInfo>& kernels = cullKernels();
+    bool straddled = false;
+
+    for (std::size_t count : { 1, 7, 13, 1001 })
+    {
+        CullBounds bounds;
+        bounds.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            glm::vec3 center(random.uniform(-20.0f, 20.0f), random.uniform(-20.0f, 20.0f), random.uniform(-30.0f, 10.0f));
+            const glm::vec3 extent(random.uniform(0.0f, 2.0f), random.uniform(0.0f, 2.0f), random.uniform(0.0f, 2.0f));
+            if (i % 2)
+            {
+                const glm::vec4& plane = frustum.planes[random.next() % 6];
+                const glm::vec3 normal(plane);
+                const float distance = glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent);
+                center -= normal * (distance / glm::dot(normal, normal));
+            }
+            Bounds box;
+            box.min = center - extent;
+            box.max = center + extent;
+            bounds.set(i, box);
+        }
+
+        const std::size_t ranges[][2] = { { 0, count }, { 0, count - 1 }, { 8, count }, { 8, count - 3 }, { 16, 21 } };
+        for (const auto& range : ranges)
+        {
+            if (range[0] > range[1])
+                continue;
+            std::vector<std::uint32_t> expected;
+            kernels.front().kernel(frustum, bounds, expected, range[0], range[1]);
+            straddled = straddled || (!expected.empty() && expected.size() < range[1] - range[0]);
+            for (const CullKernelInfo& info : kernels)
+            {
+                std::vector<std::uint32_t> visible;
+                info.kernel(frustum, bounds, visible, range[0], range[1]);
+                SELF_TEST_CHECK(test, visible == expected);
+            }
+        }
+    }
+    SELF_TEST_CHECK(test, straddled);
+}
+
+// Each reduced IDCT of a scaled JPEG decode gives the average of the full-size IDCT over
+// its output pixel's area, to within one level. The reference is a float IDCT of random
+// blocks, whose low frequencies are larger as in real images. The reduced IDCTs are
+// static in stb_image, so this needs its implementation in the same translation unit,
+// as main.cpp has it.
+inline void testReducedIdct(SelfTest& test)
+{
+    typedef void (*Idct)(stbi_uc* out, int out_stride, short data[64]);
+    const Idct IDCTS[] = { stbi__idct_block_4x4, stbi__idct_block_2x2, stbi__idct_block_1x1 };
+    const double PI = 3.14159265358979323846;
+    self_test_detail::Random random(43);
+
+    for (int shift = 1; shift <= 3; ++shift)
+    {
+        const int size = 8 >> shift, area = 1 << shift;
+        int worst = 0;
+        for (int block = 0; block < 500; ++block)
+        {
+            short data[64], coefficients[64];
+            for (int i = 0; i < 64; ++i)
+                coefficients[i] = static_cast<short>(random.uniform(-400.0f, 400.0f) / (i / 8 + i % 8 + 1));
+            // The decoder passes its own copy, which the IDCT may overwrite
+            std::memcpy(data, coefficients, sizeof(data));
+            stbi_uc out[16];
+            IDCTS[shift - 1](out, size, data);
+
+            for (int y = 0; y < size; ++y)
+                for (int x = 0; x < size; ++x)
+                {
+                    double sum = 0.0;
+                    for (int py = y * area; py < (y + 1) * area; ++py)
+                        for (int px = x * area; px < (x + 1) * area; ++px)
+                            for (int v = 0; v < 8; ++v)
+                                for (int u = 0; u < 8; ++u)
+                                    sum += (u ? std::sqrt(2.0) : 1.0) * (v ? std::sqrt(2.0) : 1.0) * coefficients[v * 8 + u] *
+                                        std::cos((2 * px + 1) * u * PI / 16) * std::cos((2 * py + 1) * v * PI / 16);
+                    const double reference = std::min(255.0, std::max(0.0, 128.0 + sum / (8 * area * area)));
+                    worst = std::max(worst, std::abs(static_cast<int>(std::lround(reference)) - out[y * size + x]));
+                }
+        }
+        SELF_TEST_CHECK(test, worst <= 1);
+    }
+}
+
+// A decode plan never reduces a JPEG below the size it asks for, takes the largest DCT
+// reduction that allows, and fits the longer side in the limit
+inline void testPlanImageDecode(SelfTest& test)
+{
+    self_test_detail::Random random(430);
+    bool covers = true, largest = true, fits = true, unscaled = true;
+    for (int i = 0; i < 5000; ++i)
+    {
+        const int width = 1 + static_cast<int>(random.next() % 4096);
+        const int height = 1 + static_cast<int>(random.next() % 4096);
+        const int maxSize = static_cast<int>(random.next() % 2048);
+        const ImageDecodePlan plan = planImageDecode(width, height, maxSize);
+        const int round = (1 << plan.dctShift) - 1;
+        covers = covers && plan.dctShift >= 0 && plan.dctShift <= 3 &&
+            plan.decodeWidth == (width + round) >> plan.dctShift && plan.decodeHeight == (height + round) >> plan.dctShift &&
+            plan.decodeWidth >= plan.width && plan.decodeHeight >= plan.height;
+        if (plan.dctShift < 3)
+        {
+            const int next = plan.dctShift + 1, nextRound = (1 << next) - 1;
+            largest = largest && (((width + nextRound) >> next) < plan.width || ((height + nextRound) >> next) < plan.height);
+        }
+        if (maxSize > 0)
+            fits = fits && std::max(plan.width, plan.height) <= std::max(maxSize, 1) && plan.width >= 1 && plan.height >= 1;
+        if (maxSize <= 0 || std::max(width, height) <= maxSize)
+            unscaled = unscaled && plan.width == width && plan.height == height && plan.dctShift == 0 && !plan.resampled();
+    }
+    SELF_TEST_CHECK(test, covers);
+    SELF_TEST_CHECK(test, largest);
+    SELF_TEST_CHECK(test, fits);
+    SELF_TEST_CHECK(test, unscaled);
+}
+
+// Resampling a flat image, to any smaller or equal size and with any channel count,
+// gives back the same flat colour: the tap weights of every output sample sum to one
+inline void testResampleFlat(SelfTest& test)
+{
+    const unsigned char COLOUR[4] = { 0, 255, 131, 7 };
+    const int SIZES[][4] = {
+        { 1, 1, 1, 1 }, { 17, 9, 17, 9 }, { 64, 64, 32, 32 }, { 33, 21, 17, 11 },
+        { 100, 75, 51, 38 }, { 257, 3, 128, 2 }, { 40, 40, 7, 13 }, { 1000, 9, 3, 1 }
+    };
+    for (int channels = 1; channels <= 4; ++channels)
+        for (const int* size : SIZES)
+        {
+            std::vector<unsigned char> source(static_cast<std::size_t>(size[0]) * size[1] * channels);
+            for (std::size_t i = 0; i < source.size(); ++i)
+                source[i] = COLOUR[i % channels];
+            std::vector<unsigned char> target(static_cast<std::size_t>(size[2]) * size[3] * channels, 1);
+            resampleImage(source.data(), size[0], size[1], target.data(), size[2], size[3], channels);
+            bool flat = true;
+            for (std::size_t i = 0; i < target.size(); ++i)
+                flat = flat && target[i] == COLOUR[i % channels];
+            SELF_TEST_CHECK(test, flat);
+        }
+}
+
+// The runtime mesh generators write exactly what the baked meshes hold for the same
+// parameters, and a sector count only known at runtime gives an indexable cylinder
+inline void testMeshGenerators(SelfTest& test)
+{
+    static constexpr CylinderMesh<12> CYLINDER(1.5f, 1.3f, 1.5f);
+    static constexpr CrossMesh CROSS(0.4f, 0.65f, 0.2f);
+    static constexpr SpikeMesh SPIKE(0.5f, 0.7f, 0.1f);
+    auto same = [](const std::vector<GLfloat>& generated, const auto& baked)
+    {
+        return generated.size() == baked.size() && std::equal(generated.begin(), generated.end(), baked.begin());
+    };
+
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> surfaces[4];
+    generateHollowCylinder(1.5f, 1.3f, 1.5f, 12, vertices, surfaces[0], surfaces[1], surfaces[2], surfaces[3]);
+    SELF_TEST_CHECK(test, same(vertices, CYLINDER.vertices));
+    const std::array<GLuint, CylinderMesh<12>::SURFACE_INDEX_COUNT>* baked[4] = {
+        &CYLINDER.outerIndices, &CYLINDER.innerIndices, &CYLINDER.topCapIndices, &CYLINDER.bottomCapIndices
+    };
+    for (int surface = 0; surface < 4; ++surface)
+        SELF_TEST_CHECK(test, surfaces[surface].size() == baked[surface]->size() &&
+                              std::equal(surfaces[surface].begin(), surfaces[surface].end(), baked[surface]->begin()));
+
+    std::vector<GLuint> indices;
+    generateCross(0.4f, 0.65f, 0.2f, vertices, indices);
+    SELF_TEST_CHECK(test, same(vertices, CROSS.vertices) && std::equal(indices.begin(), indices.end(), CROSS.indices.begin()));
+    generateSpike(0.5f, 0.7f, 0.1f, vertices, indices);
+    SELF_TEST_CHECK(test, same(vertices, SPIKE.vertices) && std::equal(indices.begin(), indices.end(), SPIKE.indices.begin()));
+
+    const int sectors = 7;
+    generateHollowCylinder(2.0f, 1.0f, 0.5f, sectors, vertices, surfaces[0], surfaces[1], surfaces[2], surfaces[3]);
+    SELF_TEST_CHECK(test, vertices.size() == static_cast<std::size_t>(sectors + 1) * 4 * VERTEX_STRIDE);
+    bool indicesInRange = true;
+    for (const std::vector<GLuint>& surface : surfaces)
+    {
+        indicesInRange = indicesInRange && surface.size() == static_cast<std::size_t>(sectors) * 6;
+        for (GLuint index : surface)
+            indicesInRange = indicesInRange && index < vertices.size() / VERTEX_STRIDE;
+    }
+    SELF_TEST_CHECK(test, indicesInRange);
+}
+
+// Every test in order; returns how many checks failed
+inline int runSelfTests()
+{
+    struct Entry
+    {
+        const char* name;
+        void (*run)(SelfTest&);
+    };
+    const Entry TESTS[] = {
+        { "bvh traversal", testBvhTraversal },
+        { "cull kernels", testCullKernels },
+        { "job dependencies", testJobDependencies },
+        { "block compression", testBlockCompression },
+        { "ktx2 validation", testKtx2Validation },
+        { "texture cache header", testTextureCacheHeader },
+        { "lz4", testLz4 },
+        { "asset pack", testAssetPack },
+        { "texture level for footprint", testTextureLevelForFootprint },
+        { "mesh generators", testMeshGenerators },
+        { "reduced idct", testReducedIdct },
+        { "plan image decode", testPlanImageDecode },
+        { "resample flat image", testResampleFlat },
+    };
+
+    int checks = 0, failures = 0;
+    for (const Entry& entry : TESTS)
+    {
+        SelfTest test(entry.name);
+        entry.run(test);
+        std::cout << "self test " << entry.name << ": " << (test.failures ? "FAILED" : "ok") << " (" << test.checks << " checks)" << std::endl;
+        checks += test.checks;
+        failures += test.failures;
+    }
+    std::cout << "self test: " << checks - failures << "/" << checks << " checks passed" << std::endl;
+    return failures;
+}
+
+#endif
@@ -8,6 +8,13 @@
 #include <iostream>
 #include <glm/glm.hpp>
 
+// Shader text that need not be NUL-terminated, such as a view into a mapped asset pack
+struct ShaderSource
+{
+    const char *code;
+    int length;
+};
+
 class Shader
 {
 public:
@@ -48,38 +55,36 @@ public:
             std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
         }
 
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
-
-        // 2. Compile shaders
-        unsigned int vertex, fragment;
-        int success;
-        char infoLog[512];
-
-        // Vertex Shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        link(ShaderSource{ vertexCode.c_str(), static_cast<int>(vertexCode.size()) },
+             ShaderSource{ fragmentCode.c_str(), static_cast<int>(fragmentCode.size()) });
+    }
 
-        // Fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+    Shader(ShaderSource vertexSource, ShaderSource fragmentSource) { link(vertexSource, fragmentSource); }
 
-        // Shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+    // Compute-only program (GL 4.3+)
+    explicit Shader(const char *computePath)
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+        }
+        catch (std::ifstream::failure &e)
+        {
+            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        }
 
-        // Delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        link(ShaderSource{ computeCode.c_str(), static_cast<int>(computeCode.size()) });
     }
 
+    explicit Shader(ShaderSource computeSource) { link(computeSource); }
+
     void use() { glUseProgram(ID); }
 
     void setBool(const std::string &name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
@@ -99,12 +104,66 @@ public:
         glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
     }
 
+    void setVec4(const std::string &name, const glm::vec4 &value) const
+    {
+        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    }
+
+    void setUInt(const std::string &name, unsigned int value) const { glUniform1ui(glGetUniformLocation(ID, name.c_str()), value); }
+
+    void setVec4Array(const std::string &name, int count, const glm::vec4 *values) const
+    {
+        glUniform4fv(glGetUniformLocation(ID, name.c_str()), count, &values[0][0]);
+    }
+
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    void link(ShaderSource vertexSource, ShaderSource fragmentSource)
+    {
+        unsigned int vertex, fragment;
+
+        // Vertex Shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vertexSource.code, &vertexSource.length);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+
+        // Fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fragmentSource.code, &fragmentSource.length);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+
+        // Shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+
+        // Delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+    }
+
+    void link(ShaderSource computeSource)
+    {
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &computeSource.code, &computeSource.length);
+        glCompileShader(compute);
+        checkCompileErrors(compute, "COMPUTE");
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+    }
+
     void checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
@@ -0,0 +1,705 @@
+#ifndef SOFT_RASTER_HPP
+#define SOFT_RASTER_HPP
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "baked_mesh.hpp"
+#include "cpu_features.hpp"
+#include "job_system.hpp"
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CROWN_RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+// CPU rendering backend for machines without a GPU. Follows the GL pipeline closely enough
+// to be compared pixel for pixel with vertex_shader.glsl + fragment_shader.glsl:
+//   - vertices are transformed and near/guard-band clipped in parallel chunks
+//   - triangles are snapped to 4 sub-pixel bits and binned into screen tiles
+//   - tiles are rasterized in parallel with SIMD edge functions (top-left fill rule,
+//     GL_LESS depth test) and shaded per pixel with the fragment shader's model
+// The colour buffer is RGBA8 with the first row at the bottom, as glReadPixels returns it.
+
+constexpr int RASTER_TILE_SIZE = 64;
+constexpr int RASTER_SUBPIXEL_BITS = 4;
+constexpr int RASTER_SUBPIXEL_ONE = 1 << RASTER_SUBPIXEL_BITS;
+constexpr float RASTER_GUARD_BAND = 4.0f; // Clip x/y only beyond this many viewports
+
+// Texture sampled like the GL path: level 0, GL_LINEAR, GL_REPEAT
+struct RasterTexture
+{
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> texels; // RGB, first row at t = 0
+
+    // Bilinear weights in 8-bit fixed point, like llvmpipe's sampler
+    glm::vec4 sample(const glm::vec2& uv) const
+    {
+        if (texels.empty())
+            return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+        const int u = static_cast<int>(std::floor((uv.x * width - 0.5f) * 256.0f));
+        const int v = static_cast<int>(std::floor((uv.y * height - 0.5f) * 256.0f));
+        const int a = u & 255;
+        const int b = v & 255;
+        auto wrap = [](int i, int size)
+        {
+            if (static_cast<unsigned>(i) < static_cast<unsigned>(size))
+                return i;
+            i %= size;
+            return i < 0 ? i + size : i;
+        };
+        const int x0 = wrap(u >> 8, width), x1 = wrap((u >> 8) + 1, width);
+        const std::uint8_t* row0 = &texels[static_cast<std::size_t>(wrap(v >> 8, height)) * width * 3];
+        const std::uint8_t* row1 = &texels[static_cast<std::size_t>(wrap((v >> 8) + 1, height)) * width * 3];
+
+        glm::vec4 rgba(0.0f, 0.0f, 0.0f, 1.0f);
+        for (int c = 0; c < 3; ++c)
+        {
+            const int top = row0[x0 * 3 + c] * (256 - a) + row0[x1 * 3 + c] * a;
+            const int bottom = row1[x0 * 3 + c] * (256 - a) + row1[x1 * 3 + c] * a;
+            rgba[c] = static_cast<float>(top * (256 - b) + bottom * b) * (1.0f / (255.0f * 65536.0f));
+        }
+        return rgba;
+    }
+};
+
+inline RasterTexture loadRasterTexture(const char* path)
+{
+    RasterTexture texture;
+    int channels = 0;
+    unsigned char* data = stbi_load(path, &texture.width, &texture.height, &channels, 3);
+    if (!data)
+    {
+        std::cerr << "Failed to load raster texture " << path << std::endl;
+        texture.width = texture.height = 0;
+        return texture;
+    }
+    texture.texels.assign(data, data + static_cast<std::size_t>(texture.width) * texture.height * 3);
+    stbi_image_free(data);
+    return texture;
+}
+
+// One mesh instance, vertices interleaved x, y, z, u, v
+struct RasterDraw
+{
+    const float* vertices = nullptr;
+    std::size_t floatCount = 0;
+    const std::uint32_t* indices = nullptr;
+    std::size_t indexCount = 0;
+    glm::mat4 model = glm::mat4(1.0f);
+    const RasterTexture* texture = nullptr;
+};
+
+// Uniforms of vertex_shader.glsl / fragment_shader.glsl
+struct RasterUniforms
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f);
+    glm::vec3 lightDir = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    float cutOff = 1.0f;
+    float outerCutOff = 1.0f;
+};
+
+struct RasterStats
+{
+    std::size_t triangles = 0;    // Submitted
+    std::size_t binned = 0;       // After clipping, entries over all tiles
+    std::size_t fragments = 0;    // Passed the depth test
+    std::size_t shaded = 0;       // Visible pixels, each shaded once
+};
+
+namespace raster_detail
+{
+    struct ClipVertex
+    {
+        glm::vec4 clip;
+        glm::vec3 world;
+        glm::vec2 uv;
+    };
+
+    // Snapped, counter-clockwise screen triangle. Edge i is opposite vertex i:
+    // E_i(x, y) = a * x + b * y + c in sub-pixel units, positive inside.
+    struct Triangle
+    {
+        std::int32_t a[3], b[3];
+        std::int64_t c[3];
+        std::int32_t bias[3];     // 1 on top-left edges so pixels exactly on them are kept
+        int minX, minY, maxX, maxY; // Pixel bounds, inclusive
+        float invArea;            // 1 / E_i(v_i)
+        float z[3];               // Window depth
+        float invW[3];
+        glm::vec2 uvW[3];         // Perspective-divided attributes
+        glm::vec3 worldW[3];
+        glm::vec3 normal;         // What cross(dFdx(FragPos), dFdy(FragPos)) gives for a flat triangle
+        const RasterTexture* texture;
+    };
+
+    // Split [0, count) into `chunks` contiguous chunks run as jobs, fn(chunk, begin, end)
+    template <typename Fn>
+    void parallelChunks(JobSystem& jobs, unsigned chunks, std::size_t count, Fn fn)
+    {
+        jobs.parallelFor(chunks, 1, [&](std::size_t first, std::size_t last)
+        {
+            for (std::size_t chunk = first; chunk < last; ++chunk)
+                fn(static_cast<unsigned>(chunk), count * chunk / chunks, count * (chunk + 1) / chunks);
+        });
+    }
+
+    inline std::uint32_t packColor(const glm::vec4& color)
+    {
+        const glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return static_cast<std::uint32_t>(c.r) | (static_cast<std::uint32_t>(c.g) << 8) |
+               (static_cast<std::uint32_t>(c.b) << 16) | (static_cast<std::uint32_t>(c.a) << 24);
+    }
+
+    // One row of a triangle's covered rectangle, `count` pixels from its left end: a pixel
+    // x is kept if edge[p] + x * edgeStep[p] > 0 for every partial edge and its depth
+    // depth + x * depthStep is below depthRow[x]
+    struct RowSpan
+    {
+        int partialCount;
+        std::int32_t edge[3];
+        std::int32_t edgeStep[3];
+        float depth;
+        float depthStep;
+        int count;    // At most RASTER_TILE_SIZE
+        int readable; // Entries of depthRow that exist, at least count
+    };
+
+    // Row kernels return the kept pixels as bits and fill depthOut[x] for each of them.
+    // depthOut has room for RASTER_TILE_SIZE entries; depthRow is read past `count` only
+    // within `readable`, and masked pixels are never written.
+    using RowKernel = std::uint64_t (*)(const RowSpan& span, const float* depthRow, float* depthOut);
+
+    inline std::uint64_t rasterRowScalar(const RowSpan& span, const float* depthRow, float* depthOut)
+    {
+        std::uint64_t kept = 0;
+        for (int x = 0; x < span.count; ++x)
+        {
+            bool inside = true;
+            for (int p = 0; p < span.partialCount && inside; ++p)
+                inside = span.edge[p] + x * span.edgeStep[p] > 0;
+            const float z = span.depth + static_cast<float>(x) * span.depthStep;
+            if (!inside || !(z < depthRow[x]))
+                continue;
+            depthOut[x] = z;
+            kept |= std::uint64_t(1) << x;
+        }
+        return kept;
+    }
+
+#ifdef CROWN_RASTER_SSE
+    // Four pixels per instruction
+    inline std::uint64_t rasterRowSSE(const RowSpan& span, const float* depthRow, float* depthOut)
+    {
+        __m128i steps[3];
+        for (int p = 0; p < span.partialCount; ++p)
+            steps[p] = _mm_setr_epi32(0, span.edgeStep[p], 2 * span.edgeStep[p], 3 * span.edgeStep[p]);
+        const __m128 depthSteps = _mm_setr_ps(0.0f, span.depthStep, 2.0f * span.depthStep, 3.0f * span.depthStep);
+
+        std::uint64_t kept = 0;
+        float blockDepth = span.depth;
+        for (int x = 0; x < span.count; x += 4, blockDepth += span.depthStep * 4)
+        {
+            const int lanesLeft = std::min(4, span.count - x);
+            int mask = (1 << lanesLeft) - 1;
+            for (int p = 0; p < span.partialCount && mask; ++p)
+            {
+                const __m128i e = _mm_add_epi32(_mm_set1_epi32(span.edge[p] + x * span.edgeStep[p]), steps[p]);
+                mask &= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(e, _mm_setzero_si128())));
+            }
+            if (!mask)
+                continue;
+
+            const __m128 z = _mm_add_ps(_mm_set1_ps(blockDepth), depthSteps);
+            _mm_storeu_ps(depthOut + x, z);
+            if (x + 4 <= span.readable)
+                mask &= _mm_movemask_ps(_mm_cmplt_ps(z, _mm_loadu_ps(depthRow + x)));
+            else
+                for (int l = 0; l < lanesLeft; ++l)
+                    if (!(depthOut[x + l] < depthRow[x + l]))
+                        mask &= ~(1 << l);
+            kept |= static_cast<std::uint64_t>(mask) << x;
+        }
+        return kept;
+    }
+#endif
+
+#ifdef CROWN_X86
+    // Eight pixels per instruction, only called when the CPU has AVX2
+    CROWN_AVX2_TARGET inline std::uint64_t rasterRowAVX2(const RowSpan& span, const float* depthRow, float* depthOut)
+    {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i steps[3];
+        for (int p = 0; p < span.partialCount; ++p)
+            steps[p] = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(span.edgeStep[p]));
+        const __m256 depthSteps = _mm256_mul_ps(_mm256_cvtepi32_ps(lanes), _mm256_set1_ps(span.depthStep));
+
+        std::uint64_t kept = 0;
+        float blockDepth = span.depth;
+        for (int x = 0; x < span.count; x += 8, blockDepth += span.depthStep * 8)
+        {
+            const int lanesLeft = std::min(8, span.count - x);
+            int mask = (1 << lanesLeft) - 1;
+            for (int p = 0; p < span.partialCount && mask; ++p)
+            {
+                const __m256i e = _mm256_add_epi32(_mm256_set1_epi32(span.edge[p] + x * span.edgeStep[p]), steps[p]);
+                mask &= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(e, _mm256_setzero_si256())));
+            }
+            if (!mask)
+                continue;
+
+            const __m256 z = _mm256_add_ps(_mm256_set1_ps(blockDepth), depthSteps);
+            _mm256_storeu_ps(depthOut + x, z);
+            if (x + 8 <= span.readable)
+                mask &= _mm256_movemask_ps(_mm256_cmp_ps(z, _mm256_loadu_ps(depthRow + x), _CMP_LT_OQ));
+            else
+                for (int l = 0; l < lanesLeft; ++l)
+                    if (!(depthOut[x + l] < depthRow[x + l]))
+                        mask &= ~(1 << l);
+            kept |= static_cast<std::uint64_t>(mask) << x;
+        }
+        return kept;
+    }
+#endif
+
+    struct RowKernelInfo
+    {
+        const char* name;
+        RowKernel kernel;
+    };
+
+    // The widest row kernel the build has and the CPU can run
+    inline const RowKernelInfo& rowKernel()
+    {
+        static const RowKernelInfo kernel = []()
+        {
+#ifdef CROWN_X86
+            if (cpuHasAvx2())
+                return RowKernelInfo{ "AVX2", rasterRowAVX2 };
+#endif
+#ifdef CROWN_RASTER_SSE
+            return RowKernelInfo{ "SSE2", rasterRowSSE };
+#else
+            return RowKernelInfo{ "scalar", rasterRowScalar };
+#endif
+        }();
+        return kernel;
+    }
+}
+
+// Name of the row kernel the rasterizer uses on this CPU
+inline const char* rasterKernelName()
+{
+    return raster_detail::rowKernel().name;
+}
+
+class SoftwareRasterizer
+{
+public:
+    // Setup and tiles run on `jobs`, split in as many chunks as it has threads
+    SoftwareRasterizer(int width, int height, JobSystem& jobs)
+        : jobs(jobs), width(width), height(height), threadCount(jobs.threadCount()),
+          tilesX((width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE),
+          tilesY((height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE),
+          color(static_cast<std::size_t>(width) * height, 0), depth(static_cast<std::size_t>(width) * height, 1.0f),
+          rasterRow(raster_detail::rowKernel().kernel), triangles(this->threadCount), bins(this->threadCount)
+    {
+        for (auto& threadBins : bins)
+            threadBins.resize(static_cast<std::size_t>(tilesX) * tilesY);
+    }
+
+    void clear(std::uint32_t clearColor = 0, float clearDepth = 1.0f)
+    {
+        std::fill(color.begin(), color.end(), clearColor);
+        std::fill(depth.begin(), depth.end(), clearDepth);
+    }
+
+    // Draw a list of instances in order, like consecutive glDrawElements calls
+    RasterStats render(const std::vector<RasterDraw>& draws, const RasterUniforms& uniforms)
+    {
+        using namespace raster_detail;
+
+        // Flatten the submission into (draw, first index) triangle references
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> submitted;
+        for (std::size_t d = 0; d < draws.size(); ++d)
+            for (std::size_t i = 0; i + 2 < draws[d].indexCount; i += 3)
+                submitted.emplace_back(static_cast<std::uint32_t>(d), static_cast<std::uint32_t>(i));
+
+        // Setup and binning: contiguous chunks keep each tile's list in submission order
+        const glm::mat4 viewProjection = uniforms.projection * uniforms.view;
+        parallelChunks(jobs, threadCount, submitted.size(), [&](unsigned t, std::size_t begin, std::size_t end)
+        {
+            triangles[t].clear();
+            for (auto& bin : bins[t])
+                bin.clear();
+            for (std::size_t s = begin; s < end; ++s)
+            {
+                const RasterDraw& draw = draws[submitted[s].first];
+                ClipVertex v[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float* p = &draw.vertices[draw.indices[submitted[s].second + k] * VERTEX_STRIDE];
+                    v[k].world = glm::vec3(draw.model * glm::vec4(p[0], p[1], p[2], 1.0f));
+                    v[k].clip = viewProjection * glm::vec4(v[k].world, 1.0f);
+                    v[k].uv = glm::vec2(p[3], p[4]);
+                }
+                clipAndSetup(t, v, draw.texture);
+            }
+        });
+
+        // Rasterize tiles in parallel, each thread pulls the next unclaimed tile
+        std::atomic<int> nextTile(0);
+        std::vector<RasterStats> tileStats(threadCount);
+        parallelChunks(jobs, threadCount, threadCount, [&](unsigned t, std::size_t, std::size_t)
+        {
+            for (int tile = nextTile++; tile < tilesX * tilesY; tile = nextTile++)
+                rasterizeTile(tile, uniforms, tileStats[t]);
+        });
+
+        RasterStats stats;
+        stats.triangles = submitted.size();
+        for (unsigned t = 0; t < threadCount; ++t)
+        {
+            for (const auto& bin : bins[t])
+                stats.binned += bin.size();
+            stats.fragments += tileStats[t].fragments;
+            stats.shaded += tileStats[t].shaded;
+        }
+        return stats;
+    }
+
+    const std::vector<std::uint32_t>& colorBuffer() const { return color; }
+    const std::vector<float>& depthBuffer() const { return depth; }
+    unsigned threads() const { return threadCount; }
+
+private:
+    // Clip against the near plane (and the guard band for huge triangles), then set up the fan
+    void clipAndSetup(unsigned t, const raster_detail::ClipVertex (&input)[3], const RasterTexture* texture)
+    {
+        using raster_detail::ClipVertex;
+
+        // Trivially reject triangles entirely outside one clip plane
+        for (int plane = 0; plane < 6; ++plane)
+        {
+            int outside = 0;
+            for (const ClipVertex& v : input)
+                outside += planeDistance(v.clip, plane, 1.0f) < 0.0f;
+            if (outside == 3)
+                return;
+        }
+
+        ClipVertex polygon[9], scratch[9];
+        int count = 3;
+        std::copy(input, input + 3, polygon);
+
+        // Plane 4 is near, 0-3 the guard band; far is handled by the depth test range
+        static const int CLIP_PLANES[] = { 4, 0, 1, 2, 3 };
+        for (int plane : CLIP_PLANES)
+        {
+            const float band = plane == 4 ? 1.0f : RASTER_GUARD_BAND;
+            bool anyOutside = false;
+            for (int i = 0; i < count; ++i)
+                anyOutside |= planeDistance(polygon[i].clip, plane, band) < 0.0f;
+            if (!anyOutside)
+                continue;
+
+            int clipped = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                const ClipVertex& a = polygon[i];
+                const ClipVertex& b = polygon[(i + 1) % count];
+                const float da = planeDistance(a.clip, plane, band);
+                const float db = planeDistance(b.clip, plane, band);
+                if (da >= 0.0f)
+                    scratch[clipped++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    const float s = da / (da - db);
+                    ClipVertex& v = scratch[clipped++];
+                    v.clip = glm::mix(a.clip, b.clip, s);
+                    v.world = glm::mix(a.world, b.world, s);
+                    v.uv = glm::mix(a.uv, b.uv, s);
+                }
+            }
+            count = clipped;
+            std::copy(scratch, scratch + count, polygon);
+            if (count < 3)
+                return;
+        }
+
+        for (int i = 1; i + 1 < count; ++i)
+            setupTriangle(t, polygon[0], polygon[i], polygon[i + 1], texture);
+    }
+
+    static float planeDistance(const glm::vec4& clip, int plane, float band)
+    {
+        switch (plane)
+        {
+        case 0: return clip.x + band * clip.w;
+        case 1: return band * clip.w - clip.x;
+        case 2: return clip.y + band * clip.w;
+        case 3: return band * clip.w - clip.y;
+        case 4: return clip.z + clip.w;
+        default: return clip.w - clip.z;
+        }
+    }
+
+    void setupTriangle(unsigned t, const raster_detail::ClipVertex& v0, const raster_detail::ClipVertex& v1,
+        const raster_detail::ClipVertex& v2, const RasterTexture* texture)
+    {
+        using raster_detail::Triangle;
+        const raster_detail::ClipVertex* v[3] = { &v0, &v1, &v2 };
+
+        Triangle tri;
+        std::int32_t x[3], y[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float invW = 1.0f / v[k]->clip.w;
+            const glm::vec3 ndc = glm::vec3(v[k]->clip) * invW;
+            x[k] = static_cast<std::int32_t>(std::lround((ndc.x * 0.5f + 0.5f) * width * RASTER_SUBPIXEL_ONE));
+            y[k] = static_cast<std::int32_t>(std::lround((ndc.y * 0.5f + 0.5f) * height * RASTER_SUBPIXEL_ONE));
+            tri.z[k] = ndc.z * 0.5f + 0.5f;
+            tri.invW[k] = invW;
+            tri.uvW[k] = v[k]->uv * invW;
+            tri.worldW[k] = v[k]->world * invW;
+        }
+
+        // Counter-clockwise on screen; a clockwise triangle is flipped, which GL does
+        // implicitly for its orientation-independent coverage
+        std::int64_t area = static_cast<std::int64_t>(x[2] - x[1]) * (y[0] - y[1]) -
+                            static_cast<std::int64_t>(y[2] - y[1]) * (x[0] - x[1]);
+        if (area == 0)
+            return;
+        glm::vec3 faceNormal = glm::cross(v[1]->world - v[0]->world, v[2]->world - v[0]->world);
+        if (area < 0)
+        {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(tri.z[1], tri.z[2]);
+            std::swap(tri.invW[1], tri.invW[2]);
+            std::swap(tri.uvW[1], tri.uvW[2]);
+            std::swap(tri.worldW[1], tri.worldW[2]);
+            area = -area;
+            faceNormal = -faceNormal;
+        }
+        const float normalLength = glm::length(faceNormal);
+        tri.normal = normalLength > 0.0f ? faceNormal / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        tri.invArea = 1.0f / static_cast<float>(area);
+        tri.texture = texture;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const int j = (i + 1) % 3, k = (i + 2) % 3;
+            tri.a[i] = y[j] - y[k];
+            tri.b[i] = x[k] - x[j];
+            tri.c[i] = -(static_cast<std::int64_t>(tri.a[i]) * x[j] + static_cast<std::int64_t>(tri.b[i]) * y[j]);
+            const std::int32_t dx = x[k] - x[j], dy = y[k] - y[j];
+            tri.bias[i] = (dy < 0 || (dy == 0 && dx < 0)) ? 1 : 0;
+        }
+
+        // Pixels whose centers can be covered
+        const int half = RASTER_SUBPIXEL_ONE / 2;
+        tri.minX = std::max(0, (std::min({ x[0], x[1], x[2] }) - half + RASTER_SUBPIXEL_ONE - 1) >> RASTER_SUBPIXEL_BITS);
+        tri.minY = std::max(0, (std::min({ y[0], y[1], y[2] }) - half + RASTER_SUBPIXEL_ONE - 1) >> RASTER_SUBPIXEL_BITS);
+        tri.maxX = std::min(width - 1, (std::max({ x[0], x[1], x[2] }) - half) >> RASTER_SUBPIXEL_BITS);
+        tri.maxY = std::min(height - 1, (std::max({ y[0], y[1], y[2] }) - half) >> RASTER_SUBPIXEL_BITS);
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+
+        const std::uint32_t index = static_cast<std::uint32_t>(triangles[t].size());
+        triangles[t].push_back(tri);
+        for (int ty = tri.minY / RASTER_TILE_SIZE; ty <= tri.maxY / RASTER_TILE_SIZE; ++ty)
+            for (int tx = tri.minX / RASTER_TILE_SIZE; tx <= tri.maxX / RASTER_TILE_SIZE; ++tx)
+                bins[t][ty * tilesX + tx].push_back(index);
+    }
+
+    // Depth pass over every binned triangle, remembering the front-most triangle per pixel,
+    // then one shading pass so overdraw never reaches the fragment shader
+    void rasterizeTile(int tile, const RasterUniforms& uniforms, RasterStats& stats)
+    {
+        using namespace raster_detail;
+        const int tileX0 = (tile % tilesX) * RASTER_TILE_SIZE;
+        const int tileY0 = (tile / tilesX) * RASTER_TILE_SIZE;
+        const int tileX1 = std::min(tileX0 + RASTER_TILE_SIZE, width) - 1;
+        const int tileY1 = std::min(tileY0 + RASTER_TILE_SIZE, height) - 1;
+        const Triangle* front[RASTER_TILE_SIZE * RASTER_TILE_SIZE] = {};
+
+        for (unsigned t = 0; t < threadCount; ++t)
+        {
+            for (std::uint32_t index : bins[t][tile])
+            {
+                const Triangle& tri = triangles[t][index];
+                const int x0 = std::max(tileX0, tri.minX), x1 = std::min(tileX1, tri.maxX);
+                const int y0 = std::max(tileY0, tri.minY), y1 = std::min(tileY1, tri.maxY);
+                if (x0 > x1 || y0 > y1)
+                    continue;
+
+                // Classify each edge over the covered rectangle: fully inside edges are skipped,
+                // partial ones are small enough here to step in 32-bit lanes
+                auto edgeAt = [&](int i, int px, int py)
+                {
+                    return tri.a[i] * static_cast<std::int64_t>(px * RASTER_SUBPIXEL_ONE + RASTER_SUBPIXEL_ONE / 2) +
+                           tri.b[i] * static_cast<std::int64_t>(py * RASTER_SUBPIXEL_ONE + RASTER_SUBPIXEL_ONE / 2) + tri.c[i] + tri.bias[i];
+                };
+                int partial[3];
+                int partialCount = 0;
+                bool rejected = false;
+                for (int i = 0; i < 3 && !rejected; ++i)
+                {
+                    const std::int64_t e00 = edgeAt(i, x0, y0), e10 = edgeAt(i, x1, y0);
+                    const std::int64_t e01 = edgeAt(i, x0, y1), e11 = edgeAt(i, x1, y1);
+                    if (std::max({ e00, e10, e01, e11 }) <= 0)
+                        rejected = true;
+                    else if (std::min({ e00, e10, e01, e11 }) <= 0)
+                        partial[partialCount++] = i;
+                }
+                if (rejected)
+                    continue;
+
+                // Screen-linear depth plane
+                const float zdx = (tri.a[0] * tri.z[0] + tri.a[1] * tri.z[1] + tri.a[2] * tri.z[2]) * RASTER_SUBPIXEL_ONE * tri.invArea;
+                const float zdy = (tri.b[0] * tri.z[0] + tri.b[1] * tri.z[1] + tri.b[2] * tri.z[2]) * RASTER_SUBPIXEL_ONE * tri.invArea;
+                auto depthAt = [&](int px, int py)
+                {
+                    float z = 0.0f;
+                    for (int i = 0; i < 3; ++i)
+                        z += static_cast<float>(edgeAt(i, px, py) - tri.bias[i]) * tri.invArea * tri.z[i];
+                    return z;
+                };
+
+                RowSpan span;
+                span.partialCount = partialCount;
+                std::int32_t rowStart[3], rowStep[3];
+                for (int p = 0; p < partialCount; ++p)
+                {
+                    const int i = partial[p];
+                    span.edgeStep[p] = tri.a[i] * RASTER_SUBPIXEL_ONE;
+                    rowStart[p] = static_cast<std::int32_t>(edgeAt(i, x0, y0));
+                    rowStep[p] = tri.b[i] * RASTER_SUBPIXEL_ONE;
+                }
+                span.depthStep = zdx;
+                span.count = x1 - x0 + 1;
+                span.readable = width - x0;
+                float rowDepth = depthAt(x0, y0);
+
+                for (int py = y0; py <= y1; ++py, rowDepth += zdy)
+                {
+                    float* depthRow = &depth[static_cast<std::size_t>(py) * width + x0];
+                    for (int p = 0; p < partialCount; ++p)
+                        span.edge[p] = rowStart[p] + (py - y0) * rowStep[p];
+                    span.depth = rowDepth;
+                    float spanDepth[RASTER_TILE_SIZE];
+                    const std::uint64_t kept = rasterRow(span, depthRow, spanDepth);
+                    for (int l = 0; l < span.count; ++l)
+                    {
+                        if (!((kept >> l) & 1))
+                            continue;
+                        depthRow[l] = spanDepth[l];
+                        front[(py - tileY0) * RASTER_TILE_SIZE + x0 + l - tileX0] = &tri;
+                        ++stats.fragments;
+                    }
+                }
+            }
+        }
+
+        for (int py = tileY0; py <= tileY1; ++py)
+            for (int px = tileX0; px <= tileX1; ++px)
+                if (const Triangle* tri = front[(py - tileY0) * RASTER_TILE_SIZE + px - tileX0])
+                {
+                    color[static_cast<std::size_t>(py) * width + px] = shade(*tri, px, py, uniforms);
+                    ++stats.shaded;
+                }
+    }
+
+    // fragment_shader.glsl for one pixel of `tri`
+    std::uint32_t shade(const raster_detail::Triangle& tri, int px, int py, const RasterUniforms& u) const
+    {
+        // Perspective-correct barycentrics from the exact edge values at the pixel center
+        float weights[3];
+        float invW = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const std::int64_t e = tri.a[i] * static_cast<std::int64_t>(px * RASTER_SUBPIXEL_ONE + RASTER_SUBPIXEL_ONE / 2) +
+                                   tri.b[i] * static_cast<std::int64_t>(py * RASTER_SUBPIXEL_ONE + RASTER_SUBPIXEL_ONE / 2) + tri.c[i];
+            weights[i] = static_cast<float>(e) * tri.invArea;
+            invW += weights[i] * tri.invW[i];
+        }
+        glm::vec2 uv(0.0f);
+        glm::vec3 fragPos(0.0f);
+        for (int i = 0; i < 3; ++i)
+        {
+            uv += weights[i] * tri.uvW[i];
+            fragPos += weights[i] * tri.worldW[i];
+        }
+        uv /= invW;
+        fragPos /= invW;
+
+        const glm::vec4 texColor = tri.texture ? tri.texture->sample(uv) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        const glm::vec3 lightDirNorm = glm::normalize(u.lightPos - fragPos);
+        const glm::vec3 viewDir = glm::normalize(u.viewPos - fragPos);
+
+        // Spotlight effect
+        const float theta = glm::dot(lightDirNorm, -glm::normalize(u.lightDir));
+        const float intensity = glm::clamp((theta - u.outerCutOff) / (u.cutOff - u.outerCutOff), 0.0f, 1.0f);
+
+        const glm::vec3 ambient = 0.5f * u.lightColor;
+        const glm::vec3 diffuse = std::max(glm::dot(tri.normal, lightDirNorm), 0.0f) * u.lightColor * 0.9f;
+        const glm::vec3 reflectDir = glm::reflect(-lightDirNorm, tri.normal);
+        const glm::vec3 specular = 0.5f * std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 16.0f) * u.lightColor;
+        const glm::vec3 lighting = ambient + intensity * (diffuse + specular);
+        return raster_detail::packColor(glm::vec4(lighting * glm::vec3(texColor), texColor.a));
+    }
+
+    JobSystem& jobs;
+    int width;
+    int height;
+    unsigned threadCount;  // Setup chunks, each with its own triangles and bins
+    int tilesX;
+    int tilesY;
+    std::vector<std::uint32_t> color;
+    std::vector<float> depth;
+    raster_detail::RowKernel rasterRow; // Widest row kernel the CPU runs
+
+    // Per setup thread: triangles and, per tile, indices into them
+    std::vector<std::vector<raster_detail::Triangle>> triangles;
+    std::vector<std::vector<std::vector<std::uint32_t>>> bins;
+};
+
+// Per-channel difference between two RGBA8 images of the same size
+struct RasterDiff
+{
+    std::size_t pixels = 0;
+    std::size_t mismatched = 0; // Any channel off by more than the tolerance
+    int maxChannelError = 0;
+};
+
+inline RasterDiff compareImages(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, int tolerance = 2)
+{
+    RasterDiff diff;
+    diff.pixels = std::min(a.size(), b.size());
+    for (std::size_t i = 0; i < diff.pixels; ++i)
+    {
+        int worst = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+            worst = std::max(worst, std::abs(static_cast<int>((a[i] >> shift) & 0xFF) - static_cast<int>((b[i] >> shift) & 0xFF)));
+        diff.maxChannelError = std::max(diff.maxChannelError, worst);
+        diff.mismatched += worst > tolerance;
+    }
+    return diff;
+}
+
+#endif
@@ -521,6 +521,11 @@ extern "C" {
     STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
     STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+    // JPEG only: decode at 1/2, 1/4 or 1/8 of the stored size (scale_shift 1-3) by running
+    // reduced IDCTs on the low-frequency coefficients; 0 decodes at full size. Other
+    // formats ignore it. Applies to images loaded on the calling thread.
+    STBIDEF void stbi_set_jpeg_scale_on_load_thread(int scale_shift);
+
     // ZLIB client - used by PNG, available for other purposes
 
     STBIDEF char* stbi_zlib_decode_malloc_guesssize(const char* buffer, int len, int initial_size, int* outlen);
@@ -1114,6 +1119,17 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+#ifndef STBI_THREAD_LOCAL
+static int stbi__jpeg_scale_on_load;
+#else
+static STBI_THREAD_LOCAL int stbi__jpeg_scale_on_load;
+#endif
+
+STBIDEF void stbi_set_jpeg_scale_on_load_thread(int scale_shift)
+{
+    stbi__jpeg_scale_on_load = scale_shift < 0 ? 0 : scale_shift > 3 ? 3 : scale_shift;
+}
+
 static void* stbi__load_main(stbi__context* s, int* x, int* y, int* comp, int req_comp, stbi__result_info* ri, int bpc)
 {
     memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1954,7 +1970,7 @@ typedef struct
         stbi_uc* data;
         void* raw_data, * raw_coeff;
         stbi_uc* linebuf;
-        short* coeff;   // progressive only
+        short* coeff;   // progressive, and baseline when buffer_coeffs is set
         int      coeff_w, coeff_h; // number of 8x8 coefficient blocks
     } img_comp[4];
 
@@ -1975,6 +1991,8 @@ typedef struct
 
     int scan_n, order[4];
     int restart_interval, todo;
+    int scale_shift; // component planes hold (8 >> scale_shift)^2 pixels per block
+    int buffer_coeffs; // baseline: keep dequantized blocks and IDCT them in parallel afterwards
 
     // kernels
     void (*idct_block_kernel)(stbi_uc* out, int out_stride, short data[64]);
@@ -2502,6 +2520,87 @@ static void stbi__idct_block(stbi_uc* out, int out_stride, short data[64])
     }
 }
 
+// reduced-size IDCTs for scaled decoding, after jidctred.c: only the low-frequency
+// coefficients contribute and the output block is 4x4, 2x2 or 1x1
+#define stbi__red_descale(x, n)  (((x) + (1 << ((n) - 1))) >> (n))
+
+static void stbi__idct_block_4x4(stbi_uc* out, int out_stride, short data[64])
+{
+    int i, t0, t2, t10, t12, o0, o2, ws[32];
+    short* d;
+    int* w;
+
+    // columns; column 4 is never read by the row pass
+    for (i = 0; i < 8; ++i) {
+        if (i == 4) continue;
+        d = data + i;
+        w = ws + i;
+        if (d[8] == 0 && d[16] == 0 && d[24] == 0 && d[40] == 0 && d[48] == 0 && d[56] == 0) {
+            w[0] = w[8] = w[16] = w[24] = d[0] * 4;
+            continue;
+        }
+        t0 = d[0] * (1 << 14);
+        t2 = d[16] * 15137 - d[48] * 6270;
+        t10 = t0 + t2;
+        t12 = t0 - t2;
+        o0 = -d[56] * 1730 + d[40] * 11893 - d[24] * 17799 + d[8] * 8697;
+        o2 = -d[56] * 4176 - d[40] * 4926 + d[24] * 7373 + d[8] * 20995;
+        w[0] = stbi__red_descale(t10 + o2, 12);
+        w[24] = stbi__red_descale(t10 - o2, 12);
+        w[8] = stbi__red_descale(t12 + o0, 12);
+        w[16] = stbi__red_descale(t12 - o0, 12);
+    }
+
+    // rows, re-centred on 128
+    for (i = 0, w = ws; i < 4; ++i, w += 8, out += out_stride) {
+        t0 = w[0] * (1 << 14);
+        t2 = w[2] * 15137 - w[6] * 6270;
+        t10 = t0 + t2;
+        t12 = t0 - t2;
+        o0 = -w[7] * 1730 + w[5] * 11893 - w[3] * 17799 + w[1] * 8697;
+        o2 = -w[7] * 4176 - w[5] * 4926 + w[3] * 7373 + w[1] * 20995;
+        out[0] = stbi__clamp(stbi__red_descale(t10 + o2, 19) + 128);
+        out[3] = stbi__clamp(stbi__red_descale(t10 - o2, 19) + 128);
+        out[1] = stbi__clamp(stbi__red_descale(t12 + o0, 19) + 128);
+        out[2] = stbi__clamp(stbi__red_descale(t12 - o0, 19) + 128);
+    }
+}
+
+static void stbi__idct_block_2x2(stbi_uc* out, int out_stride, short data[64])
+{
+    int i, t0, t10, ws[16];
+    short* d;
+    int* w;
+
+    // columns; only the odd ones and the DC column feed the row pass
+    for (i = 0; i < 8; ++i) {
+        if (i == 2 || i == 4 || i == 6) continue;
+        d = data + i;
+        w = ws + i;
+        if (d[8] == 0 && d[24] == 0 && d[40] == 0 && d[56] == 0) {
+            w[0] = w[8] = d[0] * 4;
+            continue;
+        }
+        t10 = d[0] * (1 << 15);
+        t0 = -d[56] * 5906 + d[40] * 6967 - d[24] * 10426 + d[8] * 29692;
+        w[0] = stbi__red_descale(t10 + t0, 13);
+        w[8] = stbi__red_descale(t10 - t0, 13);
+    }
+
+    for (i = 0, w = ws; i < 2; ++i, w += 8, out += out_stride) {
+        t10 = w[0] * (1 << 15);
+        t0 = -w[7] * 5906 + w[5] * 6967 - w[3] * 10426 + w[1] * 29692;
+        out[0] = stbi__clamp(stbi__red_descale(t10 + t0, 20) + 128);
+        out[1] = stbi__clamp(stbi__red_descale(t10 - t0, 20) + 128);
+    }
+}
+
+static void stbi__idct_block_1x1(stbi_uc* out, int out_stride, short data[64])
+{
+    STBI_NOTUSED(out_stride);
+    out[0] = stbi__clamp(stbi__red_descale(data[0], 3) + 128);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2925,69 +3024,313 @@ static void stbi__jpeg_reset(stbi__jpeg* j)
     // since we don't even allow 1<<30 pixels
 }
 
-static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
+// Parallel stages of the decoder. STBI_JPEG_PARALLEL_HOOK(count, task, user) runs
+// task(user, 0..count-1), in any order and on any threads, and returns when all are done;
+// STBI_JPEG_PARALLEL_THREADS() says how many threads it has. Without the hook the tasks
+// run in order on the calling thread and baseline blocks are not buffered.
+typedef void (*stbi__jpeg_task)(void* user, int index);
+
+static int stbi__jpeg_parallel_threads(void)
 {
-    stbi__jpeg_reset(z);
-    if (!z->progressive) {
-        if (z->scan_n == 1) {
-            int i, j;
-            STBI_SIMD_ALIGN(short, data[64]);
-            int n = z->order[0];
-            // non-interleaved data, we just need to process one block at a time,
-            // in trivial scanline order
-            // number of blocks to do just depends on how many actual "pixels" this
-            // component has, independent of interleaved MCU blocking and such
-            int w = (z->img_comp[n].x + 7) >> 3;
-            int h = (z->img_comp[n].y + 7) >> 3;
-            for (j = 0; j < h; ++j) {
-                for (i = 0; i < w; ++i) {
-                    int ha = z->img_comp[n].ha;
-                    if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
-                    // every data block is an MCU, so countdown the restart interval
-                    if (--z->todo <= 0) {
-                        if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                        // if it's NOT a restart, then just bail, so we get corrupt data
-                        // rather than no data
-                        if (!STBI__RESTART(z->marker)) return 1;
-                        stbi__jpeg_reset(z);
-                    }
-                }
+#ifdef STBI_JPEG_PARALLEL_HOOK
+    return STBI_JPEG_PARALLEL_THREADS();
+#else
+    return 1;
+#endif
+}
+
+static void stbi__jpeg_parallel_for(int count, stbi__jpeg_task task, void* user)
+{
+#ifdef STBI_JPEG_PARALLEL_HOOK
+    if (count > 1 && stbi__jpeg_parallel_threads() > 1) {
+        STBI_JPEG_PARALLEL_HOOK(count, task, user);
+        return;
+    }
+#endif
+    {
+        int i;
+        for (i = 0; i < count; ++i)
+            task(user, i);
+    }
+}
+
+// A baseline scan is units_y rows of units_x units: interleaved MCUs, or single blocks
+// when the scan has one component. The restart interval counts units.
+static void stbi__jpeg_scan_units(stbi__jpeg* z, int* units_x, int* units_y)
+{
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        // non-interleaved data: the number of blocks just depends on how many actual
+        // "pixels" this component has, independent of interleaved MCU blocking and such
+        *units_x = (z->img_comp[n].x + 7) >> 3;
+        *units_y = (z->img_comp[n].y + 7) >> 3;
+    }
+    else {
+        *units_x = z->img_mcu_x;
+        *units_y = z->img_mcu_y;
+    }
+}
+
+// MCU rows per band of buffered baseline blocks
+#define STBI__JPEG_BAND_MCU_ROWS 4
+
+// block rows of component n in a band; a one-component scan's bands cover the same
+// image rows as an interleaved scan's
+static int stbi__jpeg_band_blocks(stbi__jpeg* z, int n)
+{
+    return STBI__JPEG_BAND_MCU_ROWS * z->img_comp[n].v;
+}
+
+// Buffered baseline blocks live in a window of two bands, one being entropy decoded while
+// the other goes through the IDCT
+static short* stbi__jpeg_window_block(stbi__jpeg* z, int n, int x2, int y2)
+{
+    int rows = stbi__jpeg_band_blocks(z, n);
+    int row = (y2 / rows) % 2 * rows + y2 % rows;
+    return z->img_comp[n].coeff + 64 * (x2 + row * z->img_comp[n].coeff_w);
+}
+
+// entropy decodes the unit at column i, row j; its blocks go through the IDCT straight
+// away unless buffer_coeffs keeps them in the window
+static int stbi__jpeg_decode_unit(stbi__jpeg* z, int i, int j)
+{
+    int k, x, y;
+    int bs = 8 >> z->scale_shift;
+    STBI_SIMD_ALIGN(short, data[64]);
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k];
+        int ha = z->img_comp[n].ha;
+        // scan out an mcu's worth of this component; that's just determined
+        // by the basic H and V specified for the component
+        int bw = z->scan_n == 1 ? 1 : z->img_comp[n].h;
+        int bh = z->scan_n == 1 ? 1 : z->img_comp[n].v;
+        for (y = 0; y < bh; ++y) {
+            for (x = 0; x < bw; ++x) {
+                int x2 = i * bw + x;
+                int y2 = j * bh + y;
+                short* block = z->buffer_coeffs ? stbi__jpeg_window_block(z, n, x2, y2) : data;
+                if (!stbi__jpeg_decode_block(z, block, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                if (!z->buffer_coeffs)
+                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 * bs + x2 * bs, z->img_comp[n].w2, data);
             }
-            return 1;
         }
-        else { // interleaved
-            int i, j, k, x, y;
-            STBI_SIMD_ALIGN(short, data[64]);
-            for (j = 0; j < z->img_mcu_y; ++j) {
-                for (i = 0; i < z->img_mcu_x; ++i) {
-                    // scan an interleaved mcu... process scan_n components in order
-                    for (k = 0; k < z->scan_n; ++k) {
-                        int n = z->order[k];
-                        // scan out an mcu's worth of this component; that's just determined
-                        // by the basic H and V specified for the component
-                        for (y = 0; y < z->img_comp[n].v; ++y) {
-                            for (x = 0; x < z->img_comp[n].h; ++x) {
-                                int x2 = (i * z->img_comp[n].h + x) * 8;
-                                int y2 = (j * z->img_comp[n].v + y) * 8;
-                                int ha = z->img_comp[n].ha;
-                                if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2, z->img_comp[n].w2, data);
-                            }
-                        }
-                    }
-                    // after all interleaved components, that's an interleaved MCU,
-                    // so now count down the restart interval
-                    if (--z->todo <= 0) {
-                        if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                        if (!STBI__RESTART(z->marker)) return 1;
-                        stbi__jpeg_reset(z);
-                    }
-                }
+    }
+    return 1;
+}
+
+// entropy decodes rows [row_begin, row_end) of the scan; returns 0 on an error, 2 when
+// the scan stops early at a missing restart marker and 1 otherwise
+static int stbi__jpeg_decode_rows(stbi__jpeg* z, int units_x, int row_begin, int row_end)
+{
+    int i, j;
+    for (j = row_begin; j < row_end; ++j) {
+        for (i = 0; i < units_x; ++i) {
+            if (!stbi__jpeg_decode_unit(z, i, j)) return 0;
+            // every unit counts down the restart interval
+            if (--z->todo <= 0) {
+                if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+                // if it's NOT a restart, then just bail, so we get corrupt data
+                // rather than no data
+                if (!STBI__RESTART(z->marker)) return 2;
+                stbi__jpeg_reset(z);
+            }
+        }
+    }
+    return 1;
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    int units_x, units_y;
+    int band_units;  // scan rows per band
+    int band;        // band whose blocks go through the IDCT
+    int decode_next; // whether band + 1 is entropy decoded meanwhile
+    int status;      // of the last entropy decode, as from stbi__jpeg_decode_rows
+} stbi__jpeg_band_pipeline;
+
+// entropy decodes a band into its half of the window
+static int stbi__jpeg_decode_band(stbi__jpeg_band_pipeline* p, int band)
+{
+    stbi__jpeg* z = p->z;
+    int k, end = (band + 1) * p->band_units;
+    // a scan that stops early must not leave the blocks of two bands back behind
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k], rows = stbi__jpeg_band_blocks(z, n);
+        memset(stbi__jpeg_window_block(z, n, 0, band * rows), 0, 64 * sizeof(short) * z->img_comp[n].coeff_w * rows);
+    }
+    if (end > p->units_y) end = p->units_y;
+    return stbi__jpeg_decode_rows(z, p->units_x, band * p->band_units, end);
+}
+
+// block rows of component n in the band going through the IDCT, from *first
+static int stbi__jpeg_band_idct_rows(stbi__jpeg_band_pipeline* p, int n, int* first)
+{
+    stbi__jpeg* z = p->z;
+    int rows = stbi__jpeg_band_blocks(z, n);
+    int total = z->scan_n == 1 ? p->units_y : z->img_mcu_y * z->img_comp[n].v;
+    int end = (p->band + 1) * rows;
+    *first = p->band * rows;
+    return (end < total ? end : total) - *first;
+}
+
+// task 0 entropy decodes the next band, the others each IDCT a block row of this one
+static void stbi__jpeg_band_task(void* user, int index)
+{
+    stbi__jpeg_band_pipeline* p = (stbi__jpeg_band_pipeline*)user;
+    stbi__jpeg* z = p->z;
+    int i, k;
+    int bs = 8 >> z->scale_shift;
+    if (index == 0) {
+        if (p->decode_next)
+            p->status = stbi__jpeg_decode_band(p, p->band + 1);
+        return;
+    }
+    --index;
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k], first;
+        int rows = stbi__jpeg_band_idct_rows(p, n, &first);
+        if (index < rows) {
+            int y2 = first + index;
+            int w = z->scan_n == 1 ? p->units_x : z->img_comp[n].coeff_w;
+            for (i = 0; i < w; ++i)
+                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 * bs + i * bs, z->img_comp[n].w2, stbi__jpeg_window_block(z, n, i, y2));
+            return;
+        }
+        index -= rows;
+    }
+}
+
+// Huffman decoding stays in stream order, but each band's IDCTs run on the other
+// threads while the next band is decoded
+static int stbi__jpeg_decode_banded(stbi__jpeg* z, int units_x, int units_y)
+{
+    stbi__jpeg_band_pipeline p;
+    int k, first, tasks;
+    p.z = z;
+    p.units_x = units_x;
+    p.units_y = units_y;
+    p.band_units = z->scan_n == 1 ? stbi__jpeg_band_blocks(z, z->order[0]) : STBI__JPEG_BAND_MCU_ROWS;
+    p.status = stbi__jpeg_decode_band(&p, 0);
+    for (p.band = 0; p.status != 0; ++p.band) {
+        // a scan that stopped early still gets the blocks it reached
+        p.decode_next = p.status == 1 && (p.band + 1) * p.band_units < units_y;
+        for (tasks = 1, k = 0; k < z->scan_n; ++k)
+            tasks += stbi__jpeg_band_idct_rows(&p, z->order[k], &first);
+        stbi__jpeg_parallel_for(tasks, stbi__jpeg_band_task, &p);
+        if (!p.decode_next) break;
+    }
+    // a decode that failed on another thread left the failure reason there
+    return p.status ? 1 : stbi__err("bad huffman code", "Corrupt JPEG");
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    int units_x, units;
+    stbi_uc** segment; // entropy-coded data of every restart interval
+    int segments;
+    int per_task;      // restart intervals per task
+    int* status;       // of every task
+} stbi__jpeg_restart_split;
+
+// decodes a run of restart intervals, each from a reset copy of the decoder
+static void stbi__jpeg_restart_task(void* user, int index)
+{
+    stbi__jpeg_restart_split* r = (stbi__jpeg_restart_split*)user;
+    stbi__jpeg* z = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    stbi__context s = *r->z->s;
+    int seg, u, end;
+    int seg_end = (index + 1) * r->per_task < r->segments ? (index + 1) * r->per_task : r->segments;
+    r->status[index] = 0;
+    if (!z) return;
+    *z = *r->z;
+    z->s = &s;
+    // every interval covers its own units, so its blocks go straight through the IDCT
+    z->buffer_coeffs = 0;
+    for (seg = index * r->per_task; seg < seg_end; ++seg) {
+        s.img_buffer = r->segment[seg];
+        stbi__jpeg_reset(z);
+        end = (seg + 1) * z->restart_interval < r->units ? (seg + 1) * z->restart_interval : r->units;
+        for (u = seg * z->restart_interval; u < end; ++u) {
+            if (!stbi__jpeg_decode_unit(z, u % r->units_x, u / r->units_x)) {
+                STBI_FREE(z);
+                return;
             }
-            return 1;
         }
     }
+    STBI_FREE(z);
+    r->status[index] = 1;
+}
+
+// Cuts the entropy-coded data of a scan at its RSTn markers, so that the restart
+// intervals decode in parallel. Returns -1 if the scan has to be decoded in order: its
+// data comes through callbacks, or the markers don't match the interval count.
+static int stbi__jpeg_decode_restarts(stbi__jpeg* z, int units_x, int units_y)
+{
+    stbi__jpeg_restart_split r;
+    stbi_uc* p = z->s->img_buffer;
+    stbi_uc* end = z->s->img_buffer_end;
+    int i, tasks, ok = 1, threads = stbi__jpeg_parallel_threads();
+    r.units = units_x * units_y;
+    r.segments = (r.units + z->restart_interval - 1) / z->restart_interval;
+    if (z->s->read_from_callbacks || threads < 2 || r.segments < 2) return -1;
+    r.segment = (stbi_uc**)stbi__malloc_mad2(r.segments, sizeof(stbi_uc*), 0);
+    if (!r.segment) return -1;
+    r.segment[0] = p;
+    i = 1;
+    for (;;) {
+        // 0xff 0x00 is a stuffed byte, and any run of 0xff can pad a marker
+        p = (stbi_uc*)memchr(p, 0xff, end - p);
+        if (!p) break;
+        while (p < end && *p == 0xff) ++p;
+        if (p == end || (*p != 0x00 && (!STBI__RESTART(*p) || i == r.segments))) break;
+        if (*p != 0x00) r.segment[i++] = p + 1;
+        ++p;
+    }
+    // the scan must end at a marker, after the last interval
+    if (!p || p == end || i != r.segments) {
+        STBI_FREE(r.segment);
+        return -1;
+    }
+    tasks = threads * 4 < r.segments ? threads * 4 : r.segments;
+    r.status = (int*)stbi__malloc_mad2(tasks, sizeof(int), 0);
+    if (!r.status) {
+        STBI_FREE(r.segment);
+        return -1;
+    }
+    r.z = z;
+    r.units_x = units_x;
+    r.per_task = (r.segments + tasks - 1) / tasks;
+    stbi__jpeg_parallel_for(tasks, stbi__jpeg_restart_task, &r);
+    for (i = 0; i < tasks; ++i)
+        ok = ok && r.status[i];
+    STBI_FREE(r.status);
+    STBI_FREE(r.segment);
+    // carry on after the scan like the serial decode, with the marker read
+    z->marker = *p;
+    z->s->img_buffer = p + 1;
+    return ok ? 1 : stbi__err("bad huffman code", "Corrupt JPEG");
+}
+
+static int stbi__jpeg_decode_baseline(stbi__jpeg* z)
+{
+    int units_x, units_y, r;
+    stbi__jpeg_scan_units(z, &units_x, &units_y);
+    if (z->restart_interval) {
+        r = stbi__jpeg_decode_restarts(z, units_x, units_y);
+        if (r >= 0) return r;
+    }
+    if (z->buffer_coeffs)
+        return stbi__jpeg_decode_banded(z, units_x, units_y);
+    return stbi__jpeg_decode_rows(z, units_x, 0, units_y) != 0;
+}
+
+static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
+{
+    stbi__jpeg_reset(z);
+    if (!z->progressive)
+        return stbi__jpeg_decode_baseline(z);
     else {
         if (z->scan_n == 1) {
             int i, j;
@@ -3053,6 +3396,9 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
     }
 }
 
+// block rows per IDCT task
+#define STBI__JPEG_IDCT_ROWS 4
+
 static void stbi__jpeg_dequantize(short* data, stbi__uint16* dequant)
 {
     int i;
@@ -3060,22 +3406,40 @@ static void stbi__jpeg_dequantize(short* data, stbi__uint16* dequant)
         data[i] *= dequant[i];
 }
 
-static void stbi__jpeg_finish(stbi__jpeg* z)
-{
-    if (z->progressive) {
-        // dequantize and idct the data
-        int i, j, n;
-        for (n = 0; n < z->s->img_n; ++n) {
-            int w = (z->img_comp[n].x + 7) >> 3;
-            int h = (z->img_comp[n].y + 7) >> 3;
-            for (j = 0; j < h; ++j) {
+// task index runs over the row bands of every component in turn
+static void stbi__jpeg_idct_task(void* user, int index)
+{
+    stbi__jpeg* z = (stbi__jpeg*)user;
+    int i, j, n;
+    int bs = 8 >> z->scale_shift;
+    for (n = 0; n < z->s->img_n; ++n) {
+        int w = (z->img_comp[n].x + 7) >> 3;
+        int h = (z->img_comp[n].y + 7) >> 3;
+        int bands = (h + STBI__JPEG_IDCT_ROWS - 1) / STBI__JPEG_IDCT_ROWS;
+        if (index < bands) {
+            int end = (index + 1) * STBI__JPEG_IDCT_ROWS;
+            if (end > h) end = h;
+            for (j = index * STBI__JPEG_IDCT_ROWS; j < end; ++j) {
                 for (i = 0; i < w; ++i) {
                     short* data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                     stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
+                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * bs + i * bs, z->img_comp[n].w2, data);
                 }
             }
+            return;
         }
+        index -= bands;
+    }
+}
+
+static void stbi__jpeg_finish(stbi__jpeg* z)
+{
+    if (z->progressive) {
+        // dequantize and idct the data
+        int n, bands = 0;
+        for (n = 0; n < z->s->img_n; ++n)
+            bands += (((z->img_comp[n].y + 7) >> 3) + STBI__JPEG_IDCT_ROWS - 1) / STBI__JPEG_IDCT_ROWS;
+        stbi__jpeg_parallel_for(bands, stbi__jpeg_idct_task, z);
     }
 }
 
@@ -3303,6 +3667,11 @@ static int stbi__process_frame_header(stbi__jpeg* z, int scan)
     z->img_mcu_x = (s->img_x + z->img_mcu_w - 1) / z->img_mcu_w;
     z->img_mcu_y = (s->img_y + z->img_mcu_h - 1) / z->img_mcu_h;
 
+    // Buffering a band of baseline blocks lets its IDCTs run in parallel with the entropy
+    // decode of the next; not worth it for a handful of MCU rows, or for the reduced IDCTs
+    // of a scaled decode, which cost little next to the Huffman decoding
+    z->buffer_coeffs = !z->progressive && z->scale_shift == 0 && z->img_mcu_y >= 2 * STBI__JPEG_BAND_MCU_ROWS && stbi__jpeg_parallel_threads() > 1;
+
     for (i = 0; i < s->img_n; ++i) {
         // number of effective pixels (e.g. for non-interleaved MCU)
         z->img_comp[i].x = (s->img_x * z->img_comp[i].h + h_max - 1) / h_max;
@@ -3314,8 +3683,8 @@ static int stbi__process_frame_header(stbi__jpeg* z, int scan)
         //
         // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
         // so these muls can't overflow with 32-bit ints (which we require)
-        z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-        z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+        z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * (8 >> z->scale_shift);
+        z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * (8 >> z->scale_shift);
         z->img_comp[i].coeff = 0;
         z->img_comp[i].raw_coeff = 0;
         z->img_comp[i].linebuf = NULL;
@@ -3324,11 +3693,12 @@ static int stbi__process_frame_header(stbi__jpeg* z, int scan)
             return stbi__free_jpeg_components(z, i + 1, stbi__err("outofmem", "Out of memory"));
         // align blocks for idct using mmx/sse
         z->img_comp[i].data = (stbi_uc*)(((size_t)z->img_comp[i].raw_data + 15) & ~15);
-        if (z->progressive) {
-            // w2, h2 are multiples of 8 (see above)
-            z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-            z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-            z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+        if (z->progressive || z->buffer_coeffs) {
+            // progressive scans refine the coefficients of every block whatever the output
+            // scale; buffered baseline ones only need the window of two bands
+            z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+            z->img_comp[i].coeff_h = z->progressive ? z->img_mcu_y * z->img_comp[i].v : 2 * stbi__jpeg_band_blocks(z, i);
+            z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
             if (z->img_comp[i].raw_coeff == NULL)
                 return stbi__free_jpeg_components(z, i + 1, stbi__err("outofmem", "Out of memory"));
             z->img_comp[i].coeff = (short*)(((size_t)z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3409,8 +3779,7 @@ static int stbi__decode_jpeg_image(stbi__jpeg* j)
         }
         m = stbi__get_marker(j);
     }
-    if (j->progressive)
-        stbi__jpeg_finish(j);
+    stbi__jpeg_finish(j);
     return 1;
 }
 
@@ -3788,6 +4157,8 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc* out, stbi_uc const* y, stbi_uc cons
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg* j)
 {
+    j->scale_shift = 0;
+    j->buffer_coeffs = 0;
     j->idct_block_kernel = stbi__idct_block;
     j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
     j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
@@ -3805,6 +4176,12 @@ static void stbi__setup_jpeg(stbi__jpeg* j)
     j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
     j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
 #endif
+
+#ifdef STBI_JPEG_KERNEL_HOOK
+    // Application override, e.g. wider SIMD picked at runtime; gets the portable kernels too
+    STBI_JPEG_KERNEL_HOOK(j->idct_block_kernel, j->YCbCr_to_RGB_kernel, j->resample_row_hv_2_kernel,
+                          stbi__idct_block, stbi__YCbCr_to_RGB_row, stbi__resample_row_hv_2);
+#endif
 }
 
 // clean up the temporary component buffers
@@ -3830,6 +4207,157 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
     return (stbi_uc)((t + (t >> 8)) >> 8);
 }
 
+// State shared by the row bands of the resample and color conversion pass
+typedef struct
+{
+    stbi__jpeg* z;
+    stbi_uc* output;
+    stbi_uc* last_rows; // per band, see stbi__jpeg_convert_task
+    stbi__resample res_comp[4];
+    int n, decode_n, is_rgb;
+    int bands;
+} stbi__jpeg_convert;
+
+// Put a resampler into the state it has when it reaches output row j
+static void stbi__resample_seek(stbi__resample* r, stbi_uc* data, int w2, int rows, int j)
+{
+    int t = (r->vs >> 1) + j;
+    int m = t / r->vs;
+    r->ystep = t % r->vs;
+    r->ypos = m;
+    r->line1 = data + (m < rows - 1 ? m : rows - 1) * w2;
+    r->line0 = m == 0 ? data : data + (m - 1 < rows - 1 ? m - 1 : rows - 1) * w2;
+}
+
+// Resample and color-convert one band of output rows, with the band's own line buffers
+static void stbi__jpeg_convert_task(void* user, int band)
+{
+    stbi__jpeg_convert* c = (stbi__jpeg_convert*)user;
+    stbi__jpeg* z = c->z;
+    stbi__resample res_comp[4];
+    stbi_uc* linebuf[4];
+    stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+    unsigned int i, j;
+    unsigned int j_begin = (unsigned int)((size_t)z->s->img_y * band / c->bands);
+    unsigned int j_end = (unsigned int)((size_t)z->s->img_y * (band + 1) / c->bands);
+    int k;
+
+    for (k = 0; k < c->decode_n; ++k) {
+        res_comp[k] = c->res_comp[k];
+        stbi__resample_seek(&res_comp[k], z->img_comp[k].data, z->img_comp[k].w2, z->img_comp[k].y, (int)j_begin);
+        linebuf[k] = z->img_comp[k].linebuf + (size_t)band * (z->s->img_x + 3);
+    }
+
+    for (j = j_begin; j < j_end; ++j) {
+        // the converters write one byte past the row, which is the next band's first
+        // pixel; a band's last row goes through its own buffer so that can't race
+        stbi_uc* row = c->output + c->n * z->s->img_x * j;
+        stbi_uc* out = j + 1 == j_end && band + 1 < c->bands ? c->last_rows + (size_t)band * (c->n * z->s->img_x + 1) : row;
+        for (k = 0; k < c->decode_n; ++k) {
+            stbi__resample* r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k],
+                y_bot ? r->line1 : r->line0,
+                y_bot ? r->line0 : r->line1,
+                r->w_lores, r->hs);
+            if (++r->ystep >= r->vs) {
+                r->ystep = 0;
+                r->line0 = r->line1;
+                if (++r->ypos < z->img_comp[k].y)
+                    r->line1 += z->img_comp[k].w2;
+            }
+        }
+        if (c->n >= 3) {
+            stbi_uc* y = coutput[0];
+            if (z->s->img_n == 3) {
+                if (c->is_rgb) {
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        out[0] = y[i];
+                        out[1] = coutput[1][i];
+                        out[2] = coutput[2][i];
+                        out[3] = 255;
+                        out += c->n;
+                    }
+                }
+                else {
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, c->n);
+                }
+            }
+            else if (z->s->img_n == 4) {
+                if (z->app14_color_transform == 0) { // CMYK
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                        out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                        out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                        out[3] = 255;
+                        out += c->n;
+                    }
+                }
+                else if (z->app14_color_transform == 2) { // YCCK
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, c->n);
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(255 - out[0], m);
+                        out[1] = stbi__blinn_8x8(255 - out[1], m);
+                        out[2] = stbi__blinn_8x8(255 - out[2], m);
+                        out += c->n;
+                    }
+                }
+                else { // YCbCr + alpha?  Ignore the fourth channel for now
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, c->n);
+                }
+            }
+            else
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = out[1] = out[2] = y[i];
+                    out[3] = 255; // not used if n==3
+                    out += c->n;
+                }
+        }
+        else {
+            if (c->is_rgb) {
+                if (c->n == 1)
+                    for (i = 0; i < z->s->img_x; ++i)
+                        *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                else {
+                    for (i = 0; i < z->s->img_x; ++i, out += 2) {
+                        out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                        out[1] = 255;
+                    }
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    stbi_uc m = coutput[3][i];
+                    stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+                    stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+                    stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+                    out[0] = stbi__compute_y(r, g, b);
+                    out[1] = 255;
+                    out += c->n;
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+                    out[1] = 255;
+                    out += c->n;
+                }
+            }
+            else {
+                stbi_uc* y = coutput[0];
+                if (c->n == 1)
+                    for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
+                else
+                    for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+            }
+        }
+        if (j + 1 == j_end && band + 1 < c->bands)
+            memcpy(row, c->last_rows + (size_t)band * (c->n * z->s->img_x + 1), c->n * z->s->img_x);
+    }
+}
+
 static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp, int req_comp)
 {
     int n, decode_n, is_rgb;
@@ -3841,6 +4369,17 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
     // load a jpeg image from whichever source, but leave in YCbCr format
     if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
+    // scaled decodes: from here on the image and its planes are the reduced size
+    if (z->scale_shift) {
+        int round = (1 << z->scale_shift) - 1;
+        z->s->img_x = (z->s->img_x + round) >> z->scale_shift;
+        z->s->img_y = (z->s->img_y + round) >> z->scale_shift;
+        for (n = 0; n < z->s->img_n; ++n) {
+            z->img_comp[n].x = (z->img_comp[n].x + round) >> z->scale_shift;
+            z->img_comp[n].y = (z->img_comp[n].y + round) >> z->scale_shift;
+        }
+    }
+
     // determine actual number of components to generate
     n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
@@ -3858,18 +4397,24 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
     // resample and color-convert
     {
         int k;
-        unsigned int i, j;
         stbi_uc* output;
-        stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+        stbi__jpeg_convert convert;
 
-        stbi__resample res_comp[4];
+        convert.z = z;
+        convert.n = n;
+        convert.decode_n = decode_n;
+        convert.is_rgb = is_rgb;
+        // a few bands per thread keeps them busy when bands finish unevenly
+        convert.bands = stbi__jpeg_parallel_threads() * 4;
+        if (convert.bands > (int)z->s->img_y / 16) convert.bands = (int)z->s->img_y / 16;
+        if (convert.bands < 1) convert.bands = 1;
 
         for (k = 0; k < decode_n; ++k) {
-            stbi__resample* r = &res_comp[k];
+            stbi__resample* r = &convert.res_comp[k];
 
             // allocate line buffer big enough for upsampling off the edges
-            // with upsample factor of 4
-            z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc(z->s->img_x + 3);
+            // with upsample factor of 4, one per band
+            z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc_mad2(convert.bands, z->s->img_x + 3, 0);
             if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
             r->hs = z->img_h_max / z->img_comp[k].h;
@@ -3886,114 +4431,19 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
             else                               r->resample = stbi__resample_row_generic;
         }
 
-        // can't error after this so, this is safe
         output = (stbi_uc*)stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
-        // now go ahead and resample
-        for (j = 0; j < z->s->img_y; ++j) {
-            stbi_uc* out = output + n * z->s->img_x * j;
-            for (k = 0; k < decode_n; ++k) {
-                stbi__resample* r = &res_comp[k];
-                int y_bot = r->ystep >= (r->vs >> 1);
-                coutput[k] = r->resample(z->img_comp[k].linebuf,
-                    y_bot ? r->line1 : r->line0,
-                    y_bot ? r->line0 : r->line1,
-                    r->w_lores, r->hs);
-                if (++r->ystep >= r->vs) {
-                    r->ystep = 0;
-                    r->line0 = r->line1;
-                    if (++r->ypos < z->img_comp[k].y)
-                        r->line1 += z->img_comp[k].w2;
-                }
-            }
-            if (n >= 3) {
-                stbi_uc* y = coutput[0];
-                if (z->s->img_n == 3) {
-                    if (is_rgb) {
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            out[0] = y[i];
-                            out[1] = coutput[1][i];
-                            out[2] = coutput[2][i];
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else {
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else if (z->s->img_n == 4) {
-                    if (z->app14_color_transform == 0) { // CMYK
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                            out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                            out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else if (z->app14_color_transform == 2) { // YCCK
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(255 - out[0], m);
-                            out[1] = stbi__blinn_8x8(255 - out[1], m);
-                            out[2] = stbi__blinn_8x8(255 - out[2], m);
-                            out += n;
-                        }
-                    }
-                    else { // YCbCr + alpha?  Ignore the fourth channel for now
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = out[1] = out[2] = y[i];
-                        out[3] = 255; // not used if n==3
-                        out += n;
-                    }
-            }
-            else {
-                if (is_rgb) {
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i)
-                            *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                    else {
-                        for (i = 0; i < z->s->img_x; ++i, out += 2) {
-                            out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                            out[1] = 255;
-                        }
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        stbi_uc m = coutput[3][i];
-                        stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                        stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                        stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                        out[0] = stbi__compute_y(r, g, b);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else {
-                    stbi_uc* y = coutput[0];
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
-                    else
-                        for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-                }
-            }
+        convert.output = output;
+        convert.last_rows = NULL;
+        if (convert.bands > 1) {
+            convert.last_rows = (stbi_uc*)stbi__malloc_mad3(convert.bands - 1, n, z->s->img_x, convert.bands - 1);
+            if (!convert.last_rows) { STBI_FREE(output); stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
         }
+
+        // now go ahead and resample
+        stbi__jpeg_parallel_for(convert.bands, stbi__jpeg_convert_task, &convert);
+        STBI_FREE(convert.last_rows);
         stbi__cleanup_jpeg(z);
         *out_x = z->s->img_x;
         *out_y = z->s->img_y;
@@ -4010,6 +4460,10 @@ static void* stbi__jpeg_load(stbi__context* s, int* x, int* y, int* comp, int re
     STBI_NOTUSED(ri);
     j->s = s;
     stbi__setup_jpeg(j);
+    j->scale_shift = stbi__jpeg_scale_on_load;
+    if (j->scale_shift == 1) j->idct_block_kernel = stbi__idct_block_4x4;
+    else if (j->scale_shift == 2) j->idct_block_kernel = stbi__idct_block_2x2;
+    else if (j->scale_shift == 3) j->idct_block_kernel = stbi__idct_block_1x1;
     result = load_jpeg_image(j, x, y, comp, req_comp);
     STBI_FREE(j);
     return result;
@@ -0,0 +1,242 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "image_scale.hpp"
+#include "mapped_file.hpp"
+
+// Decoded textures kept on disk between runs. An entry holds the 8-bit texels of every mip
+// level at the size the loader would have produced, keyed by a hash of the source file's
+// bytes and the decode options. A warm start maps the entry and uploads each level from
+// the mapping, skipping the decode, the resample and the mip build. Entries are written
+// in native byte order for the machine that reads them back, and are never invalidated:
+// an edited source hashes to a new key.
+
+constexpr std::uint32_t TEXTURE_CACHE_VERSION = 2;
+constexpr int TEXTURE_CACHE_MAX_LEVELS = 16;
+constexpr std::size_t TEXTURE_CACHE_ALIGNMENT = 64; // Level data starts on a cache line
+constexpr char TEXTURE_CACHE_MAGIC[8] = { 'E', 'C', 'T', 'E', 'X', 'C', 'H', '\n' };
+
+struct TextureCacheLevel
+{
+    std::uint64_t offset; // From the start of the entry
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+struct TextureCacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t levelCount;
+    std::uint64_t key;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t channels;
+    std::uint32_t produceMicroseconds; // What the miss spent decoding and building mips
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+};
+
+namespace texture_cache_detail
+{
+    inline std::uint64_t mix(std::uint64_t hash, std::uint64_t value)
+    {
+        hash = (hash ^ value) * 0x100000001b3ull;
+        return hash ^ (hash >> 29);
+    }
+
+    inline std::size_t alignUp(std::size_t bytes)
+    {
+        return (bytes + TEXTURE_CACHE_ALIGNMENT - 1) / TEXTURE_CACHE_ALIGNMENT * TEXTURE_CACHE_ALIGNMENT;
+    }
+}
+
+// Content hash of a source file combined with everything that changes its decode. Eight
+// bytes per step, hashing is noise next to the decode it replaces.
+inline std::uint64_t textureCacheKey(const unsigned char* source, std::size_t bytes, int maxSize, int channels, bool flipped)
+{
+    using namespace texture_cache_detail;
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    std::size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, source + i, 8);
+        hash = mix(hash, word);
+    }
+    for (; i < bytes; ++i)
+        hash = mix(hash, source[i]);
+    hash = mix(hash, bytes);
+    hash = mix(hash, static_cast<std::uint64_t>(std::max(0, maxSize)));
+    hash = mix(hash, static_cast<std::uint64_t>(channels));
+    hash = mix(hash, flipped ? 1u : 0u);
+    return mix(hash, TEXTURE_CACHE_VERSION);
+}
+
+// A complete entry in memory: the header, then every level of `channels`-byte `pixels`
+// reduced to width x height and halved down to 1x1. The loader uploads from it and writes it out.
+inline std::vector<unsigned char> buildTextureCacheEntry(std::uint64_t key, const unsigned char* pixels, int pixelsWidth,
+                                                         int pixelsHeight, int width, int height, int channels)
+{
+    using namespace texture_cache_detail;
+    TextureCacheHeader header = {};
+    std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.key = key;
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.channels = static_cast<std::uint32_t>(channels);
+
+    std::size_t bytes = alignUp(sizeof(TextureCacheHeader));
+    for (int level = 0; level < TEXTURE_CACHE_MAX_LEVELS; ++level)
+    {
+        TextureCacheLevel& entry = header.levels[level];
+        entry.offset = bytes;
+        entry.width = static_cast<std::uint32_t>(std::max(1, width >> level));
+        entry.height = static_cast<std::uint32_t>(std::max(1, height >> level));
+        bytes = alignUp(bytes + static_cast<std::size_t>(entry.width) * entry.height * channels);
+        header.levelCount = static_cast<std::uint32_t>(level + 1);
+        if (entry.width == 1 && entry.height == 1)
+            break;
+    }
+
+    std::vector<unsigned char> data(bytes);
+    unsigned char* const base = data.data();
+    if (pixelsWidth == width && pixelsHeight == height)
+        std::memcpy(base + header.levels[0].offset, pixels, static_cast<std::size_t>(width) * height * channels);
+    else
+        resampleImage(pixels, pixelsWidth, pixelsHeight, base + header.levels[0].offset, width, height, channels);
+    // Each level is area-averaged from the one above, like glGenerateMipmap's box filter
+    for (std::uint32_t level = 1; level < header.levelCount; ++level)
+    {
+        const TextureCacheLevel& above = header.levels[level - 1];
+        const TextureCacheLevel& entry = header.levels[level];
+        resampleImage(base + above.offset, static_cast<int>(above.width), static_cast<int>(above.height),
+                      base + entry.offset, static_cast<int>(entry.width), static_cast<int>(entry.height), channels);
+    }
+    std::memcpy(base, &header, sizeof(header));
+    return data;
+}
+
+// Header of an entry, false if it is from another version or cut short
+inline bool readTextureCacheHeader(const unsigned char* data, std::size_t size, TextureCacheHeader& header)
+{
+    if (size < sizeof(TextureCacheHeader))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != TEXTURE_CACHE_VERSION ||
+        header.channels == 0 || header.channels > 4 || header.levelCount == 0 || header.levelCount > TEXTURE_CACHE_MAX_LEVELS)
+        return false;
+    for (std::uint32_t level = 0; level < header.levelCount; ++level)
+    {
+        const TextureCacheLevel& entry = header.levels[level];
+        if (entry.width != std::max(1u, header.width >> level) || entry.height != std::max(1u, header.height >> level) ||
+            entry.offset > size || static_cast<std::uint64_t>(entry.width) * entry.height * header.channels > size - entry.offset)
+            return false;
+    }
+    return true;
+}
+
+class TextureCache
+{
+public:
+    // Entries are <key>.texcache files in `directory`, which is created on the first store.
+    // `flipped` must match stbi_set_flip_vertically_on_load for the decodes being cached.
+    TextureCache(std::string directory, bool flipped)
+        : directory(std::move(directory)), flipped(flipped)
+    {
+    }
+
+    // `channels` is what the decode is asked for
+    std::uint64_t keyFor(const std::vector<unsigned char>& source, int maxSize, int channels) const
+    {
+        return textureCacheKey(source.data(), source.size(), maxSize, channels, flipped);
+    }
+
+    // Map the entry for `key`; false if there is none or it cannot be used
+    bool find(std::uint64_t key, MappedFile& file, TextureCacheHeader& header) const
+    {
+        return file.open(pathFor(key)) && readTextureCacheHeader(file.data(), file.size(), header) && header.key == key;
+    }
+
+    // Written to a temporary name and renamed, so a reader never maps half an entry. The
+    // temporary name is unique to this write, so processes storing the same entry at once
+    // never write into one file.
+    bool store(std::vector<unsigned char>& entry, double produceMs)
+    {
+        TextureCacheHeader header;
+        std::memcpy(&header, entry.data(), sizeof(header));
+        header.produceMicroseconds = static_cast<std::uint32_t>(std::max(0.0, produceMs * 1000.0));
+        std::memcpy(entry.data(), &header, sizeof(header));
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        const std::string path = pathFor(header.key);
+        const std::string temporary = temporaryPathFor(path);
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.write(reinterpret_cast<const char*>(entry.data()), static_cast<std::streamsize>(entry.size())))
+                return false;
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            // Another process got there first (Windows will not rename over a file)
+            std::remove(temporary.c_str());
+            return false;
+        }
+        ++stores;
+        return true;
+    }
+
+    void recordHit(const TextureCacheHeader& header, double loadMs)
+    {
+        ++hits;
+        const std::int64_t saved = static_cast<std::int64_t>(header.produceMicroseconds) - static_cast<std::int64_t>(loadMs * 1000.0);
+        savedMicroseconds += std::max<std::int64_t>(0, saved);
+    }
+
+    void recordMiss() { ++misses; }
+
+    // Decode and mip build time the hits did not spend, less what they spent instead
+    double savedMs() const { return static_cast<double>(savedMicroseconds.load()) / 1000.0; }
+
+    std::atomic<int> hits{ 0 };
+    std::atomic<int> misses{ 0 };
+    std::atomic<int> stores{ 0 };
+
+private:
+    std::string pathFor(std::uint64_t key) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.texcache", static_cast<unsigned long long>(key));
+        return directory + "/" + name;
+    }
+
+    // <path>.<process tag>-<write number>.tmp; the tag is random per process
+    static std::string temporaryPathFor(const std::string& path)
+    {
+        static const unsigned long long processTag =
+            (static_cast<unsigned long long>(std::random_device()()) << 32) | std::random_device()();
+        static std::atomic<unsigned> writes{ 0 };
+        char suffix[48];
+        std::snprintf(suffix, sizeof(suffix), ".%016llx-%u.tmp", processTag, writes++);
+        return path + suffix;
+    }
+
+    std::string directory;
+    bool flipped;
+    std::atomic<std::int64_t> savedMicroseconds{ 0 };
+};
+
+#endif
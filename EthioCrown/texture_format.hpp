@@ -0,0 +1,279 @@
+#ifndef TEXTURE_FORMAT_HPP
+#define TEXTURE_FORMAT_HPP
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+// Internal format negotiation and texture memory accounting for the texture loader. Every
+// image gets the smallest format that holds what it is used for: one or two channel
+// sources stay R8 / RG8 (swizzled so shaders still read grey), colour can drop to RGB565
+// or use the sRGB formats, and block-compressed files keep their encoding. Sizes are
+// driver-side estimates kept per texture and per category against an optional budget.
+
+enum TextureCategory
+{
+    TEXTURE_COLOR, // Albedo and other colour, sRGB encoded when that is enabled
+    TEXTURE_MASK,  // Single-channel coverage, always R8
+    TEXTURE_DATA,  // Linear values, never sRGB or lossy formats
+    TEXTURE_CATEGORY_COUNT
+};
+
+inline const char* textureCategoryName(int category)
+{
+    switch (category)
+    {
+    case TEXTURE_COLOR: return "color";
+    case TEXTURE_MASK: return "mask";
+    default: return "data";
+    }
+}
+
+struct TextureFormatOptions
+{
+    bool srgb = false;   // Colour textures are sRGB; needs GL_FRAMEBUFFER_SRGB to look right
+    bool rgb565 = false; // Opaque colour is stored 16-bit (internal format needs GL 4.1)
+};
+
+struct TextureFormat
+{
+    GLint internalFormat = GL_RGB8;
+    GLenum format = GL_RGB;        // Of the pixels handed to GL, always GL_UNSIGNED_BYTE
+    int channels = 3;              // Bytes per pixel handed to GL
+    int bytesPerTexel = 4;         // What the driver is assumed to store
+    GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+};
+
+// Channels the decoder should produce for a `sourceChannels` image used as `category`
+inline int textureDecodeChannels(int sourceChannels, TextureCategory category)
+{
+    return category == TEXTURE_MASK ? 1 : sourceChannels;
+}
+
+// Format for `channels`-byte pixels. Three-byte texels are counted as four, which is how
+// drivers store them.
+inline TextureFormat chooseTextureFormat(int channels, TextureCategory category, const TextureFormatOptions& options)
+{
+    TextureFormat texture;
+    texture.channels = channels;
+    const bool srgb = options.srgb && category == TEXTURE_COLOR;
+    switch (channels)
+    {
+    case 1:
+        texture.internalFormat = GL_R8;
+        texture.format = GL_RED;
+        texture.bytesPerTexel = 1;
+        texture.swizzle[1] = texture.swizzle[2] = GL_RED;
+        texture.swizzle[3] = GL_ONE;
+        break;
+    case 2:
+        // Grey and alpha
+        texture.internalFormat = GL_RG8;
+        texture.format = GL_RG;
+        texture.bytesPerTexel = 2;
+        texture.swizzle[1] = texture.swizzle[2] = GL_RED;
+        texture.swizzle[3] = GL_GREEN;
+        break;
+    case 4:
+        texture.internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        texture.format = GL_RGBA;
+        texture.bytesPerTexel = 4;
+        break;
+    default:
+        // There is no sRGB 565, sRGB wins over the smaller format
+        if (options.rgb565 && category == TEXTURE_COLOR && !srgb)
+        {
+            texture.internalFormat = GL_RGB565;
+            texture.bytesPerTexel = 2;
+        }
+        else
+        {
+            texture.internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+        }
+        break;
+    }
+    return texture;
+}
+
+// Largest unpack alignment that keeps tightly packed rows of `rowBytes` at `address`
+// where GL expects them, so uploads of odd-width rows stay correct and the rest stay fast
+inline GLint unpackAlignment(std::size_t rowBytes, std::uintptr_t address)
+{
+    for (GLint alignment = 8; alignment > 1; alignment /= 2)
+        if (rowBytes % alignment == 0 && address % alignment == 0)
+            return alignment;
+    return 1;
+}
+
+// Swizzle of the bound texture, so one and two channel formats read as grey
+inline void applyTextureFormat(const TextureFormat& format)
+{
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle);
+}
+
+// Levels of a full mip chain of `width` x `height`
+inline int textureLevelCount(int width, int height)
+{
+    int levels = 1;
+    while ((std::max(width, height) >> levels) > 0)
+        ++levels;
+    return levels;
+}
+
+// Bytes of a mip chain of `width` x `height` at `bytesPerTexel` from that size down to 1x1
+inline std::size_t textureChainBytes(int width, int height, int bytesPerTexel)
+{
+    std::size_t bytes = 0;
+    for (;;)
+    {
+        bytes += static_cast<std::size_t>(width) * height * bytesPerTexel;
+        if (width == 1 && height == 1)
+            return bytes;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
+
+// Texture memory in use, by texture and by category. The texture loader reserve()s budget
+// before an upload and commit()s it to the texture it created, or cancel()s it if the upload
+// failed; whoever deletes a texture release()s it. Reserved bytes count against the budget,
+// so uploads racing each other cannot both squeeze into the same headroom.
+class TextureMemory
+{
+public:
+    // 0 leaves texture memory unlimited
+    void setBudget(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        budgetBytes = bytes;
+    }
+
+    std::size_t budget() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return budgetBytes;
+    }
+
+    // Claim `bytes` of the budget if they stay within it
+    bool reserve(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (budgetBytes != 0 && total + reserved + bytes > budgetBytes)
+            return false;
+        reserved += bytes;
+        return true;
+    }
+
+    // Turn a reservation of `reservedBytes` into `texture` holding `bytes`
+    void commit(std::size_t reservedBytes, GLuint texture, TextureCategory category, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reserved -= reservedBytes;
+        trackLocked(texture, category, bytes);
+    }
+
+    void cancel(std::size_t reservedBytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reserved -= reservedBytes;
+    }
+
+    // Account a texture made without a reservation
+    void track(GLuint texture, TextureCategory category, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        trackLocked(texture, category, bytes);
+    }
+
+    void release(GLuint texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = textures.find(texture);
+        if (found == textures.end())
+            return;
+        removeLocked(found->second);
+        textures.erase(found);
+    }
+
+    std::size_t used() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total;
+    }
+
+    std::size_t used(TextureCategory category) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return categories[category].bytes;
+    }
+
+    std::size_t bytesOf(GLuint texture) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = textures.find(texture);
+        return found == textures.end() ? 0 : found->second.bytes;
+    }
+
+    // One line per category that holds anything, then the total against the budget
+    void report(std::ostream& out) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int category = 0; category < TEXTURE_CATEGORY_COUNT; ++category)
+            if (categories[category].textures > 0)
+                out << "texture memory " << textureCategoryName(category) << ": " << categories[category].textures << " textures, "
+                    << categories[category].bytes / 1024 << " KiB" << std::endl;
+        out << "texture memory: " << total / 1024 << " KiB";
+        if (budgetBytes > 0)
+            out << " of " << budgetBytes / 1024 << " KiB budget, " << downsized << " downsized, " << rejected << " rejected";
+        out << std::endl;
+    }
+
+    // Uploads made smaller to fit the budget, and ones that did not fit at any size
+    std::atomic<int> downsized{ 0 };
+    std::atomic<int> rejected{ 0 };
+
+private:
+    struct Entry
+    {
+        TextureCategory category = TEXTURE_COLOR;
+        std::size_t bytes = 0;
+    };
+
+    struct Category
+    {
+        int textures = 0;
+        std::size_t bytes = 0;
+    };
+
+    void trackLocked(GLuint texture, TextureCategory category, std::size_t bytes)
+    {
+        auto found = textures.find(texture);
+        if (found != textures.end())
+            removeLocked(found->second);
+        textures[texture] = Entry{ category, bytes };
+        categories[category].bytes += bytes;
+        ++categories[category].textures;
+        total += bytes;
+    }
+
+    void removeLocked(const Entry& entry)
+    {
+        categories[entry.category].bytes -= entry.bytes;
+        --categories[entry.category].textures;
+        total -= entry.bytes;
+    }
+
+    mutable std::mutex mutex;
+    std::unordered_map<GLuint, Entry> textures;
+    Category categories[TEXTURE_CATEGORY_COUNT];
+    std::size_t total = 0;
+    std::size_t reserved = 0;  // Claimed by uploads in progress
+    std::size_t budgetBytes = 0;
+};
+
+#endif
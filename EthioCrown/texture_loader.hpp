@@ -0,0 +1,660 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+// main.cpp includes stb_image.h with STB_IMAGE_IMPLEMENTATION, which must not be expanded twice
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+#include "decode_target.hpp"
+#include "image_scale.hpp"
+#include "frame_ring.hpp"
+#include "asset_pack.hpp"
+#include "ktx2.hpp"
+#include "texture_cache.hpp"
+#include "texture_format.hpp"
+
+// Decodes and uploads textures on a thread with its own GL context, shared with the main
+// window through a hidden window. Every finished texture is published with a fence; the
+// render thread polls for textures whose fence has signalled and only then switches to
+// them, so it never waits on a decode, an upload or a mipmap build. Images are decoded
+// directly into a mapped pixel unpack buffer and the texture is sourced from there, so
+// there is no heap copy of the pixels between the decoder and the driver. KTX2 files are
+// read into the same buffer and uploaded level by level, with no decode or mip build.
+// Images found in an AssetPack are uploaded with their mip chain from the pack's mapping.
+// With a TextureCache, other images are uploaded with their mip chain from a mapped cache entry,
+// and a miss decodes to the heap to build and write that entry first. Every texture gets
+// the internal format texture_format.hpp picks for its channels and category, and with a
+// TextureMemory drops top mip levels until it fits the budget. Streamed textures keep their
+// decoded chain after the first upload, so other levels of it are uploaded without a decode.
+
+constexpr int TEXTURE_STREAM_BASE_SIZE = 64; // Streamed textures start with levels of at most this size
+
+struct LoadedTexture
+{
+    int slot = -1;        // Caller's tag from load()
+    GLuint texture = 0;   // 0 if the file could not be decoded
+
+    // Streamed textures only: the texture holds levels from `level` on of a `levelCount`
+    // chain whose level 0 is width x height
+    int level = 0;
+    int levelCount = 0;
+    int width = 0;
+    int height = 0;
+    int bytesPerTexel = 0;
+};
+
+class TextureLoader
+{
+public:
+    TextureLoader() = default;
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+    ~TextureLoader() { stop(); }
+
+    // Main thread only (GLFW creates windows there), with the current window hints.
+    // Without a shared context load() uploads on the calling thread instead.
+    bool start(GLFWwindow* shareWith)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context = glfwCreateWindow(1, 1, "texture loader", nullptr, shareWith);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!context)
+            return false;
+        thread = std::thread(&TextureLoader::run, this);
+        return true;
+    }
+
+    // Main thread only, before the first load(); nullptr decodes every image each time
+    void setCache(TextureCache* textureCache)
+    {
+        cache = textureCache;
+    }
+
+    // Main thread only, before the first load()
+    void setFormats(const TextureFormatOptions& options)
+    {
+        formats = options;
+    }
+
+    // Main thread only, before the first load(); uploads are accounted in and limited by
+    // `textureMemory`
+    void setMemory(TextureMemory* textureMemory)
+    {
+        memory = textureMemory;
+    }
+
+    // Main thread only, before the first load(). The pack must stay open while loading.
+    void setPack(const AssetPack* assetPack)
+    {
+        pack = assetPack;
+    }
+
+    // Queue an image or .ktx2 file; it shows up in poll() tagged with `slot`. Images larger
+    // than `maxSize` on either side are decoded reduced to fit, KTX2 files start at the
+    // first mip level that fits; 0 keeps them as stored. `category` picks the format.
+    void load(const char* path, int slot, int maxSize = 0, TextureCategory category = TEXTURE_COLOR)
+    {
+        queue(Request{ path, slot, maxSize, category, false, -1 });
+    }
+
+    // Queue an image whose levels are streamed: it shows up in poll() holding only the levels
+    // of at most TEXTURE_STREAM_BASE_SIZE, and restream() swaps in other levels later. The
+    // decoded chain stays mapped (or in memory) until stop(). KTX2 files load as with load().
+    void stream(const char* path, int slot, TextureCategory category = TEXTURE_COLOR)
+    {
+        queue(Request{ path, slot, 0, category, true, -1 });
+    }
+
+    // Queue a new texture for a streamed `slot` holding its chain from `level` on; it shows
+    // up in poll() like the first one, which the caller then deletes
+    void restream(int slot, int level)
+    {
+        queue(Request{ std::string(), slot, 0, TEXTURE_COLOR, true, level });
+    }
+
+    // A texture the GPU has finished uploading, never blocks. Needs a current context
+    // in the loader's share group.
+    bool poll(LoadedTexture& loaded)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::size_t i = 0; i < uploaded.size(); ++i)
+        {
+            const GLenum status = glClientWaitSync(uploaded[i].fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+            glDeleteSync(uploaded[i].fence);
+            loaded = uploaded[i].texture;
+            uploaded.erase(uploaded.begin() + i);
+            return true;
+        }
+        return false;
+    }
+
+    // Block until everything queued so far is uploaded and complete, for benchmarks
+    void finish()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return pending == 0; });
+        for (const Upload& upload : uploaded)
+            while (glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+    }
+
+    // Main thread only. Queued files that were not started are dropped.
+    void stop()
+    {
+        if (!context)
+        {
+            releaseUnpack();
+            streamSources.clear();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+        glfwDestroyWindow(context);
+        context = nullptr;
+        for (const Upload& upload : uploaded)
+            glDeleteSync(upload.fence);
+        uploaded.clear();
+        streamSources.clear();
+    }
+
+    // Images decoded straight into the unpack ring, and ones that needed a copy into it
+    std::atomic<int> decodedInPlace{ 0 };
+    std::atomic<int> decodedCopied{ 0 };
+    std::atomic<int> decodedResampled{ 0 }; // Reduced to a maximum size, resampled into the ring
+    std::atomic<int> uploadedCompressed{ 0 }; // KTX2 mip chains, no decode
+    std::atomic<int> uploadedPacked{ 0 };     // Asset pack mip chains, no decode
+    std::atomic<int> uploadedStreamed{ 0 };   // Levels of streamed chains swapped in, no decode
+
+private:
+    struct Request
+    {
+        std::string path;
+        int slot;
+        int maxSize;
+        TextureCategory category;
+        bool streamed;
+        int level; // restream(): first level of the new texture, -1 for the first upload
+    };
+
+    // Decoded mip chain levels are uploaded from: a mapped cache entry, a pack entry, or an
+    // entry built in memory when there is no cache
+    struct LevelSource
+    {
+        MappedFile mapped;
+        std::vector<unsigned char> storage;
+        const unsigned char* data = nullptr;
+        TextureCacheHeader header;
+        TextureCategory category = TEXTURE_COLOR; // Of the streamed texture it belongs to
+    };
+
+    void queue(Request request)
+    {
+        if (!context)
+        {
+            upload(request);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(std::move(request));
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+    struct Upload
+    {
+        LoadedTexture texture;
+        GLsync fence;
+    };
+
+    void run()
+    {
+        glfwMakeContextCurrent(context);
+        for (;;)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping)
+                    break;
+                request = std::move(requests.front());
+                requests.pop_front();
+            }
+            upload(request);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --pending;
+            }
+            idle.notify_all();
+        }
+        releaseUnpack();
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    // Repeat-wrapped, mipmapped texture, fenced so other contexts can tell when it is usable
+    void upload(const Request& request)
+    {
+        Upload result;
+        result.texture.slot = request.slot;
+
+        const AssetPackEntry* packed = pack && request.level < 0 ? pack->find(request.path, ASSET_TEXTURE) : nullptr;
+        if (request.level >= 0)
+            result.texture.texture = uploadStreamed(request, result.texture);
+        else if (isKtx2Path(request.path))
+            result.texture.texture = uploadCompressed(request);
+        else if (packed || cache || request.streamed)
+            result.texture.texture = uploadChain(request, packed, result.texture);
+        else
+            result.texture.texture = uploadDecoded(request);
+        if (!result.texture.texture && request.level < 0)
+            std::cerr << "Failed to load " << request.path << " texture!" << std::endl;
+
+        // The flush makes sure the fence reaches the GPU even if this context goes quiet
+        result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        std::lock_guard<std::mutex> lock(mutex);
+        uploaded.push_back(result);
+    }
+
+    // Decode straight into this upload's region of the unpack ring and build the mips on
+    // the GPU, or 0
+    GLuint uploadDecoded(const Request& request)
+    {
+        int width, height, channels;
+        if (!stbi_info(request.path.c_str(), &width, &height, &channels))
+            return 0;
+        const int decodeChannels = textureDecodeChannels(channels, request.category);
+        const TextureFormat format = chooseTextureFormat(decodeChannels, request.category, formats);
+        ImageDecodePlan plan = planImageDecode(width, height, request.maxSize);
+        std::size_t reserved = 0;
+        const int first = firstLevelInBudget(textureLevelCount(plan.width, plan.height), reserved, [&](int level)
+        {
+            return textureChainBytes(std::max(1, plan.width >> level), std::max(1, plan.height >> level), format.bytesPerTexel);
+        });
+        if (first < 0)
+            return 0;
+        if (first > 0)
+            plan = planImageDecode(width, height, std::max(1, std::max(plan.width, plan.height) >> first));
+
+        // JPEG output carries one spare byte, the target allows for it
+        const std::size_t bytes = static_cast<std::size_t>(plan.width) * plan.height * decodeChannels;
+        reserveUnpack(static_cast<GLsizeiptr>(bytes + 1));
+        unpackRing.beginFrame();
+        const RingAllocation staged = unpackRing.allocate(static_cast<GLsizeiptr>(bytes + 1), 4);
+
+        DecodeTarget target;
+        target.data = static_cast<unsigned char*>(staged.data);
+        target.capacity = bytes + 1;
+        target.expected = bytes;
+        unsigned char* pixels;
+        stbi_set_jpeg_scale_on_load_thread(plan.dctShift);
+        {
+            DecodeTargetScope scope(target);
+            pixels = stbi_load(request.path.c_str(), &width, &height, &channels, decodeChannels);
+        }
+        stbi_set_jpeg_scale_on_load_thread(0);
+
+        GLuint texture = 0;
+        if (pixels)
+        {
+            if (width != plan.width || height != plan.height)
+            {
+                // Finish what the decoder's scaling left over (all of it for non-JPEGs)
+                resampleImage(pixels, width, height, target.data, plan.width, plan.height, decodeChannels);
+                stbi_image_free(pixels);
+                width = plan.width;
+                height = plan.height;
+                ++decodedResampled;
+            }
+            else if (pixels == target.data)
+            {
+                ++decodedInPlace;
+            }
+            else
+            {
+                // The decoder chose its own output buffer (another format), copy it over
+                std::memcpy(target.data, pixels, bytes);
+                stbi_image_free(pixels);
+                ++decodedCopied;
+            }
+            unpackRing.flush(staged);
+
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            applyTextureFormat(format);
+            // Decoded rows are tightly packed, odd widths may not even be 2-byte aligned
+            glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(static_cast<std::size_t>(width) * decodeChannels,
+                                                               static_cast<std::uintptr_t>(staged.offset)));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staged.buffer);
+            glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, width, height, 0, format.format, GL_UNSIGNED_BYTE,
+                         reinterpret_cast<const void*>(staged.offset));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        commit(reserved, texture, request.category, textureChainBytes(width, height, format.bytesPerTexel));
+        // The region is reused once the texture has been sourced from it
+        unpackRing.endFrame();
+        return texture;
+    }
+
+    // All mip levels of a KTX2 file from the first that fits maxSize, or 0
+    GLuint uploadCompressed(const Request& request)
+    {
+        std::ifstream file(request.path, std::ios::binary);
+        Ktx2Texture ktx;
+        if (!file || !readKtx2(file, ktx))
+            return 0;
+        if (!glSupportsBlockFormat(ktx.format))
+        {
+            std::cerr << request.path << ": " << blockFormatName(ktx.format) << " textures are not supported by this context" << std::endl;
+            return 0;
+        }
+        const bool srgb = ktx.srgb && formats.srgb && request.category == TEXTURE_COLOR && glSupportsBlockFormat(ktx.format, true);
+        std::size_t maxSizeLevel = 0;
+        while (request.maxSize > 0 && maxSizeLevel + 1 < ktx.levels.size() &&
+               std::max(ktx.width >> maxSizeLevel, ktx.height >> maxSizeLevel) > request.maxSize)
+            ++maxSizeLevel;
+        std::size_t reserved = 0;
+        const int budgetLevel = firstLevelInBudget(static_cast<int>(ktx.levels.size() - maxSizeLevel), reserved, [&](int level)
+        {
+            std::size_t chain = 0;
+            for (std::size_t stored = maxSizeLevel + level; stored < ktx.levels.size(); ++stored)
+                chain += static_cast<std::size_t>(ktx.levels[stored].length);
+            return chain;
+        });
+        if (budgetLevel < 0)
+            return 0;
+        const std::size_t first = maxSizeLevel + static_cast<std::size_t>(budgetLevel);
+
+        // Levels go into one region back to back, each aligned to the block size
+        const std::size_t alignment = static_cast<std::size_t>(blockFormatBytes(ktx.format));
+        std::vector<std::size_t> offsets;
+        std::size_t bytes = 0;
+        for (std::size_t level = first; level < ktx.levels.size(); ++level)
+        {
+            bytes = (bytes + alignment - 1) / alignment * alignment;
+            offsets.push_back(bytes);
+            bytes += static_cast<std::size_t>(ktx.levels[level].length);
+        }
+        reserveUnpack(static_cast<GLsizeiptr>(bytes));
+        unpackRing.beginFrame();
+        const RingAllocation staged = unpackRing.allocate(static_cast<GLsizeiptr>(bytes), static_cast<GLsizeiptr>(alignment));
+        bool complete = true;
+        for (std::size_t level = first; level < ktx.levels.size() && complete; ++level)
+        {
+            file.seekg(static_cast<std::streamoff>(ktx.levels[level].offset));
+            complete = static_cast<bool>(file.read(static_cast<char*>(staged.data) + offsets[level - first],
+                                                   static_cast<std::streamsize>(ktx.levels[level].length)));
+        }
+
+        GLuint texture = 0;
+        if (complete)
+        {
+            unpackRing.flush(staged);
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(ktx.levels.size() - 1 - first));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staged.buffer);
+            for (std::size_t level = first; level < ktx.levels.size(); ++level)
+            {
+                const GLint mip = static_cast<GLint>(level - first);
+                glCompressedTexImage2D(GL_TEXTURE_2D, mip, blockFormatGlFormat(ktx.format, srgb),
+                                       std::max(1, ktx.width >> level), std::max(1, ktx.height >> level), 0,
+                                       static_cast<GLsizei>(ktx.levels[level].length),
+                                       reinterpret_cast<const void*>(staged.offset + offsets[level - first]));
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            ++uploadedCompressed;
+        }
+        commit(reserved, texture, request.category, bytes);
+        unpackRing.endFrame();
+        return texture;
+    }
+
+    // A texture from a decoded chain: the pack's entry, the cache entry for the file's content,
+    // or one decoded for it. The first level is the largest that fits maxSize, or the
+    // streaming base size; a streamed texture keeps the chain for restream().
+    GLuint uploadChain(const Request& request, const AssetPackEntry* packed, LoadedTexture& loaded)
+    {
+        std::unique_ptr<LevelSource> source(new LevelSource());
+        if (!(packed ? readPacked(*packed, *source) : readChain(request, *source)))
+            return 0;
+        const TextureCacheHeader& header = source->header;
+        const int largest = request.streamed ? TEXTURE_STREAM_BASE_SIZE : request.maxSize;
+        std::uint32_t first = 0;
+        while (largest > 0 && first + 1 < header.levelCount &&
+               std::max(header.levels[first].width, header.levels[first].height) > static_cast<std::uint32_t>(largest))
+            ++first;
+        const GLuint texture = uploadLevels(request, header, source->data, first);
+        if (texture && packed)
+            ++uploadedPacked;
+        if (texture && request.streamed)
+        {
+            describeStreamed(loaded, request, header, first);
+            source->category = request.category;
+            streamSources[request.slot] = std::move(source);
+        }
+        return texture;
+    }
+
+    // Levels of a streamed slot's chain from request.level on, or 0 if it has none
+    GLuint uploadStreamed(const Request& request, LoadedTexture& loaded)
+    {
+        auto found = streamSources.find(request.slot);
+        if (found == streamSources.end())
+            return 0;
+        const LevelSource& source = *found->second;
+        const std::uint32_t first = std::min(static_cast<std::uint32_t>(request.level), source.header.levelCount - 1);
+        Request levels = request;
+        levels.category = source.category;
+        const GLuint texture = uploadLevels(levels, source.header, source.data, first);
+        describeStreamed(loaded, levels, source.header, first);
+        if (texture)
+            ++uploadedStreamed;
+        return texture;
+    }
+
+    void describeStreamed(LoadedTexture& loaded, const Request& request, const TextureCacheHeader& header, std::uint32_t first)
+    {
+        loaded.level = static_cast<int>(first);
+        loaded.levelCount = static_cast<int>(header.levelCount);
+        loaded.width = static_cast<int>(header.width);
+        loaded.height = static_cast<int>(header.height);
+        loaded.bytesPerTexel = chooseTextureFormat(static_cast<int>(header.channels), request.category, formats).bytesPerTexel;
+    }
+
+    bool readPacked(const AssetPackEntry& entry, LevelSource& source)
+    {
+        source.data = pack->contents(entry, source.storage);
+        return source.data && readTextureCacheHeader(source.data, static_cast<std::size_t>(entry.bytes), source.header);
+    }
+
+    // The cache entry for the file's content, decoded and built first if there is none. The
+    // build is written to the cache when there is one and kept in memory otherwise.
+    bool readChain(const Request& request, LevelSource& source)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::ifstream file(request.path, std::ios::binary);
+        if (!file)
+            return false;
+        const std::vector<unsigned char> encoded((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        int width, height, channels;
+        const int encodedBytes = static_cast<int>(encoded.size());
+        if (!stbi_info_from_memory(encoded.data(), encodedBytes, &width, &height, &channels))
+            return false;
+        const int decodeChannels = textureDecodeChannels(channels, request.category);
+        const std::uint64_t key = cache ? cache->keyFor(encoded, request.maxSize, decodeChannels) : 0;
+        if (cache && cache->find(key, source.mapped, source.header))
+        {
+            source.data = source.mapped.data();
+            cache->recordHit(source.header, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            return true;
+        }
+        if (cache)
+            cache->recordMiss();
+
+        const ImageDecodePlan plan = planImageDecode(width, height, request.maxSize);
+        stbi_set_jpeg_scale_on_load_thread(plan.dctShift);
+        unsigned char* pixels = stbi_load_from_memory(encoded.data(), encodedBytes, &width, &height, &channels, decodeChannels);
+        stbi_set_jpeg_scale_on_load_thread(0);
+        if (!pixels)
+            return false;
+        source.storage = buildTextureCacheEntry(key, pixels, width, height, plan.width, plan.height, decodeChannels);
+        stbi_image_free(pixels);
+        if (cache && !cache->store(source.storage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()))
+            std::cerr << "Failed to cache " << request.path << " texture" << std::endl;
+        source.data = source.storage.data();
+        std::memcpy(&source.header, source.data, sizeof(source.header));
+        return true;
+    }
+
+    // Levels of a cache entry from `first` on, or from further down if those do not fit the
+    // budget (streamed textures are kept within theirs by the caller). Uploaded from client
+    // memory so a mapped entry is read in place.
+    GLuint uploadLevels(const Request& request, const TextureCacheHeader& header, const unsigned char* entry, std::uint32_t first = 0)
+    {
+        const TextureFormat format = chooseTextureFormat(static_cast<int>(header.channels), request.category, formats);
+        std::size_t reserved = 0;
+        const int budgetLevel = request.streamed ? 0 : firstLevelInBudget(static_cast<int>(header.levelCount - first), reserved, [&](int level)
+        {
+            const TextureCacheLevel& top = header.levels[first + level];
+            return textureChainBytes(static_cast<int>(top.width), static_cast<int>(top.height), format.bytesPerTexel);
+        });
+        if (budgetLevel < 0)
+            return 0;
+        first += static_cast<std::uint32_t>(budgetLevel);
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(header.levelCount - 1 - first));
+        applyTextureFormat(format);
+        for (std::uint32_t level = first; level < header.levelCount; ++level)
+        {
+            // Levels start on a cache line, only the row length decides the alignment
+            const TextureCacheLevel& stored = header.levels[level];
+            const unsigned char* pixels = entry + stored.offset;
+            glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(static_cast<std::size_t>(stored.width) * header.channels,
+                                                               reinterpret_cast<std::uintptr_t>(pixels)));
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level - first), format.internalFormat, static_cast<GLsizei>(stored.width),
+                         static_cast<GLsizei>(stored.height), 0, format.format, GL_UNSIGNED_BYTE, pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        const TextureCacheLevel& top = header.levels[first];
+        commit(reserved, texture, request.category, textureChainBytes(static_cast<int>(top.width), static_cast<int>(top.height), format.bytesPerTexel));
+        return texture;
+    }
+
+    // How many top levels of a `levelCount` chain to leave out so the rest fits the texture
+    // budget, where `chainBytes(level)` is the size from `level` down; -1 if nothing fits.
+    // The chosen size is reserved into `reserved`, which the upload then commit()s.
+    template <typename ChainBytes>
+    int firstLevelInBudget(int levelCount, std::size_t& reserved, ChainBytes chainBytes)
+    {
+        if (!memory)
+            return 0;
+        for (int level = 0; level < levelCount; ++level)
+        {
+            const std::size_t bytes = chainBytes(level);
+            if (!memory->reserve(bytes))
+                continue;
+            reserved = bytes;
+            if (level > 0)
+                ++memory->downsized;
+            return level;
+        }
+        ++memory->rejected;
+        return -1;
+    }
+
+    // Account `texture` against its reservation (none for streamed levels), or hand the
+    // reservation back if the upload failed
+    void commit(std::size_t reserved, GLuint texture, TextureCategory category, std::size_t bytes)
+    {
+        if (!memory)
+            return;
+        if (texture)
+            memory->commit(reserved, texture, category, bytes);
+        else
+            memory->cancel(reserved);
+    }
+
+    // Regions hold the largest image seen so far. A replaced ring's buffer stays alive in
+    // the driver until the uploads that read it are done.
+    void reserveUnpack(GLsizeiptr bytes)
+    {
+        if (bytes <= unpackBytes)
+            return;
+        releaseUnpack();
+        unpackRing.create(bytes);
+        unpackBytes = bytes;
+    }
+
+    void releaseUnpack()
+    {
+        if (unpackBytes == 0)
+            return;
+        unpackRing.destroy();
+        unpackBytes = 0;
+    }
+
+    GLFWwindow* context = nullptr;
+    TextureFormatOptions formats;
+    TextureMemory* memory = nullptr;
+    const AssetPack* pack = nullptr;
+    TextureCache* cache = nullptr;
+    FrameRing unpackRing;       // Pixel unpack staging, one region per upload in flight
+    GLsizeiptr unpackBytes = 0;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Request> requests;
+    std::vector<Upload> uploaded;
+    // Loading thread only
+    std::unordered_map<int, std::unique_ptr<LevelSource>> streamSources;
+    int pending = 0;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef TEXTURE_STREAMING_HPP
+#define TEXTURE_STREAMING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "texture_format.hpp"
+#include "texture_loader.hpp"
+
+// Mip-level streaming for textures queued with TextureLoader::stream(). They arrive holding
+// only their coarse levels; every frame the scene reports how many pixels each one covers
+// on screen, and the streamer asks the loader for a texture with the finest level that
+// footprint can show. When that would go over the budget, the least recently used textures
+// are cut back to their coarse levels first. New textures come back through the loader's
+// poll() like any other, so the render thread never waits on streaming.
+
+// Finest level of a texture `textureSize` texels across worth keeping when it covers
+// `screenPixels` pixels; finer levels would only be minified away
+inline int textureLevelForFootprint(int textureSize, int levelCount, float screenPixels)
+{
+    if (screenPixels <= 0.0f)
+        return levelCount - 1;
+    const float texelsPerPixel = static_cast<float>(textureSize) / screenPixels;
+    if (texelsPerPixel <= 1.0f)
+        return 0;
+    return std::min(levelCount - 1, static_cast<int>(std::floor(std::log2(texelsPerPixel))));
+}
+
+// Screen height in pixels of a sphere of `radius` at `distance`, projected as selectLod does
+inline float projectedPixels(float radius, float distance, float fovY, float viewportHeight)
+{
+    return 2.0f * radius * viewportHeight / (2.0f * std::tan(fovY * 0.5f) * std::max(distance, 1e-4f));
+}
+
+class TextureStreamer
+{
+public:
+    // Bytes all streamed textures may take together; 0 streams whatever the footprints ask for
+    void setBudget(std::size_t bytes)
+    {
+        budgetBytes = bytes;
+    }
+
+    // Render thread, for every texture TextureLoader::poll() returns; others than streamed
+    // ones are ignored
+    void adopt(const LoadedTexture& loaded)
+    {
+        if (loaded.slot < 0 || (loaded.levelCount == 0 && !known(loaded.slot)))
+            return;
+        Slot& slot = slotFor(loaded.slot);
+        slot.inFlight = false;
+        if (!loaded.texture)
+        {
+            // Keeps the levels it had
+            slot.planned = slot.resident;
+            return;
+        }
+        slot.width = loaded.width;
+        slot.height = loaded.height;
+        slot.levelCount = loaded.levelCount;
+        slot.bytesPerTexel = loaded.bytesPerTexel;
+        if (slot.resident < 0)
+            slot.base = loaded.level;
+        slot.resident = slot.planned = loaded.level;
+    }
+
+    // Render thread: the streamed texture in `slot` covers `screenPixels` pixels this frame.
+    // Several uses in one frame keep the largest.
+    void use(int slot, float screenPixels, std::uint64_t frame)
+    {
+        if (screenPixels <= 0.0f)
+            return;
+        Slot& used = slotFor(slot);
+        const int level = used.levelCount > 0
+            ? textureLevelForFootprint(std::max(used.width, used.height), used.levelCount, screenPixels) : 0;
+        used.wanted = usedIn(used, frame) ? std::min(used.wanted, level) : level;
+        used.lastUsed = frame + 1;
+    }
+
+    // Render thread, after this frame's use() calls: queue finer levels where they are
+    // wanted, evicting to make room. At most one request per texture is in flight.
+    void update(std::uint64_t frame, TextureLoader& loader)
+    {
+        for (std::size_t index = 0; index < slots.size(); ++index)
+        {
+            Slot& slot = slots[index];
+            if (slot.resident < 0 || slot.inFlight || !usedIn(slot, frame) || slot.wanted >= slot.planned)
+                continue;
+            int level = slot.wanted;
+            while (budgetBytes > 0 && planned() - bytes(slot, slot.planned) + bytes(slot, level) > budgetBytes)
+            {
+                if (Slot* victim = leastRecentlyUsed(frame))
+                {
+                    request(*victim, usedIn(*victim, frame) ? victim->wanted : victim->base, loader);
+                    ++evictions;
+                }
+                else if (++level >= slot.planned)
+                {
+                    // Not even one more level fits next to what is in use this frame
+                    ++deferred;
+                    break;
+                }
+            }
+            if (level < slot.planned)
+            {
+                request(slot, level, loader);
+                ++streamed;
+            }
+        }
+    }
+
+    // Bytes of the levels every streamed texture holds or has been asked for
+    std::size_t planned() const
+    {
+        std::size_t total = 0;
+        for (const Slot& slot : slots)
+            if (slot.planned >= 0)
+                total += bytes(slot, slot.planned);
+        return total;
+    }
+
+    void report(std::ostream& out) const
+    {
+        out << "texture streaming: " << streamed << " level requests, " << evictions << " evictions, " << deferred
+            << " deferred, " << planned() / 1024 << " KiB";
+        if (budgetBytes > 0)
+            out << " of " << budgetBytes / 1024 << " KiB budget";
+        out << std::endl;
+    }
+
+    int streamed = 0;  // Finer levels asked for
+    int evictions = 0; // Textures cut back to coarser levels to make room
+    int deferred = 0;  // Frames a texture wanted finer levels than would fit
+
+private:
+    struct Slot
+    {
+        int resident = -1;   // First level of the texture in use, -1 until the first arrives
+        int planned = -1;    // Same, or of the texture asked for while one is in flight
+        int base = 0;        // First level of the initial upload, where eviction goes back to
+        int wanted = 0;
+        int levelCount = 0;
+        int width = 0;
+        int height = 0;
+        int bytesPerTexel = 0;
+        std::uint64_t lastUsed = 0; // Frame of the last use plus one, 0 if never used
+        bool inFlight = false;
+    };
+
+    static bool usedIn(const Slot& slot, std::uint64_t frame)
+    {
+        return slot.lastUsed == frame + 1;
+    }
+
+    bool known(int slot) const
+    {
+        return static_cast<std::size_t>(slot) < slots.size() && slots[slot].resident >= 0;
+    }
+
+    Slot& slotFor(int slot)
+    {
+        if (static_cast<std::size_t>(slot) >= slots.size())
+            slots.resize(static_cast<std::size_t>(slot) + 1);
+        return slots[slot];
+    }
+
+    static std::size_t bytes(const Slot& slot, int level)
+    {
+        return textureChainBytes(std::max(1, slot.width >> level), std::max(1, slot.height >> level), slot.bytesPerTexel);
+    }
+
+    // Texture holding more than its base levels that was used longest ago, or failing that
+    // one used this frame that holds finer levels than it now needs
+    Slot* leastRecentlyUsed(std::uint64_t frame)
+    {
+        Slot* oldest = nullptr;
+        for (Slot& slot : slots)
+        {
+            if (slot.resident < 0 || slot.inFlight)
+                continue;
+            const bool evictable = usedIn(slot, frame) ? slot.planned < slot.wanted : slot.planned < slot.base;
+            if (evictable && (!oldest || slot.lastUsed < oldest->lastUsed))
+                oldest = &slot;
+        }
+        return oldest;
+    }
+
+    void request(Slot& slot, int level, TextureLoader& loader)
+    {
+        slot.planned = level;
+        slot.inFlight = true;
+        loader.restream(static_cast<int>(&slot - slots.data()), level);
+    }
+
+    std::vector<Slot> slots;
+    std::size_t budgetBytes = 0;
+};
+
+#endif
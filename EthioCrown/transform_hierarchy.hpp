@@ -0,0 +1,179 @@
+#ifndef TRANSFORM_HIERARCHY_HPP
+#define TRANSFORM_HIERARCHY_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "frame_ring.hpp"
+
+// Scene graph of local transforms with cached world matrices. Nodes are stored parent
+// before child in flat arrays, so one forward sweep over the dirty nodes refreshes whole
+// subtrees; a static scene costs nothing per frame.
+
+constexpr GLuint TRANSFORM_TEXTURE_UNIT = 2;
+
+// Nodes whose world matrix changed in the last update, [first, last) spans all of them
+struct TransformUpdate
+{
+    int first = 0;
+    int last = 0;
+    int count = 0;
+
+    bool empty() const { return count == 0; }
+};
+
+class TransformHierarchy
+{
+public:
+    // Parent must already exist (or be -1 for a root)
+    int addNode(int parent, const glm::mat4& local)
+    {
+        parents.push_back(parent);
+        locals.push_back(local);
+        worlds.push_back(glm::mat4(1.0f));
+        dirty.push_back(1);
+        updated.push_back(0);
+        ++dirtyCount;
+        return static_cast<int>(parents.size() - 1);
+    }
+
+    void setLocal(int node, const glm::mat4& local)
+    {
+        locals[node] = local;
+        if (!dirty[node])
+        {
+            dirty[node] = 1;
+            ++dirtyCount;
+        }
+    }
+
+    // Recompute dirty nodes and everything below them
+    TransformUpdate update()
+    {
+        for (int node : changedNodes)
+            updated[node] = 0;
+        changedNodes.clear();
+
+        TransformUpdate result;
+        if (dirtyCount == 0)
+            return result;
+
+        int firstDirty = 0;
+        while (!dirty[firstDirty])
+            ++firstDirty;
+        result.first = firstDirty;
+        for (int node = firstDirty; node < static_cast<int>(parents.size()); ++node)
+        {
+            const int parent = parents[node];
+            if (!dirty[node] && (parent < 0 || !updated[parent]))
+                continue;
+            worlds[node] = parent < 0 ? locals[node] : worlds[parent] * locals[node];
+            dirty[node] = 0;
+            updated[node] = 1;
+            changedNodes.push_back(node);
+            result.last = node + 1;
+        }
+        result.count = static_cast<int>(changedNodes.size());
+        dirtyCount = 0;
+        return result;
+    }
+
+    const glm::mat4& world(int node) const { return worlds[node]; }
+    const glm::mat4& local(int node) const { return locals[node]; }
+    const std::vector<glm::mat4>& worldMatrices() const { return worlds; }
+
+    // World matrix refreshed by the last update
+    bool changed(int node) const { return updated[node] != 0; }
+    const std::vector<int>& changedList() const { return changedNodes; }
+
+    int size() const { return static_cast<int>(parents.size()); }
+
+private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;       // Contiguous, uploaded as is
+    std::vector<std::uint8_t> dirty;     // Local changed since the last update
+    std::vector<std::uint8_t> updated;   // World changed in the last update
+    std::vector<int> changedNodes;
+    int dirtyCount = 0;
+};
+
+// World matrices in a texture buffer (four RGBA32F texels per matrix) so shaders fetch the
+// model by index; each update is published with a single sub-upload of the changed span
+class TransformBuffer
+{
+public:
+    void create(int capacity)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(capacity, 1) * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void upload(const TransformHierarchy& hierarchy, const TransformUpdate& changes)
+    {
+        if (changes.empty())
+            return;
+        upload(changes.first, &hierarchy.worldMatrices()[changes.first], changes.last - changes.first);
+    }
+
+    // `count` matrices starting at node `first`, e.g. a span copied out of the hierarchy
+    void upload(int first, const glm::mat4* matrices, int count)
+    {
+        if (count == 0)
+            return;
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(glm::mat4), count * sizeof(glm::mat4), glm::value_ptr(matrices[0]));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        ++uploads;
+    }
+
+    // Same, staged through a frame ring: the copy is queued on the GPU instead of the
+    // driver synchronising with draws that still read the buffer
+    void upload(int first, const glm::mat4* matrices, int count, FrameRing& ring)
+    {
+        if (count == 0)
+            return;
+        const RingAllocation staged = ring.write(glm::value_ptr(matrices[0]), count * sizeof(glm::mat4));
+        if (!staged)
+        {
+            upload(first, matrices, count);
+            return;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, staged.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staged.offset, first * sizeof(glm::mat4), staged.size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        ++uploads;
+    }
+
+    void bind() const
+    {
+        glActiveTexture(GL_TEXTURE0 + TRANSFORM_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void destroy()
+    {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &buffer);
+        texture = buffer = 0;
+    }
+
+    GLuint texture = 0;
+    int uploads = 0; // Sub-uploads issued so far
+private:
+    GLuint buffer = 0;
+};
+
+#endif
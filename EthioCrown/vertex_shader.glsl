@@ -5,12 +5,16 @@ layout(location = 1) in vec2 aTexCoord; // Texture coordinates
 out vec3 FragPos;  // Position for fragment shader
 out vec2 TexCoord; // Texture coordinates for fragment shader
 
-uniform mat4 model;
+uniform samplerBuffer transforms; // World matrices, four texels each
+uniform int transformIndex;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
+    int base = transformIndex * 4;
+    mat4 model = mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1),
+                      texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
     FragPos = vec3(model * vec4(aPos, 1.0));  // Transform vertex position
     TexCoord = aTexCoord; // Pass texture coordinates
     gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -0,0 +1,781 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "asset_pack.hpp"
+#include "image_scale.hpp"
+#include "mapped_file.hpp"
+#include "shader.hpp"
+
+// Sparse virtual texturing for images far larger than a texture can be. The image is
+// stored pre-tiled (.vtex): every mip level cut into square pages with a border for
+// filtering, each page LZ4 compressed when that pays. At run time a fixed-size page cache
+// texture holds the pages in use and a page table texture (one texel per page per level)
+// points every page at the finest resident page covering it, so a missing page falls back
+// to a coarser one. A low-resolution feedback pass renders which page each pixel wants;
+// its readback is read a few frames later without waiting, and the pages missing from it
+// are read and expanded on a background thread, coarse levels first. The render thread
+// uploads a few finished pages a frame, replacing the least recently used. Only GL 3.3 is
+// needed, so it also runs on Mesa llvmpipe.
+
+constexpr std::uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+constexpr char VIRTUAL_TEXTURE_MAGIC[8] = { 'E', 'C', 'V', 'T', 'E', 'X', '\r', '\n' };
+constexpr int VIRTUAL_TEXTURE_MAX_PAGES = 256;       // Per side at level 0; page coordinates are 8-bit
+constexpr std::size_t VIRTUAL_TEXTURE_ALIGNMENT = 64; // Page data starts on a cache line
+constexpr int VIRTUAL_TEXTURE_BORDER = 4;             // Texels repeated around each page for filtering
+constexpr int VIRTUAL_TEXTURE_UPLOADS_PER_FRAME = 8;
+constexpr int VIRTUAL_TEXTURE_MAX_PENDING = 32;      // Pages queued for or held by the tile loader
+constexpr int VIRTUAL_TEXTURE_FEEDBACK_DIVISOR = 8;  // Feedback is rendered at 1/8 of the screen per side
+constexpr int VIRTUAL_TEXTURE_FEEDBACK_BUFFERS = 3;  // Readbacks in flight
+constexpr GLuint VIRTUAL_PAGE_TABLE_UNIT = 3;        // After the transform buffer's unit
+constexpr GLuint VIRTUAL_PAGE_CACHE_UNIT = 4;
+
+struct VirtualTextureHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t width;      // Of the image, which fills pages from the bottom left
+    std::uint32_t height;
+    std::uint32_t tileSize;   // Texels per page side, not counting the border
+    std::uint32_t border;
+    std::uint32_t pagesX;     // At level 0, powers of two
+    std::uint32_t pagesY;
+    std::uint32_t levelCount; // Down to one page
+    std::uint32_t tileCount;
+    std::uint32_t reserved;
+};
+
+// One per page, level by level and row by row; followed in the file by the page data
+struct VirtualTextureTile
+{
+    std::uint64_t offset;
+    std::uint32_t storedBytes;
+    std::uint32_t compression; // AssetCompression
+};
+
+inline int virtualLevelPages(int pages, int level)
+{
+    return std::max(1, pages >> level);
+}
+
+inline int virtualLevelCount(int pagesX, int pagesY)
+{
+    int levels = 1;
+    while (std::max(pagesX, pagesY) >> (levels - 1) > 1)
+        ++levels;
+    return levels;
+}
+
+// Page x, y and level in the layout the feedback pass writes them: red, green, blue
+inline std::uint32_t virtualPageId(int x, int y, int level)
+{
+    return static_cast<std::uint32_t>(x) | static_cast<std::uint32_t>(y) << 8 | static_cast<std::uint32_t>(level) << 16;
+}
+
+inline int virtualPageX(std::uint32_t page) { return static_cast<int>(page & 0xff); }
+inline int virtualPageY(std::uint32_t page) { return static_cast<int>((page >> 8) & 0xff); }
+inline int virtualPageLevel(std::uint32_t page) { return static_cast<int>((page >> 16) & 0xff); }
+
+inline std::string virtualTexturePathFor(const std::string& path)
+{
+    const std::size_t dot = path.find_last_of('.');
+    const std::size_t slash = path.find_last_of("/\\");
+    const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    return (hasExtension ? path.substr(0, dot) : path) + ".vtex";
+}
+
+// Tile `rgba` (bottom row first, as the loader flips images) into `path`. Each level is
+// area-averaged from the one above; border texels wrap around like GL_REPEAT. Pages are
+// LZ4 compressed with `compress` when that saves at least an eighth. False if the image
+// needs more than VIRTUAL_TEXTURE_MAX_PAGES pages a side or the file cannot be written.
+inline bool writeVirtualTexture(const std::string& path, const unsigned char* rgba, int width, int height, int tileSize,
+                                int border, bool compress)
+{
+    if (width <= 0 || height <= 0 || tileSize <= 0 || border < 0 || 2 * border >= tileSize)
+        return false;
+    int pagesX = 1, pagesY = 1;
+    while (pagesX * tileSize < width)
+        pagesX *= 2;
+    while (pagesY * tileSize < height)
+        pagesY *= 2;
+    if (pagesX > VIRTUAL_TEXTURE_MAX_PAGES || pagesY > VIRTUAL_TEXTURE_MAX_PAGES)
+        return false;
+
+    VirtualTextureHeader header = {};
+    std::memcpy(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic));
+    header.version = VIRTUAL_TEXTURE_VERSION;
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.tileSize = static_cast<std::uint32_t>(tileSize);
+    header.border = static_cast<std::uint32_t>(border);
+    header.pagesX = static_cast<std::uint32_t>(pagesX);
+    header.pagesY = static_cast<std::uint32_t>(pagesY);
+    header.levelCount = static_cast<std::uint32_t>(virtualLevelCount(pagesX, pagesY));
+    for (std::uint32_t level = 0; level < header.levelCount; ++level)
+        header.tileCount += static_cast<std::uint32_t>(virtualLevelPages(pagesX, level) * virtualLevelPages(pagesY, level));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    std::vector<VirtualTextureTile> tiles(header.tileCount);
+    const std::size_t tableBytes = sizeof(header) + tiles.size() * sizeof(VirtualTextureTile);
+    std::uint64_t offset = (tableBytes + VIRTUAL_TEXTURE_ALIGNMENT - 1) / VIRTUAL_TEXTURE_ALIGNMENT * VIRTUAL_TEXTURE_ALIGNMENT;
+    const std::vector<char> padding(VIRTUAL_TEXTURE_ALIGNMENT, 0);
+    // The header and table go in front once the pages are placed
+    file.seekp(static_cast<std::streamoff>(offset));
+
+    const int padded = tileSize + 2 * border;
+    const std::size_t tileBytes = static_cast<std::size_t>(padded) * padded * 4;
+    std::vector<unsigned char> tile(tileBytes), packed(lz4::compressBound(tileBytes));
+    std::vector<unsigned char> levelPixels(rgba, rgba + static_cast<std::size_t>(width) * height * 4), smaller;
+    int levelWidth = width, levelHeight = height;
+    std::size_t index = 0;
+    for (std::uint32_t level = 0; level < header.levelCount; ++level)
+    {
+        if (level > 0)
+        {
+            const int nextWidth = std::max(1, width >> level), nextHeight = std::max(1, height >> level);
+            smaller.resize(static_cast<std::size_t>(nextWidth) * nextHeight * 4);
+            resampleImage(levelPixels.data(), levelWidth, levelHeight, smaller.data(), nextWidth, nextHeight, 4);
+            levelPixels.swap(smaller);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+        const int levelPagesX = virtualLevelPages(pagesX, level), levelPagesY = virtualLevelPages(pagesY, level);
+        for (int y = 0; y < levelPagesY; ++y)
+        {
+            for (int x = 0; x < levelPagesX; ++x, ++index)
+            {
+                // Texels past the image repeat it, so filtering across its edge wraps
+                for (int row = 0; row < padded; ++row)
+                {
+                    const int sourceY = ((y * tileSize + row - border) % levelHeight + levelHeight) % levelHeight;
+                    const unsigned char* sourceRow = levelPixels.data() + static_cast<std::size_t>(sourceY) * levelWidth * 4;
+                    unsigned char* out = tile.data() + static_cast<std::size_t>(row) * padded * 4;
+                    for (int column = 0; column < padded; ++column)
+                    {
+                        const int sourceX = ((x * tileSize + column - border) % levelWidth + levelWidth) % levelWidth;
+                        std::memcpy(out + column * 4, sourceRow + sourceX * 4, 4);
+                    }
+                }
+
+                VirtualTextureTile& entry = tiles[index];
+                entry.offset = offset;
+                const std::size_t packedBytes = compress ? lz4::compress(tile.data(), tileBytes, packed.data()) : tileBytes;
+                if (compress && packedBytes <= tileBytes - tileBytes / 8)
+                {
+                    entry.compression = ASSET_LZ4;
+                    entry.storedBytes = static_cast<std::uint32_t>(packedBytes);
+                    file.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packedBytes));
+                }
+                else
+                {
+                    entry.compression = ASSET_STORED;
+                    entry.storedBytes = static_cast<std::uint32_t>(tileBytes);
+                    file.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(tileBytes));
+                }
+                offset += entry.storedBytes;
+                const std::size_t align = static_cast<std::size_t>((VIRTUAL_TEXTURE_ALIGNMENT - offset % VIRTUAL_TEXTURE_ALIGNMENT) % VIRTUAL_TEXTURE_ALIGNMENT);
+                file.write(padding.data(), static_cast<std::streamsize>(align));
+                offset += align;
+            }
+        }
+    }
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size() * sizeof(VirtualTextureTile)));
+    return static_cast<bool>(file);
+}
+
+class VirtualTexture
+{
+public:
+    VirtualTexture() = default;
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+    ~VirtualTexture() { destroy(); }
+
+    // Map `path` and create the page table, a cache of `cacheSlots` x `cacheSlots` pages and
+    // the feedback target for a `screenWidth` x `screenHeight` screen. The feedback program
+    // is the scene's vertex shader with virtual_texture_feedback.glsl. The coarsest page is
+    // loaded here and never evicted, so every lookup finds something. False if the file
+    // cannot be used.
+    bool create(const std::string& path, int cacheSlots, int screenWidth, int screenHeight, ShaderSource feedbackVertex,
+                ShaderSource feedbackFragment, bool srgb = false)
+    {
+        if (!file.open(path) || !readHeader() || cacheSlots < 1 || cacheSlots > VIRTUAL_TEXTURE_MAX_PAGES)
+        {
+            file.close();
+            return false;
+        }
+        padded = static_cast<int>(header.tileSize + 2 * header.border);
+        tileBytes = static_cast<std::size_t>(padded) * padded * 4;
+        slotsPerSide = cacheSlots;
+        slots.assign(static_cast<std::size_t>(cacheSlots) * cacheSlots, Slot());
+
+        // Page table levels are mip levels of one texture, every texel starts at the root page
+        const int levels = static_cast<int>(header.levelCount);
+        const std::uint32_t root = virtualPageId(0, 0, levels - 1);
+        table.resize(levels);
+        tableDirty.assign(levels, true);
+        for (int level = 0; level < levels; ++level)
+            table[level].assign(static_cast<std::size_t>(levelPagesX(level)) * levelPagesY(level), tableEntry(0, levels - 1));
+        glGenTextures(1, &pageTable);
+        glBindTexture(GL_TEXTURE_2D, pageTable);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        for (int level = 0; level < levels; ++level)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelPagesX(level), levelPagesY(level), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         table[level].data());
+        tableDirty.assign(levels, false);
+
+        glGenTextures(1, &pageCache);
+        glBindTexture(GL_TEXTURE_2D, pageCache);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, cacheSlots * padded, cacheSlots * padded, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::vector<unsigned char> rootPixels(tileBytes);
+        if (!readTile(root, rootPixels))
+        {
+            destroy();
+            return false;
+        }
+        uploadPage(0, rootPixels.data());
+        slots[0].page = root;
+        slots[0].occupied = slots[0].pinned = true;
+        resident[root] = 0;
+
+        feedbackWidth = std::max(1, screenWidth / VIRTUAL_TEXTURE_FEEDBACK_DIVISOR);
+        feedbackHeight = std::max(1, screenHeight / VIRTUAL_TEXTURE_FEEDBACK_DIVISOR);
+        glGenRenderbuffers(2, feedbackBuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackBuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, feedbackWidth, feedbackHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackBuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+        glGenFramebuffers(1, &feedbackFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackBuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackBuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER::VIRTUAL_TEXTURE_FEEDBACK_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGenBuffers(VIRTUAL_TEXTURE_FEEDBACK_BUFFERS, readbackBuffers);
+        for (GLuint buffer : readbackBuffers)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(feedbackWidth) * feedbackHeight * 4, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        feedbackShader = new Shader(feedbackVertex, feedbackFragment);
+        feedbackShader->use();
+        setLayout(*feedbackShader);
+        // The feedback target is smaller than the screen, so its derivatives are larger
+        feedbackShader->setFloat("feedbackBias", std::log2(static_cast<float>(screenHeight) / feedbackHeight));
+
+        stopping = false;
+        thread = std::thread(&VirtualTexture::run, this);
+        return true;
+    }
+
+    bool isOpen() const { return feedbackShader != nullptr; }
+
+    // Bind the page table and cache to their units and point the sampling uniforms of the
+    // bound `shader` at them
+    void bind(const Shader& shader) const
+    {
+        glActiveTexture(GL_TEXTURE0 + VIRTUAL_PAGE_TABLE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, pageTable);
+        glActiveTexture(GL_TEXTURE0 + VIRTUAL_PAGE_CACHE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, pageCache);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("pageTable", static_cast<int>(VIRTUAL_PAGE_TABLE_UNIT));
+        shader.setInt("pageCache", static_cast<int>(VIRTUAL_PAGE_CACHE_UNIT));
+        setLayout(shader);
+    }
+
+    // Render which page every pixel of the `draw(Shader&)` geometry wants into the feedback
+    // target and start reading it back; skipped while every readback is still in flight.
+    // The framebuffer, viewport and clear colour are left as they were.
+    template <typename Draw>
+    void renderFeedback(const glm::mat4& view, const glm::mat4& projection, Draw draw)
+    {
+        int buffer = 0;
+        while (buffer < VIRTUAL_TEXTURE_FEEDBACK_BUFFERS && readbackFences[buffer])
+            ++buffer;
+        if (buffer == VIRTUAL_TEXTURE_FEEDBACK_BUFFERS)
+        {
+            ++feedbackSkipped;
+            return;
+        }
+        GLint framebuffer, viewport[4];
+        GLfloat clearColor[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+        glViewport(0, 0, feedbackWidth, feedbackHeight);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        feedbackShader->use();
+        feedbackShader->setMat4("view", view);
+        feedbackShader->setMat4("projection", projection);
+        draw(*feedbackShader);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[buffer]);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbackFences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    }
+
+    // Once per frame, never blocks: request the pages finished readbacks asked for, upload
+    // pages the loader has expanded and update the page table
+    void update(std::uint64_t frame)
+    {
+        for (int buffer = 0; buffer < VIRTUAL_TEXTURE_FEEDBACK_BUFFERS; ++buffer)
+        {
+            if (!readbackFences[buffer])
+                continue;
+            const GLenum status = glClientWaitSync(readbackFences[buffer], 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+            glDeleteSync(readbackFences[buffer]);
+            readbackFences[buffer] = 0;
+            readFeedback(readbackBuffers[buffer]);
+        }
+        if (!wanted.empty())
+            requestPages(frame);
+        uploadPages();
+        for (std::size_t level = 0; level < table.size(); ++level)
+        {
+            if (!tableDirty[level])
+                continue;
+            glBindTexture(GL_TEXTURE_2D, pageTable);
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levelPagesX(static_cast<int>(level)),
+                            levelPagesY(static_cast<int>(level)), GL_RGBA, GL_UNSIGNED_BYTE, table[level].data());
+            tableDirty[level] = false;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Stops the tile loader; the GL objects need the context that created them
+    void destroy()
+    {
+        if (thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+        if (feedbackShader)
+        {
+            glDeleteProgram(feedbackShader->ID);
+            delete feedbackShader;
+            feedbackShader = nullptr;
+        }
+        for (GLsync& fence : readbackFences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+            fence = 0;
+        }
+        if (pageTable)
+        {
+            glDeleteTextures(1, &pageTable);
+            glDeleteTextures(1, &pageCache);
+            glDeleteFramebuffers(1, &feedbackFBO);
+            glDeleteRenderbuffers(2, feedbackBuffers);
+            glDeleteBuffers(VIRTUAL_TEXTURE_FEEDBACK_BUFFERS, readbackBuffers);
+            pageTable = pageCache = feedbackFBO = 0;
+        }
+        requests.clear();
+        finished.clear();
+        pending.clear();
+        resident.clear();
+        file.close();
+    }
+
+    // Pages the cache holds against its size, and the GPU memory it all takes
+    void report(std::ostream& out) const
+    {
+        std::size_t tableBytes = 0;
+        for (const std::vector<std::uint32_t>& level : table)
+            tableBytes += level.size() * 4;
+        out << "virtual texture: " << header.width << "x" << header.height << " in " << header.tileCount << " pages, "
+            << resident.size() << "/" << slots.size() << " cached, " << requested << " requested, " << loaded << " loaded, "
+            << evicted << " evicted, " << dropped << " dropped, " << feedbackSkipped << " feedback skipped, "
+            << (slots.size() * tileBytes + tableBytes) / 1024 << " KiB" << std::endl;
+    }
+
+    int requested = 0;       // Pages sent to the tile loader
+    int loaded = 0;          // Pages uploaded to the cache
+    int evicted = 0;         // Least recently used pages replaced
+    int dropped = 0;         // Loaded pages with no slot to go to, asked for again if still wanted
+    int feedbackSkipped = 0; // Frames with every readback still in flight
+
+private:
+    struct Slot
+    {
+        std::uint32_t page = 0;
+        std::uint64_t lastUsed = 0; // Frame of the last feedback wanting it plus one, 0 if never
+        bool occupied = false;
+        bool pinned = false;
+    };
+
+    struct Tile
+    {
+        std::uint32_t page = 0;
+        bool complete = false;
+        std::vector<unsigned char> pixels;
+    };
+
+    bool readHeader()
+    {
+        if (file.size() < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != VIRTUAL_TEXTURE_VERSION ||
+            header.tileSize == 0 || header.tileSize > 4096 || 2 * header.border >= header.tileSize || header.pagesX == 0 || header.pagesY == 0 ||
+            header.pagesX > VIRTUAL_TEXTURE_MAX_PAGES || header.pagesY > VIRTUAL_TEXTURE_MAX_PAGES ||
+            (header.pagesX & (header.pagesX - 1)) != 0 || (header.pagesY & (header.pagesY - 1)) != 0 ||
+            header.levelCount != static_cast<std::uint32_t>(virtualLevelCount(header.pagesX, header.pagesY)))
+            return false;
+        std::uint32_t tileCount = 0;
+        levelFirstTile.clear();
+        for (std::uint32_t level = 0; level < header.levelCount; ++level)
+        {
+            levelFirstTile.push_back(tileCount);
+            tileCount += static_cast<std::uint32_t>(levelPagesX(level) * levelPagesY(level));
+        }
+        if (tileCount != header.tileCount || (file.size() - sizeof(header)) / sizeof(VirtualTextureTile) < tileCount)
+            return false;
+        tiles.resize(tileCount);
+        std::memcpy(tiles.data(), file.data() + sizeof(header), tiles.size() * sizeof(VirtualTextureTile));
+        const std::size_t bytes = static_cast<std::size_t>(header.tileSize + 2 * header.border) * (header.tileSize + 2 * header.border) * 4;
+        for (const VirtualTextureTile& tile : tiles)
+            if (tile.offset > file.size() || tile.storedBytes > file.size() - tile.offset ||
+                !(tile.compression == ASSET_LZ4 || (tile.compression == ASSET_STORED && tile.storedBytes == bytes)))
+                return false;
+        return true;
+    }
+
+    int levelPagesX(int level) const { return virtualLevelPages(static_cast<int>(header.pagesX), level); }
+    int levelPagesY(int level) const { return virtualLevelPages(static_cast<int>(header.pagesY), level); }
+
+    // Tile loader thread (and create()); the mapping and tile table do not change
+    bool readTile(std::uint32_t page, std::vector<unsigned char>& pixels) const
+    {
+        const int level = virtualPageLevel(page);
+        if (level >= static_cast<int>(header.levelCount) || virtualPageX(page) >= levelPagesX(level) || virtualPageY(page) >= levelPagesY(level))
+            return false;
+        const VirtualTextureTile& tile = tiles[levelFirstTile[level] + virtualPageY(page) * levelPagesX(level) + virtualPageX(page)];
+        const unsigned char* stored = file.data() + tile.offset;
+        pixels.resize(tileBytes);
+        if (tile.compression == ASSET_STORED)
+        {
+            std::memcpy(pixels.data(), stored, tileBytes);
+            return true;
+        }
+        return lz4::decompress(stored, tile.storedBytes, pixels.data(), tileBytes);
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            Tile tile;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping)
+                    break;
+                tile.page = requests.front();
+                requests.pop_front();
+                if (!spare.empty())
+                {
+                    tile.pixels = std::move(spare.back());
+                    spare.pop_back();
+                }
+            }
+            tile.complete = readTile(tile.page, tile.pixels);
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(tile));
+        }
+    }
+
+    void readFeedback(GLuint buffer)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        const std::size_t pixels = static_cast<std::size_t>(feedbackWidth) * feedbackHeight;
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(pixels * 4), GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            const unsigned char* texel = static_cast<const unsigned char*>(mapped);
+            std::uint32_t previous = 0xffffffffu;
+            for (std::size_t i = 0; i < pixels; ++i, texel += 4)
+            {
+                // Neighbouring pixels mostly want the same page
+                const std::uint32_t page = virtualPageId(texel[0], texel[1], texel[2]);
+                if (texel[3] != 0 && page != previous)
+                    wanted.push_back(page);
+                previous = texel[3] != 0 ? page : previous;
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Mark wanted pages and their ancestors used, queue the missing ones coarse first
+    void requestPages(std::uint64_t frame)
+    {
+        std::sort(wanted.begin(), wanted.end());
+        wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+        missing.clear();
+        feedbackFrame = frame + 1;
+        const int top = static_cast<int>(header.levelCount) - 1;
+        for (std::uint32_t page : wanted)
+        {
+            for (;;)
+            {
+                const int level = virtualPageLevel(page);
+                if (level > top)
+                    break;
+                auto found = resident.find(page);
+                if (found != resident.end())
+                {
+                    // Its ancestors were marked with it
+                    if (slots[found->second].lastUsed == feedbackFrame)
+                        break;
+                    slots[found->second].lastUsed = feedbackFrame;
+                }
+                else if (!pending.count(page))
+                {
+                    missing.push_back(page);
+                }
+                if (level == top)
+                    break;
+                page = virtualPageId(virtualPageX(page) * levelPagesX(level + 1) / levelPagesX(level),
+                                     virtualPageY(page) * levelPagesY(level + 1) / levelPagesY(level), level + 1);
+            }
+        }
+        wanted.clear();
+        std::sort(missing.begin(), missing.end(), [](std::uint32_t a, std::uint32_t b)
+        {
+            return virtualPageLevel(a) != virtualPageLevel(b) ? virtualPageLevel(a) > virtualPageLevel(b) : a < b;
+        });
+        missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+        // Only as many as there are slots to put them in; the finest pages go without when the
+        // cache cannot hold everything in view
+        std::size_t room = 0;
+        for (const Slot& slot : slots)
+            if (!slot.occupied || (!slot.pinned && slot.lastUsed != feedbackFrame))
+                ++room;
+        room = std::min<std::size_t>(room, VIRTUAL_TEXTURE_MAX_PENDING);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::uint32_t page : missing)
+            {
+                if (pending.size() >= room)
+                    break;
+                pending.insert(page);
+                requests.push_back(page);
+                ++requested;
+            }
+        }
+        wake.notify_one();
+    }
+
+    void uploadPages()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::size_t count = std::min<std::size_t>(finished.size(), VIRTUAL_TEXTURE_UPLOADS_PER_FRAME);
+            arrived.clear();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                arrived.push_back(std::move(finished.front()));
+                finished.pop_front();
+            }
+        }
+        for (Tile& tile : arrived)
+        {
+            pending.erase(tile.page);
+            if (!tile.complete || resident.count(tile.page))
+                continue;
+            const int slot = replaceableSlot();
+            if (slot < 0)
+            {
+                ++dropped;
+                continue;
+            }
+            if (slots[slot].occupied)
+            {
+                unmapPage(slots[slot].page, slot);
+                ++evicted;
+            }
+            uploadPage(slot, tile.pixels.data());
+            slots[slot].page = tile.page;
+            slots[slot].occupied = true;
+            slots[slot].lastUsed = feedbackFrame;
+            mapPage(tile.page, slot);
+            ++loaded;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Tile& tile : arrived)
+            spare.push_back(std::move(tile.pixels));
+    }
+
+    // An empty slot, else the least recently used one the latest feedback did not want; -1 if none
+    int replaceableSlot() const
+    {
+        int oldest = -1;
+        for (std::size_t slot = 0; slot < slots.size(); ++slot)
+        {
+            if (!slots[slot].occupied)
+                return static_cast<int>(slot);
+            if (slots[slot].pinned || slots[slot].lastUsed == feedbackFrame)
+                continue;
+            if (oldest < 0 || slots[slot].lastUsed < slots[oldest].lastUsed)
+                oldest = static_cast<int>(slot);
+        }
+        return oldest;
+    }
+
+    void uploadPage(int slot, const unsigned char* pixels)
+    {
+        glBindTexture(GL_TEXTURE_2D, pageCache);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % slotsPerSide) * padded, (slot / slotsPerSide) * padded, padded, padded, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    std::uint32_t tableEntry(int slot, int level) const
+    {
+        return static_cast<std::uint32_t>(slot % slotsPerSide) | static_cast<std::uint32_t>(slot / slotsPerSide) << 8 |
+               static_cast<std::uint32_t>(level) << 16 | 0xff000000u;
+    }
+
+    // Calls `visit(level, entry)` for the page table entries of `page`'s level and every
+    // finer level that it covers
+    template <typename Visit>
+    void forEachCovered(std::uint32_t page, Visit visit)
+    {
+        const int pageLevel = virtualPageLevel(page);
+        for (int level = pageLevel; level >= 0; --level)
+        {
+            const int scaleX = levelPagesX(level) / levelPagesX(pageLevel), scaleY = levelPagesY(level) / levelPagesY(pageLevel);
+            const int width = levelPagesX(level);
+            for (int y = virtualPageY(page) * scaleY; y < (virtualPageY(page) + 1) * scaleY; ++y)
+                for (int x = virtualPageX(page) * scaleX; x < (virtualPageX(page) + 1) * scaleX; ++x)
+                    visit(level, table[level][static_cast<std::size_t>(y) * width + x]);
+            tableDirty[level] = true;
+        }
+    }
+
+    // Entries that fell back to something coarser than `page` now point at it
+    void mapPage(std::uint32_t page, int slot)
+    {
+        resident[page] = slot;
+        const std::uint32_t level = static_cast<std::uint32_t>(virtualPageLevel(page));
+        const std::uint32_t entry = tableEntry(slot, static_cast<int>(level));
+        forEachCovered(page, [&](int, std::uint32_t& covered)
+        {
+            if (((covered >> 16) & 0xff) > level)
+                covered = entry;
+        });
+    }
+
+    // Entries that pointed at `page` fall back to whatever its parent's entry points at
+    void unmapPage(std::uint32_t page, int slot)
+    {
+        resident.erase(page);
+        const int level = virtualPageLevel(page);
+        const std::uint32_t entry = tableEntry(slot, level);
+        const int parentX = virtualPageX(page) * levelPagesX(level + 1) / levelPagesX(level);
+        const int parentY = virtualPageY(page) * levelPagesY(level + 1) / levelPagesY(level);
+        const std::uint32_t fallback = table[level + 1][static_cast<std::size_t>(parentY) * levelPagesX(level + 1) + parentX];
+        forEachCovered(page, [&](int, std::uint32_t& covered)
+        {
+            if (covered == entry)
+                covered = fallback;
+        });
+    }
+
+    void setLayout(const Shader& shader) const
+    {
+        shader.setVec4("virtualPages", glm::vec4(static_cast<float>(header.pagesX), static_cast<float>(header.pagesY),
+                                                 static_cast<float>(header.levelCount), static_cast<float>(header.tileSize)));
+        shader.setVec4("virtualExtent", glm::vec4(static_cast<float>(header.width) / (header.pagesX * header.tileSize),
+                                                  static_cast<float>(header.height) / (header.pagesY * header.tileSize), 0.0f, 0.0f));
+        shader.setVec4("pageCacheLayout", glm::vec4(static_cast<float>(header.border), static_cast<float>(padded),
+                                                    static_cast<float>(slotsPerSide * padded), static_cast<float>(slotsPerSide * padded)));
+    }
+
+    MappedFile file;
+    VirtualTextureHeader header = {};
+    std::vector<VirtualTextureTile> tiles;
+    std::vector<std::uint32_t> levelFirstTile;
+    int padded = 0;
+    std::size_t tileBytes = 0;
+
+    // Render thread
+    GLuint pageTable = 0;
+    GLuint pageCache = 0;
+    int slotsPerSide = 0;
+    std::vector<Slot> slots;
+    std::unordered_map<std::uint32_t, int> resident;      // Page to slot
+    std::vector<std::vector<std::uint32_t>> table;         // Page table levels as uploaded
+    std::vector<bool> tableDirty;
+    std::unordered_set<std::uint32_t> pending;             // Requested, not uploaded yet
+    std::vector<std::uint32_t> wanted, missing;
+    std::vector<Tile> arrived;
+    std::uint64_t feedbackFrame = 0;                       // Frame of the latest feedback plus one
+    Shader* feedbackShader = nullptr;
+    GLuint feedbackFBO = 0;
+    GLuint feedbackBuffers[2] = {};
+    GLuint readbackBuffers[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {};
+    GLsync readbackFences[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {};
+    int feedbackWidth = 0;
+    int feedbackHeight = 0;
+
+    // Shared with the tile loader thread
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::uint32_t> requests;
+    std::deque<Tile> finished;
+    std::vector<std::vector<unsigned char>> spare;
+    bool stopping = false;
+};
+
+#endif
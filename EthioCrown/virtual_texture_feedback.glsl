@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec2 TexCoord;
+
+// Same layout as fragment_shader.glsl
+uniform vec4 virtualPages;  // Pages across and down at level 0, level count, tile size
+uniform vec4 virtualExtent; // Part of the level 0 pages the image covers
+uniform float feedbackBias; // log2 of how much smaller this target is than the screen
+
+// The page and level sampleVirtualTexture would want here, as red, green and blue bytes;
+// cleared pixels keep alpha 0
+void main()
+{
+    vec2 texels = TexCoord * virtualExtent.xy * virtualPages.xy * virtualPages.w;
+    float lod = log2(max(length(dFdx(texels)), length(dFdy(texels)))) - feedbackBias;
+    int level = int(clamp(floor(lod), 0.0, virtualPages.z - 1.0));
+    vec2 pages = max(floor(virtualPages.xy / exp2(float(level))), vec2(1.0));
+    vec2 page = min(floor(fract(TexCoord) * virtualExtent.xy * pages), pages - 1.0);
+    FragColor = vec4(page, float(level), 255.0) / 255.0;
+}